@@ -7,6 +7,7 @@
 #include "../network/https_client.hpp"
 #include "../nlohmann/json.hpp"
 #include "../tools/logging.hpp"
+#include "../tools/tracing.hpp"
 
 class SettingsLoadException final : public std::runtime_error {
 public:
@@ -59,6 +60,7 @@ public:
 
 private:
     void initializeSettings() {
+        Span span("config.read");
         try {
             const auto settings = Settings::createInstance();
             _host = settings->get<std::string>("public_api");
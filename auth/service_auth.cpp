@@ -0,0 +1,190 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "service_auth.hpp"
+#include <mutex>
+#include "../tools/base64.hpp"
+#include "../tools/logging.hpp"
+
+ServiceAuth::ServiceAuth(std::string audience, KeyResolver resolver, const Options options)
+    : audience(std::move(audience)), resolver(std::move(resolver)), options(options) {}
+
+std::optional<std::string_view> ServiceAuth::bearerToken(const std::string_view authorization) {
+    static constexpr std::string_view PREFIX = "Bearer ";
+    if (authorization.size() <= PREFIX.size() || authorization.substr(0, PREFIX.size()) != PREFIX) {
+        return std::nullopt;
+    }
+    return authorization.substr(PREFIX.size());
+}
+
+std::optional<std::string> ServiceAuth::verify(const std::string_view token, const std::string_view method,
+                                               const Clock::time_point now) {
+    {
+        std::shared_lock lock(tokensMutex);
+        if (const auto it = tokens.find(std::string(token)); it != tokens.end()) {
+            const auto& memo = it->second;
+            if (now < memo.expires && (memo.method.empty() || memo.method == method)) {
+                ++hits;
+                return memo.issuer;
+            }
+            if (now < memo.expires) {
+                return std::nullopt; // Valid token, but for another method
+            }
+        }
+    }
+
+    const auto firstDot = token.find('.');
+    const auto secondDot = firstDot == std::string_view::npos ? firstDot : token.find('.', firstDot + 1);
+    if (secondDot == std::string_view::npos) {
+        return std::nullopt;
+    }
+    const auto header = Base64::decodeUrl(token.substr(0, firstDot));
+    const auto payload = Base64::decodeUrl(token.substr(firstDot + 1, secondDot - firstDot - 1));
+    const auto signature = Base64::decodeUrl(token.substr(secondDot + 1));
+    if (!header || !payload || !signature) {
+        return std::nullopt;
+    }
+
+    MemoizedToken entry;
+    std::string algorithm;
+    try {
+        const auto headerJson = nlohmann::json::parse(*header);
+        const auto claims = nlohmann::json::parse(*payload);
+        algorithm = headerJson.value("alg", "");
+        entry.issuer = claims.value("iss", "");
+        entry.method = claims.value("lxm", "");
+        entry.expires = Clock::time_point(std::chrono::seconds(claims.value("exp", int64_t{0})));
+        if (claims.value("aud", "") != audience) {
+            return std::nullopt;
+        }
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+
+    if (entry.expires + options.clockSkew <= now || (!entry.method.empty() && entry.method != method)) {
+        return std::nullopt;
+    }
+
+    // Labelers and other services sign as "<did>#<service id>"; the key belongs to the DID
+    const auto did = entry.issuer.substr(0, entry.issuer.find('#'));
+    const auto resolvable = did.rfind("did:plc:", 0) == 0 || did.rfind("did:web:", 0) == 0;
+    if (!resolvable && did.rfind("did:key:", 0) != 0) {
+        return std::nullopt;
+    }
+    if (algorithm != "ES256K" && algorithm != "ES256") {
+        return std::nullopt;
+    }
+
+    const auto signingInput = token.substr(0, secondDot);
+    auto key = keyFor(did, now, false);
+    auto valid = key && key->jwtAlgorithm() == algorithm && key->verify(signingInput, *signature);
+    if (!valid) {
+        // The issuer may have rotated keys since we cached theirs
+        key = keyFor(did, now, true);
+        valid = key && key->jwtAlgorithm() == algorithm && key->verify(signingInput, *signature);
+    }
+    if (!valid) {
+        Logging::debug("Rejected service auth token from " + entry.issuer, false);
+        return std::nullopt;
+    }
+
+    entry.issuer = did;
+    memoize(token, entry, now);
+    return did;
+}
+
+std::optional<SigningKey> ServiceAuth::keyFor(const std::string& did, const Clock::time_point now, const bool refresh) {
+    if (did.rfind("did:key:", 0) == 0) {
+        return refresh ? std::nullopt : SigningKey::fromDidKey(did);
+    }
+
+    auto known = false;
+    {
+        std::shared_lock lock(keysMutex);
+        if (const auto it = keys.find(did); it != keys.end()) {
+            const auto age = now - it->second.fetched;
+            const auto fresh = age < options.keyTtl && !(refresh && age >= KEY_REFRESH_AFTER);
+            if (fresh) {
+                return refresh ? std::nullopt : it->second.key;
+            }
+            known = true;
+        }
+    }
+
+    // Resolve outside the lock; concurrent misses for one DID are collapsed by the resolver
+    ++resolutions;
+    const auto multibase = resolver ? resolver(did, refresh || known) : std::nullopt;
+    CachedKey cached{multibase ? SigningKey::fromMultibase(*multibase) : std::nullopt, now};
+    storeKey(did, cached, now);
+    return cached.key;
+}
+
+void ServiceAuth::storeKey(const std::string& did, CachedKey cached, const Clock::time_point now) {
+    std::unique_lock lock(keysMutex);
+    if (keys.size() >= options.maxCachedKeys && keys.find(did) == keys.end()) {
+        for (auto it = keys.begin(); it != keys.end();) {
+            it = now - it->second.fetched >= options.keyTtl ? keys.erase(it) : std::next(it);
+        }
+        // Still full of live keys: drop an arbitrary tenth rather than growing without bound
+        const auto target = options.maxCachedKeys - options.maxCachedKeys / 10;
+        for (auto it = keys.begin(); keys.size() >= target && it != keys.end();) {
+            it = keys.erase(it);
+        }
+    }
+    keys[did] = std::move(cached);
+}
+
+size_t ServiceAuth::cachedKeys() {
+    std::shared_lock lock(keysMutex);
+    return keys.size();
+}
+
+void ServiceAuth::invalidate(const std::string& did) {
+    std::unique_lock lock(keysMutex);
+    keys.erase(did);
+}
+
+void ServiceAuth::memoize(const std::string_view token, MemoizedToken entry, const Clock::time_point now) {
+    std::unique_lock lock(tokensMutex);
+    if (tokens.size() >= options.maxMemoizedTokens) {
+        for (auto it = tokens.begin(); it != tokens.end();) {
+            it = it->second.expires <= now ? tokens.erase(it) : std::next(it);
+        }
+        if (tokens.size() >= options.maxMemoizedTokens) {
+            tokens.clear();
+        }
+    }
+    tokens.emplace(std::string(token), std::move(entry));
+}
+
+std::string ServiceAuth::createToken(const SigningKey& key, const std::string& issuer, const std::string& audience,
+                                     const std::string& method, const std::chrono::seconds lifetime) {
+    const auto now = std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count();
+    const nlohmann::json header = {{"alg", key.jwtAlgorithm()}, {"typ", "JWT"}};
+    nlohmann::json claims = {{"iss", issuer}, {"aud", audience}, {"iat", now}, {"exp", now + lifetime.count()}};
+    if (!method.empty()) {
+        claims["lxm"] = method;
+    }
+
+    const auto signingInput = Base64::encodeUrl(header.dump()) + "." + Base64::encodeUrl(claims.dump());
+    return signingInput + "." + Base64::encodeUrl(key.sign(signingInput));
+}
+
+std::optional<std::string> ServiceAuth::signingKeyFromDocument(const nlohmann::json& document) {
+    if (!document.is_object()) {
+        return std::nullopt;
+    }
+    const auto id = document.value("id", "");
+    for (const auto& method : document.value("verificationMethod", nlohmann::json::array())) {
+        const auto methodId = method.value("id", "");
+        if (methodId == "#atproto" || methodId == id + "#atproto") {
+            const auto multibase = method.value("publicKeyMultibase", "");
+            if (!multibase.empty()) {
+                return multibase;
+            }
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,101 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef SERVICE_AUTH_H
+#define SERVICE_AUTH_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "signing_key.hpp"
+#include "../nlohmann/json.hpp"
+
+// Verifies the inter-service JWTs that an AppView attaches to feed requests on behalf of a viewer.
+//
+// A token is checked for audience, expiry and method (lxm), then its ES256K/ES256 signature is
+// verified against the issuer's #atproto signing key. Keys are decoded once and cached per DID for
+// keyTtl, up to maxCachedKeys DIDs, failed lookups included; did:key issuers carry their key in the DID
+// itself. Only did:plc and did:web issuers are resolved, and only for a supported algorithm, since the
+// issuer is read before the signature can be checked. Successful results are memoized per token until
+// it expires, so repeat requests from the same session cost a single hash lookup.
+class ServiceAuth {
+public:
+    using Clock = std::chrono::system_clock;
+
+    // Returns the publicKeyMultibase of a DID's #atproto verification method. refresh is set when a key
+    // fetched earlier expired or failed to verify a token, so the resolver should bypass its own caches.
+    using KeyResolver = std::function<std::optional<std::string>(const std::string& did, bool refresh)>;
+
+    struct Options {
+        std::chrono::seconds keyTtl{3600};
+        std::chrono::seconds clockSkew{30};
+        size_t maxMemoizedTokens = 100'000;
+        size_t maxCachedKeys = 100'000;
+    };
+
+    ServiceAuth(std::string audience, KeyResolver resolver, Options options);
+    ServiceAuth(std::string audience, KeyResolver resolver) : ServiceAuth(std::move(audience), std::move(resolver), Options{}) {}
+
+    // The issuer DID of a valid token for this service and method (e.g. "app.bsky.feed.getFeedSkeleton")
+    [[nodiscard]] std::optional<std::string> verify(std::string_view token, std::string_view method,
+                                                    Clock::time_point now = Clock::now());
+
+    // Forget a DID's cached key, e.g. after an identity event announced a key rotation
+    void invalidate(const std::string& did);
+
+    [[nodiscard]] uint64_t memoHits() const { return hits; }
+    [[nodiscard]] uint64_t keyResolutions() const { return resolutions; }
+    [[nodiscard]] size_t cachedKeys();
+
+    // The token from an "Authorization: Bearer <token>" header
+    static std::optional<std::string_view> bearerToken(std::string_view authorization);
+
+    // Mint a token, e.g. for tests or the load generator with did:key issuers
+    static std::string createToken(const SigningKey& key, const std::string& issuer, const std::string& audience,
+                                   const std::string& method, std::chrono::seconds lifetime);
+
+    // The #atproto signing key from a DID document
+    static std::optional<std::string> signingKeyFromDocument(const nlohmann::json& document);
+
+private:
+    static constexpr std::chrono::seconds KEY_REFRESH_AFTER{60}; // Minimum key age before a failed check refetches it
+
+    struct CachedKey {
+        std::optional<SigningKey> key;
+        Clock::time_point fetched;
+    };
+
+    struct MemoizedToken {
+        std::string issuer;
+        std::string method;
+        Clock::time_point expires;
+    };
+
+    std::string audience;
+    KeyResolver resolver;
+    Options options;
+
+    std::shared_mutex keysMutex;
+    std::unordered_map<std::string, CachedKey> keys;
+
+    std::shared_mutex tokensMutex;
+    std::unordered_map<std::string, MemoizedToken> tokens;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> resolutions{0};
+
+    std::optional<SigningKey> keyFor(const std::string& did, Clock::time_point now, bool refresh);
+    void memoize(std::string_view token, MemoizedToken entry, Clock::time_point now);
+    void storeKey(const std::string& did, CachedKey cached, Clock::time_point now);
+};
+
+#endif // SERVICE_AUTH_H
@@ -0,0 +1,218 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "signing_key.hpp"
+#include <openssl/bn.h>
+#include <openssl/core_names.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/obj_mac.h>
+#include <openssl/param_build.h>
+#include "../tools/base64.hpp"
+
+// Multicodec varint prefixes for compressed public keys
+static constexpr std::string_view SECP256K1_PREFIX = "\xe7\x01";
+static constexpr std::string_view P256_PREFIX = "\x80\x24";
+static constexpr size_t COMPRESSED_POINT_SIZE = 33;
+static constexpr size_t SCALAR_SIZE = 32;
+
+namespace {
+    struct BnDeleter {
+        void operator()(BIGNUM* bn) const { BN_free(bn); }
+    };
+    struct SigDeleter {
+        void operator()(ECDSA_SIG* sig) const { ECDSA_SIG_free(sig); }
+    };
+    struct MdCtxDeleter {
+        void operator()(EVP_MD_CTX* ctx) const { EVP_MD_CTX_free(ctx); }
+    };
+    using BigNum = std::unique_ptr<BIGNUM, BnDeleter>;
+    using EcdsaSig = std::unique_ptr<ECDSA_SIG, SigDeleter>;
+    using MdCtx = std::unique_ptr<EVP_MD_CTX, MdCtxDeleter>;
+
+    const char* groupName(const SigningKey::Curve curve) {
+        return curve == SigningKey::Curve::Secp256k1 ? "secp256k1" : "prime256v1";
+    }
+
+    // Group order n and n/2; signatures with s above n/2 are malleable duplicates of low-S ones
+    struct CurveOrder {
+        BIGNUM* order;
+        BIGNUM* half;
+    };
+
+    const CurveOrder& curveOrder(const SigningKey::Curve curve) {
+        static const auto make = [](const int nid) {
+            const auto group = EC_GROUP_new_by_curve_name(nid);
+            CurveOrder result{BN_dup(EC_GROUP_get0_order(group)), BN_dup(EC_GROUP_get0_order(group))};
+            BN_rshift1(result.half, result.half);
+            EC_GROUP_free(group);
+            return result;
+        };
+        static const auto secp256k1 = make(NID_secp256k1);
+        static const auto p256 = make(NID_X9_62_prime256v1);
+        return curve == SigningKey::Curve::Secp256k1 ? secp256k1 : p256;
+    }
+
+    std::shared_ptr<EVP_PKEY> wrap(EVP_PKEY* key) {
+        return {key, EVP_PKEY_free};
+    }
+}
+
+SigningKey::SigningKey(std::shared_ptr<EVP_PKEY> key, const Curve curve, const bool isPrivate)
+    : key(std::move(key)), keyCurve(curve), isPrivate(isPrivate) {}
+
+SigningKey SigningKey::generate(const Curve curve) {
+    auto* generated = EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", groupName(curve));
+    if (!generated) {
+        throw SigningKeyException("Failed to generate an EC key");
+    }
+    return {wrap(generated), curve, true};
+}
+
+std::optional<SigningKey> SigningKey::fromCompressedPoint(const std::string_view point, const Curve curve) {
+    if (point.size() != COMPRESSED_POINT_SIZE || (point[0] != 0x02 && point[0] != 0x03)) {
+        return std::nullopt;
+    }
+
+    auto* builder = OSSL_PARAM_BLD_new();
+    OSSL_PARAM_BLD_push_utf8_string(builder, OSSL_PKEY_PARAM_GROUP_NAME, groupName(curve), 0);
+    OSSL_PARAM_BLD_push_octet_string(builder, OSSL_PKEY_PARAM_PUB_KEY, point.data(), point.size());
+    auto* params = OSSL_PARAM_BLD_to_param(builder);
+    auto* context = EVP_PKEY_CTX_new_from_name(nullptr, "EC", nullptr);
+
+    // Decompressing the point fails unless it lies on the curve
+    EVP_PKEY* imported = nullptr;
+    const auto ok = params && context && EVP_PKEY_fromdata_init(context) == 1 &&
+                    EVP_PKEY_fromdata(context, &imported, EVP_PKEY_PUBLIC_KEY, params) == 1;
+
+    EVP_PKEY_CTX_free(context);
+    OSSL_PARAM_free(params);
+    OSSL_PARAM_BLD_free(builder);
+    if (!ok) {
+        EVP_PKEY_free(imported);
+        return std::nullopt;
+    }
+    return SigningKey(wrap(imported), curve, false);
+}
+
+std::optional<SigningKey> SigningKey::fromMultibase(const std::string_view multibase) {
+    if (multibase.empty() || multibase[0] != 'z') {
+        return std::nullopt;
+    }
+    const auto bytes = Base58::decode(multibase.substr(1));
+    if (!bytes) {
+        return std::nullopt;
+    }
+
+    const std::string_view decoded = *bytes;
+    if (decoded.substr(0, 2) == SECP256K1_PREFIX) {
+        return fromCompressedPoint(decoded.substr(2), Curve::Secp256k1);
+    }
+    if (decoded.substr(0, 2) == P256_PREFIX) {
+        return fromCompressedPoint(decoded.substr(2), Curve::P256);
+    }
+    return fromCompressedPoint(decoded, Curve::Secp256k1);
+}
+
+std::optional<SigningKey> SigningKey::fromDidKey(const std::string_view did) {
+    static constexpr std::string_view DID_KEY_PREFIX = "did:key:";
+    if (did.substr(0, DID_KEY_PREFIX.size()) != DID_KEY_PREFIX) {
+        return std::nullopt;
+    }
+    return fromMultibase(did.substr(DID_KEY_PREFIX.size()));
+}
+
+std::string SigningKey::multibase() const {
+    unsigned char point[65];
+    size_t length = 0;
+    if (EVP_PKEY_get_octet_string_param(key.get(), OSSL_PKEY_PARAM_PUB_KEY, point, sizeof(point), &length) != 1) {
+        throw SigningKeyException("Failed to export public key");
+    }
+
+    std::string compressed;
+    if (length == COMPRESSED_POINT_SIZE) {
+        compressed.assign(reinterpret_cast<const char*>(point), length);
+    } else if (length == 65 && point[0] == 0x04) {
+        compressed += static_cast<char>((point[64] & 1) ? 0x03 : 0x02);
+        compressed.append(reinterpret_cast<const char*>(point + 1), SCALAR_SIZE);
+    } else {
+        throw SigningKeyException("Unexpected public key encoding");
+    }
+
+    const auto prefix = keyCurve == Curve::Secp256k1 ? SECP256K1_PREFIX : P256_PREFIX;
+    return "z" + Base58::encode(std::string(prefix) + compressed);
+}
+
+std::string SigningKey::sign(const std::string_view message) const {
+    if (!isPrivate) {
+        throw SigningKeyException("Cannot sign with a public key");
+    }
+
+    const MdCtx context(EVP_MD_CTX_new());
+    size_t derLength = 0;
+    if (!context || EVP_DigestSignInit(context.get(), nullptr, EVP_sha256(), nullptr, key.get()) != 1 ||
+        EVP_DigestSign(context.get(), nullptr, &derLength,
+                       reinterpret_cast<const unsigned char*>(message.data()), message.size()) != 1) {
+        throw SigningKeyException("Failed to initialize signing");
+    }
+    std::string der(derLength, '\0');
+    if (EVP_DigestSign(context.get(), reinterpret_cast<unsigned char*>(der.data()), &derLength,
+                       reinterpret_cast<const unsigned char*>(message.data()), message.size()) != 1) {
+        throw SigningKeyException("Failed to sign");
+    }
+
+    const auto* cursor = reinterpret_cast<const unsigned char*>(der.data());
+    const EcdsaSig signature(d2i_ECDSA_SIG(nullptr, &cursor, static_cast<long>(derLength)));
+    if (!signature) {
+        throw SigningKeyException("Failed to decode signature");
+    }
+
+    const BIGNUM* r = nullptr;
+    const BIGNUM* s = nullptr;
+    ECDSA_SIG_get0(signature.get(), &r, &s);
+    BigNum lowS(BN_dup(s));
+    if (BN_cmp(lowS.get(), curveOrder(keyCurve).half) > 0) {
+        BN_sub(lowS.get(), curveOrder(keyCurve).order, lowS.get());
+    }
+
+    std::string compact(2 * SCALAR_SIZE, '\0');
+    BN_bn2binpad(r, reinterpret_cast<unsigned char*>(compact.data()), SCALAR_SIZE);
+    BN_bn2binpad(lowS.get(), reinterpret_cast<unsigned char*>(compact.data()) + SCALAR_SIZE, SCALAR_SIZE);
+    return compact;
+}
+
+bool SigningKey::verify(const std::string_view message, const std::string_view signature) const {
+    if (signature.size() != 2 * SCALAR_SIZE) {
+        return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const unsigned char*>(signature.data());
+    BigNum r(BN_bin2bn(bytes, SCALAR_SIZE, nullptr));
+    BigNum s(BN_bin2bn(bytes + SCALAR_SIZE, SCALAR_SIZE, nullptr));
+    if (!r || !s || BN_cmp(s.get(), curveOrder(keyCurve).half) > 0) {
+        return false;
+    }
+
+    // OpenSSL verifies DER-encoded signatures, so re-encode the compact form
+    const EcdsaSig parsed(ECDSA_SIG_new());
+    if (!parsed || ECDSA_SIG_set0(parsed.get(), r.get(), s.get()) != 1) {
+        return false;
+    }
+    r.release();
+    s.release();
+
+    unsigned char* der = nullptr;
+    const auto derLength = i2d_ECDSA_SIG(parsed.get(), &der);
+    if (derLength <= 0) {
+        return false;
+    }
+
+    const MdCtx context(EVP_MD_CTX_new());
+    const auto valid = context && EVP_DigestVerifyInit(context.get(), nullptr, EVP_sha256(), nullptr, key.get()) == 1 &&
+                       EVP_DigestVerify(context.get(), der, static_cast<size_t>(derLength),
+                                        reinterpret_cast<const unsigned char*>(message.data()), message.size()) == 1;
+    OPENSSL_free(der);
+    return valid;
+}
@@ -0,0 +1,71 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef SIGNING_KEY_H
+#define SIGNING_KEY_H
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+class SigningKeyException final : public std::exception {
+    std::string message;
+
+public:
+    explicit SigningKeyException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// An atproto signing key (secp256k1 or NIST P-256) backed by OpenSSL.
+// Signatures use the compact 64-byte r||s form with low-S normalization, as JWTs and repo commits do.
+class SigningKey {
+public:
+    enum class Curve {
+        Secp256k1, // JWT alg ES256K
+        P256       // JWT alg ES256
+    };
+
+    // A new private key, e.g. for did:key identities in tests and load generation
+    static SigningKey generate(Curve curve);
+
+    // Public key from a multibase string ('z' + base58btc of multicodec prefix + compressed point).
+    // A bare 33-byte point without a multicodec prefix is treated as secp256k1 (legacy DID documents).
+    static std::optional<SigningKey> fromMultibase(std::string_view multibase);
+
+    // Public key from a did:key identifier
+    static std::optional<SigningKey> fromDidKey(std::string_view did);
+
+    [[nodiscard]] Curve curve() const { return keyCurve; }
+    [[nodiscard]] std::string_view jwtAlgorithm() const { return keyCurve == Curve::Secp256k1 ? "ES256K" : "ES256"; }
+    [[nodiscard]] bool hasPrivateKey() const { return isPrivate; }
+
+    [[nodiscard]] std::string multibase() const;
+    [[nodiscard]] std::string didKey() const { return "did:key:" + multibase(); }
+
+    // SHA-256 + ECDSA; requires a private key
+    [[nodiscard]] std::string sign(std::string_view message) const;
+
+    // Rejects malformed and high-S signatures
+    [[nodiscard]] bool verify(std::string_view message, std::string_view signature) const;
+
+private:
+    std::shared_ptr<EVP_PKEY> key;
+    Curve keyCurve;
+    bool isPrivate;
+
+    SigningKey(std::shared_ptr<EVP_PKEY> key, Curve curve, bool isPrivate);
+
+    static std::optional<SigningKey> fromCompressedPoint(std::string_view point, Curve curve);
+};
+
+#endif // SIGNING_KEY_H
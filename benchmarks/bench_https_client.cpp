@@ -0,0 +1,89 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include "../mock/mock_xrpc_server.hpp"
+#include "../network/https_client.hpp"
+#include "bench_support.hpp"
+
+// The URL of a getAuthorFeed page with up to four query parameters, as the backfill builds them
+static void BM_ConstructUrl(benchmark::State& state) {
+    const QuietConsole quiet; // setHost and constructUrl log at debug level
+    HTTPSClient client;
+    client.setHost("https://public.api.bsky.app/");
+    client.setEndpoint("/xrpc/app.bsky.feed.getAuthorFeed");
+    const std::pair<const char*, const char*> params[] = {
+        {"actor", "did:plc:z72i7hdynmk6r22z27h6tvur"},
+        {"limit", "100"},
+        {"filter", "posts_with_replies"},
+        {"cursor", "2024-11-26T17:08:23.412Z"}
+    };
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        client.addQueryParam(params[i].first, params[i].second);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client.constructUrl());
+    }
+}
+BENCHMARK(BM_ConstructUrl)->DenseRange(0, 4)->ArgName("params");
+
+// One getProfile round trip to a local mock over the thread's pooled keep-alive connection: the client
+// stack's own cost per request, with TLS framing but no network
+static void BM_GetProfile(benchmark::State& state) {
+    const QuietConsole quiet;
+    MockXrpcServer mock;
+    HTTPSClient::trustCertificate(mock.certificatePem());
+    if (!mock.start()) {
+        state.SkipWithError("Could not start the mock XRPC server");
+        return;
+    }
+    HTTPSClient client;
+    client.setHost(mock.host());
+    client.setEndpoint("/xrpc/app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(client.get());
+    }
+    if (client.status() != 200) {
+        state.SkipWithError("getProfile failed");
+    }
+}
+BENCHMARK(BM_GetProfile)->UseRealTime();
+
+// Paging through 500 posts of one author at different page sizes, with 2ms of server latency per request:
+// how much batching saves when the round trip, not the bytes, is the cost
+static void BM_PageAuthorFeed(benchmark::State& state) {
+    const QuietConsole quiet;
+    MockXrpcServer::Options options;
+    options.medianLatency = std::chrono::milliseconds(2);
+    options.postsPerActor = 500;
+    MockXrpcServer mock(options);
+    HTTPSClient::trustCertificate(mock.certificatePem());
+    if (!mock.start()) {
+        state.SkipWithError("Could not start the mock XRPC server");
+        return;
+    }
+
+    int64_t posts = 0;
+    for (auto _ : state) {
+        HTTPSClient client;
+        client.setHost(mock.host());
+        client.setEndpoint("/xrpc/app.bsky.feed.getAuthorFeed");
+        client.addQueryParam("actor", "alice.bsky.social");
+        client.addQueryParam("limit", std::to_string(state.range(0)));
+        for (auto page = client.get(); page.is_object(); page = client.get()) {
+            posts += static_cast<int64_t>(page["feed"].size());
+            if (!page.contains("cursor")) {
+                break;
+            }
+            client.addQueryParam("cursor", page["cursor"].get<std::string>());
+        }
+    }
+    state.SetItemsProcessed(posts);
+}
+BENCHMARK(BM_PageAuthorFeed)->Arg(10)->Arg(50)->Arg(100)->ArgName("limit")->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
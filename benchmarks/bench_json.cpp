@@ -0,0 +1,28 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include "../nlohmann/json.hpp"
+#include "bench_support.hpp"
+
+static void parseFixture(benchmark::State& state, const char* name) {
+    const auto payload = readFixture(name);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(nlohmann::json::parse(payload.data(), payload.data() + payload.size()));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * payload.size()));
+}
+
+// app.bsky.actor.getProfile, as 'getprofile' fetches it
+static void BM_ParseProfile(benchmark::State& state) {
+    parseFixture(state, "profile.json");
+}
+BENCHMARK(BM_ParseProfile);
+
+// A 30-post app.bsky.feed.getAuthorFeed page with embeds, facets and reposts, as backfill pages through
+static void BM_ParseAuthorFeed(benchmark::State& state) {
+    parseFixture(state, "author_feed.json");
+}
+BENCHMARK(BM_ParseAuthorFeed);
@@ -0,0 +1,19 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include "../tools/logging.hpp"
+
+// Threads logging at once, as ingest stages, server workers and the console do; only the log file is
+// written so the terminal's speed does not dominate
+static void BM_LoggingInfo(benchmark::State& state) {
+    const auto message = "Thread " + std::to_string(state.thread_index()) + " compacted feed indexes in 12ms";
+    for (auto _ : state) {
+        Logging::info(message, false);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(BM_LoggingInfo)->ThreadRange(1, 8)->UseRealTime();
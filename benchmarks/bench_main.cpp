@@ -0,0 +1,31 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <iostream>
+
+// Runs from a scratch directory, since Settings and Logging write settings.json and log.txt to the working
+// directory, and records the build flavour so reports from debug builds are not compared with release ones
+int main(int argc, char** argv) {
+    const auto scratch = std::filesystem::temp_directory_path() / "bluesky_feed_bench";
+    std::filesystem::create_directories(scratch);
+    std::filesystem::current_path(scratch);
+
+#ifdef NDEBUG
+    benchmark::AddCustomContext("assertions", "disabled");
+#else
+    benchmark::AddCustomContext("assertions", "enabled");
+    std::cerr << "Warning: benchmarks built without NDEBUG; configure with -DCMAKE_BUILD_TYPE=Release" << std::endl;
+#endif
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,35 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include "../config/settings.hpp"
+
+// A settings.json with the defaults plus a few tuning keys, in the benchmark's working directory
+static Settings& benchSettings() {
+    static const auto settings = [] {
+        auto made = Settings::createInstance("bench_settings.json");
+        made->set("feed_port", "3000");
+        made->set("firehose_host", "bsky.network");
+        made->set("compaction_threshold", "0.05");
+        return made;
+    }();
+    return *settings;
+}
+
+static void BM_SettingsGet(benchmark::State& state) {
+    auto& settings = benchSettings();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(settings.get<std::string>("public_api"));
+    }
+}
+BENCHMARK(BM_SettingsGet);
+
+static void BM_SettingsGetDefault(benchmark::State& state) {
+    auto& settings = benchSettings();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(settings.get<int>("missing_key", 8));
+    }
+}
+BENCHMARK(BM_SettingsGetDefault);
@@ -0,0 +1,48 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef BENCH_SUPPORT_H
+#define BENCH_SUPPORT_H
+
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Contents of a payload in benchmarks/data: synthetic, shaped like the AppView's responses rather than recorded
+inline std::string readFixture(const std::string& name) {
+    std::ifstream in(std::string(BENCHMARK_DATA_DIR) + "/" + name, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Missing benchmark fixture: " + name);
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+// Discards what the code under test prints to the console, so it neither skews the timings with terminal
+// writes nor interleaves with the report
+class QuietConsole {
+public:
+    QuietConsole() : out(std::cout.rdbuf(nullptr)), err(std::cerr.rdbuf(nullptr)) {}
+    ~QuietConsole() {
+        std::cout.clear();
+        std::cerr.clear();
+        std::cout.rdbuf(out);
+        std::cerr.rdbuf(err);
+    }
+
+    QuietConsole(const QuietConsole&) = delete;
+    QuietConsole& operator=(const QuietConsole&) = delete;
+
+private:
+    std::streambuf* out;
+    std::streambuf* err;
+};
+
+#endif // BENCH_SUPPORT_H
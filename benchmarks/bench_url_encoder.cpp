@@ -0,0 +1,39 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+#include "../tools/url_encoder.hpp"
+
+// Typical values: a DID, a post URI, a feed cursor and a paragraph of post text with emoji and punctuation
+static const std::vector<std::string>& components() {
+    static const std::vector<std::string> values = {
+        "did:plc:z72i7hdynmk6r22z27h6tvur",
+        "at://did:plc:z72i7hdynmk6r22z27h6tvur/app.bsky.feed.post/3lbfdnq7zys2w",
+        "1732640903412::bafyreiaipewjmdrchuc6ij4wnb6p6vclbtdhkvbm2nmdiavt5n4zzxkuk4",
+        "Custom feeds are here! 🎉 Pick the algorithm you want — or build your own: https://bsky.social/about "
+        "(see the docs & the starter kit) #atproto #bluesky. Questions? Ask away; we're reading every reply."
+    };
+    return values;
+}
+
+static void BM_EncodeComponent(benchmark::State& state) {
+    const auto& value = components()[static_cast<size_t>(state.range(0))];
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(URLEncoder::encodeComponent(value));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * value.size()));
+}
+BENCHMARK(BM_EncodeComponent)->DenseRange(0, 3)->ArgName("value");
+
+static void BM_Decode(benchmark::State& state) {
+    const auto encoded = URLEncoder::encodeComponent(components()[static_cast<size_t>(state.range(0))]);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(URLEncoder::decode(encoded));
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * encoded.size()));
+}
+BENCHMARK(BM_Decode)->DenseRange(0, 3)->ArgName("value");
@@ -95,7 +95,9 @@ std::unordered_map<std::string, std::string> Settings::getDefaultSettings() {
         {"auth_endpoint", "https://bsky.social/oauth/authorize"},
         {"token_endpoint", "https://bsky.social/oauth/token"},
         {"redirect_uri", "https://bsky.interlacedpixel.com/redirect"},
-        {"feed_name", "Interlaced Pixel Test"}
+        {"feed_name", "Interlaced Pixel Test"},
+        {"service_did", "did:web:bsky.interlacedpixel.com"},
+        {"publisher_did", "REPLACE_WITH_DID"}
     };
 }
 
@@ -0,0 +1,182 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "engagement_counters.hpp"
+#include <stdexcept>
+#include "../tools/logging.hpp"
+
+static std::atomic<uint64_t> nextInstance{1};
+
+EngagementCounters::EngagementCounters()
+    : instance(nextInstance.fetch_add(1, std::memory_order_relaxed)),
+      chunks(new std::atomic<Chunk*>[MAX_CHUNKS]) {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+EngagementCounters::~EngagementCounters() {
+    stopMerging();
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+// A thread creates its shard the first time it records into an instance and remembers it, so later
+// calls find it without any shared state
+EngagementCounters::Shard& EngagementCounters::localShard() {
+    struct Known {
+        uint64_t instance;
+        Shard* shard;
+    };
+    thread_local std::vector<Known> known;
+    for (const auto& entry : known) {
+        if (entry.instance == instance) {
+            return *entry.shard;
+        }
+    }
+
+    std::lock_guard lock(shardsMutex);
+    auto* shard = shards.emplace_back(std::make_unique<Shard>()).get();
+    known.push_back({instance, shard});
+    return *shard;
+}
+
+size_t EngagementCounters::shardCount() const {
+    std::lock_guard lock(shardsMutex);
+    return shards.size();
+}
+
+void EngagementCounters::add(const uint32_t postId, const Engagement kind, const int64_t delta) {
+    auto& shard = localShard();
+    std::lock_guard lock(shard.mutex);
+
+    auto& pending = shard.deltas[postId];
+    switch (kind) {
+        case Engagement::Like: pending.likes += delta; break;
+        case Engagement::Repost: pending.reposts += delta; break;
+        case Engagement::Reply: pending.replies += delta; break;
+    }
+}
+
+size_t EngagementCounters::merge(const MergeCallback& onMerged) {
+    std::lock_guard mergeLock(mergeMutex);
+
+    std::vector<Shard*> current;
+    {
+        std::lock_guard lock(shardsMutex);
+        for (const auto& shard : shards) {
+            current.push_back(shard.get());
+        }
+    }
+
+    // Swap every shard's deltas out, holding each shard lock only for the swap
+    std::unordered_map<uint32_t, EngagementCounts> combined;
+    for (auto* shard : current) {
+        std::unordered_map<uint32_t, EngagementCounts> taken;
+        {
+            std::lock_guard lock(shard->mutex);
+            taken.swap(shard->deltas);
+        }
+
+        if (combined.empty()) {
+            combined.swap(taken);
+            continue;
+        }
+        for (const auto& [postId, delta] : taken) {
+            auto& total = combined[postId];
+            total.likes += delta.likes;
+            total.reposts += delta.reposts;
+            total.replies += delta.replies;
+        }
+    }
+
+    for (const auto& [postId, delta] : combined) {
+        auto& target = slot(postId);
+        EngagementCounts totals;
+        totals.likes = target.likes.fetch_add(delta.likes, std::memory_order_relaxed) + delta.likes;
+        totals.reposts = target.reposts.fetch_add(delta.reposts, std::memory_order_relaxed) + delta.reposts;
+        totals.replies = target.replies.fetch_add(delta.replies, std::memory_order_relaxed) + delta.replies;
+        if (onMerged) {
+            onMerged(postId, totals);
+        }
+    }
+
+    return combined.size();
+}
+
+EngagementCounts EngagementCounters::read(const uint32_t postId) const {
+    if ((postId >> CHUNK_BITS) >= MAX_CHUNKS) {
+        return {};
+    }
+    const auto* chunk = chunks[postId >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        return {};
+    }
+
+    const auto& source = (*chunk)[postId & (CHUNK_SIZE - 1)];
+    return {
+        source.likes.load(std::memory_order_relaxed),
+        source.reposts.load(std::memory_order_relaxed),
+        source.replies.load(std::memory_order_relaxed)
+    };
+}
+
+// Only called with mergeMutex held, so chunk allocation needs no further locking
+EngagementCounters::Slot& EngagementCounters::slot(const uint32_t postId) {
+    if ((postId >> CHUNK_BITS) >= MAX_CHUNKS) {
+        throw std::out_of_range("EngagementCounters: post id out of range: " + std::to_string(postId));
+    }
+
+    auto& entry = chunks[postId >> CHUNK_BITS];
+    auto* chunk = entry.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        chunk = new Chunk[1];
+        entry.store(chunk, std::memory_order_release);
+    }
+    return (*chunk)[postId & (CHUNK_SIZE - 1)];
+}
+
+void EngagementCounters::startMerging(const std::chrono::milliseconds interval, MergeCallback onMerged) {
+    stopMerging();
+
+    {
+        std::lock_guard lock(mergerMutex);
+        mergerRunning = true;
+    }
+
+    merger = std::thread([this, interval, onMerged = std::move(onMerged)] {
+        const auto mergeLogged = [this, &onMerged] {
+            try {
+                merge(onMerged);
+            } catch (const std::exception& e) {
+                Logging::error("EngagementCounters merge failed: " + std::string(e.what()));
+            }
+        };
+
+        std::unique_lock lock(mergerMutex);
+        while (!mergerWake.wait_for(lock, interval, [this] { return !mergerRunning; })) {
+            lock.unlock();
+            mergeLogged();
+            lock.lock();
+        }
+        lock.unlock();
+
+        // Drain whatever was recorded before the stop request
+        mergeLogged();
+    });
+}
+
+void EngagementCounters::stopMerging() {
+    {
+        std::lock_guard lock(mergerMutex);
+        mergerRunning = false;
+    }
+    mergerWake.notify_all();
+
+    if (merger.joinable()) {
+        merger.join();
+    }
+}
@@ -0,0 +1,99 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef ENGAGEMENT_COUNTERS_H
+#define ENGAGEMENT_COUNTERS_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+enum class Engagement : uint8_t {
+    Like,
+    Repost,
+    Reply
+};
+
+struct EngagementCounts {
+    int64_t likes = 0;
+    int64_t reposts = 0;
+    int64_t replies = 0;
+};
+
+// Like/repost/reply counters keyed by interned post id.
+// Every thread that records gets a shard of pending deltas of its own, so writers never share a lock or a
+// cache line; merge() periodically folds them into a shared table that ranking reads without locks. Reads
+// are therefore approximate: they do not include deltas recorded since the last merge.
+class EngagementCounters {
+public:
+    using MergeCallback = std::function<void(uint32_t postId, const EngagementCounts& totals)>;
+
+    EngagementCounters();
+    ~EngagementCounters();
+
+    EngagementCounters(const EngagementCounters&) = delete;
+    EngagementCounters& operator=(const EngagementCounters&) = delete;
+
+    // Record an event on the calling thread's shard; negative deltas undo likes/reposts
+    void add(uint32_t postId, Engagement kind, int64_t delta = 1);
+
+    // Fold pending deltas into the shared table. onMerged is called once per touched post
+    // with its new totals. Returns the number of posts touched.
+    size_t merge(const MergeCallback& onMerged = nullptr);
+
+    // Merged totals for a post; zero for posts never seen
+    [[nodiscard]] EngagementCounts read(uint32_t postId) const;
+
+    // Threads that have recorded into this instance, each with its own shard
+    [[nodiscard]] size_t shardCount() const;
+
+    // Run merge() on a background thread every interval until stopMerging()
+    void startMerging(std::chrono::milliseconds interval, MergeCallback onMerged = nullptr);
+    void stopMerging();
+
+private:
+    static constexpr uint32_t CHUNK_BITS = 12;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static constexpr uint32_t MAX_CHUNKS = 1u << 18;
+
+    // Padded so that two ingest threads never write to the same cache line
+    struct alignas(64) Shard {
+        std::mutex mutex; // Only ever contended by merge() swapping the map out
+        std::unordered_map<uint32_t, EngagementCounts> deltas;
+    };
+
+    // Shared totals are only written by the merging thread, so slots are packed rather than padded
+    struct Slot {
+        std::atomic<int64_t> likes{0};
+        std::atomic<int64_t> reposts{0};
+        std::atomic<int64_t> replies{0};
+    };
+    using Chunk = Slot[CHUNK_SIZE];
+
+    const uint64_t instance; // Never reused, unlike the address, so thread caches cannot go stale
+    mutable std::mutex shardsMutex;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    std::mutex mergeMutex;
+
+    std::thread merger;
+    std::mutex mergerMutex;
+    std::condition_variable mergerWake;
+    bool mergerRunning = false;
+
+    Slot& slot(uint32_t postId);
+    Shard& localShard();
+};
+
+#endif // ENGAGEMENT_COUNTERS_H
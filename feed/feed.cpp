@@ -0,0 +1,120 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed.hpp"
+#include <stdexcept>
+#include "../tools/hash.hpp"
+
+Feed::Feed(std::string name, std::shared_ptr<const StringInterner> posts, const FeedSort sort,
+           const size_t capacity, const std::chrono::seconds halfLife, const size_t indexSlices)
+    : feedName(std::move(name)),
+      sortOrder(sort),
+      postUris(std::move(posts)),
+      topK(capacity, halfLife, capacity * 20),
+      chronological(capacity * 100, indexSlices) {}
+
+// Removals change the served list before they change the index, so tombstone marks count as well
+uint64_t Feed::epoch() const {
+    const auto removals = tombstones ? tombstones->version() : 0;
+    return (sortOrder == FeedSort::Top ? topK.version() : chronological.version()) + removals;
+}
+
+uint32_t Feed::tieFor(const std::string_view uri) {
+    return static_cast<uint32_t>(Hash::bytes(uri));
+}
+
+FeedSort Feed::parseSort(const std::string& value) {
+    if (value == "top") {
+        return FeedSort::Top;
+    }
+    if (value == "new" || value == "chronological") {
+        return FeedSort::Chronological;
+    }
+    throw std::invalid_argument("Unknown feed sort: " + value);
+}
+
+Feed::Page Feed::page(const std::optional<FeedCursor>& after, const size_t limit,
+                      const std::vector<uint32_t>* followedAuthors) const {
+    return sortOrder == FeedSort::Top ? rankedPage(after, limit) : chronologicalPage(after, limit, followedAuthors);
+}
+
+// Ranked cursors carry the offset of the next item. If the ranking moved since the cursor was
+// issued, resume after the last post the client saw instead, so pages neither repeat nor skip it.
+Feed::Page Feed::rankedPage(const std::optional<FeedCursor>& after, const size_t limit) const {
+    const auto epoch32 = static_cast<uint32_t>(epoch());
+    const auto ranked = topK.ranked();
+
+    size_t start = 0;
+    if (after) {
+        start = std::min<size_t>(after->key, ranked->size());
+        if (after->epoch != epoch32) {
+            for (size_t i = 0; i < ranked->size(); ++i) {
+                if (tieFor(postUri((*ranked)[i])) == after->tie) {
+                    start = i + 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    Page result;
+    auto end = start;
+    for (; end < ranked->size() && result.posts.size() < limit; ++end) {
+        if (!removed((*ranked)[end])) {
+            result.posts.push_back((*ranked)[end]);
+        }
+    }
+    if (end < ranked->size() && !result.posts.empty()) {
+        result.next = FeedCursor{epoch32, end, tieFor(postUri(result.posts.back()))};
+    }
+    return result;
+}
+
+// Chronological cursors carry the (timestamp, tie) of the last post served; the index seeks to it directly
+Feed::Page Feed::chronologicalPage(const std::optional<FeedCursor>& after, const size_t limit,
+                                   const std::vector<uint32_t>* followedAuthors) const {
+    static constexpr size_t SCAN_FACTOR = 50;
+
+    std::optional<FeedIndex::Position> position;
+    if (after) {
+        position = FeedIndex::Position{after->key, after->tie};
+    }
+
+    Page result;
+    if (followedAuthors) {
+        // Resume from the last entry examined, not the last one returned, so sparse viewers make progress
+        const auto scan = chronological.pageByAuthors(position, limit, *followedAuthors, limit * SCAN_FACTOR);
+        for (const auto& entry : scan.entries) {
+            if (!removed(entry.postId)) {
+                result.posts.push_back(entry.postId);
+            }
+        }
+        if (!scan.exhausted && scan.lastScanned) {
+            result.next = FeedCursor{static_cast<uint32_t>(epoch()), scan.lastScanned->key, scan.lastScanned->tie};
+        }
+        return result;
+    }
+
+    // Removed posts leave gaps, so keep reading until the page is full or the index runs out
+    result.posts.reserve(limit);
+    auto more = true;
+    while (more && result.posts.size() < limit) {
+        const auto wanted = limit - result.posts.size();
+        const auto entries = chronological.page(position, wanted);
+        for (const auto& entry : entries) {
+            if (!removed(entry.postId)) {
+                result.posts.push_back(entry.postId);
+            }
+        }
+        more = entries.size() == wanted;
+        if (!entries.empty()) {
+            position = FeedIndex::Position{entries.back().key, entries.back().tie};
+        }
+    }
+    if (more && position && !result.posts.empty()) {
+        result.next = FeedCursor{static_cast<uint32_t>(epoch()), position->key, position->tie};
+    }
+    return result;
+}
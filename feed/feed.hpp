@@ -0,0 +1,95 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_H
+#define FEED_H
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "feed_cursor.hpp"
+#include "feed_index.hpp"
+#include "tombstones.hpp"
+#include "top_k.hpp"
+#include "../tools/string_interner.hpp"
+
+enum class FeedSort {
+    Top,          // Time-decayed engagement ranking
+    Chronological // Newest first
+};
+
+// A hosted feed: its record key (the last segment of the feed's AT-URI) and its ranked posts.
+class Feed {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1000;
+    static constexpr std::chrono::seconds DEFAULT_HALF_LIFE{6 * 3600};
+
+    struct Page {
+        std::vector<uint32_t> posts;
+        std::optional<FeedCursor> next; // Absent on the last page
+    };
+
+    // indexSlices splits the chronological index into one slice per ingest shard
+    Feed(std::string name, std::shared_ptr<const StringInterner> posts, FeedSort sort = FeedSort::Top,
+         size_t capacity = DEFAULT_CAPACITY, std::chrono::seconds halfLife = DEFAULT_HALF_LIFE,
+         size_t indexSlices = 1);
+
+    [[nodiscard]] const std::string& name() const { return feedName; }
+    [[nodiscard]] FeedSort sort() const { return sortOrder; }
+
+    [[nodiscard]] DecayedTopK& ranking() { return topK; }
+    [[nodiscard]] const DecayedTopK& ranking() const { return topK; }
+    [[nodiscard]] FeedIndex& index() { return chronological; }
+    [[nodiscard]] const FeedIndex& index() const { return chronological; }
+
+    // Changes whenever the served list may have changed; used to invalidate rendered pages
+    [[nodiscard]] uint64_t epoch() const;
+
+    [[nodiscard]] std::shared_ptr<const std::vector<uint32_t>> ranked() const { return topK.ranked(); }
+
+    // Up to limit posts after the cursor (or from the top). For chronological feeds, a sorted list of
+    // followed author DIDs restricts the page to those authors (a set intersection with the index).
+    [[nodiscard]] Page page(const std::optional<FeedCursor>& after, size_t limit,
+                            const std::vector<uint32_t>* followedAuthors = nullptr) const;
+
+    // Feeds that only make sense per viewer, e.g. "topic posts from people you follow"
+    [[nodiscard]] bool followingOnly() const { return onlyFollowed; }
+    void setFollowingOnly(const bool value) { onlyFollowed = value; }
+
+    // Posts marked here are skipped when serving until compaction purges them from the index
+    void setTombstones(std::shared_ptr<const Tombstones> value) { tombstones = std::move(value); }
+
+    [[nodiscard]] std::string_view postUri(const uint32_t postId) const { return postUris->lookup(postId); }
+
+    // Stable across restarts, unlike interned post ids
+    static uint32_t tieFor(std::string_view uri);
+
+    // "top" or "new"/"chronological"
+    static FeedSort parseSort(const std::string& value);
+
+private:
+    std::string feedName;
+    FeedSort sortOrder;
+    std::shared_ptr<const StringInterner> postUris;
+    DecayedTopK topK;
+    FeedIndex chronological;
+    bool onlyFollowed = false;
+    std::shared_ptr<const Tombstones> tombstones;
+
+    [[nodiscard]] bool removed(const uint32_t postId) const {
+        return tombstones && tombstones->removed(postId, *postUris);
+    }
+
+    [[nodiscard]] Page rankedPage(const std::optional<FeedCursor>& after, size_t limit) const;
+    [[nodiscard]] Page chronologicalPage(const std::optional<FeedCursor>& after, size_t limit,
+                                         const std::vector<uint32_t>* followedAuthors) const;
+};
+
+#endif // FEED_H
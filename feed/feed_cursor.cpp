@@ -0,0 +1,84 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed_cursor.hpp"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <stdexcept>
+#include "../tools/base32.hpp"
+#include "../tools/varint.hpp"
+
+CursorCodec::CursorCodec(std::string secret) : secret(std::move(secret)) {
+    if (this->secret.empty()) {
+        throw std::invalid_argument("CursorCodec requires a non-empty secret");
+    }
+}
+
+std::string CursorCodec::mac(const std::string_view payload) const {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length = 0;
+    HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+         reinterpret_cast<const unsigned char*>(payload.data()), payload.size(), digest, &length);
+    return {reinterpret_cast<const char*>(digest), MAC_BYTES};
+}
+
+// version | varint epoch | varint key | tie (4 bytes LE) | mac
+std::string CursorCodec::encode(const FeedCursor& cursor) const {
+    std::string payload;
+    payload += static_cast<char>(FORMAT_VERSION);
+    Varint::append(payload, cursor.epoch);
+    Varint::append(payload, cursor.key);
+    for (int shift = 0; shift < 32; shift += 8) {
+        payload += static_cast<char>((cursor.tie >> shift) & 0xFF);
+    }
+    return Base32::encode(payload + mac(payload));
+}
+
+std::optional<FeedCursor> CursorCodec::decode(const std::string_view token) const {
+    const auto raw = Base32::decode(token);
+    if (!raw || raw->size() < 1 + MAC_BYTES + 6) {
+        return std::nullopt;
+    }
+
+    const std::string_view data(*raw);
+    const auto payload = data.substr(0, data.size() - MAC_BYTES);
+    const auto expected = mac(payload);
+    if (CRYPTO_memcmp(expected.data(), data.data() + payload.size(), MAC_BYTES) != 0) {
+        return std::nullopt;
+    }
+    if (static_cast<uint8_t>(payload[0]) != FORMAT_VERSION) {
+        return std::nullopt;
+    }
+
+    FeedCursor cursor;
+    size_t position = 1;
+    uint64_t epoch = 0;
+    if (!Varint::read(payload, position, epoch) || epoch > UINT32_MAX ||
+        !Varint::read(payload, position, cursor.key) || payload.size() - position != 4) {
+        return std::nullopt;
+    }
+    cursor.epoch = static_cast<uint32_t>(epoch);
+    for (int shift = 0; shift < 32; shift += 8) {
+        cursor.tie |= static_cast<uint32_t>(static_cast<unsigned char>(payload[position++])) << shift;
+    }
+    return cursor;
+}
+
+std::string CursorCodec::generateSecret() {
+    unsigned char bytes[32];
+    if (RAND_bytes(bytes, sizeof(bytes)) != 1) {
+        throw std::runtime_error("RAND_bytes failed while generating cursor secret");
+    }
+
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string hex;
+    for (const auto byte : bytes) {
+        hex += HEX[byte >> 4];
+        hex += HEX[byte & 0xF];
+    }
+    return hex;
+}
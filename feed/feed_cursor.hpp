@@ -0,0 +1,51 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_CURSOR_H
+#define FEED_CURSOR_H
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Position of the last item a client has seen. For chronological feeds key is the post's TID
+// timestamp; for ranked feeds it is the offset of the next item. tie is a stable hash of the post URI.
+struct FeedCursor {
+    uint32_t epoch = 0;
+    uint64_t key = 0;
+    uint32_t tie = 0;
+
+    bool operator==(const FeedCursor& other) const {
+        return epoch == other.epoch && key == other.key && tie == other.tie;
+    }
+};
+
+// Encodes cursors as short base32 tokens authenticated with a truncated HMAC-SHA256,
+// so the server keeps no per-client state and rejects cursors it did not issue.
+class CursorCodec {
+public:
+    explicit CursorCodec(std::string secret);
+
+    [[nodiscard]] std::string encode(const FeedCursor& cursor) const;
+
+    // nullopt for malformed, truncated or tampered tokens
+    [[nodiscard]] std::optional<FeedCursor> decode(std::string_view token) const;
+
+    // 32 random bytes, hex encoded, for the cursor_secret setting
+    static std::string generateSecret();
+
+private:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t MAC_BYTES = 8;
+
+    std::string secret;
+
+    [[nodiscard]] std::string mac(std::string_view payload) const;
+};
+
+#endif // FEED_CURSOR_H
@@ -0,0 +1,201 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed_index.hpp"
+#include <algorithm>
+#include <mutex>
+
+FeedIndex::FeedIndex(const size_t maxEntries, const size_t sliceCount)
+    : sliceCount(std::max<size_t>(sliceCount, 1)),
+      capacity((maxEntries + this->sliceCount - 1) / this->sliceCount),
+      slicesByShard(std::make_unique<Slice[]>(this->sliceCount)) {}
+
+bool FeedIndex::insert(const uint64_t key, const uint32_t tie, const uint32_t postId, const uint32_t authorId,
+                       const size_t slice) {
+    const Entry entry{key, tie, postId, authorId};
+    auto& target = sliceAt(slice);
+    std::unique_lock lock(target.mutex);
+    auto& entries = target.entries;
+
+    if (entries.empty() || entries.back() < entry) {
+        entries.push_back(entry);
+    } else {
+        // Late arrival: binary search for its slot
+        const auto it = std::lower_bound(entries.begin(), entries.end(), entry);
+        if (it != entries.end() && !(entry < *it)) {
+            return false;
+        }
+        entries.insert(it, entry);
+    }
+
+    if (capacity > 0 && entries.size() > capacity) {
+        entries.pop_front();
+    }
+    ++target.version;
+    return true;
+}
+
+bool FeedIndex::remove(const uint64_t key, const uint32_t tie, const size_t slice) {
+    const Entry probe{key, tie, 0, 0};
+    auto& target = sliceAt(slice);
+    std::unique_lock lock(target.mutex);
+    auto& entries = target.entries;
+
+    const auto it = std::lower_bound(entries.begin(), entries.end(), probe);
+    if (it == entries.end() || probe < *it) {
+        return false;
+    }
+    entries.erase(it);
+    ++target.version;
+    return true;
+}
+
+// A slice holds at most its share of the capacity, so one pass keeps the lock for a bounded time
+size_t FeedIndex::compact(const size_t slice, const std::function<bool(const Entry&)>& dead) {
+    auto& target = sliceAt(slice);
+    std::unique_lock lock(target.mutex);
+    auto& entries = target.entries;
+
+    const auto kept = std::remove_if(entries.begin(), entries.end(), dead);
+    const auto removed = static_cast<size_t>(entries.end() - kept);
+    if (removed == 0) {
+        return 0;
+    }
+    entries.erase(kept, entries.end());
+    entries.shrink_to_fit();
+    ++target.version;
+    return removed;
+}
+
+std::vector<FeedIndex::Entry> FeedIndex::slicePage(const Slice& slice, const std::optional<Position>& after,
+                                                   const size_t limit) {
+    std::shared_lock lock(slice.mutex);
+    const auto& entries = slice.entries;
+
+    // Everything before 'end' is strictly older than the cursor position
+    auto end = entries.end();
+    if (after) {
+        end = std::lower_bound(entries.begin(), entries.end(), Entry{after->key, after->tie, 0, 0});
+    }
+
+    std::vector<Entry> result;
+    result.reserve(std::min<size_t>(limit, static_cast<size_t>(end - entries.begin())));
+    while (end != entries.begin() && result.size() < limit) {
+        --end;
+        result.push_back(*end);
+    }
+    return result;
+}
+
+// Each slice's page is a consistent snapshot of that slice; the newest limit entries of all of them
+// are the newest limit entries of the whole index
+std::vector<FeedIndex::Entry> FeedIndex::page(const std::optional<Position>& after, const size_t limit) const {
+    if (sliceCount == 1) {
+        return slicePage(slicesByShard[0], after, limit);
+    }
+
+    std::vector<Entry> merged;
+    for (size_t i = 0; i < sliceCount; ++i) {
+        const auto part = slicePage(slicesByShard[i], after, limit);
+        merged.insert(merged.end(), part.begin(), part.end());
+    }
+    const auto newer = [](const Entry& a, const Entry& b) { return b < a; };
+    const auto count = std::min(limit, merged.size());
+    std::partial_sort(merged.begin(), merged.begin() + static_cast<std::ptrdiff_t>(count), merged.end(), newer);
+    merged.resize(count);
+    return merged;
+}
+
+FeedIndex::ScanResult FeedIndex::sliceScan(const Slice& slice, const std::optional<Position>& after,
+                                           const size_t limit, const std::vector<uint32_t>& authors,
+                                           const size_t maxScan) {
+    std::shared_lock lock(slice.mutex);
+    const auto& entries = slice.entries;
+
+    auto end = entries.end();
+    if (after) {
+        end = std::lower_bound(entries.begin(), entries.end(), Entry{after->key, after->tie, 0, 0});
+    }
+
+    ScanResult result;
+    size_t scanned = 0;
+    while (end != entries.begin() && result.entries.size() < limit && scanned < maxScan) {
+        --end;
+        ++scanned;
+        if (std::binary_search(authors.begin(), authors.end(), end->authorId)) {
+            result.entries.push_back(*end);
+        }
+        result.lastScanned = Position{end->key, end->tie};
+    }
+    result.exhausted = end == entries.begin();
+    return result;
+}
+
+// Slices are scanned with an equal share of the budget and stop at different depths. Only entries at
+// or above the shallowest stopping point have been seen in every slice, so the merged page ends there
+// and the next page resumes from it.
+FeedIndex::ScanResult FeedIndex::pageByAuthors(const std::optional<Position>& after, const size_t limit,
+                                               const std::vector<uint32_t>& authors, const size_t maxScan) const {
+    if (sliceCount == 1) {
+        return sliceScan(slicesByShard[0], after, limit, authors, maxScan);
+    }
+
+    const auto budget = std::max<size_t>(1, maxScan / sliceCount);
+    std::optional<Entry> cut;     // Newest position a slice stopped at without reaching its end
+    std::optional<Entry> deepest; // Oldest position scanned anywhere
+    std::vector<Entry> merged;
+    for (size_t i = 0; i < sliceCount; ++i) {
+        auto part = sliceScan(slicesByShard[i], after, limit, authors, budget);
+        if (part.lastScanned) {
+            const Entry stop{part.lastScanned->key, part.lastScanned->tie, 0, 0};
+            if (!part.exhausted && (!cut || *cut < stop)) {
+                cut = stop;
+            }
+            if (!deepest || stop < *deepest) {
+                deepest = stop;
+            }
+        }
+        merged.insert(merged.end(), part.entries.begin(), part.entries.end());
+    }
+
+    if (cut) {
+        merged.erase(std::remove_if(merged.begin(), merged.end(), [&](const Entry& entry) { return entry < *cut; }),
+                     merged.end());
+    }
+    std::sort(merged.begin(), merged.end(), [](const Entry& a, const Entry& b) { return b < a; });
+
+    ScanResult result;
+    if (merged.size() > limit) {
+        merged.resize(limit);
+        result.lastScanned = Position{merged.back().key, merged.back().tie};
+    } else if (cut) {
+        result.lastScanned = Position{cut->key, cut->tie};
+    } else {
+        result.exhausted = true;
+        if (deepest) {
+            result.lastScanned = Position{deepest->key, deepest->tie};
+        }
+    }
+    result.entries = std::move(merged);
+    return result;
+}
+
+size_t FeedIndex::size() const {
+    size_t total = 0;
+    for (size_t i = 0; i < sliceCount; ++i) {
+        std::shared_lock lock(slicesByShard[i].mutex);
+        total += slicesByShard[i].entries.size();
+    }
+    return total;
+}
+
+uint64_t FeedIndex::version() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < sliceCount; ++i) {
+        std::shared_lock lock(slicesByShard[i].mutex);
+        total += slicesByShard[i].version;
+    }
+    return total;
+}
@@ -0,0 +1,96 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_INDEX_H
+#define FEED_INDEX_H
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+// Chronological post index ordered by (key, tie), where key is the post's TID timestamp in
+// microseconds and tie a stable hash of its URI. Posts mostly arrive in order, so inserts are
+// appends; pages are read newest first from any position in O(log n + limit).
+//
+// The index is split into slices, one per ingest shard, each with its own lock, so shards never
+// contend with each other when writing. Reads take a page from every slice and merge them.
+class FeedIndex {
+public:
+    struct Entry {
+        uint64_t key;
+        uint32_t tie;
+        uint32_t postId;
+        uint32_t authorId;
+
+        bool operator<(const Entry& other) const {
+            return key != other.key ? key < other.key : tie < other.tie;
+        }
+    };
+
+    struct Position {
+        uint64_t key;
+        uint32_t tie;
+    };
+
+    struct ScanResult {
+        std::vector<Entry> entries;
+        std::optional<Position> lastScanned; // Where to resume; unset if nothing was scanned
+        bool exhausted = false;              // Reached the oldest entry
+    };
+
+    // maxEntries of 0 keeps everything; otherwise the oldest entries of each slice are evicted once
+    // it holds its share of maxEntries
+    explicit FeedIndex(size_t maxEntries = 0, size_t sliceCount = 1);
+
+    // Returns false if an entry with the same (key, tie) is already in the slice. A post must be
+    // removed from the slice it was inserted into.
+    bool insert(uint64_t key, uint32_t tie, uint32_t postId, uint32_t authorId = 0, size_t slice = 0);
+    bool remove(uint64_t key, uint32_t tie, size_t slice = 0);
+
+    [[nodiscard]] size_t slices() const { return sliceCount; }
+
+    // Rewrite one slice without the entries dead() picks, releasing the memory they held. dead() runs
+    // once per entry with the slice's write lock held. Returns the number of entries removed.
+    size_t compact(size_t slice, const std::function<bool(const Entry&)>& dead);
+
+    // Up to limit entries strictly older than after (or from the newest), newest first
+    [[nodiscard]] std::vector<Entry> page(const std::optional<Position>& after, size_t limit) const;
+
+    // Like page(), but only entries whose author is in the sorted authors list, looking at no more
+    // than maxScan entries so sparse matches cannot turn one request into a full scan
+    [[nodiscard]] ScanResult pageByAuthors(const std::optional<Position>& after, size_t limit,
+                                           const std::vector<uint32_t>& authors, size_t maxScan) const;
+
+    [[nodiscard]] size_t size() const;
+
+    // Bumped on every change
+    [[nodiscard]] uint64_t version() const;
+
+private:
+    // Padded so that writers on different shards never share a cache line
+    struct alignas(64) Slice {
+        mutable std::shared_mutex mutex;
+        std::deque<Entry> entries; // Ascending
+        uint64_t version = 0;
+    };
+
+    const size_t sliceCount;
+    const size_t capacity; // Per slice
+    std::unique_ptr<Slice[]> slicesByShard;
+
+    [[nodiscard]] Slice& sliceAt(const size_t slice) { return slicesByShard[slice % sliceCount]; }
+    [[nodiscard]] static std::vector<Entry> slicePage(const Slice& slice, const std::optional<Position>& after,
+                                                      size_t limit);
+    [[nodiscard]] static ScanResult sliceScan(const Slice& slice, const std::optional<Position>& after, size_t limit,
+                                              const std::vector<uint32_t>& authors, size_t maxScan);
+};
+
+#endif // FEED_INDEX_H
@@ -0,0 +1,89 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_MASK_H
+#define FEED_MASK_H
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "../tools/bits.hpp"
+
+// Fixed-width set of feed indexes; one bit per hosted feed
+class FeedMask {
+public:
+    static constexpr size_t MAX_FEEDS = 256;
+
+    void set(const size_t feed) { words[feed / 64] |= 1ULL << (feed % 64); }
+    void reset(const size_t feed) { words[feed / 64] &= ~(1ULL << (feed % 64)); }
+    [[nodiscard]] bool test(const size_t feed) const { return (words[feed / 64] >> (feed % 64)) & 1ULL; }
+
+    [[nodiscard]] bool any() const {
+        uint64_t combined = 0;
+        for (const auto word : words) {
+            combined |= word;
+        }
+        return combined != 0;
+    }
+
+    [[nodiscard]] size_t count() const {
+        size_t total = 0;
+        forEach([&total](size_t) { ++total; });
+        return total;
+    }
+
+    FeedMask& operator&=(const FeedMask& other) {
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] &= other.words[i];
+        }
+        return *this;
+    }
+
+    FeedMask& operator|=(const FeedMask& other) {
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+
+    [[nodiscard]] FeedMask operator~() const {
+        FeedMask result;
+        for (size_t i = 0; i < WORDS; ++i) {
+            result.words[i] = ~words[i];
+        }
+        return result;
+    }
+
+    friend FeedMask operator&(FeedMask a, const FeedMask& b) { return a &= b; }
+    friend FeedMask operator|(FeedMask a, const FeedMask& b) { return a |= b; }
+
+    bool operator==(const FeedMask& other) const {
+        for (size_t i = 0; i < WORDS; ++i) {
+            if (words[i] != other.words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Call fn(feedIndex) for every set bit, lowest first
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < WORDS; ++i) {
+            auto word = words[i];
+            while (word != 0) {
+                fn(i * 64 + Bits::lowest(word));
+                word &= word - 1;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t WORDS = MAX_FEEDS / 64;
+    uint64_t words[WORDS] = {};
+};
+
+#endif // FEED_MASK_H
@@ -0,0 +1,172 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed_registry.hpp"
+#include "../config/settings.hpp"
+
+RuleNode FeedDefinition::toRule() const {
+    std::vector<RuleNode> parts;
+    if (!rule.empty()) {
+        parts.push_back(FeedRule::parse(rule));
+    }
+
+    if (!keywords.empty()) {
+        std::vector<RuleNode> anyKeyword;
+        for (const auto& keyword : keywords) {
+            RulePredicate predicate;
+            predicate.kind = RulePredicate::Kind::Keyword;
+            predicate.values = {keyword};
+            predicate.options = keywordOptions;
+            anyKeyword.push_back(RuleNode::leaf(std::move(predicate)));
+        }
+        parts.push_back(RuleNode::combine(RuleNode::Type::Or, std::move(anyKeyword)));
+    }
+
+    if (!langs.empty()) {
+        RulePredicate predicate;
+        predicate.kind = RulePredicate::Kind::Lang;
+        predicate.values = langs;
+        parts.push_back(RuleNode::leaf(std::move(predicate)));
+    }
+
+    if (!includeReplies) {
+        RulePredicate predicate;
+        predicate.kind = RulePredicate::Kind::IsReply;
+        parts.push_back(RuleNode::negate(RuleNode::leaf(std::move(predicate))));
+    }
+
+    return RuleNode::combine(RuleNode::Type::And, std::move(parts));
+}
+
+FeedDefinition FeedDefinition::fromJson(const nlohmann::json& json) {
+    if (!json.is_object() || !json.contains("name")) {
+        throw FeedRegistryException("Feed definitions must be objects with a 'name'");
+    }
+
+    FeedDefinition definition;
+    definition.name = json.at("name").get<std::string>();
+    definition.followingOnly = json.value("following_only", false);
+    // Only the chronological index can be filtered by author, so following-only feeds default to it
+    definition.sort = Feed::parseSort(json.value("sort", definition.followingOnly ? "new" : "top"));
+    definition.capacity = json.value("capacity", Feed::DEFAULT_CAPACITY);
+    definition.rule = json.value("rule", "");
+    definition.keywords = json.value("keywords", std::vector<std::string>{});
+    definition.keywordOptions.caseInsensitive = !json.value("case_sensitive", false);
+    definition.keywordOptions.wholeWord = json.value("whole_word", true);
+    definition.langs = json.value("langs", std::vector<std::string>{});
+    definition.includeReplies = json.value("include_replies", true);
+    return definition;
+}
+
+FeedRegistry::FeedRegistry(std::shared_ptr<StringInterner> postUris, const size_t indexSlices)
+    : uris(std::move(postUris)), slices(indexSlices), removals(std::make_shared<Tombstones>()) {}
+
+size_t FeedRegistry::addFeed(const FeedDefinition& definition) {
+    if (built) {
+        throw FeedRegistryException("FeedRegistry::addFeed() called after build()");
+    }
+    if (hosted.size() == FeedMask::MAX_FEEDS) {
+        throw FeedRegistryException("At most " + std::to_string(FeedMask::MAX_FEEDS) + " feeds can be hosted");
+    }
+    if (definition.followingOnly && definition.sort != FeedSort::Chronological) {
+        throw FeedRegistryException("Following-only feed " + definition.name + " must be sorted chronologically");
+    }
+    for (const auto& feed : hosted) {
+        if (feed->name() == definition.name) {
+            throw FeedRegistryException("Duplicate feed name: " + definition.name);
+        }
+    }
+
+    // Compile first so that an invalid rule leaves the registry unchanged
+    const auto entry = program.add(definition.toRule());
+
+    const auto index = hosted.size();
+    auto feed = std::make_shared<Feed>(definition.name, uris, definition.sort, definition.capacity,
+                                       Feed::DEFAULT_HALF_LIFE, slices);
+    feed->setTombstones(removals);
+    feed->setFollowingOnly(definition.followingOnly);
+    hosted.push_back(std::move(feed));
+
+    entries.push_back(entry);
+    return index;
+}
+
+void FeedRegistry::build() {
+    program.build();
+    built = true;
+}
+
+FeedMask FeedRegistry::evaluate(const Post& post) const {
+    // Reused across posts so that evaluation does not allocate once warmed up
+    thread_local RuleProgram::Evaluation evaluation;
+    program.begin(evaluation, post);
+
+    FeedMask mask;
+    for (size_t index = 0; index < entries.size(); ++index) {
+        if (program.matches(entries[index], evaluation)) {
+            mask.set(index);
+        }
+    }
+    return mask;
+}
+
+void FeedRegistry::assign(const uint32_t postId, const FeedMask& mask) {
+    auto& shard = shardFor(postId);
+    std::lock_guard lock(shard.mutex);
+    shard.masks[postId] |= mask;
+}
+
+void FeedRegistry::unassign(const uint32_t postId) {
+    auto& shard = shardFor(postId);
+    std::lock_guard lock(shard.mutex);
+    shard.masks.erase(postId);
+}
+
+FeedMask FeedRegistry::membership(const uint32_t postId) const {
+    const auto& shard = shardFor(postId);
+    std::lock_guard lock(shard.mutex);
+    const auto it = shard.masks.find(postId);
+    return it == shard.masks.end() ? FeedMask{} : it->second;
+}
+
+size_t FeedRegistry::membershipCount() const {
+    size_t total = 0;
+    for (const auto& shard : memberships) {
+        std::lock_guard lock(shard.mutex);
+        total += shard.masks.size();
+    }
+    return total;
+}
+
+size_t FeedRegistry::releaseMemberships(const std::function<bool(uint32_t postId)>& unused) {
+    size_t released = 0;
+    for (auto& shard : memberships) {
+        std::lock_guard lock(shard.mutex);
+        for (auto it = shard.masks.begin(); it != shard.masks.end();) {
+            if (unused(it->first)) {
+                it = shard.masks.erase(it);
+                ++released;
+            } else {
+                ++it;
+            }
+        }
+    }
+    return released;
+}
+
+std::unique_ptr<FeedRegistry> FeedRegistry::fromSettings(Settings& settings, std::shared_ptr<StringInterner> postUris,
+                                                         const size_t indexSlices) {
+    const auto feeds = settings.get<nlohmann::json>("feeds", nlohmann::json::array());
+    if (!feeds.is_array()) {
+        throw FeedRegistryException("'feeds' in settings must be an array");
+    }
+
+    auto registry = std::make_unique<FeedRegistry>(std::move(postUris), indexSlices);
+    for (const auto& definition : feeds) {
+        registry->addFeed(FeedDefinition::fromJson(definition));
+    }
+    registry->build();
+    return registry;
+}
@@ -0,0 +1,119 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_REGISTRY_H
+#define FEED_REGISTRY_H
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "feed.hpp"
+#include "feed_mask.hpp"
+#include "feed_rule.hpp"
+#include "post.hpp"
+#include "../nlohmann/json.hpp"
+
+class Settings;
+
+class FeedRegistryException final : public std::exception {
+    std::string message;
+
+public:
+    explicit FeedRegistryException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// One entry of the "feeds" array in settings.json
+struct FeedDefinition {
+    std::string name;
+    FeedSort sort = FeedSort::Top;
+    size_t capacity = Feed::DEFAULT_CAPACITY;
+    std::string rule;                  // Rule language source, see FeedRule
+    std::vector<std::string> keywords; // Shorthand for "keyword or keyword ..."
+    KeywordMatchOptions keywordOptions;
+    std::vector<std::string> langs;    // Shorthand for "lang:<langs>"
+    bool includeReplies = true;        // false is shorthand for "not is:reply"
+    bool followingOnly = false;
+
+    // The rule and all shorthands and-ed together; an empty definition matches every post
+    [[nodiscard]] RuleNode toRule() const;
+
+    static FeedDefinition fromJson(const nlohmann::json& json);
+};
+
+// All hosted feeds and the single-pass evaluator that decides which of them a post belongs to.
+//
+// Every feed's rule is compiled into one shared RuleProgram, so a post's text is scanned at most once
+// and each distinct predicate is evaluated at most once regardless of the number of feeds.
+class FeedRegistry {
+public:
+    // Every feed's chronological index gets indexSlices slices, one per ingest shard
+    explicit FeedRegistry(std::shared_ptr<StringInterner> postUris, size_t indexSlices = 1);
+
+    // Register a feed before build(); returns its index in the mask
+    size_t addFeed(const FeedDefinition& definition);
+
+    // Compile the combined matcher; no feeds may be added afterwards
+    void build();
+
+    [[nodiscard]] FeedMask evaluate(const Post& post) const;
+
+    [[nodiscard]] const std::vector<std::shared_ptr<Feed>>& feeds() const { return hosted; }
+    [[nodiscard]] const std::shared_ptr<Feed>& feed(const size_t index) const { return hosted.at(index); }
+    [[nodiscard]] size_t size() const { return hosted.size(); }
+    [[nodiscard]] const std::shared_ptr<StringInterner>& postUris() const { return uris; }
+
+    // Deleted posts and taken-down accounts, shared by every feed; see IndexCompactor
+    [[nodiscard]] Tombstones& tombstones() { return *removals; }
+    [[nodiscard]] const Tombstones& tombstones() const { return *removals; }
+
+    // Which feeds a post was added to; shared by every ingest thread so engagement can be routed
+    void assign(uint32_t postId, const FeedMask& mask);
+    void unassign(uint32_t postId);
+    [[nodiscard]] FeedMask membership(uint32_t postId) const;
+    [[nodiscard]] size_t membershipCount() const;
+
+    // Drop the memberships of posts that unused() picks, e.g. ones every feed has evicted. Returns the
+    // number dropped.
+    size_t releaseMemberships(const std::function<bool(uint32_t postId)>& unused);
+
+    // Build and compile every feed in the "feeds" array of settings.json
+    static std::unique_ptr<FeedRegistry> fromSettings(Settings& settings, std::shared_ptr<StringInterner> postUris,
+                                                      size_t indexSlices = 1);
+
+private:
+    static constexpr size_t MEMBERSHIP_SHARDS = 16;
+
+    struct MembershipShard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint32_t, FeedMask> masks;
+    };
+
+    std::shared_ptr<StringInterner> uris;
+    size_t slices;
+    std::shared_ptr<Tombstones> removals;
+    std::vector<std::shared_ptr<Feed>> hosted;
+    RuleProgram program;
+    std::vector<uint32_t> entries; // Program entry point per feed
+    bool built = false;
+
+    std::array<MembershipShard, MEMBERSHIP_SHARDS> memberships;
+
+    [[nodiscard]] MembershipShard& shardFor(uint32_t postId) { return memberships[postId % MEMBERSHIP_SHARDS]; }
+    [[nodiscard]] const MembershipShard& shardFor(const uint32_t postId) const {
+        return memberships[postId % MEMBERSHIP_SHARDS];
+    }
+};
+
+#endif // FEED_REGISTRY_H
@@ -0,0 +1,493 @@
+//
+// Created by jayian on 1/29/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed_rule.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+    std::string lowercase(std::string value) {
+        std::transform(value.begin(), value.end(), value.begin(),
+                       [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return value;
+    }
+
+    // "en-US" and "EN" both match the rule value "en"
+    bool langMatches(const std::string_view postLang, const std::string& code) {
+        const auto primary = postLang.substr(0, postLang.find('-'));
+        if (primary.size() != code.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < code.size(); ++i) {
+            if (std::tolower(static_cast<unsigned char>(primary[i])) != code[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<std::string> splitList(const std::string& value) {
+        std::vector<std::string> items;
+        size_t start = 0;
+        while (start <= value.size()) {
+            const auto comma = std::min(value.find(',', start), value.size());
+            if (comma > start) {
+                items.push_back(value.substr(start, comma - start));
+            }
+            start = comma + 1;
+        }
+        return items;
+    }
+
+    bool sameNode(const RuleNode& a, const RuleNode& b) {
+        if (a.type != b.type || a.children.size() != b.children.size()) {
+            return false;
+        }
+        if (a.type == RuleNode::Type::Predicate && !(a.predicate == b.predicate)) {
+            return false;
+        }
+        for (size_t i = 0; i < a.children.size(); ++i) {
+            if (!sameNode(a.children[i], b.children[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct Token {
+        enum class Type { End, Open, Close, And, Or, Not, Atom };
+        Type type = Type::End;
+        std::string name;  // Predicate name before the first ':'; empty for bare keywords
+        std::string value;
+        size_t position = 0;
+    };
+
+    class Parser {
+    public:
+        explicit Parser(const std::string_view text) : text(text) { advance(); }
+
+        RuleNode parseRule() {
+            if (current.type == Token::Type::End) {
+                return RuleNode::all();
+            }
+            auto rule = parseOr();
+            if (current.type != Token::Type::End) {
+                fail("Unexpected token");
+            }
+            return rule;
+        }
+
+    private:
+        std::string_view text;
+        size_t offset = 0;
+        Token current;
+
+        [[noreturn]] void fail(const std::string& message) const {
+            throw FeedRuleException(message + " at position " + std::to_string(current.position));
+        }
+
+        std::string readQuoted() {
+            std::string value;
+            ++offset; // Opening quote
+            while (offset < text.size() && text[offset] != '"') {
+                if (text[offset] == '\\' && offset + 1 < text.size()) {
+                    ++offset;
+                }
+                value += text[offset++];
+            }
+            if (offset == text.size()) {
+                throw FeedRuleException("Unterminated quote in rule");
+            }
+            ++offset; // Closing quote
+            return value;
+        }
+
+        void advance() {
+            while (offset < text.size() && std::isspace(static_cast<unsigned char>(text[offset]))) {
+                ++offset;
+            }
+
+            current = Token{};
+            current.position = offset;
+            if (offset == text.size()) {
+                return;
+            }
+
+            const auto rest = text.substr(offset);
+            if (rest[0] == '(' || rest[0] == ')') {
+                current.type = rest[0] == '(' ? Token::Type::Open : Token::Type::Close;
+                ++offset;
+                return;
+            }
+            if (rest.substr(0, 2) == "&&" || rest.substr(0, 2) == "||") {
+                current.type = rest[0] == '&' ? Token::Type::And : Token::Type::Or;
+                offset += 2;
+                return;
+            }
+            if (rest[0] == '!') {
+                current.type = Token::Type::Not;
+                ++offset;
+                return;
+            }
+
+            current.type = Token::Type::Atom;
+            auto quoted = false;
+            while (offset < text.size()) {
+                const auto c = text[offset];
+                if (std::isspace(static_cast<unsigned char>(c)) || c == '(' || c == ')') {
+                    break;
+                }
+                if (c == '"') {
+                    current.value += readQuoted();
+                    quoted = true;
+                    continue;
+                }
+                if (c == ':' && current.name.empty() && !quoted && !current.value.empty()) {
+                    current.name = lowercase(current.value);
+                    current.value.clear();
+                    ++offset;
+                    continue;
+                }
+                current.value += c;
+                ++offset;
+            }
+
+            if (current.name.empty() && !quoted) {
+                const auto word = lowercase(current.value);
+                if (word == "and" || word == "or" || word == "not") {
+                    current.type = word == "and" ? Token::Type::And : word == "or" ? Token::Type::Or : Token::Type::Not;
+                }
+            }
+        }
+
+        RuleNode parseOr() {
+            std::vector<RuleNode> children{parseAnd()};
+            while (current.type == Token::Type::Or) {
+                advance();
+                children.push_back(parseAnd());
+            }
+            return RuleNode::combine(RuleNode::Type::Or, std::move(children));
+        }
+
+        // Adjacent terms without an operator are and-ed: "rust lang:en"
+        RuleNode parseAnd() {
+            std::vector<RuleNode> children{parseUnary()};
+            while (current.type == Token::Type::And || current.type == Token::Type::Not ||
+                   current.type == Token::Type::Open || current.type == Token::Type::Atom) {
+                if (current.type == Token::Type::And) {
+                    advance();
+                }
+                children.push_back(parseUnary());
+            }
+            return RuleNode::combine(RuleNode::Type::And, std::move(children));
+        }
+
+        RuleNode parseUnary() {
+            switch (current.type) {
+                case Token::Type::Not:
+                    advance();
+                    return RuleNode::negate(parseUnary());
+                case Token::Type::Open: {
+                    advance();
+                    auto inner = parseOr();
+                    if (current.type != Token::Type::Close) {
+                        fail("Expected ')'");
+                    }
+                    advance();
+                    return inner;
+                }
+                case Token::Type::Atom: {
+                    auto predicate = parsePredicate();
+                    advance();
+                    return RuleNode::leaf(std::move(predicate));
+                }
+                default:
+                    fail("Expected a predicate");
+            }
+        }
+
+        RulePredicate parsePredicate() const {
+            using Kind = RulePredicate::Kind;
+            const auto& name = current.name;
+            const auto& value = current.value;
+            if (value.empty()) {
+                fail("Missing value for '" + name + "'");
+            }
+
+            RulePredicate predicate;
+            if (name.empty() || name == "keyword" || name == "contains") {
+                predicate.kind = Kind::Keyword;
+                predicate.values = {value};
+                predicate.options.wholeWord = name != "contains";
+            } else if (name == "is" && lowercase(value) == "reply") {
+                predicate.kind = Kind::IsReply;
+            } else if (name == "is" && lowercase(value) == "quote") {
+                predicate.kind = Kind::IsQuote;
+            } else if (name == "has" && lowercase(value) == "media") {
+                predicate.kind = Kind::HasMedia;
+            } else if (name == "author" || name == "lang" || name == "label") {
+                predicate.kind = name == "author" ? Kind::Author : name == "lang" ? Kind::Lang : Kind::Label;
+                predicate.values = splitList(value);
+            } else {
+                fail("Unknown predicate '" + name + ":" + value + "'");
+            }
+            return predicate;
+        }
+    };
+}
+
+bool RulePredicate::operator==(const RulePredicate& other) const {
+    return kind == other.kind && values == other.values && options.caseInsensitive == other.options.caseInsensitive &&
+           options.wholeWord == other.options.wholeWord;
+}
+
+RuleNode RuleNode::leaf(RulePredicate predicate) {
+    RuleNode node;
+    node.type = Type::Predicate;
+    node.predicate = std::move(predicate);
+    return node;
+}
+
+RuleNode RuleNode::negate(RuleNode child) {
+    RuleNode node;
+    node.type = Type::Not;
+    node.children.push_back(std::move(child));
+    return node;
+}
+
+RuleNode RuleNode::combine(const Type type, std::vector<RuleNode> children) {
+    if (children.size() == 1) {
+        return std::move(children.front());
+    }
+    RuleNode node;
+    node.type = children.empty() ? Type::All : type;
+    node.children = std::move(children);
+    return node;
+}
+
+RuleNode FeedRule::parse(const std::string_view text) {
+    return Parser(text).parseRule();
+}
+
+// Rough relative cost of evaluating a subtree; keyword tests may trigger the text scan
+uint32_t RuleProgram::cost(const RuleNode& node) {
+    using Kind = RulePredicate::Kind;
+    switch (node.type) {
+        case RuleNode::Type::All:
+            return 0;
+        case RuleNode::Type::Predicate:
+            switch (node.predicate.kind) {
+                case Kind::IsReply:
+                case Kind::IsQuote:
+                case Kind::HasMedia:
+                    return 1;
+                case Kind::Author:
+                    return 2;
+                case Kind::Lang:
+                case Kind::Label:
+                    return 3;
+                case Kind::Keyword:
+                    return 8;
+            }
+            return 8;
+        default: {
+            uint32_t total = 0;
+            for (const auto& child : node.children) {
+                total += cost(child);
+            }
+            return total;
+        }
+    }
+}
+
+// Flatten nested and/or, drop double negation and duplicate operands, and order operands by cost
+RuleNode RuleProgram::simplify(const RuleNode& node) {
+    if (node.type == RuleNode::Type::Predicate || node.type == RuleNode::Type::All) {
+        return node;
+    }
+
+    if (node.type == RuleNode::Type::Not) {
+        auto child = simplify(node.children.front());
+        if (child.type == RuleNode::Type::Not) {
+            return std::move(child.children.front());
+        }
+        return RuleNode::negate(std::move(child));
+    }
+
+    std::vector<RuleNode> operands;
+    for (const auto& child : node.children) {
+        auto simplified = simplify(child);
+        if (simplified.type == RuleNode::Type::All) {
+            if (node.type == RuleNode::Type::Or) {
+                return simplified; // Anything or everything
+            }
+            continue;
+        }
+
+        std::vector<RuleNode> flattened;
+        if (simplified.type == node.type) {
+            flattened = std::move(simplified.children);
+        } else {
+            flattened.push_back(std::move(simplified));
+        }
+        for (auto& operand : flattened) {
+            const auto duplicate = std::any_of(operands.begin(), operands.end(),
+                                               [&operand](const RuleNode& existing) { return sameNode(existing, operand); });
+            if (!duplicate) {
+                operands.push_back(std::move(operand));
+            }
+        }
+    }
+
+    std::stable_sort(operands.begin(), operands.end(),
+                     [](const RuleNode& a, const RuleNode& b) { return cost(a) < cost(b); });
+    return RuleNode::combine(node.type, std::move(operands));
+}
+
+uint32_t RuleProgram::intern(const RulePredicate& predicate) {
+    auto normalized = predicate;
+    if (normalized.kind == RulePredicate::Kind::Lang) {
+        for (auto& value : normalized.values) {
+            value = lowercase(value.substr(0, value.find('-')));
+        }
+    }
+
+    for (uint32_t i = 0; i < predicates.size(); ++i) {
+        if (predicates[i].source == normalized) {
+            return i;
+        }
+    }
+
+    const auto index = static_cast<uint32_t>(predicates.size());
+    CompiledPredicate compiled{normalized, {}};
+    if (normalized.kind == RulePredicate::Kind::Author) {
+        compiled.authors.insert(normalized.values.begin(), normalized.values.end());
+    } else if (normalized.kind == RulePredicate::Kind::Keyword) {
+        matcher.addTerm(normalized.values.front(), normalized.options, index);
+    }
+    predicates.push_back(std::move(compiled));
+    return index;
+}
+
+// Emit code for node that continues at onTrue or onFalse; returns the node's entry point
+uint32_t RuleProgram::emit(const RuleNode& node, const uint32_t onTrue, const uint32_t onFalse) {
+    switch (node.type) {
+        case RuleNode::Type::All:
+            return onTrue;
+        case RuleNode::Type::Not:
+            return emit(node.children.front(), onFalse, onTrue);
+        case RuleNode::Type::Predicate: {
+            const auto predicate = intern(node.predicate);
+            code.push_back({predicate, onTrue, onFalse});
+            return static_cast<uint32_t>(code.size() - 1);
+        }
+        case RuleNode::Type::And: {
+            auto target = onTrue;
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                target = emit(*it, target, onFalse);
+            }
+            return target;
+        }
+        case RuleNode::Type::Or: {
+            auto target = onFalse;
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                target = emit(*it, onTrue, target);
+            }
+            return target;
+        }
+    }
+    return onFalse;
+}
+
+uint32_t RuleProgram::add(const RuleNode& rule) {
+    if (built) {
+        throw FeedRuleException("RuleProgram::add() called after build()");
+    }
+    if (code.size() >= ACCEPT) {
+        throw FeedRuleException("Rule program is too large");
+    }
+    return emit(simplify(rule), ACCEPT, REJECT);
+}
+
+void RuleProgram::build() {
+    matcher.build();
+    built = true;
+}
+
+void RuleProgram::begin(Evaluation& evaluation, const Post& post) const {
+    evaluation.post = &post;
+    evaluation.keywordsScanned = false;
+    if (evaluation.decided.size() != predicates.size() || ++evaluation.generation == 0) {
+        evaluation.decided.assign(predicates.size(), 0);
+        evaluation.results.assign(predicates.size(), 0);
+        evaluation.generation = 1;
+    }
+}
+
+bool RuleProgram::matches(const uint32_t entry, Evaluation& evaluation) const {
+    auto pc = entry;
+    while (pc < ACCEPT) {
+        const auto& instruction = code[pc];
+        pc = test(instruction.predicate, evaluation) ? instruction.onTrue : instruction.onFalse;
+    }
+    return pc == ACCEPT;
+}
+
+// One pass over the text resolves every keyword predicate at once: the ones it finds are recorded as
+// true, and any keyword test without a recorded result afterwards is false
+void RuleProgram::scanKeywords(Evaluation& evaluation) const {
+    evaluation.keywordsScanned = true;
+    matcher.scan(evaluation.post->text, [this, &evaluation](const KeywordMatcher::Match& match) {
+        const auto predicate = matcher.tag(match.termId);
+        evaluation.decided[predicate] = evaluation.generation;
+        evaluation.results[predicate] = 2;
+    });
+}
+
+bool RuleProgram::test(const uint32_t predicate, Evaluation& evaluation) const {
+    if (evaluation.decided[predicate] == evaluation.generation) {
+        return evaluation.results[predicate] == 2;
+    }
+
+    using Kind = RulePredicate::Kind;
+    const auto& post = *evaluation.post;
+    const auto& compiled = predicates[predicate];
+    const auto& values = compiled.source.values;
+    auto result = false;
+    switch (compiled.source.kind) {
+        case Kind::IsReply:
+            result = post.isReply();
+            break;
+        case Kind::IsQuote:
+            result = post.isQuote();
+            break;
+        case Kind::HasMedia:
+            result = post.hasMedia;
+            break;
+        case Kind::Author:
+            result = compiled.authors.count(post.authorDid) != 0;
+            break;
+        case Kind::Lang:
+            result = std::any_of(post.langs.begin(), post.langs.end(), [&values](const std::string& lang) {
+                return std::any_of(values.begin(), values.end(),
+                                   [&lang](const std::string& code) { return langMatches(lang, code); });
+            });
+            break;
+        case Kind::Label:
+            result = std::any_of(post.labels.begin(), post.labels.end(), [&values](const std::string& label) {
+                return std::find(values.begin(), values.end(), label) != values.end();
+            });
+            break;
+        case Kind::Keyword:
+            if (!evaluation.keywordsScanned) {
+                scanKeywords(evaluation);
+            }
+            return evaluation.decided[predicate] == evaluation.generation;
+    }
+
+    evaluation.decided[predicate] = evaluation.generation;
+    evaluation.results[predicate] = result ? 2 : 1;
+    return result;
+}
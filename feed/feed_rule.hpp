@@ -0,0 +1,149 @@
+//
+// Created by jayian on 1/29/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_RULE_H
+#define FEED_RULE_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "keyword_matcher.hpp"
+#include "post.hpp"
+
+class FeedRuleException final : public std::exception {
+    std::string message;
+
+public:
+    explicit FeedRuleException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// A single test against a post
+struct RulePredicate {
+    enum class Kind : uint8_t {
+        IsReply,
+        IsQuote,
+        HasMedia,
+        Author,  // values: DIDs
+        Lang,    // values: primary language subtags
+        Label,   // values: label names
+        Keyword  // values: one term, matched with options
+    };
+
+    Kind kind = Kind::IsReply;
+    std::vector<std::string> values;
+    KeywordMatchOptions options;
+
+    bool operator==(const RulePredicate& other) const;
+};
+
+// Parsed rule before compilation
+struct RuleNode {
+    enum class Type : uint8_t {
+        All, // Matches every post (an empty rule)
+        And,
+        Or,
+        Not,
+        Predicate
+    };
+
+    Type type = Type::All;
+    RulePredicate predicate;
+    std::vector<RuleNode> children;
+
+    static RuleNode all() { return {}; }
+    static RuleNode leaf(RulePredicate predicate);
+    static RuleNode negate(RuleNode child);
+    static RuleNode combine(Type type, std::vector<RuleNode> children);
+};
+
+// Parser for the rule language used by the "rule" key of a feed definition:
+//
+//   lang:en and (rust or "rust lang" or author:did:plc:abc) and not (is:reply or label:nsfw,spam)
+//
+// Predicates are is:reply, is:quote, has:media, author:<did,...>, lang:<code,...>, label:<name,...>,
+// keyword:<term> (whole word) and contains:<term> (substring); a bare word or quoted phrase is a keyword.
+// Keywords are case-insensitive. Operators are and/or/not (or &&, ||, !) with the usual precedence.
+class FeedRule {
+public:
+    static RuleNode parse(std::string_view text);
+};
+
+// Every hosted feed's rule compiled into one flat branch program.
+//
+// Each rule becomes a run of test instructions that jump to the next test or straight to accept/reject,
+// so evaluation short-circuits without recursion or a stack. Operands of and/or are reordered so cheap
+// flag checks run before set lookups and keyword matching. Identical predicates are shared by all rules
+// and evaluated at most once per post; all keyword predicates are resolved together by a single scan
+// of the text with one combined matcher, and only if some rule actually reaches a keyword test. The
+// cost per post follows the tests actually reached, not the number of predicates.
+class RuleProgram {
+public:
+    static constexpr uint32_t ACCEPT = UINT32_MAX - 1;
+    static constexpr uint32_t REJECT = UINT32_MAX;
+
+    // Per-post predicate results; reuse one per thread to avoid allocating. Results are stamped with the
+    // post's generation, so starting a new post does not touch them.
+    class Evaluation {
+    public:
+        Evaluation() = default;
+
+    private:
+        friend class RuleProgram;
+        const Post* post = nullptr;
+        uint32_t generation = 0;
+        bool keywordsScanned = false;
+        std::vector<uint32_t> decided; // Generation in which each result below was stored
+        std::vector<uint8_t> results;  // 1 = false, 2 = true
+    };
+
+    // Compile a rule before build(); returns its entry point
+    uint32_t add(const RuleNode& rule);
+
+    // Compile the keyword matcher; no rules may be added afterwards
+    void build();
+
+    // Reset the evaluation for a new post
+    void begin(Evaluation& evaluation, const Post& post) const;
+
+    [[nodiscard]] bool matches(uint32_t entry, Evaluation& evaluation) const;
+
+    [[nodiscard]] size_t predicateCount() const { return predicates.size(); }
+    [[nodiscard]] size_t instructionCount() const { return code.size(); }
+
+private:
+    struct Instruction {
+        uint32_t predicate;
+        uint32_t onTrue;
+        uint32_t onFalse;
+    };
+
+    struct CompiledPredicate {
+        RulePredicate source;
+        std::unordered_set<std::string> authors; // Author predicates only
+    };
+
+    std::vector<CompiledPredicate> predicates;
+    std::vector<Instruction> code;
+    KeywordMatcher matcher; // Terms are tagged with their predicate index
+    bool built = false;
+
+    uint32_t emit(const RuleNode& node, uint32_t onTrue, uint32_t onFalse);
+    uint32_t intern(const RulePredicate& predicate);
+    [[nodiscard]] bool test(uint32_t predicate, Evaluation& evaluation) const;
+    void scanKeywords(Evaluation& evaluation) const;
+
+    static RuleNode simplify(const RuleNode& node);
+    static uint32_t cost(const RuleNode& node);
+};
+
+#endif // FEED_RULE_H
@@ -0,0 +1,205 @@
+//
+// Created by jayian on 2/10/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "index_compactor.hpp"
+#include <algorithm>
+#include "../config/settings.hpp"
+#include "../tools/logging.hpp"
+
+IndexCompactor::IndexCompactor(const Options& options, std::shared_ptr<FeedRegistry> registry)
+    : options(options), registry(std::move(registry)) {}
+
+IndexCompactor::~IndexCompactor() {
+    stop();
+}
+
+void IndexCompactor::start() {
+    std::lock_guard lock(mutex);
+    if (running) {
+        return;
+    }
+    running = true;
+    worker = std::thread(&IndexCompactor::run, this);
+}
+
+void IndexCompactor::stop() {
+    {
+        std::lock_guard lock(mutex);
+        running = false;
+    }
+    wake.notify_all();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void IndexCompactor::run() {
+    const auto tick = std::max(std::chrono::seconds(1), std::min(options.interval, options.rankingInterval));
+    auto nextCheck = std::chrono::steady_clock::now() + options.interval;
+    std::unique_lock lock(mutex);
+    while (running) {
+        wake.wait_for(lock, tick, [this] { return !running; });
+        if (!running) {
+            break;
+        }
+        lock.unlock();
+        try {
+            refreshRankings();
+            if (std::chrono::steady_clock::now() >= nextCheck) {
+                nextCheck = std::chrono::steady_clock::now() + options.interval;
+                if (due()) {
+                    compact();
+                }
+            }
+        } catch (const std::exception& e) {
+            Logging::error("Index compaction failed: " + std::string(e.what()));
+        }
+        lock.lock();
+    }
+}
+
+void IndexCompactor::refreshRankings() {
+    const auto now = std::chrono::system_clock::now();
+    for (const auto& feed : registry->feeds()) {
+        if (feed->sort() == FeedSort::Top) {
+            feed->ranking().rebuildIfDue(now, options.rankingInterval);
+        }
+    }
+}
+
+bool IndexCompactor::due() const {
+    const auto& tombstones = registry->tombstones();
+    if (tombstones.authorCount() != authorsCompacted.load()) {
+        return true;
+    }
+    size_t indexed = 0;
+    size_t held = 0;
+    for (const auto& feed : registry->feeds()) {
+        indexed += feed->index().size();
+        held += feed->index().size() + (feed->sort() == FeedSort::Top ? feed->ranking().candidateCount() : 0);
+    }
+    // Every live membership belongs to a post some feed still holds, so many more means evictions piled up
+    if (registry->membershipCount() > 2 * held) {
+        return true;
+    }
+    const auto marked = tombstones.postCount();
+    if (marked == 0) {
+        return false;
+    }
+    return static_cast<double>(marked) >= options.threshold * static_cast<double>(std::max<size_t>(indexed, 1));
+}
+
+// Only the marks taken at the start are purged and cleared: a post marked during the pass may already
+// be past in some feeds, so it stays marked until the next pass.
+//
+// The pass also notes every post still indexed or ranked, and releases the feed memberships of posts
+// that were held nowhere at the end of this pass and the one before; the second pass covers posts that
+// were interned but not yet indexed while this one scanned.
+size_t IndexCompactor::compact() {
+    std::lock_guard pass(passMutex);
+    const auto started = std::chrono::steady_clock::now();
+    auto& tombstones = registry->tombstones();
+    const auto& uris = *registry->postUris();
+    const auto marked = tombstones.posts();
+    const auto authors = tombstones.authorCount();
+
+    std::vector<bool> referenced(uris.size());
+    const auto reference = [&](const uint32_t postId) {
+        if (postId < referenced.size()) {
+            referenced[postId] = true;
+        }
+    };
+
+    const auto dead = [&](const uint32_t postId) {
+        return std::binary_search(marked.begin(), marked.end(), postId) ||
+               (authors > 0 && tombstones.authorRemoved(Tombstones::authorOf(uris.lookup(postId))));
+    };
+
+    size_t removed = 0;
+    for (const auto& feed : registry->feeds()) {
+        auto& index = feed->index();
+        std::vector<uint32_t> dropped;
+        for (size_t slice = 0; slice < index.slices(); ++slice) {
+            size_t scanned = 0;
+            removed += index.compact(slice, [&](const FeedIndex::Entry& entry) {
+                ++scanned;
+                if (!dead(entry.postId)) {
+                    reference(entry.postId);
+                    return false;
+                }
+                dropped.push_back(entry.postId);
+                return true;
+            });
+            throttle(scanned);
+        }
+
+        if (feed->sort() == FeedSort::Top && (!marked.empty() || !dropped.empty())) {
+            // Marked posts can be ranked after the index evicted them, so drop all of them
+            for (const auto postId : marked) {
+                feed->ranking().remove(postId);
+            }
+            for (const auto postId : dropped) {
+                feed->ranking().remove(postId);
+            }
+            feed->ranking().rebuild(std::chrono::system_clock::now());
+        }
+        if (feed->sort() == FeedSort::Top) {
+            for (const auto postId : feed->ranking().candidateIds()) {
+                reference(postId);
+            }
+        }
+        // Deleted posts were unassigned when marked; posts of taken-down accounts still need it
+        for (const auto postId : dropped) {
+            registry->unassign(postId);
+        }
+    }
+
+    tombstones.clearPosts(marked);
+    authorsCompacted = authors;
+
+    const auto releasedNow = registry->releaseMemberships([&](const uint32_t postId) {
+        return postId < unreferenced.size() && unreferenced[postId] && !referenced[postId];
+    });
+    referenced.flip();
+    unreferenced = std::move(referenced);
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+    ++passes;
+    purged += removed;
+    released += releasedNow;
+    lastPassMs = static_cast<uint64_t>(elapsed.count());
+    Logging::debug("Compacted feed indexes: " + std::to_string(removed) + " entries of " +
+                   std::to_string(marked.size()) + " deleted posts and " + std::to_string(authors) +
+                   " taken-down accounts purged, " + std::to_string(releasedNow) +
+                   " memberships of evicted posts released in " + std::to_string(elapsed.count()) + "ms");
+    return removed;
+}
+
+void IndexCompactor::throttle(const size_t scanned) {
+    if (options.maxEntriesPerSecond == 0 || scanned == 0) {
+        return;
+    }
+    const auto pause = std::chrono::duration<double>(static_cast<double>(scanned) /
+                                                     static_cast<double>(options.maxEntriesPerSecond));
+    std::unique_lock lock(mutex);
+    wake.wait_for(lock, pause, [this] { return !running; });
+}
+
+IndexCompactor::Stats IndexCompactor::stats() const {
+    return Stats{passes, purged, lastPassMs, released};
+}
+
+IndexCompactor::Options IndexCompactor::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.threshold = settings.get<double>("compaction_threshold", result.threshold);
+    result.interval = std::chrono::seconds(settings.get<int64_t>("compaction_interval_seconds",
+                                                                 result.interval.count()));
+    result.maxEntriesPerSecond = settings.get<size_t>("compaction_max_entries_per_second",
+                                                      result.maxEntriesPerSecond);
+    result.rankingInterval = std::chrono::seconds(settings.get<int64_t>("ranking_refresh_seconds",
+                                                                        result.rankingInterval.count()));
+    return result;
+}
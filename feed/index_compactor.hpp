@@ -0,0 +1,102 @@
+//
+// Created by jayian on 2/10/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef INDEX_COMPACTOR_H
+#define INDEX_COMPACTOR_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "feed_registry.hpp"
+
+class Settings;
+
+// Background purge of tombstoned posts from feed indexes and rankings.
+//
+// Deletes and takedowns only mark the registry's Tombstones and feeds skip marked posts when serving,
+// so removed entries keep taking up memory and every page has to step over them. Once marked posts
+// reach threshold of the indexed entries, or another account was taken down, a pass rewrites every
+// index slice without them, drops them from the rankings and clears their marks. A pass also releases
+// the feed memberships of posts every index has evicted, and runs on its own once those pile up to twice
+// the posts the feeds hold. A pass scans at most maxEntriesPerSecond index entries per second, pausing
+// between slices, so it never holds a slice's lock for long or competes with ingest for a whole core.
+//
+// The same thread rebuilds the ranking of every Top feed each rankingInterval, which is when new
+// engagement becomes visible in those feeds (see DecayedTopK).
+class IndexCompactor {
+public:
+    struct Options {
+        double threshold = 0.05;            // Marked posts per indexed entry that trigger a pass
+        std::chrono::seconds interval{10};  // How often to check
+        size_t maxEntriesPerSecond = 2'000'000;
+        std::chrono::seconds rankingInterval{10};
+    };
+
+    struct Stats {
+        uint64_t passes = 0;
+        uint64_t entriesPurged = 0;
+        uint64_t lastPassMs = 0;
+        uint64_t membershipsReleased = 0;
+    };
+
+    IndexCompactor(const Options& options, std::shared_ptr<FeedRegistry> registry);
+    explicit IndexCompactor(std::shared_ptr<FeedRegistry> registry)
+        : IndexCompactor(Options{}, std::move(registry)) {}
+    ~IndexCompactor();
+
+    IndexCompactor(const IndexCompactor&) = delete;
+    IndexCompactor& operator=(const IndexCompactor&) = delete;
+
+    // Check every interval and compact when due, and rebuild rankings every rankingInterval, until stop()
+    void start();
+    void stop();
+
+    // Whether the marks made since the last pass call for another
+    [[nodiscard]] bool due() const;
+
+    // Run one pass now, throttled only while started. Returns the number of index entries purged.
+    size_t compact();
+
+    // Rebuild the ranking of each Top feed whose last rebuild is at least rankingInterval old
+    void refreshRankings();
+
+    [[nodiscard]] Stats stats() const;
+
+    // Reads compaction_threshold, compaction_interval_seconds, compaction_max_entries_per_second and
+    // ranking_refresh_seconds from settings.json
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    Options options;
+    std::shared_ptr<FeedRegistry> registry;
+
+    std::mutex passMutex; // One pass at a time
+    std::atomic<size_t> authorsCompacted{0};
+    std::vector<bool> unreferenced; // Post ids no index or ranking held at the end of the last pass
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    bool running = false;
+
+    std::atomic<uint64_t> passes{0};
+    std::atomic<uint64_t> purged{0};
+    std::atomic<uint64_t> lastPassMs{0};
+    std::atomic<uint64_t> released{0};
+
+    void run();
+
+    // Pause long enough to keep a pass under maxEntriesPerSecond after scanning this many entries
+    void throttle(size_t scanned);
+};
+
+#endif // INDEX_COMPACTOR_H
@@ -0,0 +1,194 @@
+//
+// Created by jayian on 1/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "keyword_matcher.hpp"
+#include <cctype>
+#include <deque>
+#include "../config/settings.hpp"
+#include "../tools/logging.hpp"
+
+static constexpr uint32_t NO_STATE = UINT32_MAX;
+
+// Letters, digits, underscore and any UTF-8 lead/continuation byte count as part of a word
+bool KeywordMatcher::isWordByte(const unsigned char c) {
+    return std::isalnum(c) || c == '_' || c >= 0x80;
+}
+
+unsigned char KeywordMatcher::fold(const unsigned char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+uint32_t KeywordMatcher::addTerm(const std::string_view term, const Options options, const uint32_t tag) {
+    if (built) {
+        throw KeywordMatcherException("Cannot add term '" + std::string(term) + "' after build()");
+    }
+    if (term.empty()) {
+        throw KeywordMatcherException("Keyword terms must not be empty");
+    }
+
+    terms.push_back({std::string(term), options, tag});
+    return static_cast<uint32_t>(terms.size() - 1);
+}
+
+// Compile the trie into a full DFA: every (state, class) pair has a precomputed transition
+void KeywordMatcher::build() {
+    if (built) {
+        return;
+    }
+
+    // Assign alphabet classes to the folded bytes that appear in any term
+    byteClass.fill(0);
+    classCount = 1;
+    for (const auto& term : terms) {
+        for (const unsigned char c : term.text) {
+            auto& cls = byteClass[fold(c)];
+            if (cls == 0) {
+                if (classCount == 256) {
+                    throw KeywordMatcherException("Too many distinct bytes in keyword terms");
+                }
+                cls = static_cast<uint8_t>(classCount++);
+            }
+        }
+    }
+    for (unsigned char c = 'A'; c <= 'Z'; ++c) {
+        byteClass[c] = byteClass[fold(c)];
+    }
+
+    // Insert every term into a trie laid out in the dense transition table
+    transitions.assign(classCount, NO_STATE);
+    std::vector<std::vector<uint32_t>> stateOutputs(1);
+    for (uint32_t id = 0; id < terms.size(); ++id) {
+        uint32_t state = 0;
+        for (const unsigned char c : terms[id].text) {
+            auto next = transitions[state * classCount + byteClass[c]];
+            if (next == NO_STATE) {
+                next = static_cast<uint32_t>(stateOutputs.size());
+                transitions[state * classCount + byteClass[c]] = next;
+                transitions.resize(transitions.size() + classCount, NO_STATE);
+                stateOutputs.emplace_back();
+            }
+            state = next;
+        }
+        stateOutputs[state].push_back(id);
+    }
+
+    // Breadth-first pass computes failure links and fills the missing transitions
+    const auto states = static_cast<uint32_t>(stateOutputs.size());
+    std::vector<uint32_t> failure(states, 0);
+    std::deque<uint32_t> queue;
+
+    for (uint32_t cls = 0; cls < classCount; ++cls) {
+        auto& next = transitions[cls];
+        if (next == NO_STATE) {
+            next = 0;
+        } else {
+            queue.push_back(next);
+        }
+    }
+
+    while (!queue.empty()) {
+        const auto state = queue.front();
+        queue.pop_front();
+
+        const auto& inherited = stateOutputs[failure[state]];
+        stateOutputs[state].insert(stateOutputs[state].end(), inherited.begin(), inherited.end());
+
+        for (uint32_t cls = 0; cls < classCount; ++cls) {
+            auto& next = transitions[state * classCount + cls];
+            const auto fallback = transitions[failure[state] * classCount + cls];
+            if (next == NO_STATE) {
+                next = fallback;
+            } else {
+                failure[next] = fallback;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Flatten the per-state outputs
+    outputOffsets.assign(states + 1, 0);
+    outputs.clear();
+    for (uint32_t state = 0; state < states; ++state) {
+        outputOffsets[state] = static_cast<uint32_t>(outputs.size());
+        outputs.insert(outputs.end(), stateOutputs[state].begin(), stateOutputs[state].end());
+    }
+    outputOffsets[states] = static_cast<uint32_t>(outputs.size());
+
+    built = true;
+    Logging::debug("KeywordMatcher built: " + std::to_string(terms.size()) + " terms, " +
+                   std::to_string(states) + " states, " + std::to_string(classCount) + " classes", false);
+}
+
+// Apply the per-term options the folded automaton cannot express
+bool KeywordMatcher::accept(const uint32_t termId, const std::string_view text, const size_t begin, const size_t end) const {
+    const auto& term = terms[termId];
+
+    if (!term.options.caseInsensitive && text.compare(begin, end - begin, term.text) != 0) {
+        return false;
+    }
+
+    if (term.options.wholeWord) {
+        const auto first = static_cast<unsigned char>(term.text.front());
+        const auto last = static_cast<unsigned char>(term.text.back());
+        if (begin > 0 && isWordByte(first) && isWordByte(static_cast<unsigned char>(text[begin - 1]))) {
+            return false;
+        }
+        if (end < text.size() && isWordByte(last) && isWordByte(static_cast<unsigned char>(text[end]))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<KeywordMatcher::Match> KeywordMatcher::findAll(const std::string_view text) const {
+    std::vector<Match> matches;
+    scan(text, [&matches](const Match& match) { matches.push_back(match); });
+    return matches;
+}
+
+// Same walk as scan(), but stops at the first accepted match
+bool KeywordMatcher::matchesAny(const std::string_view text) const {
+    if (!built) {
+        throw KeywordMatcherException("KeywordMatcher::matchesAny() called before build()");
+    }
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        state = transitions[state * classCount + byteClass[static_cast<unsigned char>(text[i])]];
+        for (auto o = outputOffsets[state]; o < outputOffsets[state + 1]; ++o) {
+            const auto termId = outputs[o];
+            if (accept(termId, text, i + 1 - terms[termId].text.size(), i + 1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Feed definitions look like:
+//   "feeds": [{"name": "rust", "keywords": ["rust", "#rustlang"], "case_sensitive": false, "whole_word": true}]
+KeywordMatcher KeywordMatcher::fromSettings(Settings& settings) {
+    const auto feeds = settings.get<nlohmann::json>("feeds", nlohmann::json::array());
+    if (!feeds.is_array()) {
+        throw KeywordMatcherException("'feeds' in settings must be an array");
+    }
+
+    KeywordMatcher matcher;
+    for (size_t index = 0; index < feeds.size(); ++index) {
+        const auto& feed = feeds[index];
+
+        Options options;
+        options.caseInsensitive = !feed.value("case_sensitive", false);
+        options.wholeWord = feed.value("whole_word", true);
+
+        for (const auto& keyword : feed.value("keywords", nlohmann::json::array())) {
+            matcher.addTerm(keyword.get<std::string>(), options, static_cast<uint32_t>(index));
+        }
+    }
+
+    matcher.build();
+    return matcher;
+}
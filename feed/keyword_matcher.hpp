@@ -0,0 +1,93 @@
+//
+// Created by jayian on 1/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef KEYWORD_MATCHER_H
+#define KEYWORD_MATCHER_H
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Settings;
+
+class KeywordMatcherException final : public std::exception {
+    std::string message;
+
+public:
+    explicit KeywordMatcherException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+struct KeywordMatchOptions {
+    bool caseInsensitive = true; // ASCII case folding
+    bool wholeWord = true;       // Match must not touch other word characters
+};
+
+// Aho-Corasick automaton compiled into a dense DFA over byte classes.
+// Every term is found in a single pass over the text, so the per-byte cost
+// does not grow with the number of terms.
+class KeywordMatcher {
+public:
+    using Options = KeywordMatchOptions;
+
+    struct Match {
+        uint32_t termId;
+        size_t begin; // Byte offsets into the scanned text
+        size_t end;
+    };
+
+    // Add a term before build(). The tag is an arbitrary caller value (e.g. a feed index).
+    uint32_t addTerm(std::string_view term, Options options = {}, uint32_t tag = 0);
+
+    // Compile the automaton; no terms may be added afterwards
+    void build();
+
+    // Invoke onMatch(const Match&) for every accepted occurrence, in order of end offset
+    template <typename Callback>
+    void scan(std::string_view text, Callback&& onMatch) const;
+
+    [[nodiscard]] std::vector<Match> findAll(std::string_view text) const;
+    [[nodiscard]] bool matchesAny(std::string_view text) const;
+
+    [[nodiscard]] bool isBuilt() const { return built; }
+    [[nodiscard]] size_t termCount() const { return terms.size(); }
+    [[nodiscard]] size_t stateCount() const { return outputOffsets.empty() ? 0 : outputOffsets.size() - 1; }
+    [[nodiscard]] const std::string& term(const uint32_t id) const { return terms.at(id).text; }
+    [[nodiscard]] uint32_t tag(const uint32_t id) const { return terms.at(id).tag; }
+
+    // Build a matcher from the "feeds" array in settings.json; each term is tagged with its feed index
+    static KeywordMatcher fromSettings(Settings& settings);
+
+private:
+    struct Term {
+        std::string text;
+        Options options;
+        uint32_t tag;
+    };
+
+    std::vector<Term> terms;
+    bool built = false;
+
+    std::array<uint8_t, 256> byteClass{}; // Case-folded byte -> alphabet class (0 = not in any term)
+    uint32_t classCount = 1;
+    std::vector<uint32_t> transitions;    // stateCount * classCount
+    std::vector<uint32_t> outputOffsets;  // stateCount + 1
+    std::vector<uint32_t> outputs;        // Term ids, including those reached through failure links
+
+    [[nodiscard]] bool accept(uint32_t termId, std::string_view text, size_t begin, size_t end) const;
+
+    static bool isWordByte(unsigned char c);
+    static unsigned char fold(unsigned char c);
+};
+
+#include "keyword_matcher.tpp"
+#endif // KEYWORD_MATCHER_H
@@ -0,0 +1,24 @@
+#ifndef KEYWORD_MATCHER_TPP
+#define KEYWORD_MATCHER_TPP
+
+template <typename Callback>
+void KeywordMatcher::scan(const std::string_view text, Callback&& onMatch) const {
+    if (!built) {
+        throw KeywordMatcherException("KeywordMatcher::scan() called before build()");
+    }
+
+    uint32_t state = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        state = transitions[state * classCount + byteClass[static_cast<unsigned char>(text[i])]];
+
+        for (auto o = outputOffsets[state]; o < outputOffsets[state + 1]; ++o) {
+            const auto termId = outputs[o];
+            const auto end = i + 1;
+            const auto begin = end - terms[termId].text.size();
+            if (accept(termId, text, begin, end)) {
+                onMatch(Match{termId, begin, end});
+            }
+        }
+    }
+}
+#endif // KEYWORD_MATCHER_TPP
@@ -0,0 +1,32 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef POST_H
+#define POST_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The parts of an app.bsky.feed.post record that feed rules look at
+struct Post {
+    std::string uri;       // at://<did>/app.bsky.feed.post/<rkey>
+    std::string cid;
+    std::string authorDid;
+    std::string text;
+    std::vector<std::string> langs;
+    std::vector<std::string> labels; // Self-labels, e.g. "nsfw"
+    std::string replyParent; // URI of the post replied to, if any
+    std::string quoteUri;    // URI of the quoted post, if any
+    bool hasMedia = false;
+    uint64_t createdAtUs = 0; // The record's createdAt; feeds key on the rkey TID instead when there is one
+
+    [[nodiscard]] bool isReply() const { return !replyParent.empty(); }
+    [[nodiscard]] bool isQuote() const { return !quoteUri.empty(); }
+};
+
+#endif // POST_H
@@ -0,0 +1,133 @@
+//
+// Created by jayian on 2/10/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "tombstones.hpp"
+#include <mutex>
+#include "../tools/bits.hpp"
+
+static constexpr std::string_view AT_SCHEME = "at://";
+
+Tombstones::Tombstones() : chunks(new std::atomic<Chunk*>[MAX_CHUNKS]) {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Tombstones::~Tombstones() {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete[] chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+std::atomic<uint64_t>* Tombstones::word(const uint32_t postId) const {
+    auto* chunk = chunks[postId >> CHUNK_BITS].load(std::memory_order_acquire);
+    return chunk == nullptr ? nullptr : &(*chunk)[(postId >> 6) & (CHUNK_WORDS - 1)];
+}
+
+// Any ingest thread may be first to touch a chunk, so allocation races are settled with a CAS
+std::atomic<uint64_t>& Tombstones::wordForWrite(const uint32_t postId) {
+    auto& entry = chunks[postId >> CHUNK_BITS];
+    auto* chunk = entry.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        auto* fresh = new Chunk[1];
+        for (auto& bits : *fresh) {
+            bits.store(0, std::memory_order_relaxed);
+        }
+        if (entry.compare_exchange_strong(chunk, fresh, std::memory_order_acq_rel)) {
+            chunk = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return (*chunk)[(postId >> 6) & (CHUNK_WORDS - 1)];
+}
+
+bool Tombstones::markPost(const uint32_t postId) {
+    const auto bit = uint64_t{1} << (postId & 63);
+    if (wordForWrite(postId).fetch_or(bit, std::memory_order_acq_rel) & bit) {
+        return false;
+    }
+    markedPosts.fetch_add(1, std::memory_order_relaxed);
+    currentVersion.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool Tombstones::postRemoved(const uint32_t postId) const {
+    const auto* bits = word(postId);
+    return bits != nullptr && (bits->load(std::memory_order_acquire) >> (postId & 63)) & 1;
+}
+
+std::vector<uint32_t> Tombstones::posts() const {
+    std::vector<uint32_t> result;
+    for (uint32_t c = 0; c < MAX_CHUNKS; ++c) {
+        const auto* chunk = chunks[c].load(std::memory_order_acquire);
+        if (chunk == nullptr) {
+            continue;
+        }
+        for (uint32_t w = 0; w < CHUNK_WORDS; ++w) {
+            for (auto bits = (*chunk)[w].load(std::memory_order_acquire); bits != 0; bits &= bits - 1) {
+                result.push_back((c << CHUNK_BITS) | (w << 6) | Bits::lowest(bits));
+            }
+        }
+    }
+    return result;
+}
+
+void Tombstones::clearPosts(const std::vector<uint32_t>& postIds) {
+    for (const auto postId : postIds) {
+        auto* bits = word(postId);
+        if (bits == nullptr) {
+            continue;
+        }
+        const auto bit = uint64_t{1} << (postId & 63);
+        if (bits->fetch_and(~bit, std::memory_order_acq_rel) & bit) {
+            markedPosts.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Tombstones::markAuthor(const std::string_view did) {
+    std::unique_lock lock(authorMutex);
+    if (!authors.emplace(did).second) {
+        return false;
+    }
+    markedAuthors.fetch_add(1, std::memory_order_relaxed);
+    currentVersion.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+bool Tombstones::unmarkAuthor(const std::string_view did) {
+    std::unique_lock lock(authorMutex);
+    if (authors.erase(std::string(did)) == 0) {
+        return false;
+    }
+    markedAuthors.fetch_sub(1, std::memory_order_relaxed);
+    currentVersion.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+std::vector<std::string> Tombstones::authorDids() const {
+    std::shared_lock lock(authorMutex);
+    return {authors.begin(), authors.end()};
+}
+
+bool Tombstones::authorRemoved(const std::string_view did) const {
+    if (markedAuthors.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    std::shared_lock lock(authorMutex);
+    return authors.find(std::string(did)) != authors.end();
+}
+
+bool Tombstones::removed(const uint32_t postId, const StringInterner& postUris) const {
+    return postRemoved(postId) || (authorCount() > 0 && authorRemoved(authorOf(postUris.lookup(postId))));
+}
+
+std::string_view Tombstones::authorOf(std::string_view uri) {
+    if (uri.substr(0, AT_SCHEME.size()) == AT_SCHEME) {
+        uri.remove_prefix(AT_SCHEME.size());
+    }
+    return uri.substr(0, uri.find('/'));
+}
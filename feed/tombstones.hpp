@@ -0,0 +1,89 @@
+//
+// Created by jayian on 2/10/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef TOMBSTONES_H
+#define TOMBSTONES_H
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "../tools/string_interner.hpp"
+
+// Posts and accounts that were removed but may still sit in feed indexes and rankings.
+//
+// Marking a post is one atomic bit set, so a delete costs the ingest thread O(1) and never touches the
+// index structures; feeds skip marked posts when serving, and IndexCompactor later purges them in the
+// background and clears their marks. Taken-down accounts are rare, so they are kept by DID in a small
+// set and checked against the author in each served post's URI. Unlike post marks, an account's mark
+// can be lifted again when it is reinstated; its posts that were not purged yet are served again.
+class Tombstones {
+public:
+    Tombstones();
+    ~Tombstones();
+
+    Tombstones(const Tombstones&) = delete;
+    Tombstones& operator=(const Tombstones&) = delete;
+
+    // Returns false if the post was already marked
+    bool markPost(uint32_t postId);
+    [[nodiscard]] bool postRemoved(uint32_t postId) const;
+
+    // Every marked post, ascending. Marks made while this runs may or may not be included.
+    [[nodiscard]] std::vector<uint32_t> posts() const;
+
+    // Once the posts are purged everywhere they were indexed
+    void clearPosts(const std::vector<uint32_t>& postIds);
+
+    [[nodiscard]] size_t postCount() const { return markedPosts.load(std::memory_order_relaxed); }
+
+    // Returns false if the account was already taken down
+    bool markAuthor(std::string_view did);
+    [[nodiscard]] bool authorRemoved(std::string_view did) const;
+
+    // Returns false if the account was not taken down
+    bool unmarkAuthor(std::string_view did);
+
+    // Every taken-down account, for checkpoints
+    [[nodiscard]] std::vector<std::string> authorDids() const;
+    [[nodiscard]] size_t authorCount() const { return markedAuthors.load(std::memory_order_relaxed); }
+
+    // Whether a served post must be skipped: it was deleted or its author taken down. The URI is only
+    // looked up while some account is taken down.
+    [[nodiscard]] bool removed(uint32_t postId, const StringInterner& postUris) const;
+
+    // Bumped on every new mark and every lifted account mark; feeds fold it into their epoch so cached
+    // pages are dropped at once
+    [[nodiscard]] uint64_t version() const { return currentVersion.load(std::memory_order_acquire); }
+
+    // The DID of an at:// URI
+    static std::string_view authorOf(std::string_view uri);
+
+private:
+    static constexpr uint32_t CHUNK_BITS = 16; // Post ids per chunk
+    static constexpr uint32_t CHUNK_WORDS = (1u << CHUNK_BITS) / 64;
+    static constexpr uint32_t MAX_CHUNKS = 1u << (32 - CHUNK_BITS);
+
+    using Chunk = std::atomic<uint64_t>[CHUNK_WORDS];
+
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    std::atomic<size_t> markedPosts{0};
+    std::atomic<uint64_t> currentVersion{0};
+
+    mutable std::shared_mutex authorMutex;
+    std::unordered_set<std::string> authors;
+    std::atomic<size_t> markedAuthors{0};
+
+    [[nodiscard]] std::atomic<uint64_t>* word(uint32_t postId) const;
+    std::atomic<uint64_t>& wordForWrite(uint32_t postId);
+};
+
+#endif // TOMBSTONES_H
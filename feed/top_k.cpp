@@ -0,0 +1,284 @@
+//
+// Created by jayian on 1/13/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "top_k.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Rebase once scaled scores grow by 2^60; doubles stay far from overflow
+static constexpr double MAX_EXPONENT = 60.0;
+
+// Candidates whose decayed score falls below this are dropped on rebuild
+static constexpr double PRUNE_THRESHOLD = 1e-3;
+
+DecayedTopK::DecayedTopK(const size_t capacity, const std::chrono::seconds halfLife, const size_t maxCandidates)
+    : limit(capacity),
+      candidateLimit(maxCandidates),
+      decayRate(halfLife.count() > 0 ? 1.0 / static_cast<double>(halfLife.count()) : 0.0) {
+    if (capacity == 0) {
+        throw std::invalid_argument("DecayedTopK capacity must be positive");
+    }
+    heap.reserve(capacity);
+}
+
+double DecayedTopK::toSeconds(const Clock::time_point at) {
+    return std::chrono::duration<double>(at.time_since_epoch()).count();
+}
+
+// Multiplier for an event at the given time, relative to the reference time
+double DecayedTopK::scaleFor(const double seconds) {
+    if (candidates.empty() || referenceTime == 0.0) {
+        referenceTime = seconds;
+    }
+
+    const auto exponent = (seconds - referenceTime) * decayRate;
+    if (exponent > MAX_EXPONENT) {
+        rebase(seconds);
+        return 1.0;
+    }
+    return std::exp2(exponent);
+}
+
+// Move the reference time forward, decaying every stored score; relative order is unchanged
+void DecayedTopK::rebase(const double seconds) {
+    const auto factor = std::exp2(-(seconds - referenceTime) * decayRate);
+    for (auto& [postId, candidate] : candidates) {
+        candidate.scaled *= factor;
+    }
+    referenceTime = seconds;
+}
+
+void DecayedTopK::add(const uint32_t postId, const double weight, const Clock::time_point at) {
+    std::lock_guard lock(mutex);
+
+    const auto scale = scaleFor(toSeconds(at));
+    auto& candidate = candidates[postId];
+    candidate.scaled += weight * scale;
+
+    if (candidate.heapIndex == NOT_IN_HEAP) {
+        offer(postId);
+        return;
+    }
+
+    // Members move down the min-heap when they improve and up when they weaken
+    const auto index = static_cast<size_t>(candidate.heapIndex);
+    if (weight >= 0) {
+        siftDown(index);
+    } else {
+        siftUp(index);
+    }
+}
+
+void DecayedTopK::remove(const uint32_t postId) {
+    std::lock_guard lock(mutex);
+
+    const auto it = candidates.find(postId);
+    if (it == candidates.end()) {
+        return;
+    }
+    const auto member = it->second.heapIndex != NOT_IN_HEAP;
+    if (member) {
+        heapRemove(static_cast<size_t>(it->second.heapIndex));
+    }
+    candidates.erase(it);
+    if (member) {
+        publish();
+    }
+}
+
+void DecayedTopK::rebuild(const Clock::time_point now) {
+    std::lock_guard lock(mutex);
+    lastRebuild = now;
+
+    if (candidates.empty()) {
+        heap.clear();
+        publish();
+        return;
+    }
+
+    // After rebasing to now, scaled scores are the true decayed scores
+    rebase(toSeconds(now));
+
+    std::vector<std::pair<double, uint32_t>> ordered;
+    ordered.reserve(candidates.size());
+    for (auto it = candidates.begin(); it != candidates.end();) {
+        if (std::fabs(it->second.scaled) < PRUNE_THRESHOLD) {
+            it = candidates.erase(it);
+            continue;
+        }
+        it->second.heapIndex = NOT_IN_HEAP;
+        ordered.emplace_back(it->second.scaled, it->first);
+        ++it;
+    }
+
+    const auto byScoreDescending = [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second > b.second;
+    };
+
+    // Bound the candidate set so memory stays proportional to maxCandidates
+    if (candidateLimit > 0 && ordered.size() > candidateLimit) {
+        std::nth_element(ordered.begin(), ordered.begin() + static_cast<std::ptrdiff_t>(candidateLimit),
+                         ordered.end(), byScoreDescending);
+        for (auto it = ordered.begin() + static_cast<std::ptrdiff_t>(candidateLimit); it != ordered.end(); ++it) {
+            candidates.erase(it->second);
+        }
+        ordered.resize(candidateLimit);
+    }
+
+    const auto members = std::min(limit, ordered.size());
+    if (members < ordered.size()) {
+        std::nth_element(ordered.begin(), ordered.begin() + static_cast<std::ptrdiff_t>(members),
+                         ordered.end(), byScoreDescending);
+    }
+
+    heap.clear();
+    for (size_t i = 0; i < members; ++i) {
+        place(heap.size(), ordered[i].second);
+        siftUp(heap.size() - 1);
+    }
+    publish();
+}
+
+bool DecayedTopK::rebuildIfDue(const Clock::time_point now, const std::chrono::seconds interval) {
+    {
+        std::lock_guard lock(mutex);
+        if (now - lastRebuild < interval) {
+            return false;
+        }
+    }
+    rebuild(now);
+    return true;
+}
+
+std::shared_ptr<const std::vector<uint32_t>> DecayedTopK::sortedMembers() const {
+    auto ordered = heap;
+    std::sort(ordered.begin(), ordered.end(), [this](const uint32_t a, const uint32_t b) { return less(b, a); });
+    return std::make_shared<const std::vector<uint32_t>>(std::move(ordered));
+}
+
+void DecayedTopK::publish() {
+    published = sortedMembers();
+    ++currentVersion;
+}
+
+std::shared_ptr<const std::vector<uint32_t>> DecayedTopK::ranked() const {
+    std::lock_guard lock(mutex);
+    if (!published) {
+        published = sortedMembers(); // Same version: nothing was published before
+    }
+    return published;
+}
+
+double DecayedTopK::score(const uint32_t postId, const Clock::time_point now) const {
+    std::lock_guard lock(mutex);
+
+    const auto it = candidates.find(postId);
+    if (it == candidates.end()) {
+        return 0.0;
+    }
+    return it->second.scaled * std::exp2(-(toSeconds(now) - referenceTime) * decayRate);
+}
+
+uint64_t DecayedTopK::version() const {
+    std::lock_guard lock(mutex);
+    return currentVersion;
+}
+
+size_t DecayedTopK::size() const {
+    std::lock_guard lock(mutex);
+    return heap.size();
+}
+
+size_t DecayedTopK::candidateCount() const {
+    std::lock_guard lock(mutex);
+    return candidates.size();
+}
+
+std::vector<uint32_t> DecayedTopK::candidateIds() const {
+    std::lock_guard lock(mutex);
+    std::vector<uint32_t> ids;
+    ids.reserve(candidates.size());
+    for (const auto& [postId, candidate] : candidates) {
+        ids.push_back(postId);
+    }
+    return ids;
+}
+
+// Ties are broken by post id so that newer posts (higher interned ids) rank first
+bool DecayedTopK::less(const uint32_t a, const uint32_t b) const {
+    const auto scoreA = candidates.at(a).scaled;
+    const auto scoreB = candidates.at(b).scaled;
+    return scoreA != scoreB ? scoreA < scoreB : a < b;
+}
+
+void DecayedTopK::place(const size_t index, const uint32_t postId) {
+    if (index == heap.size()) {
+        heap.push_back(postId);
+    } else {
+        heap[index] = postId;
+    }
+    candidates[postId].heapIndex = static_cast<int>(index);
+}
+
+void DecayedTopK::siftUp(size_t index) {
+    const auto postId = heap[index];
+    while (index > 0) {
+        const auto parent = (index - 1) / 2;
+        if (!less(postId, heap[parent])) {
+            break;
+        }
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, postId);
+}
+
+void DecayedTopK::siftDown(size_t index) {
+    const auto postId = heap[index];
+    const auto count = heap.size();
+    while (true) {
+        auto smallest = 2 * index + 1;
+        if (smallest >= count) {
+            break;
+        }
+        if (smallest + 1 < count && less(heap[smallest + 1], heap[smallest])) {
+            ++smallest;
+        }
+        if (!less(heap[smallest], postId)) {
+            break;
+        }
+        place(index, heap[smallest]);
+        index = smallest;
+    }
+    place(index, postId);
+}
+
+void DecayedTopK::heapRemove(const size_t index) {
+    candidates[heap[index]].heapIndex = NOT_IN_HEAP;
+
+    const auto last = heap.back();
+    heap.pop_back();
+    if (index < heap.size()) {
+        place(index, last);
+        siftUp(index);
+        siftDown(static_cast<size_t>(candidates[last].heapIndex));
+    }
+}
+
+// Admit a non-member if there is room or it beats the weakest member
+void DecayedTopK::offer(const uint32_t postId) {
+    if (heap.size() < limit) {
+        place(heap.size(), postId);
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    if (less(heap[0], postId)) {
+        candidates[heap[0]].heapIndex = NOT_IN_HEAP;
+        place(0, postId);
+        siftDown(0);
+    }
+}
@@ -0,0 +1,100 @@
+//
+// Created by jayian on 1/13/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Incrementally maintained top-K set under exponential time decay.
+//
+// Scores are stored relative to a reference time t0: an event of weight w at time t adds
+// w * 2^((t - t0) / halfLife). Decay multiplies every score by the same factor, so the order never
+// changes with time alone and no per-tick work is needed; t0 is only moved forward (rescaling all
+// scores once) when the exponent grows large. Each event costs O(log K).
+//
+// Lowering a member's score or removing a member can leave a better candidate outside the heap;
+// rebuild() recomputes the set from all candidates to catch that drift and prunes dead candidates.
+//
+// Readers see a published snapshot rather than the live heap: engagement reorders the heap on every
+// event, and republishing on each one would re-sort it under the ingest lock and invalidate every cached
+// page. A new ranking is published only by rebuild() and by remove(), so callers rebuild on an interval.
+class DecayedTopK {
+public:
+    using Clock = std::chrono::system_clock;
+
+    DecayedTopK(size_t capacity, std::chrono::seconds halfLife, size_t maxCandidates = 0);
+
+    // Add weight (may be negative) to a post's score as of the given event time
+    void add(uint32_t postId, double weight, Clock::time_point at);
+
+    // Drop a post entirely (deleted or taken down)
+    void remove(uint32_t postId);
+
+    // Recompute the top-K from every candidate and prune candidates that decayed to nothing
+    void rebuild(Clock::time_point now);
+
+    // Rebuild if at least interval has passed since the last rebuild
+    bool rebuildIfDue(Clock::time_point now, std::chrono::seconds interval);
+
+    // The last published members, best first (the live members before the first publish). The snapshot is
+    // shared and immutable.
+    [[nodiscard]] std::shared_ptr<const std::vector<uint32_t>> ranked() const;
+
+    // Decayed score at time now; 0 for unknown posts
+    [[nodiscard]] double score(uint32_t postId, Clock::time_point now) const;
+
+    // Increases whenever a new ranking is published
+    [[nodiscard]] uint64_t version() const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t candidateCount() const;
+    [[nodiscard]] std::vector<uint32_t> candidateIds() const;
+    [[nodiscard]] size_t capacity() const { return limit; }
+
+private:
+    static constexpr int NOT_IN_HEAP = -1;
+
+    struct Candidate {
+        double scaled = 0.0;
+        int heapIndex = NOT_IN_HEAP;
+    };
+
+    const size_t limit;
+    const size_t candidateLimit;
+    const double decayRate; // log2 growth per second: 1 / halfLife
+
+    mutable std::mutex mutex;
+    double referenceTime = 0.0; // t0 in seconds since the epoch
+    std::unordered_map<uint32_t, Candidate> candidates;
+    std::vector<uint32_t> heap; // Min-heap on scaled score, heap[0] is the weakest member
+    uint64_t currentVersion = 0;
+    Clock::time_point lastRebuild{};
+    mutable std::shared_ptr<const std::vector<uint32_t>> published;
+
+    [[nodiscard]] std::shared_ptr<const std::vector<uint32_t>> sortedMembers() const;
+    void publish();
+
+    double scaleFor(double seconds);
+    void rebase(double seconds);
+
+    [[nodiscard]] bool less(uint32_t a, uint32_t b) const;
+    void place(size_t index, uint32_t postId);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+    void heapRemove(size_t index);
+    void offer(uint32_t postId);
+
+    static double toSeconds(Clock::time_point at);
+};
+
+#endif // TOP_K_H
@@ -0,0 +1,234 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "follow_graph.hpp"
+#include <algorithm>
+#include "../tools/varint.hpp"
+
+FollowGraph::FollowGraph(const size_t memoryBudgetBytes) : budget(memoryBudgetBytes) {}
+
+std::string FollowGraph::pack(const std::vector<uint32_t>& sorted) {
+    std::string packed;
+    packed.reserve(sorted.size() * 3);
+
+    uint32_t previous = 0;
+    for (const auto subject : sorted) {
+        Varint::append(packed, subject - previous);
+        previous = subject;
+    }
+    packed.shrink_to_fit();
+    return packed;
+}
+
+std::vector<uint32_t> FollowGraph::unpack(const Adjacency& adjacency) {
+    std::vector<uint32_t> result;
+    result.reserve(adjacency.packedCount + adjacency.added.size());
+
+    // Merge the packed list with the pending buffers in one sorted pass
+    auto added = adjacency.added.begin();
+    auto removed = adjacency.removed.begin();
+    size_t position = 0;
+    uint64_t delta = 0;
+    uint32_t current = 0;
+    for (uint32_t i = 0; i < adjacency.packedCount && Varint::read(adjacency.packed, position, delta); ++i) {
+        current += static_cast<uint32_t>(delta);
+        while (added != adjacency.added.end() && *added < current) {
+            result.push_back(*added++);
+        }
+        while (removed != adjacency.removed.end() && *removed < current) {
+            ++removed;
+        }
+        if (removed != adjacency.removed.end() && *removed == current) {
+            continue;
+        }
+        result.push_back(current);
+    }
+    result.insert(result.end(), added, adjacency.added.end());
+    return result;
+}
+
+bool FollowGraph::packedContains(const Adjacency& adjacency, const uint32_t subject) {
+    size_t position = 0;
+    uint64_t delta = 0;
+    uint32_t current = 0;
+    for (uint32_t i = 0; i < adjacency.packedCount && Varint::read(adjacency.packed, position, delta); ++i) {
+        current += static_cast<uint32_t>(delta);
+        if (current >= subject) {
+            return current == subject;
+        }
+    }
+    return false;
+}
+
+void FollowGraph::setFollows(const uint32_t viewer, std::vector<uint32_t> subjects) {
+    std::sort(subjects.begin(), subjects.end());
+    subjects.erase(std::unique(subjects.begin(), subjects.end()), subjects.end());
+
+    std::lock_guard lock(mutex);
+    auto [it, inserted] = viewers.try_emplace(viewer);
+    auto& adjacency = it->second;
+    if (inserted) {
+        lru.push_front(viewer);
+        adjacency.recency = lru.begin();
+    } else {
+        usedBytes -= adjacency.bytes();
+        touch(adjacency);
+    }
+
+    adjacency.packed = pack(subjects);
+    adjacency.packedCount = static_cast<uint32_t>(subjects.size());
+    adjacency.added = {};
+    adjacency.removed = {};
+    usedBytes += adjacency.bytes();
+
+    enforceBudget(viewer);
+}
+
+bool FollowGraph::addFollow(const uint32_t viewer, const uint32_t subject) {
+    std::lock_guard lock(mutex);
+    const auto it = viewers.find(viewer);
+    if (it == viewers.end()) {
+        return false;
+    }
+
+    auto& adjacency = it->second;
+    usedBytes -= adjacency.bytes();
+
+    const auto removed = std::lower_bound(adjacency.removed.begin(), adjacency.removed.end(), subject);
+    if (removed != adjacency.removed.end() && *removed == subject) {
+        adjacency.removed.erase(removed);
+    } else if (!packedContains(adjacency, subject)) {
+        const auto added = std::lower_bound(adjacency.added.begin(), adjacency.added.end(), subject);
+        if (added == adjacency.added.end() || *added != subject) {
+            adjacency.added.insert(added, subject);
+        }
+    }
+
+    compact(adjacency);
+    usedBytes += adjacency.bytes();
+    enforceBudget(viewer);
+    return true;
+}
+
+bool FollowGraph::removeFollow(const uint32_t viewer, const uint32_t subject) {
+    std::lock_guard lock(mutex);
+    const auto it = viewers.find(viewer);
+    if (it == viewers.end()) {
+        return false;
+    }
+
+    auto& adjacency = it->second;
+    usedBytes -= adjacency.bytes();
+
+    const auto added = std::lower_bound(adjacency.added.begin(), adjacency.added.end(), subject);
+    if (added != adjacency.added.end() && *added == subject) {
+        adjacency.added.erase(added);
+    } else if (packedContains(adjacency, subject)) {
+        const auto removed = std::lower_bound(adjacency.removed.begin(), adjacency.removed.end(), subject);
+        if (removed == adjacency.removed.end() || *removed != subject) {
+            adjacency.removed.insert(removed, subject);
+        }
+    }
+
+    compact(adjacency);
+    usedBytes += adjacency.bytes();
+    return true;
+}
+
+void FollowGraph::removeViewer(const uint32_t viewer) {
+    std::lock_guard lock(mutex);
+    const auto it = viewers.find(viewer);
+    if (it == viewers.end()) {
+        return;
+    }
+    usedBytes -= it->second.bytes();
+    lru.erase(it->second.recency);
+    viewers.erase(it);
+}
+
+bool FollowGraph::hasViewer(const uint32_t viewer) const {
+    std::lock_guard lock(mutex);
+    return viewers.count(viewer) > 0;
+}
+
+bool FollowGraph::follows(const uint32_t viewer, const uint32_t subject) const {
+    std::lock_guard lock(mutex);
+    const auto it = viewers.find(viewer);
+    if (it == viewers.end()) {
+        return false;
+    }
+
+    const auto& adjacency = it->second;
+    touch(adjacency);
+    if (std::binary_search(adjacency.added.begin(), adjacency.added.end(), subject)) {
+        return true;
+    }
+    if (std::binary_search(adjacency.removed.begin(), adjacency.removed.end(), subject)) {
+        return false;
+    }
+    return packedContains(adjacency, subject);
+}
+
+std::optional<std::vector<uint32_t>> FollowGraph::following(const uint32_t viewer) const {
+    std::lock_guard lock(mutex);
+    const auto it = viewers.find(viewer);
+    if (it == viewers.end()) {
+        return std::nullopt;
+    }
+    touch(it->second);
+    return unpack(it->second);
+}
+
+std::vector<uint32_t> FollowGraph::intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    std::vector<uint32_t> result;
+    result.reserve(std::min(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+size_t FollowGraph::memoryBytes() const {
+    std::lock_guard lock(mutex);
+    return usedBytes;
+}
+
+size_t FollowGraph::viewerCount() const {
+    std::lock_guard lock(mutex);
+    return viewers.size();
+}
+
+uint64_t FollowGraph::evictions() const {
+    std::lock_guard lock(mutex);
+    return evictionCount;
+}
+
+// Fold the pending buffers back into the packed list once they reach 1/8 of its size
+void FollowGraph::compact(Adjacency& adjacency) {
+    const auto pending = adjacency.added.size() + adjacency.removed.size();
+    if (pending < std::max<size_t>(16, adjacency.packedCount / 8)) {
+        return;
+    }
+
+    const auto merged = unpack(adjacency);
+    adjacency.packed = pack(merged);
+    adjacency.packedCount = static_cast<uint32_t>(merged.size());
+    adjacency.added = {};
+    adjacency.removed = {};
+}
+
+void FollowGraph::touch(const Adjacency& adjacency) const {
+    lru.splice(lru.begin(), lru, adjacency.recency);
+}
+
+// Evict least recently used viewers, but never the one just written
+void FollowGraph::enforceBudget(const uint32_t keep) {
+    while (usedBytes > budget && lru.size() > 1) {
+        const auto victim = lru.back() == keep ? *std::prev(lru.end(), 2) : lru.back();
+        const auto it = viewers.find(victim);
+        usedBytes -= it->second.bytes();
+        lru.erase(it->second.recency);
+        viewers.erase(it);
+        ++evictionCount;
+    }
+}
@@ -0,0 +1,85 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FOLLOW_GRAPH_H
+#define FOLLOW_GRAPH_H
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Follow lists of active viewers over interned DIDs.
+//
+// Each list is stored as delta-encoded varints (typically 2-3 bytes per follow) plus small sorted
+// buffers of follows/unfollows applied from the event stream since the last compaction. When the
+// total exceeds the memory budget, the least recently used viewers are evicted and must be fetched
+// again on their next request.
+class FollowGraph {
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 256ULL * 1024 * 1024;
+
+    explicit FollowGraph(size_t memoryBudgetBytes = DEFAULT_MEMORY_BUDGET);
+
+    // Replace a viewer's follow list (e.g. after fetching it); subjects need not be sorted
+    void setFollows(uint32_t viewer, std::vector<uint32_t> subjects);
+
+    // Apply a follow/unfollow event. Ignored (returns false) for viewers that are not tracked.
+    bool addFollow(uint32_t viewer, uint32_t subject);
+    bool removeFollow(uint32_t viewer, uint32_t subject);
+
+    void removeViewer(uint32_t viewer);
+
+    [[nodiscard]] bool hasViewer(uint32_t viewer) const;
+    [[nodiscard]] bool follows(uint32_t viewer, uint32_t subject) const;
+
+    // Sorted follow list; nullopt if the viewer is not tracked (never fetched or evicted)
+    [[nodiscard]] std::optional<std::vector<uint32_t>> following(uint32_t viewer) const;
+
+    // Sorted intersection of two sorted id lists
+    static std::vector<uint32_t> intersect(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+
+    [[nodiscard]] size_t memoryBytes() const;
+    [[nodiscard]] size_t viewerCount() const;
+    [[nodiscard]] uint64_t evictions() const;
+
+private:
+    // Rough per-viewer bookkeeping cost: hash map node, LRU node and the Adjacency itself
+    static constexpr size_t VIEWER_OVERHEAD = 128;
+
+    struct Adjacency {
+        std::string packed;            // Sorted subjects, delta + varint encoded
+        uint32_t packedCount = 0;
+        std::vector<uint32_t> added;   // Sorted, absent from packed
+        std::vector<uint32_t> removed; // Sorted, present in packed
+        std::list<uint32_t>::iterator recency;
+
+        [[nodiscard]] size_t bytes() const {
+            return VIEWER_OVERHEAD + packed.capacity() + (added.capacity() + removed.capacity()) * sizeof(uint32_t);
+        }
+    };
+
+    const size_t budget;
+    mutable std::mutex mutex;
+    std::unordered_map<uint32_t, Adjacency> viewers;
+    mutable std::list<uint32_t> lru; // Most recently used first
+    size_t usedBytes = 0;
+    uint64_t evictionCount = 0;
+
+    static std::string pack(const std::vector<uint32_t>& sorted);
+    static std::vector<uint32_t> unpack(const Adjacency& adjacency);
+    static bool packedContains(const Adjacency& adjacency, uint32_t subject);
+
+    void compact(Adjacency& adjacency);
+    void touch(const Adjacency& adjacency) const;
+    void enforceBudget(uint32_t keep);
+};
+
+#endif // FOLLOW_GRAPH_H
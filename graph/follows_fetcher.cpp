@@ -0,0 +1,91 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "follows_fetcher.hpp"
+#include <atomic>
+#include <thread>
+#include "follow_graph.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/logging.hpp"
+#include "../tools/string_interner.hpp"
+
+FollowsFetcher::FollowsFetcher(std::string host, std::string bearerToken, const size_t parallelism)
+    : host(std::move(host)), bearerToken(std::move(bearerToken)), parallelism(std::max<size_t>(1, parallelism)) {}
+
+FollowsFetcher::Result FollowsFetcher::fetch(const std::string& actor) const {
+    Result result;
+    result.actor = actor;
+
+    HTTPSClient client;
+    client.setHost(host);
+    client.setEndpoint("/xrpc/app.bsky.graph.getFollows");
+    client.setBearerToken(bearerToken);
+    client.addQueryParam("actor", actor);
+    client.addQueryParam("limit", std::to_string(PAGE_SIZE));
+
+    for (int page = 0; page < MAX_PAGES; ++page) {
+        const auto response = client.get();
+        if (!response.is_object() || !response.contains("follows")) {
+            // A truncated list would replace the stored one as if complete, so drop the partial result
+            Logging::error("getFollows failed for " + actor + " on page " + std::to_string(page));
+            return {actor, {}, {}};
+        }
+
+        if (result.did.empty() && response.contains("subject")) {
+            result.did = response["subject"].value("did", "");
+        }
+        for (const auto& follow : response["follows"]) {
+            result.follows.push_back(follow.value("did", ""));
+        }
+
+        const auto cursor = response.value("cursor", "");
+        if (cursor.empty() || response["follows"].empty()) {
+            break;
+        }
+        client.addQueryParam("cursor", cursor);
+    }
+    return result;
+}
+
+std::vector<FollowsFetcher::Result> FollowsFetcher::fetchAll(const std::vector<std::string>& actors) const {
+    std::vector<Result> results(actors.size());
+    std::atomic<size_t> next{0};
+
+    const auto worker = [&] {
+        for (auto i = next.fetch_add(1); i < actors.size(); i = next.fetch_add(1)) {
+            results[i] = fetch(actors[i]);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(parallelism, actors.size()); ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    return results;
+}
+
+size_t FollowsFetcher::load(FollowGraph& graph, StringInterner& dids, const std::vector<std::string>& viewers) const {
+    size_t loaded = 0;
+    for (const auto& result : fetchAll(viewers)) {
+        if (result.did.empty()) {
+            continue;
+        }
+
+        std::vector<uint32_t> subjects;
+        subjects.reserve(result.follows.size());
+        for (const auto& did : result.follows) {
+            if (!did.empty()) {
+                subjects.push_back(dids.intern(did));
+            }
+        }
+        graph.setFollows(dids.intern(result.did), std::move(subjects));
+        ++loaded;
+    }
+    return loaded;
+}
@@ -0,0 +1,46 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FOLLOWS_FETCHER_H
+#define FOLLOWS_FETCHER_H
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+class FollowGraph;
+class StringInterner;
+
+// Pages through app.bsky.graph.getFollows via HTTPSClient. Several actors are fetched
+// concurrently; each worker thread keeps its own keep-alive connection to the API host.
+class FollowsFetcher {
+public:
+    struct Result {
+        std::string actor;              // As requested (handle or DID)
+        std::string did;                // Resolved subject DID; empty if any page failed
+        std::vector<std::string> follows;
+    };
+
+    FollowsFetcher(std::string host, std::string bearerToken, size_t parallelism = DEFAULT_PARALLELISM);
+
+    [[nodiscard]] Result fetch(const std::string& actor) const;
+    [[nodiscard]] std::vector<Result> fetchAll(const std::vector<std::string>& actors) const;
+
+    // Fetch each viewer's follows and store them in the graph; returns how many viewers were loaded.
+    // Viewers whose fetch failed keep the follows already in the graph.
+    size_t load(FollowGraph& graph, StringInterner& dids, const std::vector<std::string>& viewers) const;
+
+private:
+    static constexpr size_t DEFAULT_PARALLELISM = 8;
+    static constexpr int PAGE_SIZE = 100;
+    static constexpr int MAX_PAGES = 200; // 20k follows
+
+    std::string host;
+    std::string bearerToken;
+    size_t parallelism;
+};
+
+#endif // FOLLOWS_FETCHER_H
@@ -3,10 +3,165 @@
 // Copyright (c) 2024 Interlaced Pixel. All rights reserved.
 //
 
+#include <fstream>
+#include <mutex>
 #include "../actor/getProfile.cpp"
+#include "../auth/service_auth.hpp"
 #include "../network/oauth_client.hpp"
+#include "../feed/feed_registry.hpp"
+#include "../feed/index_compactor.hpp"
+#include "../graph/follow_graph.hpp"
+#include "../graph/follows_fetcher.hpp"
+#include "../identity/did_resolver.hpp"
+#include "../ingest/backfill.hpp"
+#include "../ingest/car_reader.hpp"
+#include "../ingest/firehose_frame.hpp"
+#include "../ingest/firehose_subscriber.hpp"
+#include "../ingest/index_checkpoint.hpp"
+#include "../ingest/ingest_pipeline.hpp"
+#include "../ingest/ingestor.hpp"
+#include "../server/feed_server.hpp"
+#include "../tools/metrics.hpp"
+#include "../tools/rate_limiter.hpp"
+#include "../tools/tracing.hpp"
 #include "command_handler.hpp"
 
+// State for the background feed server started by the 'serve' command
+static std::unique_ptr<FeedServer> feedServer;
+static bool serviceReady = false;
+
+// Follow lists of viewers, shared with personalized feeds
+static auto actorDids = std::make_shared<StringInterner>();
+static auto followGraph = std::make_shared<FollowGraph>();
+
+// Hosted feeds and the ingest stages that fill them, shared by 'serve' and 'backfill'
+static std::shared_ptr<FeedRegistry> feedRegistry;
+static nlohmann::json feedDefinitions; // The "feeds" setting the registry was built from
+static std::shared_ptr<EngagementCounters> engagement;
+static std::vector<std::unique_ptr<Ingestor>> ingestors; // One per ingest shard, used only by its thread
+
+// Every ingest source feeds this pipeline; the firehose subscriber is its receive stage once started
+static std::unique_ptr<IngestPipeline> pipeline;
+static std::unique_ptr<FirehoseSubscriber> firehose;
+static FirehoseSubscriber::Options firehoseOptions; // What the running subscriber was started with
+
+// The backfill in progress, if any, so that shutdown() can interrupt it
+static std::mutex backfillMutex;
+static Backfill* activeBackfill = nullptr;
+static bool backfillStopped = false; // Set by stopBackfill(); later backfills stop at once
+
+// Publishes a running backfill for stopBackfill() until it goes out of scope
+struct ActiveBackfill {
+    explicit ActiveBackfill(Backfill& backfill) {
+        std::lock_guard lock(backfillMutex);
+        activeBackfill = &backfill;
+        if (backfillStopped) {
+            backfill.stop();
+        }
+    }
+    ~ActiveBackfill() {
+        std::lock_guard lock(backfillMutex);
+        activeBackfill = nullptr;
+    }
+};
+
+// Purges deleted posts and taken-down accounts from the feed indexes in the background
+static std::unique_ptr<IndexCompactor> compactor;
+
+// Feed state and firehose cursor, restored on first use and saved by the pipeline and shutdown()
+static std::unique_ptr<IndexCheckpoint> checkpoint;
+
+// Shared DID document and handle cache, restored from disk on first use and saved by shutdown()
+static std::shared_ptr<DidResolver> identity;
+
+static DidResolver& ensureIdentity(Settings& settings) {
+    if (!identity) {
+        identity = std::make_shared<DidResolver>(DidResolver::optionsFromSettings(settings));
+        const auto restored = identity->load();
+        if (restored > 0) {
+            Logging::info("Restored " + std::to_string(restored) + " cached identities");
+        }
+    }
+    return *identity;
+}
+
+// Signing keys for ServiceAuth. A first lookup may be served from the identity cache (warm after a
+// restart); refreshes, asked for when ServiceAuth's own copy expired or failed to verify a token, bypass
+// it to pick up rotated keys.
+static std::optional<std::string> resolveSigningKey(const std::string& did, const bool refresh) {
+    if (refresh) {
+        identity->invalidate(did);
+    }
+    const auto document = identity->resolveDid(did);
+    if (!document || document->signingKey.empty()) {
+        return std::nullopt;
+    }
+    return document->signingKey;
+}
+
+// Ingest state read on each scrape of /metrics. The pipeline, compactor and registry are never
+// destroyed once built, so the samplers can hold on to them.
+static void registerIngestMetrics() {
+    auto& metrics = Metrics::global();
+    const auto stages = pipeline->stats();
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const auto labels = "{stage=\"" + stages[i].name + "\"}";
+        metrics.sample("bluesky_ingest_queue_depth" + labels, "Items waiting in the queue in front of an ingest stage",
+                       Metrics::Type::Gauge, [i] { return static_cast<double>(pipeline->stats()[i].queue.depth); });
+        metrics.sample("bluesky_ingest_processed_total" + labels, "Items an ingest stage has processed",
+                       Metrics::Type::Counter, [i] { return static_cast<double>(pipeline->stats()[i].processed); });
+        metrics.sample("bluesky_ingest_busy_seconds_total" + labels, "Time an ingest stage spent working",
+                       Metrics::Type::Counter, [i] { return static_cast<double>(pipeline->stats()[i].busyNs) / 1e9; });
+        metrics.sample("bluesky_ingest_stalled_seconds_total" + labels,
+                       "Time producers spent blocked on a full ingest queue", Metrics::Type::Counter,
+                       [i] { return static_cast<double>(pipeline->stats()[i].queue.pushStallNs) / 1e9; });
+    }
+    metrics.sample("bluesky_ingest_last_seq", "Sequence number of the newest firehose commit routed",
+                   Metrics::Type::Gauge, [] { return static_cast<double>(pipeline->lastSeq()); });
+    metrics.sample("bluesky_ingest_malformed_frames_total", "Firehose frames that could not be decoded",
+                   Metrics::Type::Counter, [] { return static_cast<double>(pipeline->malformedFrames()); });
+    metrics.sample("bluesky_tombstoned_posts", "Deleted posts waiting for compaction", Metrics::Type::Gauge,
+                   [] { return static_cast<double>(feedRegistry->tombstones().postCount()); });
+    metrics.sample("bluesky_compaction_purged_entries_total", "Index entries purged by compaction",
+                   Metrics::Type::Counter, [] { return static_cast<double>(compactor->stats().entriesPurged); });
+}
+
+// Build the feed registry, ingest shards and pipeline from settings on first use
+static void ensureIngest(Settings& settings) {
+    if (feedRegistry) {
+        return;
+    }
+    auto pipelineOptions = IngestPipeline::optionsFromSettings(settings);
+    pipelineOptions.shards = IngestPipeline::shardCountFor(pipelineOptions);
+
+    feedRegistry = FeedRegistry::fromSettings(settings, std::make_shared<StringInterner>(), pipelineOptions.shards);
+    feedDefinitions = settings.get<nlohmann::json>("feeds", nlohmann::json::array());
+    engagement = std::make_shared<EngagementCounters>();
+    engagement->startMerging(std::chrono::seconds(1));
+
+    // Each shard sees only its share of the accounts, so it needs only that share of the dedupe window
+    auto dedupe = DedupeFilter::optionsFromSettings(settings);
+    dedupe.itemsPerGeneration = std::max<size_t>(1, dedupe.itemsPerGeneration / pipelineOptions.shards);
+    for (size_t i = 0; i < pipelineOptions.shards; ++i) {
+        ingestors.push_back(std::make_unique<Ingestor>(feedRegistry, actorDids, engagement, dedupe, followGraph));
+    }
+    pipeline = std::make_unique<IngestPipeline>(pipelineOptions, [](const size_t shard, const IngestEvent& event) {
+        ingestors[shard]->ingest(event);
+    });
+
+    checkpoint = std::make_unique<IndexCheckpoint>(IndexCheckpoint::optionsFromSettings(settings), feedRegistry,
+                                                   actorDids, engagement);
+    if (const auto seq = checkpoint->load()) {
+        pipeline->resumeAfter(*seq);
+    }
+    pipeline->setCheckpointer(checkpoint->interval(), [](const int64_t seq) { checkpoint->saveInBackground(seq); });
+    pipeline->start();
+
+    compactor = std::make_unique<IndexCompactor>(IndexCompactor::optionsFromSettings(settings), feedRegistry);
+    compactor->start();
+    registerIngestMetrics();
+}
+
 // Execute a command
 void CommandHandler::executeCommand(const std::string& command, const std::vector<std::string>& args) {
     if (command == "getprofile") {
@@ -15,6 +170,18 @@ void CommandHandler::executeCommand(const std::string& command, const std::vecto
         handleMetadata();
     } else if (command == "oauth") {
         handleOAuth();
+    } else if (command == "follows") {
+        handleFollows(args);
+    } else if (command == "serve") {
+        handleServe(args);
+    } else if (command == "backfill") {
+        handleBackfill(args);
+    } else if (command == "import") {
+        handleImport(args);
+    } else if (command == "firehose") {
+        handleFirehose(args);
+    } else if (command == "trace") {
+        handleTrace(args);
     } else if (command == "help") {
         printHelp();
     } else {
@@ -30,6 +197,7 @@ void CommandHandler::handleGetProfile(const std::vector<std::string>& args) {
     }
 
     const auto identity = std::string(args[0]);
+    Trace trace("getprofile");
     const auto profile = GetProfile(identity);
     std::cout << profile.getData() << std::endl;
 }
@@ -47,12 +215,356 @@ void CommandHandler::handleOAuth() {
     std::cout << "Access Token: " << client.getAccessToken() << std::endl;
 }
 
+void CommandHandler::handleFollows(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "Error: follows requires at least one actor." << std::endl;
+        return;
+    }
+
+    const auto settings = Settings::createInstance();
+    const FollowsFetcher fetcher(settings->get<std::string>("public_api"), settings->get<std::string>("accessToken"),
+                                 settings->get<size_t>("follows_parallelism", 8));
+
+    const auto loaded = fetcher.load(*followGraph, *actorDids, args);
+    Logging::info("Loaded follows for " + std::to_string(loaded) + "/" + std::to_string(args.size()) +
+                  " actors; follow graph holds " + std::to_string(followGraph->viewerCount()) + " viewers in " +
+                  std::to_string(followGraph->memoryBytes()) + " bytes");
+}
+
+void CommandHandler::handleServe(const std::vector<std::string>& args) {
+    if (!args.empty() && args[0] == "stop") {
+        if (feedServer) {
+            feedServer->stop();
+            feedServer.reset();
+            Logging::info("Feed server stopped.");
+        }
+        return;
+    }
+
+    if (feedServer && feedServer->isRunning()) {
+        Logging::info("Feed server is already running on port " + std::to_string(feedServer->port()));
+        return;
+    }
+
+    try {
+        const auto settings = Settings::createInstance();
+        ensureIngest(*settings);
+        ensureIdentity(*settings);
+        if (!settings->hasKey("cursor_secret")) {
+            settings->set("cursor_secret", CursorCodec::generateSecret());
+        }
+        feedServer = std::make_unique<FeedServer>(settings->get<std::string>("service_did"),
+                                                  settings->get<std::string>("publisher_did"),
+                                                  settings->get<std::string>("cursor_secret"));
+
+        for (const auto& feed : feedRegistry->feeds()) {
+            feedServer->addFeed(feed);
+        }
+
+        // Personalized feeds identify the viewer from the AppView's service-auth token
+        ServiceAuth::Options authOptions;
+        authOptions.keyTtl = std::chrono::seconds(settings->get<int64_t>("auth_key_ttl_seconds", authOptions.keyTtl.count()));
+        feedServer->setAuth(std::make_shared<ServiceAuth>(settings->get<std::string>("service_did"), resolveSigningKey,
+                                                          authOptions));
+        feedServer->setFollowsLookup([](const std::string& viewerDid) -> std::optional<std::vector<uint32_t>> {
+            const auto viewer = actorDids->find(viewerDid);
+            return viewer ? followGraph->following(*viewer) : std::nullopt;
+        });
+
+        const auto host = settings->get<std::string>("feed_host", "0.0.0.0");
+        const auto port = settings->get<int>("feed_port", 3000);
+        feedServer->setReady(serviceReady);
+        if (!feedServer->start(host, port)) {
+            feedServer.reset();
+            return;
+        }
+
+        // /metrics and /debug/trace stay off the public port; a negative admin_port turns them off
+        const auto adminHost = settings->get<std::string>("admin_host", "127.0.0.1");
+        const auto adminPort = settings->get<int>("admin_port", 3001);
+        if (adminPort >= 0) {
+            feedServer->startAdmin(adminHost, adminPort);
+        }
+    } catch (const std::exception& e) {
+        Logging::error("Failed to start feed server: " + std::string(e.what()));
+        feedServer.reset();
+    }
+}
+
+void CommandHandler::handleBackfill(const std::vector<std::string>& args) {
+    try {
+        const auto settings = Settings::createInstance();
+        ensureIngest(*settings);
+
+        auto options = Backfill::optionsFromSettings(*settings);
+        options.bearerToken = settings->get<std::string>("accessToken", "");
+        const auto rate = settings->get<double>("backfill_requests_per_second", 10.0);
+        Backfill backfill(options, std::make_shared<RateLimiter>(rate, rate * 2), [](const IngestEvent& event) {
+            pipeline->pushEvent(event);
+        });
+
+        auto authors = args;
+        if (!authors.empty() && authors.front() == "reset") {
+            backfill.reset();
+            authors.erase(authors.begin());
+            Logging::info("Backfill progress cleared.");
+        }
+        if (authors.empty()) {
+            authors = settings->get<std::vector<std::string>>("backfill_authors", {});
+        }
+        if (authors.empty()) {
+            std::cerr << "Error: backfill needs authors as arguments or in 'backfill_authors'." << std::endl;
+            return;
+        }
+
+        const auto started = std::chrono::steady_clock::now();
+        const auto result = [&] {
+            ActiveBackfill active(backfill);
+            return backfill.run(authors);
+        }();
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started);
+        Logging::info("Backfill " + std::string(result.interrupted ? "interrupted" : "finished") + " in " +
+                      std::to_string(seconds.count()) + "s: " + std::to_string(result.posts) + " posts from " +
+                      std::to_string(result.authorsCompleted) + " authors (" + std::to_string(result.authorsSkipped) +
+                      " already done, " + std::to_string(result.authorsFailed) + " failed)");
+    } catch (const std::exception& e) {
+        Logging::error("Backfill failed: " + std::string(e.what()));
+    }
+}
+
+void CommandHandler::handleImport(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        std::cerr << "Error: import requires at least one CAR file." << std::endl;
+        return;
+    }
+
+    try {
+        const auto settings = Settings::createInstance();
+        ensureIngest(*settings);
+        const auto maxAge = Backfill::optionsFromSettings(*settings).maxAge;
+
+        for (const auto& path : args) {
+            const auto started = std::chrono::steady_clock::now();
+            const auto car = CarReader::open(path);
+            const auto repo = car->did();
+            if (repo.empty()) {
+                Logging::error(path + " is not a repo export");
+                continue;
+            }
+
+            // Like backfill, only recent posts are imported and each keeps its own time for ranking
+            const auto now = std::chrono::system_clock::now();
+            const auto cutoff = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>((now - maxAge).time_since_epoch()).count());
+            size_t posts = 0;
+            IngestEvent event;
+
+            car->forEachRecord("app.bsky.feed.post", [&](const std::string_view recordPath, const std::string_view cid,
+                                                         const std::string_view block) {
+                if (!FirehoseFrame::postEvent(repo, recordPath, cid, block, event) ||
+                    event.post.createdAtUs < cutoff) {
+                    return;
+                }
+                const auto created = std::chrono::system_clock::time_point(
+                    std::chrono::microseconds(event.post.createdAtUs));
+                event.time = std::min(now, created);
+                pipeline->pushEvent(event);
+                ++posts;
+            });
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started);
+            Logging::info("Imported " + std::to_string(posts) + " posts by " + std::string(repo) + " from " +
+                          std::to_string(car->blockCount()) + " blocks (" + std::to_string(car->size() >> 20) +
+                          " MB) in " + std::to_string(elapsed.count()) + "ms");
+        }
+    } catch (const std::exception& e) {
+        Logging::error("Import failed: " + std::string(e.what()));
+    }
+}
+
+void CommandHandler::handleFirehose(const std::vector<std::string>& args) {
+    if (!args.empty() && args[0] == "stop") {
+        if (firehose) {
+            firehose->stop();
+            firehose.reset();
+            Logging::info("Firehose stopped.");
+        }
+        return;
+    }
+
+    if (!args.empty() && args[0] == "stats") {
+        if (firehose) {
+            std::cout << "receive: " << firehose->frames() << " frames, " << (firehose->bytes() >> 20) << " MB, "
+                      << firehose->reconnects() << " reconnects"
+                      << (firehose->isConnected() ? "" : " (disconnected)") << std::endl;
+        }
+        if (!pipeline) {
+            std::cout << "Ingest pipeline is not running." << std::endl;
+            return;
+        }
+        for (const auto& stage : pipeline->stats()) {
+            std::cout << stage.name << ": " << stage.processed << " processed, queue " << stage.queue.depth << "/"
+                      << stage.queue.highWaterMark << ", busy " << stage.busyNs / 1'000'000 << "ms, idle "
+                      << stage.queue.popWaitNs / 1'000'000 << "ms, upstream stalled "
+                      << stage.queue.pushStallNs / 1'000'000 << "ms" << std::endl;
+        }
+        std::cout << "last seq " << pipeline->lastSeq() << " (indexed " << pipeline->indexedSeq() << "), "
+                  << pipeline->malformedFrames() << " malformed, " << pipeline->replayedFrames() << " replayed frames"
+                  << std::endl;
+        const auto& tombstones = feedRegistry->tombstones();
+        const auto compaction = compactor->stats();
+        std::cout << "compaction: " << tombstones.postCount() << " deleted posts and " << tombstones.authorCount()
+                  << " taken-down accounts marked, " << compaction.passes << " passes purged "
+                  << compaction.entriesPurged << " entries and released " << compaction.membershipsReleased
+                  << " memberships, last took " << compaction.lastPassMs << "ms" << std::endl;
+        return;
+    }
+
+    if (firehose && firehose->isRunning()) {
+        Logging::info("Firehose is already running.");
+        return;
+    }
+
+    try {
+        const auto settings = Settings::createInstance();
+        ensureIngest(*settings);
+        firehoseOptions = FirehoseSubscriber::optionsFromSettings(*settings);
+        firehose = std::make_unique<FirehoseSubscriber>(firehoseOptions,
+                                                        [](std::string&& frame) {
+                                                            return pipeline->pushFrame(std::move(frame));
+                                                        },
+                                                        [] { return pipeline->lastSeq(); });
+        firehose->start();
+    } catch (const std::exception& e) {
+        Logging::error("Failed to start firehose: " + std::string(e.what()));
+        firehose.reset();
+    }
+}
+
+void CommandHandler::handleTrace(const std::vector<std::string>& args) {
+    if (args.size() == 2 && args[0] == "save") {
+        std::ofstream out(args[1], std::ios::trunc);
+        out << Tracing::exportChromeJson();
+        if (!out) {
+            Logging::error("Failed to write trace to " + args[1]);
+            return;
+        }
+        Logging::info("Trace written to " + args[1] + "; open it in https://ui.perfetto.dev");
+        return;
+    }
+    if (args.size() == 1 && args[0] == "clear") {
+        Tracing::clear();
+        return;
+    }
+    if (args.size() == 1) {
+        try {
+            const auto every = args[0] == "off" ? 0 : std::stoul(args[0]);
+            Tracing::setSampleEvery(static_cast<uint32_t>(every));
+            Logging::info(every == 0 ? "Tracing is off." : "Tracing one in every " + std::to_string(every) +
+                                                          " requests per thread.");
+            return;
+        } catch (const std::exception&) {
+            // Fall through to the usage
+        }
+    }
+    std::cerr << "Usage: trace <every>|off|clear|save <file.json>" << std::endl;
+}
+
+bool CommandHandler::isRunning(const std::string& command) {
+    if (command == "serve") {
+        return feedServer && feedServer->isRunning();
+    }
+    if (command == "firehose") {
+        return firehose && firehose->isRunning();
+    }
+    return true;
+}
+
+void CommandHandler::stopBackfill() {
+    std::lock_guard lock(backfillMutex);
+    backfillStopped = true;
+    if (activeBackfill) {
+        activeBackfill->stop();
+    }
+}
+
+void CommandHandler::setReady(const bool ready) {
+    serviceReady = ready;
+    if (feedServer) {
+        feedServer->setReady(ready);
+    }
+}
+
+void CommandHandler::reload() {
+    try {
+        const auto settings = Settings::createInstance();
+        Tracing::setSampleEvery(settings->get<uint32_t>("trace_sample_every", 0));
+
+        // A firehose with a new read timeout resumes after the last commit it routed. Another relay numbers
+        // its commits on its own, so pointed elsewhere it starts from that relay's live position.
+        const auto options = FirehoseSubscriber::optionsFromSettings(*settings);
+        const auto relayChanged = options.url != firehoseOptions.url;
+        if (firehose && (relayChanged || options.readTimeout != firehoseOptions.readTimeout)) {
+            handleFirehose({"stop"});
+            if (relayChanged) {
+                pipeline->resetSequence();
+                Logging::info("Following " + options.url + " from its live position.");
+            }
+            handleFirehose({});
+        }
+
+        if (feedRegistry && settings->get<nlohmann::json>("feeds", nlohmann::json::array()) != feedDefinitions) {
+            Logging::error("Feed definitions changed; restart to apply them.");
+        }
+        Logging::info("Settings reloaded.");
+    } catch (const std::exception& e) {
+        Logging::error("Failed to reload settings: " + std::string(e.what()));
+    }
+}
+
+void CommandHandler::shutdown() {
+    // Leave the feed server answering while draining, but tell load balancers to stop sending traffic
+    setReady(false);
+    stopBackfill();
+
+    // Stop the source first so the pipeline can drain what it already accepted
+    if (firehose) {
+        firehose->stop();
+        firehose.reset();
+    }
+    if (pipeline) {
+        pipeline->stop();
+        // Drained, so every accepted commit is in the index and the checkpoint covers all of them
+        const auto stages = pipeline->stats();
+        if (std::any_of(stages.begin(), stages.end(), [](const auto& stage) { return stage.processed > 0; })) {
+            checkpoint->save(pipeline->indexedSeq());
+        }
+    }
+    if (compactor) {
+        compactor->stop();
+    }
+    if (feedServer) {
+        feedServer->stop();
+        feedServer.reset();
+    }
+    if (identity) {
+        identity->save();
+    }
+}
+
 // Print help message
 void CommandHandler::printHelp() {
     std::cout << "Available commands:" << std::endl;
     std::cout << "  getprofile <name>     - Returns details for the specified profile" << std::endl;
     std::cout << "  oauth                 - Authenticates the OAuth client with Bluesky API" << std::endl;
     std::cout << "  metadata              - Assists with creating a client-metadata.json file." << std::endl;
+    std::cout << "  follows <actor...>    - Fetches follow lists into the follow graph" << std::endl;
+    std::cout << "  serve [stop]          - Starts (or stops) the feed generator HTTP server" << std::endl;
+    std::cout << "  backfill [reset] [actor...] - Loads recent posts by these (or backfill_authors) actors" << std::endl;
+    std::cout << "  import <file.car...>  - Loads recent posts from repo exports (com.atproto.sync.getRepo)" << std::endl;
+    std::cout << "  firehose [stop|stats] - Follows (or stops following) the relay firehose into the hosted feeds" << std::endl;
+    std::cout << "  trace <n|off|clear|save file> - Samples one in n requests into spans, or saves them as a Chrome trace" << std::endl;
     std::cout << "  help                  - Shows this help message" << std::endl;
     std::cout << "  exit                  - Exit the program" << std::endl;
 }
\ No newline at end of file
@@ -24,6 +24,40 @@ public:
 
     static void handleOAuth();
 
+    // Fetch follow lists for personalized feeds
+    static void handleFollows(const std::vector<std::string>& args);
+
+    // Start or stop the feed generator server in the background
+    static void handleServe(const std::vector<std::string>& args);
+
+    // Load recent history for a seed set of authors into the hosted feeds
+    static void handleBackfill(const std::vector<std::string>& args);
+
+    // Load recent posts from repo export CAR files into the hosted feeds
+    static void handleImport(const std::vector<std::string>& args);
+
+    // Follow the relay firehose through the ingest pipeline, or report its stage statistics
+    static void handleFirehose(const std::vector<std::string>& args);
+
+    // Set the tracing sample rate, or save the recorded spans as Chrome trace-event JSON
+    static void handleTrace(const std::vector<std::string>& args);
+
+    // Whether the service a command starts ('serve', 'firehose') is up; true for commands without one
+    static bool isRunning(const std::string& command);
+
+    // Ask a backfill in progress on another thread, and any started later, to stop after the requests in flight
+    static void stopBackfill();
+
+    // Mark the service ready (or not) on the feed server's /ready route, now and for a server started later
+    static void setReady(bool ready);
+
+    // Apply settings held by long-running services; everything else is read afresh by each command.
+    // Feed definitions are compiled into the index once, so changing them takes a restart.
+    static void reload();
+
+    // Stop background services and persist caches before exiting
+    static void shutdown();
+
     // Print help message for available commands
     static void printHelp();
 };
@@ -0,0 +1,217 @@
+//
+// Created by jayian on 2/5/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "did_resolver.hpp"
+#include <filesystem>
+#include <fstream>
+#include "../config/settings.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/logging.hpp"
+
+static constexpr std::string_view DID_PLC_PREFIX = "did:plc:";
+static constexpr std::string_view DID_WEB_PREFIX = "did:web:";
+
+static bool matchesFragment(const std::string& id, const std::string& did, const std::string& fragment) {
+    return id == fragment || id == did + fragment;
+}
+
+std::optional<DidDocument> DidDocument::fromJson(const std::string& did, const nlohmann::json& document) {
+    if (!document.is_object() || document.value("id", "") != did) {
+        return std::nullopt;
+    }
+
+    try {
+        DidDocument result;
+        result.did = did;
+        for (const auto& alias : document.value("alsoKnownAs", nlohmann::json::array())) {
+            const auto value = alias.get<std::string>();
+            if (value.rfind("at://", 0) == 0) {
+                result.handle = value.substr(5);
+                break;
+            }
+        }
+        for (const auto& method : document.value("verificationMethod", nlohmann::json::array())) {
+            if (matchesFragment(method.value("id", ""), did, "#atproto")) {
+                result.signingKey = method.value("publicKeyMultibase", "");
+            }
+        }
+        for (const auto& service : document.value("service", nlohmann::json::array())) {
+            const auto endpoint = service.find("serviceEndpoint");
+            if (matchesFragment(service.value("id", ""), did, "#atproto_pds") && endpoint != service.end() &&
+                endpoint->is_string()) {
+                result.pdsEndpoint = endpoint->get<std::string>();
+            }
+        }
+        return result;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+// The same shape as a DID document, so a saved entry is parsed by fromJson
+nlohmann::json DidDocument::toJson() const {
+    nlohmann::json document = {{"id", did}};
+    if (!handle.empty()) {
+        document["alsoKnownAs"] = {"at://" + handle};
+    }
+    if (!signingKey.empty()) {
+        document["verificationMethod"] = {{{"id", did + "#atproto"}, {"publicKeyMultibase", signingKey}}};
+    }
+    if (!pdsEndpoint.empty()) {
+        document["service"] = {{{"id", "#atproto_pds"}, {"serviceEndpoint", pdsEndpoint}}};
+    }
+    return document;
+}
+
+DidResolver::DidResolver(const Options& options)
+    : DidResolver(options, nullptr, nullptr) {}
+
+DidResolver::DidResolver(const Options& options, DocumentFetcher fetchDocument, HandleFetcher fetchHandle)
+    : options(options),
+      fetchDocument(std::move(fetchDocument)),
+      fetchHandle(std::move(fetchHandle)),
+      dids(options.ttl, options.negativeTtl, options.maxEntries),
+      handles(options.ttl, options.negativeTtl, options.maxEntries) {
+    if (!this->fetchDocument) {
+        this->fetchDocument = [this](const std::string& did) { return fetchDocumentOverHttps(did); };
+    }
+    if (!this->fetchHandle) {
+        this->fetchHandle = [this](const std::string& handle) { return fetchHandleOverHttps(handle); };
+    }
+}
+
+std::optional<nlohmann::json> DidResolver::fetchDocumentOverHttps(const std::string& did) const {
+    HTTPSClient client;
+    if (did.rfind(DID_PLC_PREFIX, 0) == 0) {
+        client.setHost(options.plcHost);
+        client.setEndpoint("/" + did);
+    } else if (did.rfind(DID_WEB_PREFIX, 0) == 0 && did.find(':', DID_WEB_PREFIX.size()) == std::string::npos) {
+        client.setHost(did.substr(DID_WEB_PREFIX.size()));
+        client.setEndpoint("/.well-known/did.json");
+    } else {
+        return std::nullopt;
+    }
+
+    auto document = client.get();
+    if (!document.is_object()) {
+        return std::nullopt;
+    }
+    return document;
+}
+
+std::optional<std::string> DidResolver::fetchHandleOverHttps(const std::string& handle) const {
+    HTTPSClient client;
+    client.setHost(options.handleHost);
+    client.setEndpoint("/xrpc/com.atproto.identity.resolveHandle");
+    client.addQueryParam("handle", handle);
+
+    const auto response = client.get();
+    const auto did = response.is_object() ? response.value("did", "") : "";
+    return did.empty() ? std::nullopt : std::optional<std::string>(did);
+}
+
+std::shared_ptr<const DidDocument> DidResolver::resolveDid(const std::string& did) {
+    const auto resolved = dids.get(did, [this](const std::string& key) -> std::optional<std::shared_ptr<const DidDocument>> {
+        const auto document = fetchDocument(key);
+        const auto parsed = document ? DidDocument::fromJson(key, *document) : std::nullopt;
+        if (!parsed) {
+            return std::nullopt;
+        }
+        return std::make_shared<const DidDocument>(*parsed);
+    });
+    return resolved ? *resolved : nullptr;
+}
+
+std::optional<std::string> DidResolver::resolveHandle(const std::string& handle) {
+    return handles.get(handle, fetchHandle);
+}
+
+std::optional<std::string> DidResolver::resolveActor(const std::string& actor) {
+    if (actor.rfind("did:", 0) == 0) {
+        return actor;
+    }
+    return resolveHandle(actor);
+}
+
+void DidResolver::invalidate(const std::string& didOrHandle) {
+    dids.erase(didOrHandle);
+    handles.erase(didOrHandle);
+}
+
+bool DidResolver::save() const {
+    nlohmann::json store = {{"dids", nlohmann::json::object()}, {"handles", nlohmann::json::object()}};
+    const auto expiresAt = [](const SingleFlightCache<std::string>::Clock::time_point expires) {
+        return std::chrono::duration_cast<std::chrono::seconds>(expires.time_since_epoch()).count();
+    };
+    dids.forEach([&](const std::string& did, const std::shared_ptr<const DidDocument>& document, const auto expires) {
+        store["dids"][did] = {{"document", document->toJson()}, {"expires", expiresAt(expires)}};
+    });
+    handles.forEach([&](const std::string& handle, const std::string& did, const auto expires) {
+        store["handles"][handle] = {{"did", did}, {"expires", expiresAt(expires)}};
+    });
+
+    // Written to a temporary file and renamed so that a crash never leaves a truncated store
+    const auto temporary = options.storePath + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file) {
+            Logging::error("Unable to write identity cache to " + temporary);
+            return false;
+        }
+        file << store.dump();
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, options.storePath, error);
+    if (error) {
+        Logging::error("Unable to save identity cache: " + error.message());
+        return false;
+    }
+    return true;
+}
+
+size_t DidResolver::load() {
+    std::ifstream file(options.storePath);
+    if (!file) {
+        return 0;
+    }
+
+    size_t restored = 0;
+    try {
+        const auto store = nlohmann::json::parse(file);
+        const auto now = SingleFlightCache<std::string>::Clock::now();
+        const auto expiresAt = [](const nlohmann::json& entry) {
+            return SingleFlightCache<std::string>::Clock::time_point(std::chrono::seconds(entry.value("expires", int64_t{0})));
+        };
+
+        const auto savedDids = store.value("dids", nlohmann::json::object());
+        for (const auto& [did, entry] : savedDids.items()) {
+            const auto document = DidDocument::fromJson(did, entry.value("document", nlohmann::json::object()));
+            if (document && expiresAt(entry) > now) {
+                dids.put(did, std::make_shared<const DidDocument>(*document), expiresAt(entry));
+                ++restored;
+            }
+        }
+        const auto savedHandles = store.value("handles", nlohmann::json::object());
+        for (const auto& [handle, entry] : savedHandles.items()) {
+            if (expiresAt(entry) > now) {
+                handles.put(handle, entry.value("did", ""), expiresAt(entry));
+                ++restored;
+            }
+        }
+    } catch (const nlohmann::json::exception& e) {
+        Logging::error("Ignoring unreadable identity cache " + options.storePath + ": " + e.what());
+    }
+    return restored;
+}
+
+DidResolver::Options DidResolver::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.plcHost = settings.get<std::string>("plc_host", result.plcHost);
+    result.handleHost = settings.get<std::string>("handle_resolver_host", result.handleHost);
+    result.ttl = std::chrono::seconds(settings.get<int64_t>("identity_ttl_seconds", result.ttl.count()));
+    result.negativeTtl = std::chrono::seconds(settings.get<int64_t>("identity_negative_ttl_seconds", result.negativeTtl.count()));
+    result.storePath = settings.get<std::string>("identity_cache_path", result.storePath);
+    return result;
+}
@@ -0,0 +1,86 @@
+//
+// Created by jayian on 2/5/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef DID_RESOLVER_H
+#define DID_RESOLVER_H
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include "single_flight_cache.hpp"
+#include "../nlohmann/json.hpp"
+
+class Settings;
+
+// The parts of a DID document that the rest of the service uses
+struct DidDocument {
+    std::string did;
+    std::string handle;      // From alsoKnownAs at://<handle>; unverified
+    std::string signingKey;  // publicKeyMultibase of #atproto
+    std::string pdsEndpoint; // serviceEndpoint of #atproto_pds
+
+    static std::optional<DidDocument> fromJson(const std::string& did, const nlohmann::json& document);
+    [[nodiscard]] nlohmann::json toJson() const;
+};
+
+// Shared resolver for did:plc / did:web documents and handles.
+//
+// Results are cached in memory (failures for a shorter time) with concurrent misses collapsed into one
+// fetch, and can be saved to disk so a restart begins warm. A cached lookup is one hash lookup under a
+// shared lock.
+class DidResolver {
+public:
+    using DocumentFetcher = std::function<std::optional<nlohmann::json>(const std::string& did)>;
+    using HandleFetcher = std::function<std::optional<std::string>(const std::string& handle)>;
+
+    struct Options {
+        std::string plcHost = "plc.directory";
+        std::string handleHost = "public.api.bsky.app"; // Serves com.atproto.identity.resolveHandle
+        std::chrono::seconds ttl{6 * 3600};
+        std::chrono::seconds negativeTtl{300};
+        size_t maxEntries = 1'000'000;
+        std::string storePath = "identity_cache.json";
+    };
+
+    explicit DidResolver(const Options& options);
+
+    // Replace network access, e.g. with an in-process fake or a mock server
+    DidResolver(const Options& options, DocumentFetcher fetchDocument, HandleFetcher fetchHandle);
+
+    [[nodiscard]] std::shared_ptr<const DidDocument> resolveDid(const std::string& did);
+    [[nodiscard]] std::optional<std::string> resolveHandle(const std::string& handle);
+
+    // A DID passes through; a handle is resolved
+    [[nodiscard]] std::optional<std::string> resolveActor(const std::string& actor);
+
+    // Drop cached data after an identity event
+    void invalidate(const std::string& didOrHandle);
+
+    // Persist unexpired positive entries; returns false if the file could not be written
+    bool save() const;
+    // Restore entries saved by save(); returns the number restored
+    size_t load();
+
+    [[nodiscard]] size_t cachedDids() const { return dids.size(); }
+    [[nodiscard]] uint64_t fetches() const { return dids.loads() + handles.loads(); }
+
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    Options options;
+    DocumentFetcher fetchDocument;
+    HandleFetcher fetchHandle;
+    SingleFlightCache<std::shared_ptr<const DidDocument>> dids;
+    SingleFlightCache<std::string> handles;
+
+    [[nodiscard]] std::optional<nlohmann::json> fetchDocumentOverHttps(const std::string& did) const;
+    [[nodiscard]] std::optional<std::string> fetchHandleOverHttps(const std::string& handle) const;
+};
+
+#endif // DID_RESOLVER_H
@@ -0,0 +1,72 @@
+//
+// Created by jayian on 2/5/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef SINGLE_FLIGHT_CACHE_H
+#define SINGLE_FLIGHT_CACHE_H
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// String-keyed cache for slow lookups (network resolution). Hits take a shared lock and one hash lookup.
+// Failed lookups are cached for a shorter negativeTtl, so a missing DID cannot trigger a fetch per
+// request, and concurrent misses for the same key wait on a single load instead of each fetching.
+template <typename Value>
+class SingleFlightCache {
+public:
+    using Clock = std::chrono::system_clock;
+    using Loader = std::function<std::optional<Value>(const std::string& key)>;
+
+    SingleFlightCache(std::chrono::seconds ttl, std::chrono::seconds negativeTtl, size_t maxEntries);
+
+    // The cached value for key, loading it on a miss or after expiry; nullopt if the load failed
+    std::optional<Value> get(const std::string& key, const Loader& load, Clock::time_point now = Clock::now());
+
+    // Insert a known-good value, e.g. one restored from disk
+    void put(const std::string& key, Value value, Clock::time_point expires);
+
+    void erase(const std::string& key);
+
+    // Call fn(key, value, expires) for every unexpired positive entry
+    template <typename Fn>
+    void forEach(Fn&& fn, Clock::time_point now = Clock::now()) const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] uint64_t hits() const { return hitCount; }
+    [[nodiscard]] uint64_t loads() const { return loadCount; }
+
+private:
+    struct Entry {
+        std::optional<Value> value; // nullopt records a failed lookup
+        Clock::time_point expires;
+    };
+
+    std::chrono::seconds ttl;
+    std::chrono::seconds negativeTtl;
+    size_t maxEntries;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+    std::mutex flightMutex;
+    std::unordered_map<std::string, std::shared_future<std::optional<Value>>> inflight;
+
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> loadCount{0};
+
+    void store(const std::string& key, Entry entry, Clock::time_point now);
+};
+
+#include "single_flight_cache.tpp"
+#endif // SINGLE_FLIGHT_CACHE_H
@@ -0,0 +1,96 @@
+#ifndef SINGLE_FLIGHT_CACHE_TPP
+#define SINGLE_FLIGHT_CACHE_TPP
+
+template <typename Value>
+SingleFlightCache<Value>::SingleFlightCache(const std::chrono::seconds ttl, const std::chrono::seconds negativeTtl,
+                                            const size_t maxEntries)
+    : ttl(ttl), negativeTtl(negativeTtl), maxEntries(std::max<size_t>(1, maxEntries)) {}
+
+template <typename Value>
+std::optional<Value> SingleFlightCache<Value>::get(const std::string& key, const Loader& load, const Clock::time_point now) {
+    {
+        std::shared_lock lock(mutex);
+        if (const auto it = entries.find(key); it != entries.end() && now < it->second.expires) {
+            ++hitCount;
+            return it->second.value;
+        }
+    }
+
+    // The first caller to miss becomes the leader and loads; everyone else waits on its future
+    std::promise<std::optional<Value>> promise;
+    std::shared_future<std::optional<Value>> result;
+    auto leader = false;
+    {
+        std::lock_guard lock(flightMutex);
+        if (const auto it = inflight.find(key); it != inflight.end()) {
+            result = it->second;
+        } else {
+            result = promise.get_future().share();
+            inflight.emplace(key, result);
+            leader = true;
+        }
+    }
+    if (!leader) {
+        return result.get();
+    }
+
+    std::optional<Value> value;
+    try {
+        ++loadCount;
+        value = load(key);
+    } catch (...) {
+        value = std::nullopt;
+    }
+
+    store(key, Entry{value, now + (value ? ttl : negativeTtl)}, now);
+    promise.set_value(value);
+    {
+        std::lock_guard lock(flightMutex);
+        inflight.erase(key);
+    }
+    return value;
+}
+
+template <typename Value>
+void SingleFlightCache<Value>::put(const std::string& key, Value value, const Clock::time_point expires) {
+    store(key, Entry{std::move(value), expires}, Clock::now());
+}
+
+template <typename Value>
+void SingleFlightCache<Value>::erase(const std::string& key) {
+    std::unique_lock lock(mutex);
+    entries.erase(key);
+}
+
+template <typename Value>
+void SingleFlightCache<Value>::store(const std::string& key, Entry entry, const Clock::time_point now) {
+    std::unique_lock lock(mutex);
+    if (entries.size() >= maxEntries && entries.find(key) == entries.end()) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            it = it->second.expires <= now ? entries.erase(it) : std::next(it);
+        }
+        // Still full of live entries: drop an arbitrary tenth rather than growing without bound
+        for (auto it = entries.begin(); entries.size() >= maxEntries - maxEntries / 10 && it != entries.end();) {
+            it = entries.erase(it);
+        }
+    }
+    entries[key] = std::move(entry);
+}
+
+template <typename Value>
+template <typename Fn>
+void SingleFlightCache<Value>::forEach(Fn&& fn, const Clock::time_point now) const {
+    std::shared_lock lock(mutex);
+    for (const auto& [key, entry] : entries) {
+        if (entry.value && now < entry.expires) {
+            fn(key, *entry.value, entry.expires);
+        }
+    }
+}
+
+template <typename Value>
+size_t SingleFlightCache<Value>::size() const {
+    std::shared_lock lock(mutex);
+    return entries.size();
+}
+#endif // SINGLE_FLIGHT_CACHE_TPP
@@ -0,0 +1,325 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "backfill.hpp"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include "../config/settings.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/base32.hpp"
+#include "../tools/logging.hpp"
+#include "../tools/rate_limiter.hpp"
+#include "../tools/timestamp.hpp"
+
+Backfill::Backfill(Options options, std::shared_ptr<RateLimiter> limiter, Sink sink)
+    : options(std::move(options)), limiter(std::move(limiter)), sink(std::move(sink)) {
+    this->options.parallelism = std::max<size_t>(1, this->options.parallelism);
+}
+
+std::optional<IngestEvent> Backfill::eventFromPost(const std::string& uri, const std::string& cid,
+                                                   const std::string& authorDid, const nlohmann::json& record,
+                                                   const nlohmann::json& labels) {
+    if (uri.empty() || authorDid.empty() || !record.is_object() ||
+        record.value("$type", "app.bsky.feed.post") != "app.bsky.feed.post") {
+        return std::nullopt;
+    }
+
+    try {
+        IngestEvent event;
+        event.kind = EventKind::Post;
+        event.uri = uri;
+        event.cid = cid;
+        event.repo = authorDid;
+
+        auto& post = event.post;
+        post.uri = uri;
+        post.cid = cid;
+        post.authorDid = authorDid;
+        post.text = record.value("text", "");
+        post.langs = record.value("langs", std::vector<std::string>{});
+
+        if (const auto reply = record.find("reply"); reply != record.end() && reply->contains("parent")) {
+            post.replyParent = (*reply)["parent"].value("uri", "");
+        }
+
+        if (const auto embed = record.find("embed"); embed != record.end() && embed->is_object()) {
+            const auto type = embed->value("$type", "");
+            post.hasMedia = type == "app.bsky.embed.images" || type == "app.bsky.embed.video" ||
+                            type == "app.bsky.embed.recordWithMedia";
+            if (type == "app.bsky.embed.record") {
+                post.quoteUri = (*embed)["record"].value("uri", "");
+            } else if (type == "app.bsky.embed.recordWithMedia") {
+                post.quoteUri = (*embed)["record"]["record"].value("uri", "");
+            }
+        }
+
+        if (labels.is_array()) {
+            for (const auto& label : labels) {
+                post.labels.push_back(label.value("val", ""));
+            }
+        }
+
+        if (const auto createdAt = Timestamp::parseIso8601(record.value("createdAt", ""))) {
+            post.createdAtUs = *createdAt;
+        } else if (const auto tid = Base32::tidTimestamp(uri.substr(uri.rfind('/') + 1))) {
+            post.createdAtUs = *tid;
+        }
+
+        // Historical posts keep their own time so that ranking decays them like any other post
+        const auto created = std::chrono::system_clock::time_point(std::chrono::microseconds(post.createdAtUs));
+        event.time = std::min(event.time, created);
+        return event;
+    } catch (const nlohmann::json::exception&) {
+        return std::nullopt;
+    }
+}
+
+Backfill::Outcome Backfill::backfillAuthor(const std::string& author) {
+    try {
+        return fetchAuthor(author);
+    } catch (const std::exception& e) {
+        Logging::error("Backfill of " + author + " failed: " + std::string(e.what()));
+        return Outcome::Failed;
+    }
+}
+
+Backfill::Outcome Backfill::fetchAuthor(const std::string& author) {
+    HTTPSClient client;
+    client.setHost(options.host);
+    client.setBearerToken(options.bearerToken);
+    client.setRateLimiter(limiter);
+    client.setMaxRetries(MAX_RETRIES);
+    client.setCancelFlag(&stopping);
+    client.addQueryParam("limit", std::to_string(PAGE_SIZE));
+    if (options.source == Source::AuthorFeed) {
+        client.setEndpoint("/xrpc/app.bsky.feed.getAuthorFeed");
+        client.addQueryParam("actor", author);
+        client.addQueryParam("filter", "posts_with_replies");
+    } else {
+        client.setEndpoint("/xrpc/com.atproto.repo.listRecords");
+        client.addQueryParam("repo", author);
+        client.addQueryParam("collection", "app.bsky.feed.post");
+    }
+
+    {
+        std::lock_guard lock(stateMutex);
+        if (const auto it = cursors.find(author); it != cursors.end()) {
+            client.addQueryParam("cursor", it->second);
+        }
+    }
+
+    const auto now = std::chrono::system_clock::now();
+    const auto cutoff = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>((now - options.maxAge).time_since_epoch()).count());
+    size_t taken = 0;
+
+    while (!stopping) {
+        const auto response = client.get();
+        if (!response.is_object() && stopping) {
+            return Outcome::Interrupted;
+        }
+        if (!response.is_object()) {
+            // 4xx other than 429 means the account is gone or invalid, so retrying later will not help
+            const auto status = client.status();
+            if (status >= 400 && status < 500 && status != 429) {
+                recordFinished(author);
+            }
+            return Outcome::Failed;
+        }
+
+        const auto& items = options.source == Source::AuthorFeed ? response.value("feed", nlohmann::json::array())
+                                                                 : response.value("records", nlohmann::json::array());
+        auto done = items.empty();
+        for (const auto& item : items) {
+            std::optional<IngestEvent> event;
+            if (options.source == Source::AuthorFeed) {
+                if (item.contains("reason")) {
+                    continue; // A repost by this author, not their post
+                }
+                const auto& post = item.value("post", nlohmann::json::object());
+                event = eventFromPost(post.value("uri", ""), post.value("cid", ""),
+                                      post.value("author", nlohmann::json::object()).value("did", ""),
+                                      post.value("record", nlohmann::json::object()),
+                                      post.value("labels", nlohmann::json::array()));
+            } else {
+                const auto uri = item.value("uri", "");
+                const auto repo = uri.rfind("at://", 0) == 0 ? uri.substr(5, uri.find('/', 5) - 5) : std::string();
+                const auto& record = item.value("value", nlohmann::json::object());
+                const auto labels = record.value("labels", nlohmann::json::object()).value("values", nlohmann::json::array());
+                event = eventFromPost(uri, item.value("cid", ""), repo, record, labels);
+            }
+
+            if (!event) {
+                continue;
+            }
+            if (event->post.createdAtUs < cutoff || taken >= options.maxPostsPerAuthor) {
+                done = true;
+                break;
+            }
+            sink(*event);
+            ++taken;
+            ++postCount;
+        }
+
+        const auto cursor = response.value("cursor", "");
+        if (done || cursor.empty()) {
+            recordFinished(author);
+            return Outcome::Finished;
+        }
+        recordCursor(author, cursor);
+        client.addQueryParam("cursor", cursor);
+    }
+    return Outcome::Interrupted;
+}
+
+Backfill::Result Backfill::run(const std::vector<std::string>& authors) {
+    loadState();
+    postCount = 0;
+
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0}, skipped{0}, failed{0};
+
+    const auto worker = [&] {
+        for (auto i = next.fetch_add(1); i < authors.size() && !stopping; i = next.fetch_add(1)) {
+            const auto& author = authors[i];
+            {
+                std::lock_guard lock(stateMutex);
+                if (completed.count(author) != 0) {
+                    ++skipped;
+                    continue;
+                }
+            }
+
+            switch (backfillAuthor(author)) {
+                case Outcome::Finished:
+                    ++finished;
+                    break;
+                case Outcome::Failed:
+                    Logging::error("Backfill failed for " + author);
+                    ++failed;
+                    break;
+                case Outcome::Interrupted:
+                    break;
+            }
+
+            if (const auto done = finished + failed; done % 100 == 0 && done > 0) {
+                Logging::info("Backfill progress: " + std::to_string(done + skipped) + "/" +
+                              std::to_string(authors.size()) + " authors, " + std::to_string(postCount) + " posts");
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(options.parallelism, authors.size()); ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    saveState();
+
+    Result result;
+    result.authorsCompleted = finished;
+    result.authorsSkipped = skipped;
+    result.authorsFailed = failed;
+    result.posts = postCount;
+    result.interrupted = stopping;
+    return result;
+}
+
+void Backfill::recordCursor(const std::string& author, const std::string& cursor) {
+    std::lock_guard lock(stateMutex);
+    cursors[author] = cursor;
+}
+
+void Backfill::recordFinished(const std::string& author) {
+    std::lock_guard lock(stateMutex);
+    cursors.erase(author);
+    completed.insert(author);
+    if (++unsaved >= options.saveEvery) {
+        saveStateLocked();
+    }
+}
+
+void Backfill::reset() {
+    std::lock_guard lock(stateMutex);
+    completed.clear();
+    cursors.clear();
+    std::error_code error;
+    std::filesystem::remove(options.statePath, error);
+}
+
+void Backfill::loadState() {
+    std::lock_guard lock(stateMutex);
+    completed.clear();
+    cursors.clear();
+
+    std::ifstream file(options.statePath);
+    if (!file) {
+        return;
+    }
+    try {
+        const auto state = nlohmann::json::parse(file);
+        for (const auto& author : state.value("completed", nlohmann::json::array())) {
+            completed.insert(author.get<std::string>());
+        }
+        const auto savedCursors = state.value("cursors", nlohmann::json::object());
+        for (const auto& [author, cursor] : savedCursors.items()) {
+            cursors[author] = cursor.get<std::string>();
+        }
+        Logging::info("Resuming backfill: " + std::to_string(completed.size()) + " authors already done");
+    } catch (const nlohmann::json::exception& e) {
+        Logging::error("Ignoring unreadable backfill state " + options.statePath + ": " + e.what());
+    }
+}
+
+void Backfill::saveState() {
+    std::lock_guard lock(stateMutex);
+    saveStateLocked();
+}
+
+// Written to a temporary file and renamed so that a crash never leaves a truncated state file
+void Backfill::saveStateLocked() {
+    nlohmann::json state;
+    state["completed"] = nlohmann::json::array();
+    for (const auto& author : completed) {
+        state["completed"].push_back(author);
+    }
+    state["cursors"] = nlohmann::json::object();
+    for (const auto& [author, cursor] : cursors) {
+        state["cursors"][author] = cursor;
+    }
+
+    const auto temporary = options.statePath + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        if (!file) {
+            Logging::error("Unable to write backfill state to " + temporary);
+            return;
+        }
+        file << state.dump();
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, options.statePath, error);
+    if (error) {
+        Logging::error("Unable to save backfill state: " + error.message());
+        return;
+    }
+    unsaved = 0;
+}
+
+Backfill::Options Backfill::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.host = settings.get<std::string>("backfill_host", result.host);
+    result.source = settings.get<std::string>("backfill_source", "author_feed") == "list_records" ? Source::ListRecords
+                                                                                                  : Source::AuthorFeed;
+    result.parallelism = settings.get<size_t>("backfill_parallelism", result.parallelism);
+    result.maxPostsPerAuthor = settings.get<size_t>("backfill_max_posts", result.maxPostsPerAuthor);
+    result.maxAge = std::chrono::hours(settings.get<int64_t>("backfill_max_age_hours", result.maxAge.count()));
+    result.statePath = settings.get<std::string>("backfill_state_path", result.statePath);
+    return result;
+}
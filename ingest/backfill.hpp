@@ -0,0 +1,109 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef BACKFILL_H
+#define BACKFILL_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "event.hpp"
+#include "../nlohmann/json.hpp"
+
+class RateLimiter;
+class Settings;
+
+// Loads recent history for a seed set of authors so new feeds are not empty until live events arrive.
+//
+// Authors are paged concurrently through app.bsky.feed.getAuthorFeed (any AppView) or
+// com.atproto.repo.listRecords (the authors' PDS), all sharing one RateLimiter. Each post is handed
+// to the sink as an IngestEvent, so it goes through the same dedupe and feed evaluation as live
+// events. Progress (finished authors and the cursor of each unfinished one) is saved to a state
+// file, so an interrupted run picks up where it left off.
+class Backfill {
+public:
+    enum class Source {
+        AuthorFeed, // app.bsky.feed.getAuthorFeed
+        ListRecords // com.atproto.repo.listRecords
+    };
+
+    struct Options {
+        std::string host = "public.api.bsky.app";
+        std::string bearerToken;
+        Source source = Source::AuthorFeed;
+        size_t parallelism = 16;
+        size_t maxPostsPerAuthor = 500;
+        std::chrono::hours maxAge{72}; // Stop paging an author once posts are older than this
+        std::string statePath = "backfill_state.json";
+        size_t saveEvery = 50;         // Save state after this many authors finish
+    };
+
+    struct Result {
+        size_t authorsCompleted = 0;
+        size_t authorsSkipped = 0; // Already finished in a previous run
+        size_t authorsFailed = 0;
+        uint64_t posts = 0;
+        bool interrupted = false;
+    };
+
+    // The sink is called from worker threads and must be thread-safe
+    using Sink = std::function<void(const IngestEvent&)>;
+
+    Backfill(Options options, std::shared_ptr<RateLimiter> limiter, Sink sink);
+
+    Result run(const std::vector<std::string>& authors);
+
+    // Ask a running backfill to save its state and return early; one stopped before run() returns at once
+    void stop() { stopping = true; }
+
+    // Forget all saved progress
+    void reset();
+
+    // Convert one post from either endpoint into an event; nullopt for records that are not usable posts
+    static std::optional<IngestEvent> eventFromPost(const std::string& uri, const std::string& cid,
+                                                    const std::string& authorDid, const nlohmann::json& record,
+                                                    const nlohmann::json& labels);
+
+    // Reads backfill_host, backfill_source ("author_feed"/"list_records"), backfill_parallelism,
+    // backfill_max_posts, backfill_max_age_hours and backfill_state_path from settings.json
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    static constexpr int PAGE_SIZE = 100;
+    static constexpr int MAX_RETRIES = 4;
+
+    enum class Outcome { Finished, Failed, Interrupted };
+
+    Options options;
+    std::shared_ptr<RateLimiter> limiter;
+    Sink sink;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> postCount{0};
+
+    std::mutex stateMutex;
+    std::unordered_set<std::string> completed;
+    std::unordered_map<std::string, std::string> cursors; // Authors in progress
+    size_t unsaved = 0;
+
+    // Never throws: a failure of any kind is Failed, so one author cannot take down a worker thread
+    Outcome backfillAuthor(const std::string& author);
+    Outcome fetchAuthor(const std::string& author);
+    void recordCursor(const std::string& author, const std::string& cursor);
+    void recordFinished(const std::string& author);
+    void loadState();
+    void saveState();
+    void saveStateLocked();
+};
+
+#endif // BACKFILL_H
@@ -0,0 +1,294 @@
+//
+// Created by jayian on 2/7/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "car_reader.hpp"
+#include <fstream>
+#include <sstream>
+#include "../tools/dag_cbor.hpp"
+#include "../tools/varint.hpp"
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static constexpr size_t MAX_TREE_DEPTH = 64;
+
+std::unique_ptr<CarReader> CarReader::open(const std::string& path) {
+    std::unique_ptr<CarReader> reader(new CarReader());
+
+#ifndef _WIN32
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw CarReaderException("Unable to open " + path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw CarReaderException("Unable to stat " + path);
+    }
+    reader->mappingSize = static_cast<size_t>(status.st_size);
+    if (reader->mappingSize > 0) {
+        reader->mapping = mmap(nullptr, reader->mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (reader->mapping == MAP_FAILED) {
+        reader->mapping = nullptr;
+        throw CarReaderException("Unable to map " + path);
+    }
+    reader->data = std::string_view(static_cast<const char*>(reader->mapping), reader->mappingSize);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw CarReaderException("Unable to open " + path);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    reader->buffer = contents.str();
+    reader->data = reader->buffer;
+#endif
+
+    reader->index();
+    return reader;
+}
+
+CarReader::CarReader(const std::string_view data) : data(data) {
+    index();
+}
+
+CarReader::~CarReader() {
+#ifndef _WIN32
+    if (mapping) {
+        munmap(mapping, mappingSize);
+    }
+#endif
+}
+
+size_t CarReader::cidLength(const std::string_view data) {
+    // CIDv0 is a bare sha2-256 multihash
+    if (data.size() >= 34 && data[0] == 0x12 && data[1] == 0x20) {
+        return 34;
+    }
+
+    size_t position = 0;
+    uint64_t version, codec, hash, digestLength;
+    if (!Varint::read(data, position, version) || version != 1 || !Varint::read(data, position, codec) ||
+        !Varint::read(data, position, hash) || !Varint::read(data, position, digestLength) ||
+        digestLength > data.size() - position) {
+        return 0;
+    }
+    return position + digestLength;
+}
+
+// A CARv1 file is a varint-prefixed DAG-CBOR header ({roots, version}) followed by varint-prefixed
+// sections of CID then block
+void CarReader::index() {
+    size_t position = 0;
+    uint64_t length;
+    if (!Varint::read(data, position, length) || length > data.size() - position) {
+        throw CarReaderException("Malformed CAR header");
+    }
+
+    try {
+        DagCborReader header(data.substr(position, length));
+        uint64_t version = 0;
+        for (auto fields = header.readMap(); fields > 0; --fields) {
+            const auto key = header.readText();
+            if (key == "version") {
+                version = header.readUnsigned();
+            } else if (key == "roots") {
+                for (auto count = header.readArray(); count > 0; --count) {
+                    rootCids.push_back(header.readCid());
+                }
+            } else {
+                header.skip();
+            }
+        }
+        if (version != 1) {
+            throw CarReaderException("Unsupported CAR version " + std::to_string(version));
+        }
+    } catch (const DagCborException& e) {
+        throw CarReaderException(std::string("Malformed CAR header: ") + e.what());
+    }
+    position += length;
+
+    while (position < data.size()) {
+        if (!Varint::read(data, position, length) || length > data.size() - position) {
+            throw CarReaderException("Truncated CAR section at offset " + std::to_string(position));
+        }
+        const auto section = data.substr(position, length);
+        const auto cid = cidLength(section);
+        if (cid == 0) {
+            throw CarReaderException("Malformed CID at offset " + std::to_string(position));
+        }
+        blocks.emplace(section.substr(0, cid), Location{position + cid, length - cid});
+        position += length;
+    }
+}
+
+std::optional<std::string_view> CarReader::block(const std::string_view cid) const {
+    const auto it = blocks.find(cid);
+    if (it == blocks.end()) {
+        return std::nullopt;
+    }
+    return data.substr(it->second.offset, it->second.length);
+}
+
+void CarReader::forEachBlock(const std::function<void(std::string_view cid, std::string_view block)>& visit) const {
+    size_t position = 0;
+    uint64_t length;
+    Varint::read(data, position, length);
+    position += length;
+
+    // index() has already validated every section
+    while (position < data.size()) {
+        Varint::read(data, position, length);
+        const auto section = data.substr(position, length);
+        const auto cid = cidLength(section);
+        visit(section.substr(0, cid), section.substr(cid));
+        position += length;
+    }
+}
+
+std::string_view CarReader::did() const {
+    const auto commit = rootCids.empty() ? std::nullopt : block(rootCids.front());
+    if (!commit) {
+        return {};
+    }
+    try {
+        DagCborReader reader(*commit);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            if (reader.readText() == "did") {
+                return reader.readText();
+            }
+            reader.skip();
+        }
+    } catch (const DagCborException&) {
+    }
+    return {};
+}
+
+void CarReader::forEachRecord(const std::string_view collection, const RecordVisitor& visit) const {
+    const auto commit = rootCids.empty() ? std::nullopt : block(rootCids.front());
+    if (!commit) {
+        return;
+    }
+
+    std::string_view root;
+    try {
+        DagCborReader reader(*commit);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            if (reader.readText() == "data") {
+                root = reader.readCid();
+            } else {
+                reader.skip();
+            }
+        }
+    } catch (const DagCborException& e) {
+        throw CarReaderException(std::string("Malformed repo commit: ") + e.what());
+    }
+
+    // Keys of the collection are exactly those in ["<collection>/", "<collection>0"), as '0' follows '/'
+    const auto first = std::string(collection) + "/";
+    const auto last = std::string(collection) + "0";
+    walkTree(root, {}, nullptr, first, last, visit, 0);
+}
+
+// A tree node is {e: [{p: shared prefix length, k: key suffix, v: record CID, t: right subtree}], l: left
+// subtree}. Keys are sorted, so a subtree lying between two keys can be skipped when that range misses
+// the collection.
+void CarReader::walkTree(const std::string_view nodeCid, const std::string_view low, const std::string* high,
+                         const std::string_view first, const std::string_view last, const RecordVisitor& visit,
+                         const size_t depth) const {
+    if (depth > MAX_TREE_DEPTH) {
+        throw CarReaderException("Repo tree too deep");
+    }
+    const auto node = block(nodeCid);
+    if (!node) {
+        return; // Partial archives, e.g. commit blocks, omit unchanged subtrees
+    }
+
+    struct Entry {
+        std::string key;
+        std::string_view value;
+        std::string_view tree;
+    };
+    std::vector<Entry> entries;
+    std::string_view left;
+
+    try {
+        DagCborReader reader(*node);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            const auto key = reader.readText();
+            if (key == "l") {
+                if (!reader.readNull()) {
+                    left = reader.readCid();
+                }
+            } else if (key == "e") {
+                for (auto count = reader.readArray(); count > 0; --count) {
+                    auto& entry = entries.emplace_back();
+                    uint64_t prefix = 0;
+                    std::string_view suffix;
+                    for (auto entryFields = reader.readMap(); entryFields > 0; --entryFields) {
+                        const auto entryKey = reader.readText();
+                        if (entryKey == "p") {
+                            prefix = reader.readUnsigned();
+                        } else if (entryKey == "k") {
+                            suffix = reader.readBytes();
+                        } else if (entryKey == "v") {
+                            entry.value = reader.readCid();
+                        } else if (entryKey == "t") {
+                            if (!reader.readNull()) {
+                                entry.tree = reader.readCid();
+                            }
+                        } else {
+                            reader.skip();
+                        }
+                    }
+                    const auto previous = entries.size() > 1 ? std::string_view(entries[entries.size() - 2].key)
+                                                             : std::string_view();
+                    if (prefix > previous.size()) {
+                        throw CarReaderException("Malformed repo tree key");
+                    }
+                    entry.key.assign(previous.substr(0, prefix)).append(suffix);
+                }
+            } else {
+                reader.skip();
+            }
+        }
+    } catch (const DagCborException& e) {
+        throw CarReaderException(std::string("Malformed repo tree node: ") + e.what());
+    }
+
+    // Does the subtree holding keys between lower and upper overlap [first, last)?
+    const auto overlaps = [&](const std::string_view lower, const std::string* upper) {
+        return (upper == nullptr || *upper > first) && lower < last;
+    };
+
+    if (!left.empty()) {
+        const auto* upper = entries.empty() ? high : &entries.front().key;
+        if (overlaps(low, upper)) {
+            walkTree(left, low, upper, first, last, visit, depth + 1);
+        }
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& entry = entries[i];
+        if (entry.key >= last) {
+            break;
+        }
+        if (entry.key >= first) {
+            if (const auto record = block(entry.value)) {
+                visit(entry.key, entry.value, *record);
+            }
+        }
+        if (!entry.tree.empty()) {
+            const auto* upper = i + 1 < entries.size() ? &entries[i + 1].key : high;
+            if (overlaps(entry.key, upper)) {
+                walkTree(entry.tree, entry.key, upper, first, last, visit, depth + 1);
+            }
+        }
+    }
+}
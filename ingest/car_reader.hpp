@@ -0,0 +1,106 @@
+//
+// Created by jayian on 2/7/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef CAR_READER_H
+#define CAR_READER_H
+
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class CarReaderException final : public std::exception {
+    std::string message;
+
+public:
+    explicit CarReaderException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Reader for CARv1 archives: repo exports from com.atproto.sync.getRepo and commit blocks.
+//
+// Files are memory-mapped, so a multi-hundred-MB repo costs address space rather than heap; blocks stay
+// in the mapping and the CID index holds views into it. Building the index only reads each section's
+// length and CID. Records are found by walking the repo's Merkle Search Tree, decoding only the nodes
+// whose key range overlaps the requested collection.
+class CarReader {
+public:
+    // visit(path, cid, block) with path "<collection>/<rkey>" and the record's DAG-CBOR block
+    using RecordVisitor = std::function<void(std::string_view path, std::string_view cid, std::string_view block)>;
+
+    // Map a CAR file from disk; throws CarReaderException if it cannot be read or is malformed
+    static std::unique_ptr<CarReader> open(const std::string& path);
+
+    // Index a CAR that is already in memory; data must outlive the reader
+    explicit CarReader(std::string_view data);
+
+    ~CarReader();
+
+    CarReader(const CarReader&) = delete;
+    CarReader& operator=(const CarReader&) = delete;
+
+    [[nodiscard]] const std::vector<std::string_view>& roots() const { return rootCids; }
+    [[nodiscard]] size_t blockCount() const { return blocks.size(); }
+    [[nodiscard]] size_t size() const { return data.size(); }
+
+    [[nodiscard]] std::optional<std::string_view> block(std::string_view cid) const;
+
+    // visit(cid, block) for every block in file order
+    void forEachBlock(const std::function<void(std::string_view cid, std::string_view block)>& visit) const;
+
+    // The repo's DID, read from the commit object the first root points at; empty if there is none
+    [[nodiscard]] std::string_view did() const;
+
+    // Visit every record of collection (e.g. "app.bsky.feed.post") in key order. Subtrees missing from
+    // the archive are skipped. Throws CarReaderException on malformed tree nodes.
+    void forEachRecord(std::string_view collection, const RecordVisitor& visit) const;
+
+    // Length of the binary CID at the start of data, or 0 if it is malformed
+    static size_t cidLength(std::string_view data);
+
+private:
+    // Digests are uniformly distributed, so their trailing bytes make a good hash
+    struct CidHash {
+        size_t operator()(const std::string_view cid) const {
+            size_t hash = cid.size();
+            if (cid.size() >= sizeof(size_t)) {
+                std::memcpy(&hash, cid.data() + cid.size() - sizeof(size_t), sizeof(size_t));
+            }
+            return hash;
+        }
+    };
+
+    struct Location {
+        size_t offset;
+        size_t length;
+    };
+
+    CarReader() = default;
+
+    std::string_view data;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    std::string buffer; // Holds the file where memory mapping is unavailable
+
+    std::vector<std::string_view> rootCids;
+    std::unordered_map<std::string_view, Location, CidHash> blocks;
+
+    void index();
+    // Visit the records in [first, last) under the tree node nodeCid, whose keys lie between low and high
+    // (a null high is unbounded)
+    void walkTree(std::string_view nodeCid, std::string_view low, const std::string* high, std::string_view first,
+                  std::string_view last, const RecordVisitor& visit, size_t depth) const;
+};
+
+#endif // CAR_READER_H
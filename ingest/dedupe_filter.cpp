@@ -0,0 +1,127 @@
+//
+// Created by jayian on 1/15/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "dedupe_filter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include "../config/settings.hpp"
+#include "../tools/hash.hpp"
+
+static constexpr uint64_t BLOCK_BITS = 512;
+
+DedupeFilter::DedupeFilter(const Options& options) : options(options) {
+    if (options.itemsPerGeneration == 0 || options.generations == 0) {
+        throw std::invalid_argument("DedupeFilter needs at least one item and one generation");
+    }
+    if (options.falsePositiveRate <= 0.0 || options.falsePositiveRate >= 1.0) {
+        throw std::invalid_argument("DedupeFilter false positive rate must be in (0, 1)");
+    }
+
+    // Standard Bloom sizing, with 20% headroom for the uneven load of a blocked layout
+    const auto ln2 = std::log(2.0);
+    const auto bitsPerItem = -std::log(options.falsePositiveRate) / (ln2 * ln2) * 1.2;
+    const auto totalBits = static_cast<double>(options.itemsPerGeneration) * bitsPerItem;
+
+    blocksPerGeneration = std::max<size_t>(1, static_cast<size_t>(std::ceil(totalBits / BLOCK_BITS)));
+    hashCount = std::clamp<uint32_t>(static_cast<uint32_t>(std::lround(bitsPerItem / 1.2 * ln2)), 1, 16);
+
+    blocks.resize(blocksPerGeneration * options.generations);
+    generations.resize(options.generations);
+    clear();
+}
+
+void DedupeFilter::clear() {
+    std::memset(blocks.data(), 0, blocks.size() * sizeof(Block));
+    for (auto& generation : generations) {
+        generation = Generation{};
+    }
+    current = 0;
+}
+
+bool DedupeFilter::checkAndInsert(const std::string_view key, const Clock::time_point now) {
+    return checkAndInsertHash(Hash::bytes(key), now);
+}
+
+bool DedupeFilter::checkAndInsert(const std::string_view uri, const std::string_view cid, const Clock::time_point now) {
+    return checkAndInsertHash(Hash::bytes(cid, Hash::bytes(uri)), now);
+}
+
+bool DedupeFilter::probablyContains(const std::string_view key) const {
+    return contains(Hash::bytes(key));
+}
+
+bool DedupeFilter::checkAndInsertHash(const uint64_t hash, const Clock::time_point now) {
+    if (contains(hash)) {
+        ++duplicateCount;
+        return true;
+    }
+    insert(hash, now);
+    return false;
+}
+
+// Check the newest generation first, since replays are usually of recent events
+bool DedupeFilter::contains(const uint64_t hash) const {
+    const auto blockIndex = hash % blocksPerGeneration;
+    for (size_t age = 0; age < generations.size(); ++age) {
+        const auto generation = (current + generations.size() - age) % generations.size();
+        if (generations[generation].items == 0) {
+            continue;
+        }
+        if (testBlock(blocks[generation * blocksPerGeneration + blockIndex], hash)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Bit positions come from double hashing the upper half of the key hash
+bool DedupeFilter::testBlock(const Block& block, const uint64_t hash) const {
+    const auto h1 = static_cast<uint32_t>(hash >> 32);
+    const auto h2 = static_cast<uint32_t>(Hash::mix(hash)) | 1u;
+    for (uint32_t i = 0; i < hashCount; ++i) {
+        const auto bit = (h1 + i * h2) % BLOCK_BITS;
+        if ((block.words[bit / 64] & (1ULL << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void DedupeFilter::insert(const uint64_t hash, const Clock::time_point now) {
+    auto& generation = generations[current];
+    if (generation.items == 0) {
+        generation.started = now;
+    } else if (generation.items >= options.itemsPerGeneration || now - generation.started >= options.window) {
+        rotate(now);
+    }
+
+    auto& block = blocks[current * blocksPerGeneration + hash % blocksPerGeneration];
+    const auto h1 = static_cast<uint32_t>(hash >> 32);
+    const auto h2 = static_cast<uint32_t>(Hash::mix(hash)) | 1u;
+    for (uint32_t i = 0; i < hashCount; ++i) {
+        const auto bit = (h1 + i * h2) % BLOCK_BITS;
+        block.words[bit / 64] |= 1ULL << (bit % 64);
+    }
+    ++generations[current].items;
+}
+
+// Recycle the oldest generation as the new current one
+void DedupeFilter::rotate(const Clock::time_point now) {
+    current = (current + 1) % generations.size();
+    std::memset(&blocks[current * blocksPerGeneration], 0, blocksPerGeneration * sizeof(Block));
+    generations[current] = Generation{0, now};
+    ++rotationCount;
+}
+
+DedupeFilter::Options DedupeFilter::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.itemsPerGeneration = settings.get<size_t>("dedupe_items_per_generation", result.itemsPerGeneration);
+    result.falsePositiveRate = settings.get<double>("dedupe_false_positive_rate", result.falsePositiveRate);
+    result.generations = settings.get<size_t>("dedupe_generations", result.generations);
+    result.window = std::chrono::seconds(settings.get<int64_t>("dedupe_window_seconds", result.window.count()));
+    return result;
+}
@@ -0,0 +1,79 @@
+//
+// Created by jayian on 1/15/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef DEDUPE_FILTER_H
+#define DEDUPE_FILTER_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+class Settings;
+
+// Probabilistic "seen before" filter for event URIs/CIDs.
+//
+// A ring of blocked Bloom filters: each key sets its bits inside a single 64-byte block, so a
+// lookup costs one cache miss per generation. New keys go into the newest generation; once it holds
+// itemsPerGeneration keys or is older than window, the oldest generation is cleared and reused.
+// Memory is therefore fixed at construction. Not thread-safe: each ingest shard owns its own filter.
+class DedupeFilter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        size_t itemsPerGeneration = 1'000'000;
+        double falsePositiveRate = 0.001;
+        size_t generations = 3;
+        std::chrono::seconds window{600};
+    };
+
+    explicit DedupeFilter(const Options& options);
+
+    // Record the key and report whether it was (probably) already present
+    bool checkAndInsert(std::string_view key, Clock::time_point now = Clock::now());
+    bool checkAndInsert(std::string_view uri, std::string_view cid, Clock::time_point now = Clock::now());
+
+    [[nodiscard]] bool probablyContains(std::string_view key) const;
+
+    void clear();
+
+    [[nodiscard]] size_t memoryBytes() const { return blocks.size() * sizeof(Block); }
+    [[nodiscard]] uint64_t duplicates() const { return duplicateCount; }
+    [[nodiscard]] uint64_t rotations() const { return rotationCount; }
+
+    // Reads dedupe_items_per_generation, dedupe_false_positive_rate, dedupe_generations and
+    // dedupe_window_seconds from settings.json, falling back to the defaults above
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    struct alignas(64) Block {
+        uint64_t words[8];
+    };
+
+    struct Generation {
+        size_t items = 0;
+        Clock::time_point started{};
+    };
+
+    Options options;
+    size_t blocksPerGeneration;
+    uint32_t hashCount;
+    std::vector<Block> blocks; // generations * blocksPerGeneration
+    std::vector<Generation> generations;
+    size_t current = 0;
+    uint64_t duplicateCount = 0;
+    uint64_t rotationCount = 0;
+
+    [[nodiscard]] bool contains(uint64_t hash) const;
+    [[nodiscard]] bool testBlock(const Block& block, uint64_t hash) const;
+    void insert(uint64_t hash, Clock::time_point now);
+    void rotate(Clock::time_point now);
+    bool checkAndInsertHash(uint64_t hash, Clock::time_point now);
+};
+
+#endif // DEDUPE_FILTER_H
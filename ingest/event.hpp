@@ -0,0 +1,45 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "../feed/post.hpp"
+#include "../tools/hash.hpp"
+
+enum class EventKind : uint8_t {
+    Post,
+    Like,
+    Repost,
+    Follow,
+    Delete,
+    Takedown, // The account was taken down, suspended or deleted
+    Reinstate // The account is active again
+};
+
+// A record create or delete from any source (firehose, backfill, replay), decoded just enough to route it
+struct IngestEvent {
+    EventKind kind = EventKind::Post;
+    std::string uri;     // The record's own AT-URI; empty for Takedown and Reinstate
+    std::string cid;
+    std::string repo;    // DID of the account that wrote the record
+    std::string subject; // Like/Repost: the subject post URI. Follow: the followed DID.
+    Post post;           // Only for EventKind::Post
+    std::chrono::system_clock::time_point time = std::chrono::system_clock::now();
+
+    // Ingest shard for a repo: every record of one account goes to the same shard, so its creates and
+    // deletes are applied in order without locks between shards
+    static size_t shardFor(const std::string_view repo, const size_t shards) {
+        return shards <= 1 ? 0 : Hash::bytes(repo) % shards;
+    }
+};
+
+#endif // EVENT_H
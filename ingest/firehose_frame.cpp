@@ -0,0 +1,343 @@
+//
+// Created by jayian on 2/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "firehose_frame.hpp"
+#include "car_reader.hpp"
+#include "../tools/base32.hpp"
+#include "../tools/dag_cbor.hpp"
+#include "../tools/timestamp.hpp"
+#include "../tools/varint.hpp"
+
+static constexpr std::string_view POST_COLLECTION = "app.bsky.feed.post";
+static constexpr std::string_view LIKE_COLLECTION = "app.bsky.feed.like";
+static constexpr std::string_view REPOST_COLLECTION = "app.bsky.feed.repost";
+static constexpr std::string_view FOLLOW_COLLECTION = "app.bsky.graph.follow";
+
+std::optional<FrameHeader> FirehoseFrame::decodeHeader(const std::string_view frame, std::string_view& body) {
+    try {
+        DagCborReader reader(frame);
+        FrameHeader header;
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            const auto key = reader.readText();
+            if (key == "op") {
+                header.op = reader.readInteger();
+            } else if (key == "t") {
+                header.type = reader.readText();
+            } else {
+                reader.skip();
+            }
+        }
+        body = reader.remaining();
+        return header;
+    } catch (const DagCborException&) {
+        return std::nullopt;
+    }
+}
+
+bool FirehoseFrame::decodeCommit(const std::string_view body, CommitFrame& commit) {
+    commit.seq = 0;
+    commit.repo = commit.rev = commit.time = commit.blocks = {};
+    commit.tooBig = false;
+    commit.ops.clear();
+
+    try {
+        DagCborReader reader(body);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            const auto key = reader.readText();
+            if (key == "ops") {
+                for (auto count = reader.readArray(); count > 0; --count) {
+                    auto& op = commit.ops.emplace_back();
+                    for (auto opFields = reader.readMap(); opFields > 0; --opFields) {
+                        const auto opKey = reader.readText();
+                        if (opKey == "action") {
+                            op.action = reader.readText();
+                        } else if (opKey == "path") {
+                            op.path = reader.readText();
+                        } else if (opKey == "cid" && !reader.readNull()) {
+                            op.cid = reader.readCid();
+                        } else if (opKey != "cid") {
+                            reader.skip();
+                        }
+                    }
+                }
+            } else if (key == "seq") {
+                commit.seq = reader.readInteger();
+            } else if (key == "repo") {
+                commit.repo = reader.readText();
+            } else if (key == "rev") {
+                commit.rev = reader.readText();
+            } else if (key == "time") {
+                commit.time = reader.readText();
+            } else if (key == "blocks") {
+                commit.blocks = reader.readBytes();
+            } else if (key == "tooBig") {
+                commit.tooBig = reader.readBool();
+            } else {
+                reader.skip();
+            }
+        }
+        return !commit.repo.empty();
+    } catch (const DagCborException&) {
+        return false;
+    }
+}
+
+bool FirehoseFrame::decodeAccount(const std::string_view body, AccountFrame& account) {
+    account = AccountFrame{};
+    try {
+        DagCborReader reader(body);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            const auto key = reader.readText();
+            if (key == "seq") {
+                account.seq = reader.readInteger();
+            } else if (key == "did") {
+                account.did = reader.readText();
+            } else if (key == "active") {
+                account.active = reader.readBool();
+            } else if (key == "status" && !reader.readNull()) {
+                account.status = reader.readText();
+            } else if (key != "status") {
+                reader.skip();
+            }
+        }
+        return !account.did.empty();
+    } catch (const DagCborException&) {
+        return false;
+    }
+}
+
+// Commits carry only a handful of blocks, so a linear scan beats building a CarReader index
+std::optional<std::string_view> FirehoseFrame::findBlock(const std::string_view car, const std::string_view cid) {
+    size_t position = 0;
+    uint64_t length;
+    if (cid.empty() || !Varint::read(car, position, length) || length > car.size() - position) {
+        return std::nullopt;
+    }
+    position += length;
+
+    while (position < car.size()) {
+        if (!Varint::read(car, position, length) || length > car.size() - position) {
+            return std::nullopt;
+        }
+        const auto section = car.substr(position, length);
+        const auto sectionCid = CarReader::cidLength(section);
+        if (sectionCid == 0) {
+            return std::nullopt;
+        }
+        if (section.substr(0, sectionCid) == cid) {
+            return section.substr(sectionCid);
+        }
+        position += length;
+    }
+    return std::nullopt;
+}
+
+// The uri of a com.atproto.repo.strongRef, or of the strongRef nested in an embed's "record"
+std::string_view FirehoseFrame::readStrongRefUri(DagCborReader& reader, const int nesting) {
+    if (reader.peek() != DagCborReader::Type::Map) {
+        reader.skip();
+        return {};
+    }
+
+    std::string_view uri, nested;
+    for (auto fields = reader.readMap(); fields > 0; --fields) {
+        const auto key = reader.readText();
+        if (key == "uri") {
+            uri = reader.readText();
+        } else if (key == "record" && nesting > 0) {
+            nested = readStrongRefUri(reader, nesting - 1);
+        } else {
+            reader.skip();
+        }
+    }
+    return uri.empty() ? nested : uri;
+}
+
+void FirehoseFrame::readEmbed(DagCborReader& reader, Post& post) {
+    std::string_view type, quote;
+    for (auto fields = reader.readMap(); fields > 0; --fields) {
+        const auto key = reader.readText();
+        if (key == "$type") {
+            type = reader.readText();
+        } else if (key == "record") {
+            quote = readStrongRefUri(reader);
+        } else {
+            reader.skip();
+        }
+    }
+
+    post.hasMedia = type == "app.bsky.embed.images" || type == "app.bsky.embed.video" ||
+                    type == "app.bsky.embed.recordWithMedia";
+    if (type == "app.bsky.embed.record" || type == "app.bsky.embed.recordWithMedia") {
+        post.quoteUri.assign(quote);
+    }
+}
+
+void FirehoseFrame::readSelfLabels(DagCborReader& reader, Post& post) {
+    for (auto fields = reader.readMap(); fields > 0; --fields) {
+        if (reader.readText() != "values") {
+            reader.skip();
+            continue;
+        }
+        for (auto count = reader.readArray(); count > 0; --count) {
+            for (auto labelFields = reader.readMap(); labelFields > 0; --labelFields) {
+                if (reader.readText() == "val") {
+                    post.labels.emplace_back(reader.readText());
+                } else {
+                    reader.skip();
+                }
+            }
+        }
+    }
+}
+
+bool FirehoseFrame::decodePost(const std::string_view block, Post& post) {
+    post.text.clear();
+    post.langs.clear();
+    post.labels.clear();
+    post.replyParent.clear();
+    post.quoteUri.clear();
+    post.hasMedia = false;
+    post.createdAtUs = 0;
+
+    try {
+        DagCborReader reader(block);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            const auto key = reader.readText();
+            if (key == "$type") {
+                if (reader.readText() != POST_COLLECTION) {
+                    return false;
+                }
+            } else if (key == "text") {
+                post.text.assign(reader.readText());
+            } else if (key == "langs") {
+                for (auto count = reader.readArray(); count > 0; --count) {
+                    post.langs.emplace_back(reader.readText());
+                }
+            } else if (key == "reply") {
+                for (auto replyFields = reader.readMap(); replyFields > 0; --replyFields) {
+                    if (reader.readText() == "parent") {
+                        post.replyParent.assign(readStrongRefUri(reader));
+                    } else {
+                        reader.skip();
+                    }
+                }
+            } else if (key == "embed") {
+                readEmbed(reader, post);
+            } else if (key == "labels") {
+                readSelfLabels(reader, post);
+            } else if (key == "createdAt") {
+                post.createdAtUs = Timestamp::parseIso8601(reader.readText()).value_or(0);
+            } else {
+                reader.skip();
+            }
+        }
+        return true;
+    } catch (const DagCborException&) {
+        return false;
+    }
+}
+
+std::optional<std::string_view> FirehoseFrame::decodeSubject(const std::string_view block) {
+    try {
+        DagCborReader reader(block);
+        for (auto fields = reader.readMap(); fields > 0; --fields) {
+            if (reader.readText() != "subject") {
+                reader.skip();
+                continue;
+            }
+            const auto subject = reader.peek() == DagCborReader::Type::Text ? reader.readText()
+                                                                              : readStrongRefUri(reader);
+            return subject.empty() ? std::nullopt : std::optional<std::string_view>(subject);
+        }
+    } catch (const DagCborException&) {
+    }
+    return std::nullopt;
+}
+
+bool FirehoseFrame::postEvent(const std::string_view repo, const std::string_view path, const std::string_view cid,
+                              const std::string_view block, IngestEvent& event) {
+    auto& post = event.post;
+    if (!decodePost(block, post)) {
+        return false;
+    }
+    event.kind = EventKind::Post;
+    event.uri.assign("at://").append(repo).append("/").append(path);
+    event.cid = Base32::encodeMultibase(cid);
+    event.repo.assign(repo);
+    event.subject.clear();
+
+    post.uri = event.uri;
+    post.cid = event.cid;
+    post.authorDid = event.repo;
+    if (post.createdAtUs == 0) {
+        post.createdAtUs = Base32::tidTimestamp(path.substr(path.find('/') + 1)).value_or(0);
+    }
+    return true;
+}
+
+size_t FirehoseFrame::events(const CommitFrame& commit, const Sink& sink) {
+    IngestEvent event;
+    event.repo.assign(commit.repo);
+    size_t emitted = 0;
+
+    for (const auto& op : commit.ops) {
+        const auto collection = op.collection();
+        if (collection == POST_COLLECTION) {
+            event.kind = EventKind::Post;
+        } else if (collection == LIKE_COLLECTION) {
+            event.kind = EventKind::Like;
+        } else if (collection == REPOST_COLLECTION) {
+            event.kind = EventKind::Repost;
+        } else if (collection == FOLLOW_COLLECTION) {
+            event.kind = EventKind::Follow;
+        } else {
+            continue;
+        }
+
+        event.uri.assign("at://").append(commit.repo).append("/").append(op.path);
+        event.subject.clear();
+
+        if (op.action == "delete") {
+            event.kind = EventKind::Delete;
+            event.cid.clear();
+        } else if (op.action == "create") {
+            const auto block = findBlock(commit.blocks, op.cid);
+            if (!block) {
+                continue; // Blocks are missing from tooBig commits
+            }
+            if (event.kind == EventKind::Post) {
+                if (!postEvent(commit.repo, op.path, op.cid, *block, event)) {
+                    continue;
+                }
+            } else if (const auto subject = decodeSubject(*block)) {
+                event.cid = Base32::encodeMultibase(op.cid);
+                event.subject.assign(*subject);
+            } else {
+                continue;
+            }
+        } else {
+            continue; // Updates do not change anything feeds index
+        }
+
+        event.time = std::chrono::system_clock::now();
+        sink(event);
+        ++emitted;
+    }
+    return emitted;
+}
+
+size_t FirehoseFrame::events(const AccountFrame& account, const Sink& sink) {
+    const auto removed = account.status == "takendown" || account.status == "suspended" ||
+                         account.status == "deleted";
+    if (!account.active && !removed) {
+        return 0;
+    }
+    IngestEvent event;
+    event.kind = account.active ? EventKind::Reinstate : EventKind::Takedown;
+    event.repo.assign(account.did);
+    sink(event);
+    return 1;
+}
@@ -0,0 +1,99 @@
+//
+// Created by jayian on 2/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FIREHOSE_FRAME_H
+#define FIREHOSE_FRAME_H
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include "event.hpp"
+
+class DagCborReader;
+
+// Header of a com.atproto.sync.subscribeRepos frame
+struct FrameHeader {
+    int64_t op = 0;        // 1 for a message, -1 for an error frame
+    std::string_view type; // "#commit", "#identity", "#account", ...
+};
+
+// One record operation of a commit. Views point into the frame.
+struct RepoOp {
+    std::string_view action; // "create", "update" or "delete"
+    std::string_view path;   // "<collection>/<rkey>"
+    std::string_view cid;    // Binary CID of the new record; empty for deletes
+
+    [[nodiscard]] std::string_view collection() const { return path.substr(0, path.find('/')); }
+};
+
+// The fields of a #commit message that ingest uses. Views point into the frame, so a CommitFrame is
+// only valid while the frame buffer is; reuse one across frames to keep the ops vector's capacity.
+struct CommitFrame {
+    int64_t seq = 0;
+    std::string_view repo;
+    std::string_view rev;
+    std::string_view time;
+    bool tooBig = false;      // The commit's blocks were omitted
+    std::string_view blocks;  // CAR file holding the new records
+    std::vector<RepoOp> ops;
+};
+
+// The fields of an #account message: a change to whether the network serves the account's content
+struct AccountFrame {
+    int64_t seq = 0;
+    std::string_view did;
+    bool active = true;
+    std::string_view status; // Why the account is inactive: "takendown", "suspended", "deleted", ...
+};
+
+// Typed decoding of firehose frames straight from the receive buffer, with no intermediate DOM.
+// Malformed input makes the decode functions return false or nullopt rather than throw.
+class FirehoseFrame {
+public:
+    using Sink = std::function<void(const IngestEvent&)>;
+
+    // Split a frame into its header; body receives the rest of the frame
+    static std::optional<FrameHeader> decodeHeader(std::string_view frame, std::string_view& body);
+
+    static bool decodeCommit(std::string_view body, CommitFrame& commit);
+    static bool decodeAccount(std::string_view body, AccountFrame& account);
+
+    // The block stored under cid in a commit's CAR blocks
+    static std::optional<std::string_view> findBlock(std::string_view car, std::string_view cid);
+
+    // Fill the record fields of post (everything except uri, cid and authorDid) from an
+    // app.bsky.feed.post block
+    static bool decodePost(std::string_view block, Post& post);
+
+    // Fill event with the post stored at path ("app.bsky.feed.post/<rkey>") of repo, e.g. from a commit or
+    // a repo export; false if block is not a usable post
+    static bool postEvent(std::string_view repo, std::string_view path, std::string_view cid,
+                          std::string_view block, IngestEvent& event);
+
+    // Hand every create/delete of posts, likes, reposts and follows in a commit to sink as an event.
+    // The event passed to sink is reused between calls. Returns the number of events emitted.
+    static size_t events(const CommitFrame& commit, const Sink& sink);
+
+    // A Takedown event for an account that was taken down, suspended or deleted, and a Reinstate event for
+    // an active one. An account its owner deactivated emits nothing: its posts stay up.
+    static size_t events(const AccountFrame& account, const Sink& sink);
+
+private:
+    // A recordWithMedia embed nests the strongRef one level down; deeper "record" keys are skipped
+    static constexpr int MAX_RECORD_NESTING = 1;
+
+    static std::string_view readStrongRefUri(DagCborReader& reader, int nesting = MAX_RECORD_NESTING);
+    static void readEmbed(DagCborReader& reader, Post& post);
+    static void readSelfLabels(DagCborReader& reader, Post& post);
+
+    // Like/repost: the subject post URI. Follow: the followed DID.
+    static std::optional<std::string_view> decodeSubject(std::string_view block);
+};
+
+#endif // FIREHOSE_FRAME_H
@@ -0,0 +1,101 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "firehose_subscriber.hpp"
+#include "../config/settings.hpp"
+#include "../tools/logging.hpp"
+
+FirehoseSubscriber::FirehoseSubscriber(Options options, FrameSink sink, CursorSource cursor)
+    : options(std::move(options)), sink(std::move(sink)), cursor(std::move(cursor)) {}
+
+FirehoseSubscriber::~FirehoseSubscriber() {
+    stop();
+}
+
+void FirehoseSubscriber::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    if (reader.joinable()) {
+        reader.join(); // The sink ended the previous run
+    }
+    reader = std::thread(&FirehoseSubscriber::run, this);
+}
+
+void FirehoseSubscriber::stop() {
+    running = false;
+    {
+        std::lock_guard lock(mutex);
+        if (client) {
+            client->close();
+        }
+    }
+    wake.notify_all();
+    if (reader.joinable()) {
+        reader.join();
+    }
+}
+
+void FirehoseSubscriber::run() {
+    auto backoff = std::chrono::seconds(1);
+    std::string frame;
+
+    while (running) {
+        // Each attempt gets its own client, published only once connected so stop() never races connect()
+        auto connection = std::make_shared<WebSocketClient>();
+        const auto url = urlWithCursor(options.url, cursor ? cursor() : 0);
+        try {
+            connection->connect(url, options.readTimeout);
+            std::lock_guard lock(mutex);
+            if (!running) {
+                break;
+            }
+            client = connection;
+        } catch (const WebSocketException& e) {
+            Logging::error("Firehose connection failed: " + std::string(e.what()));
+            connection.reset();
+        }
+
+        if (connection) {
+            connected = true;
+            backoff = std::chrono::seconds(1);
+            Logging::info("Connected to " + url);
+            while (connection->readMessage(frame)) {
+                ++frameCount;
+                byteCount += frame.size();
+                if (!sink(std::move(frame))) {
+                    running = false;
+                    break;
+                }
+                frame.clear();
+            }
+            connected = false;
+            Logging::info("Firehose connection closed");
+        }
+
+        std::unique_lock lock(mutex);
+        client.reset();
+        if (wake.wait_for(lock, backoff, [this] { return !running; })) {
+            break;
+        }
+        backoff = std::min(backoff * 2, options.maxBackoff);
+        ++reconnectCount;
+    }
+}
+
+std::string FirehoseSubscriber::urlWithCursor(const std::string& url, const int64_t cursor) {
+    if (cursor <= 0) {
+        return url;
+    }
+    return url + (url.find('?') == std::string::npos ? "?" : "&") + "cursor=" + std::to_string(cursor);
+}
+
+FirehoseSubscriber::Options FirehoseSubscriber::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.url = settings.get<std::string>("firehose_url", result.url);
+    result.readTimeout = std::chrono::seconds(settings.get<int64_t>("firehose_read_timeout_seconds",
+                                                                    result.readTimeout.count()));
+    return result;
+}
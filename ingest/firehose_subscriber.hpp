@@ -0,0 +1,86 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FIREHOSE_SUBSCRIBER_H
+#define FIREHOSE_SUBSCRIBER_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "../network/websocket_client.hpp"
+
+class Settings;
+
+// Receive stage: reads com.atproto.sync.subscribeRepos frames on a background thread and hands each to
+// the sink, reconnecting with exponential backoff when the connection drops. Every connection asks the
+// relay to resume after the cursor the CursorSource reports, so a reconnect or restart neither skips
+// events nor starts over from live.
+//
+// The sink is called on the reader thread and may block (IngestPipeline::pushFrame does when decoding is
+// behind); nothing more is read from the socket until it returns.
+class FirehoseSubscriber {
+public:
+    // Returns false to stop reading
+    using FrameSink = std::function<bool(std::string&&)>;
+
+    // Sequence number to resume after; 0 starts from live
+    using CursorSource = std::function<int64_t()>;
+
+    struct Options {
+        std::string url = "wss://bsky.network/xrpc/com.atproto.sync.subscribeRepos";
+        std::chrono::seconds readTimeout{60};
+        std::chrono::seconds maxBackoff{60};
+    };
+
+    FirehoseSubscriber(Options options, FrameSink sink, CursorSource cursor = nullptr);
+    ~FirehoseSubscriber();
+
+    FirehoseSubscriber(const FirehoseSubscriber&) = delete;
+    FirehoseSubscriber& operator=(const FirehoseSubscriber&) = delete;
+
+    void start();
+
+    // Close the connection and wait for the reader thread; a sink call in progress finishes first
+    void stop();
+
+    [[nodiscard]] bool isRunning() const { return running; }
+    [[nodiscard]] bool isConnected() const { return connected; }
+    [[nodiscard]] uint64_t frames() const { return frameCount; }
+    [[nodiscard]] uint64_t bytes() const { return byteCount; }
+    [[nodiscard]] uint64_t reconnects() const { return reconnectCount; }
+
+    // The subscription URL resuming after cursor
+    static std::string urlWithCursor(const std::string& url, int64_t cursor);
+
+    // Reads firehose_url and firehose_read_timeout_seconds from settings.json
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    Options options;
+    FrameSink sink;
+    CursorSource cursor;
+
+    std::thread reader;
+    std::mutex mutex;                        // Guards client
+    std::shared_ptr<WebSocketClient> client; // The open connection, for stop() to close
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+    std::atomic<bool> connected{false};
+
+    std::atomic<uint64_t> frameCount{0};
+    std::atomic<uint64_t> byteCount{0};
+    std::atomic<uint64_t> reconnectCount{0};
+
+    void run();
+};
+
+#endif // FIREHOSE_SUBSCRIBER_H
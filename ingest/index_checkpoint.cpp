@@ -0,0 +1,283 @@
+//
+// Created by jayian on 2/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "index_checkpoint.hpp"
+#include <fstream>
+#include <unordered_map>
+#include "event.hpp"
+#include "../config/settings.hpp"
+#include "../tools/durable_file.hpp"
+#include "../tools/logging.hpp"
+
+// The state a checkpoint covers, copied while the pipeline is drained. Strings are resolved only when
+// writing: interned ids never change meaning, but engagement totals and scores would.
+struct IndexCheckpoint::Snapshot {
+    struct Post {
+        uint32_t postId = 0;
+        uint32_t authorId = 0;
+        uint64_t key = 0;
+        EngagementCounts counts;
+    };
+
+    struct SavedFeed {
+        std::string name;
+        std::vector<std::pair<size_t, double>> entries; // Position in posts and decayed score
+    };
+
+    int64_t seq = 0;
+    std::chrono::system_clock::time_point savedAt;
+    std::vector<Post> posts;
+    std::vector<SavedFeed> feeds;
+    std::vector<std::string> takedowns;
+};
+
+IndexCheckpoint::IndexCheckpoint(Options options, std::shared_ptr<FeedRegistry> registry,
+                                 std::shared_ptr<StringInterner> actorDids,
+                                 std::shared_ptr<EngagementCounters> engagement)
+    : options(std::move(options)), registry(std::move(registry)), actorDids(std::move(actorDids)),
+      engagement(std::move(engagement)) {}
+
+IndexCheckpoint::~IndexCheckpoint() {
+    {
+        std::lock_guard lock(pendingMutex);
+        stopping = true;
+    }
+    pendingChanged.notify_all();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+bool IndexCheckpoint::save(const int64_t seq) {
+    return write(snapshot(seq));
+}
+
+void IndexCheckpoint::saveInBackground(const int64_t seq) {
+    auto taken = std::make_unique<Snapshot>(snapshot(seq));
+    {
+        std::lock_guard lock(pendingMutex);
+        pending = std::move(taken);
+        if (!writer.joinable()) {
+            writer = std::thread([this] { writeLoop(); });
+        }
+    }
+    pendingChanged.notify_one();
+}
+
+void IndexCheckpoint::writeLoop() {
+    std::unique_lock lock(pendingMutex);
+    while (true) {
+        pendingChanged.wait(lock, [this] { return pending || stopping; });
+        if (!pending) {
+            return;
+        }
+        const auto taken = std::move(pending);
+        lock.unlock();
+        write(*taken);
+        lock.lock();
+    }
+}
+
+IndexCheckpoint::Snapshot IndexCheckpoint::snapshot(const int64_t seq) const {
+    if (engagement) {
+        engagement->merge(); // Totals still pending on ingest shards belong to this checkpoint too
+    }
+
+    Snapshot result;
+    result.seq = seq;
+    result.savedAt = std::chrono::system_clock::now();
+    std::unordered_map<uint32_t, size_t> positions;
+    const auto& tombstones = registry->tombstones();
+
+    for (const auto& feed : registry->feeds()) {
+        auto& saved = result.feeds.emplace_back();
+        saved.name = feed->name();
+        const auto entries = feed->index().page(std::nullopt, feed->index().size());
+        saved.entries.reserve(entries.size());
+        for (const auto& entry : entries) {
+            if (tombstones.removed(entry.postId, *registry->postUris())) {
+                continue; // Not purged yet, but must not come back after a restart
+            }
+            auto [position, added] = positions.try_emplace(entry.postId, result.posts.size());
+            if (added) {
+                const auto counts = engagement ? engagement->read(entry.postId) : EngagementCounts{};
+                result.posts.push_back({entry.postId, entry.authorId, entry.key, counts});
+            }
+            const auto score =
+                feed->sort() == FeedSort::Top ? feed->ranking().score(entry.postId, result.savedAt) : 0.0;
+            saved.entries.emplace_back(position->second, score);
+        }
+    }
+    result.takedowns = tombstones.authorDids(); // Their later posts must stay hidden after a restart
+    return result;
+}
+
+// Posts are stored once as [uri, author, key, likes, reposts, replies] and feeds refer to them by
+// position as [post, score], since a post is usually in several feeds. Written one element at a time
+// rather than through a document of the whole index.
+bool IndexCheckpoint::write(const Snapshot& snapshot) {
+    std::lock_guard lock(fileMutex);
+    if (snapshot.seq <= writtenSeq) {
+        return true; // A save from the same or a later cursor got there first
+    }
+    const auto started = std::chrono::steady_clock::now();
+
+    // One file renamed into place, so the cursor can never be newer or older than the feeds beside it
+    DurableFile file(options.path);
+    const auto savedAt = std::chrono::duration_cast<std::chrono::seconds>(snapshot.savedAt.time_since_epoch());
+    auto written = file.write("{\"seq\":" + std::to_string(snapshot.seq) +
+                              ",\"savedAt\":" + std::to_string(savedAt.count()) + ",\"posts\":[");
+    for (size_t i = 0; i < snapshot.posts.size() && written; ++i) {
+        const auto& post = snapshot.posts[i];
+        const nlohmann::json saved = {std::string(registry->postUris()->lookup(post.postId)),
+                                      std::string(actorDids->lookup(post.authorId)), post.key, post.counts.likes,
+                                      post.counts.reposts, post.counts.replies};
+        written = file.write((i == 0 ? "" : ",") + saved.dump());
+    }
+    written = written && file.write("],\"feeds\":{");
+    for (size_t i = 0; i < snapshot.feeds.size() && written; ++i) {
+        const auto& feed = snapshot.feeds[i];
+        written = file.write((i == 0 ? "" : ",") + nlohmann::json(feed.name).dump() + ":[");
+        for (size_t k = 0; k < feed.entries.size() && written; ++k) {
+            const nlohmann::json entry = {feed.entries[k].first, feed.entries[k].second};
+            written = file.write((k == 0 ? "" : ",") + entry.dump());
+        }
+        written = written && file.write("]");
+    }
+    written = written && file.write("},\"takedowns\":" + nlohmann::json(snapshot.takedowns).dump() + "}");
+    if (!written || !file.commit()) {
+        Logging::error("Unable to save checkpoint to " + options.path);
+        return false;
+    }
+    writtenSeq = snapshot.seq;
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - started);
+    Logging::debug("Checkpoint at seq " + std::to_string(snapshot.seq) + " with " +
+                   std::to_string(snapshot.posts.size()) + " posts saved in " + std::to_string(elapsed.count()) +
+                   "ms");
+    return true;
+}
+
+std::optional<int64_t> IndexCheckpoint::load() {
+    std::ifstream file(options.path);
+    if (!file) {
+        return std::nullopt;
+    }
+
+    struct SavedPost {
+        std::string uri;
+        std::string author;
+        uint64_t key = 0;
+        int64_t totals[3] = {};
+        std::optional<uint32_t> postId; // Interned lazily so posts only in removed feeds are not restored
+    };
+    struct SavedFeed {
+        size_t index = 0;
+        std::vector<std::pair<size_t, double>> entries;
+    };
+
+    // Everything is read and checked first, so a corrupt file leaves the registry untouched
+    int64_t seq = 0;
+    std::chrono::system_clock::time_point savedAt;
+    std::vector<SavedPost> posts;
+    std::vector<SavedFeed> feeds;
+    std::vector<std::string> takedowns;
+    try {
+        const auto checkpoint = nlohmann::json::parse(file);
+        seq = checkpoint.at("seq").get<int64_t>();
+        savedAt = std::chrono::system_clock::time_point(std::chrono::seconds(checkpoint.value("savedAt", int64_t{0})));
+
+        const auto& savedPosts = checkpoint.at("posts");
+        for (const auto& post : savedPosts) {
+            auto& saved = posts.emplace_back();
+            saved.uri = post.at(0).get<std::string>();
+            saved.author = post.at(1).get<std::string>();
+            saved.key = post.at(2).get<uint64_t>();
+            for (size_t k = 0; k < 3; ++k) {
+                saved.totals[k] = post.at(3 + k).get<int64_t>();
+            }
+        }
+
+        std::unordered_map<std::string, size_t> feedIndexes;
+        for (size_t i = 0; i < registry->size(); ++i) {
+            feedIndexes[registry->feed(i)->name()] = i;
+        }
+        const auto savedFeeds = checkpoint.value("feeds", nlohmann::json::object());
+        for (const auto& [name, entries] : savedFeeds.items()) {
+            const auto found = feedIndexes.find(name);
+            if (found == feedIndexes.end()) {
+                continue;
+            }
+            auto& saved = feeds.emplace_back();
+            saved.index = found->second;
+            for (const auto& item : entries) {
+                const auto position = item.at(0).get<size_t>();
+                savedPosts.at(position); // Throws for a position past the saved posts
+                saved.entries.emplace_back(position, item.at(1).get<double>());
+            }
+        }
+
+        for (const auto& did : checkpoint.value("takedowns", nlohmann::json::array())) {
+            takedowns.push_back(did.get<std::string>());
+        }
+    } catch (const nlohmann::json::exception& e) {
+        Logging::error("Ignoring unreadable checkpoint " + options.path + ": " + e.what());
+        return std::nullopt;
+    }
+
+    std::unordered_map<uint32_t, FeedMask> masks;
+    for (const auto& saved : feeds) {
+        auto& feed = *registry->feed(saved.index);
+        for (const auto& [position, score] : saved.entries) {
+            auto& post = posts[position];
+            if (!post.postId) {
+                post.postId = registry->postUris()->intern(post.uri);
+            }
+            const auto postId = *post.postId;
+            feed.index().insert(post.key, Feed::tieFor(post.uri), postId, actorDids->intern(post.author),
+                                IngestEvent::shardFor(post.author, feed.index().slices()));
+            // Adding the saved score as of the save time decays it across the downtime as well
+            if (feed.sort() == FeedSort::Top && score > 0.0) {
+                feed.ranking().add(postId, score, savedAt);
+            }
+            masks[postId].set(saved.index);
+        }
+    }
+
+    for (const auto& [postId, mask] : masks) {
+        registry->assign(postId, mask);
+    }
+    for (const auto& did : takedowns) {
+        registry->tombstones().markAuthor(did);
+    }
+    if (engagement) {
+        const Engagement kinds[] = {Engagement::Like, Engagement::Repost, Engagement::Reply};
+        for (const auto& post : posts) {
+            for (size_t k = 0; post.postId && k < 3; ++k) {
+                if (post.totals[k] != 0) {
+                    engagement->add(*post.postId, kinds[k], post.totals[k]);
+                }
+            }
+        }
+        engagement->merge();
+    }
+    for (const auto& feed : registry->feeds()) {
+        if (feed->sort() == FeedSort::Top) {
+            feed->ranking().rebuild(std::chrono::system_clock::now());
+        }
+    }
+
+    Logging::info("Restored " + std::to_string(masks.size()) + " posts from checkpoint at seq " + std::to_string(seq));
+    return seq;
+}
+
+IndexCheckpoint::Options IndexCheckpoint::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.path = settings.get<std::string>("checkpoint_path", result.path);
+    result.interval = std::chrono::seconds(settings.get<int64_t>("checkpoint_interval_seconds",
+                                                                 result.interval.count()));
+    return result;
+}
@@ -0,0 +1,88 @@
+//
+// Created by jayian on 2/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef INDEX_CHECKPOINT_H
+#define INDEX_CHECKPOINT_H
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include "../feed/engagement_counters.hpp"
+#include "../feed/feed_registry.hpp"
+#include "../tools/string_interner.hpp"
+
+class Settings;
+
+// The firehose cursor and the feed state it covers, saved together in one file.
+//
+// A checkpoint holds every indexed post (URI, author, sort key, engagement totals) with its decayed score
+// in each feed and the taken-down accounts, plus the sequence number of the last commit whose events are
+// all reflected in that state.
+// Both are written to one temporary file, synced and renamed into place, so after a crash or power loss
+// the restored feeds and the cursor to resume from always agree: nothing before the cursor is lost and
+// nothing after it was already applied.
+class IndexCheckpoint {
+public:
+    struct Options {
+        std::string path = "index_checkpoint.json";
+        std::chrono::seconds interval{60}; // How often the index stage saves while the firehose runs
+    };
+
+    IndexCheckpoint(Options options, std::shared_ptr<FeedRegistry> registry,
+                    std::shared_ptr<StringInterner> actorDids, std::shared_ptr<EngagementCounters> engagement);
+    ~IndexCheckpoint(); // Writes a snapshot still waiting for the background writer
+
+    IndexCheckpoint(const IndexCheckpoint&) = delete;
+    IndexCheckpoint& operator=(const IndexCheckpoint&) = delete;
+
+    // Only consistent with seq while no commit after seq is being indexed: call it once the pipeline
+    // has drained up to seq (IngestPipeline's checkpointer) or has stopped
+    bool save(int64_t seq);
+
+    // Same, but only copy the state here and serialize and write it on a background thread, so the
+    // caller (the firehose receive thread) is held for the copy alone. A snapshot still waiting is
+    // replaced by the newer one.
+    void saveInBackground(int64_t seq);
+
+    // Restore the feeds from the last checkpoint into an empty registry; returns its cursor, or
+    // nothing if there is no readable checkpoint. The whole file is validated before anything is
+    // restored. Feeds no longer configured are skipped.
+    std::optional<int64_t> load();
+
+    [[nodiscard]] std::chrono::seconds interval() const { return options.interval; }
+
+    // Reads checkpoint_path and checkpoint_interval_seconds from settings.json
+    static Options optionsFromSettings(Settings& settings);
+
+private:
+    struct Snapshot;
+
+    Options options;
+    std::shared_ptr<FeedRegistry> registry;
+    std::shared_ptr<StringInterner> actorDids;
+    std::shared_ptr<EngagementCounters> engagement;
+
+    std::mutex fileMutex; // One writer of the file at a time
+    int64_t writtenSeq = -1;
+
+    std::mutex pendingMutex;
+    std::condition_variable pendingChanged;
+    std::unique_ptr<Snapshot> pending;
+    bool stopping = false;
+    std::thread writer;
+
+    [[nodiscard]] Snapshot snapshot(int64_t seq) const;
+    bool write(const Snapshot& snapshot);
+    void writeLoop();
+};
+
+#endif // INDEX_CHECKPOINT_H
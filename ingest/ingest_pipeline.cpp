@@ -0,0 +1,231 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "ingest_pipeline.hpp"
+#include "../config/settings.hpp"
+#include "../tools/logging.hpp"
+
+static uint64_t elapsedNs(const std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+IngestPipeline::Shard::Shard(const Options& options)
+    : frames(options.frameCapacity, options.frameHighWaterMark),
+      events(options.eventCapacity, options.eventHighWaterMark) {}
+
+IngestPipeline::IngestPipeline(const Options& options, Indexer indexer)
+    : options(options), indexer(std::move(indexer)) {
+    this->options.batchSize = std::max<size_t>(1, this->options.batchSize);
+    const auto count = shardCountFor(options);
+    for (size_t i = 0; i < count; ++i) {
+        shards.push_back(std::make_unique<Shard>(options));
+    }
+}
+
+IngestPipeline::~IngestPipeline() {
+    stop();
+}
+
+size_t IngestPipeline::shardCountFor(const Options& options) {
+    if (options.shards > 0) {
+        return options.shards;
+    }
+    return std::max<size_t>(1, std::thread::hardware_concurrency() / 2);
+}
+
+void IngestPipeline::setCheckpointer(const std::chrono::seconds interval, Checkpointer checkpointer) {
+    checkpointInterval = interval;
+    this->checkpointer = std::move(checkpointer);
+}
+
+void IngestPipeline::resumeAfter(const int64_t seq) {
+    latestSeq = seq;
+    latestIndexedSeq = seq;
+}
+
+void IngestPipeline::resetSequence() {
+    drain();
+    latestSeq = 0;
+    latestIndexedSeq = 0;
+}
+
+void IngestPipeline::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    lastCheckpoint = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shards[i]->decoder = std::thread(&IngestPipeline::decodeLoop, this, std::ref(*shards[i]));
+        shards[i]->indexer = std::thread(&IngestPipeline::indexLoop, this, i);
+    }
+}
+
+void IngestPipeline::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    // Close front to back so each stage drains what the one before it produced
+    for (const auto& shard : shards) {
+        shard->frames.close();
+    }
+    for (const auto& shard : shards) {
+        shard->decoder.join();
+        shard->events.close();
+    }
+    for (const auto& shard : shards) {
+        shard->indexer.join();
+    }
+    latestIndexedSeq = latestSeq.load();
+}
+
+// Only the envelope is read here, in place, to find the repo; records are decoded on the shard
+bool IngestPipeline::pushFrame(std::string frame) {
+    std::string_view body;
+    const auto header = FirehoseFrame::decodeHeader(frame, body);
+    if (!header) {
+        ++malformed;
+        return running;
+    }
+    if (header->op != 1) {
+        Logging::error("Firehose error frame: " + std::string(header->type));
+        return running;
+    }
+
+    int64_t seq;
+    std::string_view repo;
+    if (header->type == "#commit") {
+        if (!FirehoseFrame::decodeCommit(body, envelope)) {
+            ++malformed;
+            return running;
+        }
+        seq = envelope.seq;
+        repo = envelope.repo;
+    } else if (header->type == "#account") {
+        if (!FirehoseFrame::decodeAccount(body, account)) {
+            ++malformed;
+            return running;
+        }
+        seq = account.seq;
+        repo = account.did;
+    } else {
+        return running; // Identity events do not change feeds
+    }
+
+    // Sequence numbers only grow, so anything not newer was indexed before a reconnect or restart
+    if (seq <= latestSeq.load(std::memory_order_relaxed)) {
+        ++replayed;
+        return running;
+    }
+
+    // Account events go to the account's shard too, so a takedown lands after the commits before it
+    auto& shard = *shards[IngestEvent::shardFor(repo, shards.size())];
+    if (!shard.frames.push(std::move(frame))) {
+        return false;
+    }
+    ++shard.framesRouted;
+    latestSeq.store(seq, std::memory_order_relaxed);
+
+    // Shards run ahead of each other, so the only moment the index holds exactly the commits up to seq
+    // is after routing stops and every shard catches up
+    if (checkpointer && std::chrono::steady_clock::now() - lastCheckpoint >= checkpointInterval) {
+        drain();
+        checkpointer(seq);
+        latestIndexedSeq = seq;
+        lastCheckpoint = std::chrono::steady_clock::now();
+    }
+    return true;
+}
+
+bool IngestPipeline::pushEvent(IngestEvent event) {
+    return shards[IngestEvent::shardFor(event.repo, shards.size())]->events.push(std::move(event));
+}
+
+void IngestPipeline::drain() {
+    for (const auto& shard : shards) {
+        QueueBackoff backoff;
+        while (shard->framesDecoded.load(std::memory_order_acquire) < shard->framesRouted) {
+            backoff.pause();
+        }
+        const auto pushed = shard->events.stats().pushed;
+        while (shard->eventsIndexed.load(std::memory_order_acquire) < pushed) {
+            backoff.pause();
+        }
+    }
+}
+
+void IngestPipeline::decodeLoop(Shard& shard) {
+    std::vector<std::string> batch;
+    batch.reserve(options.batchSize);
+    CommitFrame commit;
+    AccountFrame account;
+    const auto sink = [&shard](const IngestEvent& event) { shard.events.push(event); };
+
+    while (shard.frames.popBatch(batch, options.batchSize) > 0) {
+        const auto started = std::chrono::steady_clock::now();
+        for (const auto& frame : batch) {
+            // Already validated by pushFrame()
+            std::string_view body;
+            if (FirehoseFrame::decodeHeader(frame, body)->type == "#account") {
+                FirehoseFrame::decodeAccount(body, account);
+                FirehoseFrame::events(account, sink);
+            } else {
+                FirehoseFrame::decodeCommit(body, commit);
+                FirehoseFrame::events(commit, sink);
+            }
+        }
+        shard.decodeBusyNs.fetch_add(elapsedNs(started), std::memory_order_relaxed);
+        shard.framesDecoded.fetch_add(batch.size(), std::memory_order_release);
+        batch.clear();
+    }
+}
+
+void IngestPipeline::indexLoop(const size_t shard) {
+    auto& self = *shards[shard];
+    std::vector<IngestEvent> batch;
+    batch.reserve(options.batchSize);
+
+    while (self.events.popBatch(batch, options.batchSize) > 0) {
+        const auto started = std::chrono::steady_clock::now();
+        for (const auto& event : batch) {
+            indexer(shard, event);
+        }
+        self.indexBusyNs.fetch_add(elapsedNs(started), std::memory_order_relaxed);
+        self.eventsIndexed.fetch_add(batch.size(), std::memory_order_release);
+        batch.clear();
+    }
+}
+
+std::vector<IngestPipeline::StageStats> IngestPipeline::stats() const {
+    std::vector<StageStats> result;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        const auto& shard = *shards[i];
+        StageStats decode;
+        decode.name = "decode/" + std::to_string(i);
+        decode.queue = shard.frames.stats();
+        decode.processed = shard.framesDecoded;
+        decode.busyNs = shard.decodeBusyNs;
+        result.push_back(std::move(decode));
+
+        StageStats index;
+        index.name = "index/" + std::to_string(i);
+        index.queue = shard.events.stats();
+        index.processed = shard.eventsIndexed;
+        index.busyNs = shard.indexBusyNs;
+        result.push_back(std::move(index));
+    }
+    return result;
+}
+
+IngestPipeline::Options IngestPipeline::optionsFromSettings(Settings& settings) {
+    Options result;
+    result.shards = settings.get<size_t>("ingest_shards", result.shards);
+    result.frameCapacity = settings.get<size_t>("pipeline_frame_capacity", result.frameCapacity);
+    result.frameHighWaterMark = settings.get<size_t>("pipeline_frame_high_water", result.frameHighWaterMark);
+    result.eventCapacity = settings.get<size_t>("pipeline_event_capacity", result.eventCapacity);
+    result.eventHighWaterMark = settings.get<size_t>("pipeline_event_high_water", result.eventHighWaterMark);
+    result.batchSize = settings.get<size_t>("pipeline_batch_size", result.batchSize);
+    return result;
+}
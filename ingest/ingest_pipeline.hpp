@@ -0,0 +1,149 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef INGEST_PIPELINE_H
+#define INGEST_PIPELINE_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event.hpp"
+#include "firehose_frame.hpp"
+#include "../tools/ring_queue.hpp"
+
+class Settings;
+
+// Staged ingest: receive -> decode -> index, with a bounded queue in front of every stage.
+//
+// Decoding and indexing are split into shards by a hash of the repo DID, each shard with its own decode
+// and index thread. All records of one account land on the same shard, so they are applied in order,
+// and each shard writes only its own slice of the feed indexes. The receiving thread (the firehose
+// reader) hands raw frames to pushFrame(), which reads just the commit envelope to route the frame;
+// other sources such as backfill and repo imports enter at pushEvent(). #account frames are routed the
+// same way and become Takedown events when an account goes inactive. When a stage lags, its queue
+// fills to the high-water mark and the push in front of it blocks, so a slow index pass stalls
+// decoding, which stalls the network reader, instead of growing memory without limit.
+class IngestPipeline {
+public:
+    // Called from a shard's index thread; calls for one shard never overlap
+    using Indexer = std::function<void(size_t shard, const IngestEvent&)>;
+
+    // Called from the receiving thread once every commit up to seq, and none after it, is indexed. Frames
+    // are not read while it runs, so it should only copy the state and leave writing it to another thread.
+    using Checkpointer = std::function<void(int64_t seq)>;
+
+    struct Options {
+        size_t shards = 0;             // 0 means one per two hardware threads
+        size_t frameCapacity = 4096;   // Per shard
+        size_t frameHighWaterMark = 0; // 0 means the full capacity
+        size_t eventCapacity = 65536;  // Per shard
+        size_t eventHighWaterMark = 0;
+        size_t batchSize = 256;        // Items a stage takes from its queue at once
+    };
+
+    struct StageStats {
+        std::string name;     // "decode/<shard>" or "index/<shard>"
+        QueueStats queue;     // The queue feeding this stage
+        uint64_t processed = 0;
+        uint64_t busyNs = 0;  // Time spent working rather than waiting for input
+    };
+
+    IngestPipeline(const Options& options, Indexer indexer);
+    explicit IngestPipeline(Indexer indexer) : IngestPipeline(Options{}, std::move(indexer)) {}
+    ~IngestPipeline();
+
+    IngestPipeline(const IngestPipeline&) = delete;
+    IngestPipeline& operator=(const IngestPipeline&) = delete;
+
+    // Drain and save a checkpoint every interval while firehose commits arrive. Call before start().
+    void setCheckpointer(std::chrono::seconds interval, Checkpointer checkpointer);
+
+    // Treat every commit up to seq as already indexed (restored from a checkpoint). Call before start().
+    void resumeAfter(int64_t seq);
+
+    // Forget the sequence numbers seen so far, when frames will come from a relay that numbers its own.
+    // Indexes what was already routed first; the receive stage must be stopped.
+    void resetSequence();
+
+    void start();
+
+    // Process everything already queued, then stop every stage. Producers must have stopped pushing.
+    void stop();
+
+    [[nodiscard]] bool isRunning() const { return running; }
+    [[nodiscard]] size_t shardCount() const { return shards.size(); }
+
+    // Receive stage: one thread only. Blocks while the shard's decode stage is behind; false once stopped.
+    bool pushFrame(std::string frame);
+
+    // Any number of threads. Blocks while the shard's index stage is behind; false once stopped.
+    bool pushEvent(IngestEvent event);
+
+    [[nodiscard]] std::vector<StageStats> stats() const;
+    [[nodiscard]] uint64_t malformedFrames() const { return malformed; }
+
+    // Commits at or before lastSeq() that arrived again, e.g. after resuming from an older cursor
+    [[nodiscard]] uint64_t replayedFrames() const { return replayed; }
+
+    // Sequence number of the newest commit routed; the cursor to resume a dropped connection from
+    [[nodiscard]] int64_t lastSeq() const { return latestSeq; }
+
+    // Sequence number up to which every commit is known to be indexed: as of the last checkpoint,
+    // or of stop()
+    [[nodiscard]] int64_t indexedSeq() const { return latestIndexedSeq; }
+
+    // Reads ingest_shards, pipeline_frame_capacity, pipeline_frame_high_water, pipeline_event_capacity,
+    // pipeline_event_high_water and pipeline_batch_size from settings.json
+    static Options optionsFromSettings(Settings& settings);
+
+    // The number of shards options asks for
+    static size_t shardCountFor(const Options& options);
+
+private:
+    struct Shard {
+        explicit Shard(const Options& options);
+
+        SpscQueue<std::string> frames;
+        MpscQueue<IngestEvent> events;
+        std::thread decoder;
+        std::thread indexer;
+
+        uint64_t framesRouted = 0; // Receiving thread only
+        std::atomic<uint64_t> framesDecoded{0};
+        std::atomic<uint64_t> eventsIndexed{0};
+        std::atomic<uint64_t> decodeBusyNs{0};
+        std::atomic<uint64_t> indexBusyNs{0};
+    };
+
+    Options options;
+    Indexer indexer;
+    Checkpointer checkpointer;
+    std::chrono::seconds checkpointInterval{0};
+    std::chrono::steady_clock::time_point lastCheckpoint;
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> running{false};
+    CommitFrame envelope; // Receiving thread only
+    AccountFrame account; // Receiving thread only
+
+    std::atomic<uint64_t> malformed{0};
+    std::atomic<uint64_t> replayed{0};
+    std::atomic<int64_t> latestSeq{0};
+    std::atomic<int64_t> latestIndexedSeq{0};
+
+    void decodeLoop(Shard& shard);
+    void indexLoop(size_t shard);
+
+    // Wait until every frame routed so far has been decoded and every resulting event indexed
+    void drain();
+};
+
+#endif // INGEST_PIPELINE_H
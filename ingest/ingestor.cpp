@@ -0,0 +1,245 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "ingestor.hpp"
+#include <algorithm>
+#include <iterator>
+#include "../tools/base32.hpp"
+
+static constexpr std::string_view POST_COLLECTION = "/app.bsky.feed.post/";
+static constexpr std::string_view FOLLOW_COLLECTION = "/app.bsky.graph.follow/";
+
+Ingestor::Ingestor(std::shared_ptr<FeedRegistry> registry, std::shared_ptr<StringInterner> actorDids,
+                   std::shared_ptr<EngagementCounters> engagement, const DedupeFilter::Options& dedupe,
+                   std::shared_ptr<FollowGraph> follows)
+    : registry(std::move(registry)), actorDids(std::move(actorDids)), engagement(std::move(engagement)),
+      follows(std::move(follows)), dedupe(dedupe),
+      countedPerGeneration(std::max<size_t>(1, dedupe.itemsPerGeneration)),
+      followRecordsSweepAt(countedPerGeneration) {}
+
+uint64_t Ingestor::sortKey(const std::string_view uri, const uint64_t createdAtUs) {
+    const auto slash = uri.rfind('/');
+    if (slash != std::string_view::npos) {
+        if (const auto timestamp = Base32::tidTimestamp(uri.substr(slash + 1))) {
+            return *timestamp;
+        }
+    }
+    return createdAtUs;
+}
+
+bool Ingestor::ingest(const IngestEvent& event) {
+    ++counters.events;
+
+    // Account events carry no record to deduplicate by, and applying one twice is harmless
+    const auto account = event.kind == EventKind::Takedown || event.kind == EventKind::Reinstate;
+    const auto duplicate = account ? false
+                           : event.kind == EventKind::Delete ? dedupe.checkAndInsert(event.uri)
+                                                             : dedupe.checkAndInsert(event.uri, event.cid);
+    if (duplicate) {
+        ++counters.duplicates;
+        return false;
+    }
+
+    switch (event.kind) {
+        case EventKind::Post:
+            return ingestPost(event);
+        case EventKind::Like:
+            return ingestEngagement(event.subject, Engagement::Like, event.time, event.uri);
+        case EventKind::Repost:
+            return ingestEngagement(event.subject, Engagement::Repost, event.time, event.uri);
+        case EventKind::Follow:
+            return ingestFollow(event);
+        case EventKind::Delete:
+            return ingestDelete(event);
+        case EventKind::Takedown:
+            return ingestTakedown(event);
+        case EventKind::Reinstate:
+            return ingestReinstate(event);
+    }
+    return false;
+}
+
+bool Ingestor::ingestPost(const IngestEvent& event) {
+    const auto& post = event.post;
+    auto changed = false;
+    if (post.isReply()) {
+        changed = ingestEngagement(post.replyParent, Engagement::Reply, event.time);
+    }
+
+    const auto mask = registry->evaluate(post);
+    if (!mask.any()) {
+        ++counters.postsUnmatched;
+        return changed;
+    }
+    ++counters.postsMatched;
+
+    const auto postId = registry->postUris()->intern(event.uri);
+    const auto authorId = actorDids->intern(event.repo);
+    const auto key = sortKey(event.uri, post.createdAtUs);
+    const auto tie = Feed::tieFor(event.uri);
+    const auto slice = IngestEvent::shardFor(event.repo, registry->feed(0)->index().slices());
+
+    mask.forEach([&](const size_t index) {
+        auto& feed = *registry->feed(index);
+        feed.index().insert(key, tie, postId, authorId, slice);
+        if (feed.sort() == FeedSort::Top) {
+            feed.ranking().add(postId, POST_WEIGHT, event.time);
+        }
+    });
+    registry->assign(postId, mask);
+    return true;
+}
+
+double Ingestor::weightOf(const Engagement kind) {
+    return kind == Engagement::Like ? LIKE_WEIGHT : kind == Engagement::Repost ? REPOST_WEIGHT : REPLY_WEIGHT;
+}
+
+bool Ingestor::ingestEngagement(const std::string_view subjectUri, const Engagement kind,
+                                const std::chrono::system_clock::time_point at, const std::string_view recordUri) {
+    // Only hosted posts are interned, so anything else is dropped without allocating
+    const auto postId = registry->postUris()->find(subjectUri);
+    if (!postId) {
+        return false;
+    }
+    const auto mask = registry->membership(*postId);
+    if (!mask.any()) {
+        return false;
+    }
+
+    ++counters.engagements;
+    engagement->add(*postId, kind);
+    if (!recordUri.empty()) {
+        if (counted.size() >= countedPerGeneration) {
+            countedBefore = std::move(counted);
+            counted.clear();
+        }
+        counted[Hash::bytes(recordUri)] = Counted{*postId, kind, at};
+    }
+
+    const auto weight = weightOf(kind);
+    mask.forEach([&](const size_t index) {
+        auto& feed = *registry->feed(index);
+        if (feed.sort() == FeedSort::Top) {
+            feed.ranking().add(*postId, weight, at);
+        }
+    });
+    return true;
+}
+
+bool Ingestor::ingestFollow(const IngestEvent& event) {
+    if (!follows) {
+        return false;
+    }
+    // Only viewers whose lists were fetched are tracked; follows by anyone else are irrelevant. Authors
+    // of indexed posts are interned too, so check the graph before interning the subject.
+    const auto viewer = actorDids->find(event.repo);
+    if (!viewer || !follows->hasViewer(*viewer)) {
+        return false;
+    }
+    const auto subject = actorDids->intern(event.subject);
+    if (!follows->addFollow(*viewer, subject)) {
+        return false;
+    }
+    followRecords[Hash::bytes(event.uri)] = {*viewer, subject};
+    if (followRecords.size() >= followRecordsSweepAt) {
+        sweepFollowRecords();
+    }
+    return true;
+}
+
+// Evicted viewers are fetched whole again before they are tracked, so their records are never needed
+void Ingestor::sweepFollowRecords() {
+    for (auto it = followRecords.begin(); it != followRecords.end();) {
+        it = follows->hasViewer(it->second.viewer) ? std::next(it) : followRecords.erase(it);
+    }
+    followRecordsSweepAt = followRecords.size() + countedPerGeneration;
+}
+
+bool Ingestor::ingestUnfollow(const IngestEvent& event) {
+    const auto found = followRecords.find(Hash::bytes(event.uri));
+    if (!follows || found == followRecords.end()) {
+        return false;
+    }
+    const auto [viewer, subject] = found->second;
+    followRecords.erase(found);
+
+    if (!follows->removeFollow(viewer, subject)) {
+        return false;
+    }
+    ++counters.unfollows;
+    return true;
+}
+
+// Deletes carry no record body, so the URI alone has to identify what was removed
+bool Ingestor::ingestDelete(const IngestEvent& event) {
+    if (event.uri.find(FOLLOW_COLLECTION) != std::string::npos) {
+        return ingestUnfollow(event);
+    }
+    if (event.uri.find(POST_COLLECTION) == std::string::npos) {
+        return ingestRetraction(event);
+    }
+    const auto postId = registry->postUris()->find(event.uri);
+    if (!postId) {
+        return false;
+    }
+    if (!registry->membership(*postId).any()) {
+        return false;
+    }
+
+    // Feeds stop serving the post as soon as it is marked; IndexCompactor purges it from them later
+    registry->tombstones().markPost(*postId);
+    registry->unassign(*postId);
+    ++counters.deletes;
+    return true;
+}
+
+// An unlike or un-repost: subtract the event as of the time it was counted, so the decayed score is
+// exactly what it would be had the record never existed
+bool Ingestor::ingestRetraction(const IngestEvent& event) {
+    const auto key = Hash::bytes(event.uri);
+    auto* generation = &counted;
+    auto found = counted.find(key);
+    if (found == counted.end()) {
+        generation = &countedBefore;
+        found = countedBefore.find(key);
+        if (found == countedBefore.end()) {
+            return false;
+        }
+    }
+    const auto entry = found->second;
+    generation->erase(found);
+
+    const auto mask = registry->membership(entry.postId);
+    if (!mask.any()) {
+        return false;
+    }
+
+    ++counters.retractions;
+    engagement->add(entry.postId, entry.kind, -1);
+    const auto weight = weightOf(entry.kind);
+    mask.forEach([&](const size_t index) {
+        auto& feed = *registry->feed(index);
+        if (feed.sort() == FeedSort::Top) {
+            feed.ranking().add(entry.postId, -weight, entry.at);
+        }
+    });
+    return true;
+}
+
+bool Ingestor::ingestTakedown(const IngestEvent& event) {
+    if (!registry->tombstones().markAuthor(event.repo)) {
+        return false;
+    }
+    ++counters.takedowns;
+    return true;
+}
+
+bool Ingestor::ingestReinstate(const IngestEvent& event) {
+    if (!registry->tombstones().unmarkAuthor(event.repo)) {
+        return false;
+    }
+    ++counters.reinstatements;
+    return true;
+}
@@ -0,0 +1,116 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef INGESTOR_H
+#define INGESTOR_H
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include "dedupe_filter.hpp"
+#include "event.hpp"
+#include "../feed/engagement_counters.hpp"
+#include "../feed/feed_registry.hpp"
+#include "../graph/follow_graph.hpp"
+
+// Routes decoded events into every hosted feed in one pass.
+//
+// Posts are deduplicated, evaluated once against the whole registry, and inserted into each matching
+// feed. Likes, reposts and replies are only counted for posts that some feed holds. One Ingestor per
+// ingest thread: the dedupe filter and stats are not shared, while the registry, feeds, counters and
+// interners are thread-safe and may be shared between Ingestors.
+//
+// Removals only mark the registry's tombstones, so a delete or takedown costs O(1) here; the feeds stop
+// serving the post at once and IndexCompactor purges it later. Deleting a like or repost record undoes
+// its count if the Ingestor still remembers it, which it does for about two dedupe generations. Deleting
+// a follow record that this Ingestor applied to a tracked viewer removes it from the follow graph again.
+class Ingestor {
+public:
+    static constexpr double POST_WEIGHT = 1.0;
+    static constexpr double LIKE_WEIGHT = 1.0;
+    static constexpr double REPOST_WEIGHT = 2.0;
+    static constexpr double REPLY_WEIGHT = 1.5;
+
+    struct Stats {
+        uint64_t events = 0;
+        uint64_t duplicates = 0;
+        uint64_t postsMatched = 0;
+        uint64_t postsUnmatched = 0;
+        uint64_t engagements = 0;    // Counted against a hosted post
+        uint64_t deletes = 0;        // Posts removed from feeds
+        uint64_t retractions = 0;    // Likes and reposts of hosted posts undone
+        uint64_t takedowns = 0;      // Accounts whose posts were removed from feeds
+        uint64_t reinstatements = 0; // Taken-down accounts whose posts are served again
+        uint64_t unfollows = 0;      // Follows of tracked viewers removed from the follow graph
+    };
+
+    Ingestor(std::shared_ptr<FeedRegistry> registry, std::shared_ptr<StringInterner> actorDids,
+             std::shared_ptr<EngagementCounters> engagement, const DedupeFilter::Options& dedupe,
+             std::shared_ptr<FollowGraph> follows = nullptr);
+
+    // Returns true if the event changed any feed, counter or follow list
+    bool ingest(const IngestEvent& event);
+
+    [[nodiscard]] const Stats& stats() const { return counters; }
+
+    // Follow records remembered for unfollows
+    [[nodiscard]] size_t followRecordCount() const { return followRecords.size(); }
+
+    // Index key for a post: the timestamp of its TID record key, else its createdAt
+    static uint64_t sortKey(std::string_view uri, uint64_t createdAtUs);
+
+private:
+    std::shared_ptr<FeedRegistry> registry;
+    std::shared_ptr<StringInterner> actorDids;
+    std::shared_ptr<EngagementCounters> engagement;
+    std::shared_ptr<FollowGraph> follows;
+    DedupeFilter dedupe;
+    Stats counters;
+
+    // A like or repost counted against a hosted post, kept so that deleting the record can undo it
+    struct Counted {
+        uint32_t postId;
+        Engagement kind;
+        std::chrono::system_clock::time_point at;
+    };
+
+    // Keyed by a hash of the record URI. Two generations: the older is dropped when the newer fills.
+    std::unordered_map<uint64_t, Counted> counted;
+    std::unordered_map<uint64_t, Counted> countedBefore;
+    size_t countedPerGeneration;
+
+    // A follow applied to a tracked viewer. Deletes carry only the record URI, so this is what lets an
+    // unfollow find its subject. Follows loaded by FollowsFetcher have no record URI and are only dropped
+    // when the viewer's list is fetched again.
+    struct FollowRecord {
+        uint32_t viewer;
+        uint32_t subject;
+    };
+
+    // Keyed by a hash of the record URI. Records of viewers the graph has since evicted are swept out
+    // whenever the map has grown by a dedupe generation, so it holds only follows of tracked viewers.
+    std::unordered_map<uint64_t, FollowRecord> followRecords;
+    size_t followRecordsSweepAt;
+
+    void sweepFollowRecords();
+
+    bool ingestPost(const IngestEvent& event);
+    bool ingestEngagement(std::string_view subjectUri, Engagement kind, std::chrono::system_clock::time_point at,
+                          std::string_view recordUri = {});
+    bool ingestFollow(const IngestEvent& event);
+    bool ingestDelete(const IngestEvent& event);
+    bool ingestRetraction(const IngestEvent& event);
+    bool ingestUnfollow(const IngestEvent& event);
+    bool ingestTakedown(const IngestEvent& event);
+    bool ingestReinstate(const IngestEvent& event);
+
+    [[nodiscard]] static double weightOf(Engagement kind);
+};
+
+#endif // INGESTOR_H
@@ -0,0 +1,473 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "firehose_generator.hpp"
+#include <chrono>
+#include <cmath>
+#include "../tools/base32.hpp"
+#include "../tools/dag_cbor.hpp"
+#include "../tools/hash.hpp"
+#include "../tools/timestamp.hpp"
+#include "../tools/varint.hpp"
+
+ZipfDistribution::ZipfDistribution(const uint64_t n, const double exponent) : n(std::max<uint64_t>(1, n)),
+                                                                               exponent(exponent) {
+    integralX1 = integral(1.5) - 1.0;
+    integralN = integral(static_cast<double>(this->n) + 0.5);
+    cutoff = 2.0 - integralInverse(integral(2.5) - h(2.0));
+}
+
+double ZipfDistribution::h(const double x) const {
+    return std::exp(-exponent * std::log(x));
+}
+
+// The integral of h, (x^(1 - s) - 1) / (1 - s), written so that it stays exact as s approaches 1
+double ZipfDistribution::integral(const double x) const {
+    const auto logX = std::log(x);
+    const auto t = (1.0 - exponent) * logX;
+    return (std::abs(t) > 1e-8 ? std::expm1(t) / t : 1.0 + t / 2.0) * logX;
+}
+
+double ZipfDistribution::integralInverse(const double x) const {
+    auto t = x * (1.0 - exponent);
+    if (t < -1.0) {
+        t = -1.0; // Rounding at the far tail
+    }
+    return std::exp((std::abs(t) > 1e-8 ? std::log1p(t) / t : 1.0 - t / 2.0) * x);
+}
+
+namespace {
+    constexpr char POST[] = "app.bsky.feed.post";
+    constexpr char LIKE[] = "app.bsky.feed.like";
+    constexpr char REPOST[] = "app.bsky.feed.repost";
+    constexpr char FOLLOW[] = "app.bsky.graph.follow";
+
+    enum Operation { POST_OP, LIKE_OP, REPOST_OP, FOLLOW_OP, DELETE_OP, TAKEDOWN_OP };
+
+    // Roughly the language mix of posts on the network, with enough words of each to vary the text
+    struct Language {
+        const char* code;
+        double weight;
+        const char* separator;
+        std::vector<const char*> words;
+    };
+
+    const std::vector<Language>& languages() {
+        static const std::vector<Language> table = {
+            {"en", 0.52, " ", {"the", "a", "and", "of", "to", "in", "is", "this", "that", "it", "for", "on", "with",
+                               "just", "new", "today", "really", "people", "think", "love", "rust", "cats", "coffee",
+                               "programming", "art", "music", "news", "game", "book", "weather", "bluesky", "feed",
+                               "photo", "garden", "election", "science", "space", "dog", "movie", "#art", "#rust"}},
+            {"ja", 0.18, "", {"今日", "は", "の", "を", "に", "が", "とても", "楽しい", "猫", "写真",
+                              "ゲーム", "絵", "仕事", "ラーメン", "雨", "です", "ました", "かわいい", "音楽",
+                              "映画"}},
+            {"pt", 0.10, " ", {"o", "a", "de", "que", "e", "do", "da", "em", "um", "para", "hoje", "muito", "gente",
+                               "futebol", "música", "bom", "dia", "obrigado", "Brasil", "notícia"}},
+            {"de", 0.05, " ", {"der", "die", "das", "und", "ist", "nicht", "ich", "heute", "sehr", "gut", "Katze",
+                               "Wetter", "Bahn", "Kaffee", "neue", "Woche"}},
+            {"es", 0.05, " ", {"el", "la", "de", "que", "y", "en", "un", "hoy", "muy", "gracias", "gato", "fútbol",
+                               "música", "noticia", "buenos", "días"}},
+            {"fr", 0.04, " ", {"le", "la", "de", "et", "un", "une", "est", "pas", "aujourd'hui", "très", "chat",
+                               "café", "musique", "nouvelle", "merci"}},
+            {"ko", 0.03, " ", {"오늘", "정말", "고양이", "사진", "게임", "음악", "좋아요", "감사합니다",
+                               "날씨", "커피"}},
+            {"zh", 0.03, "", {"今天", "我们", "的", "是", "很", "猫", "照片", "音乐", "新闻", "天气",
+                              "谢谢"}}
+        };
+        return table;
+    }
+
+    // A CIDv1 (dag-cbor, sha2-256) for a block. The digest is a stand-in built from fast hashes; nothing in
+    // ingest verifies it, and it is the right size and unique per block.
+    std::string cidOf(const std::string_view block) {
+        std::string cid("\x01\x71\x12\x20", 4);
+        for (uint64_t i = 0; i < 4; ++i) {
+            const auto part = Hash::bytes(block, i);
+            for (int byte = 0; byte < 8; ++byte) {
+                cid += static_cast<char>(part >> (byte * 8));
+            }
+        }
+        return cid;
+    }
+
+    void appendStrongRef(std::string& out, const std::string& uri, const std::string& cid) {
+        DagCborWriter::appendMap(out, 2);
+        DagCborWriter::appendText(out, "cid");
+        DagCborWriter::appendText(out, Base32::encodeMultibase(cid));
+        DagCborWriter::appendText(out, "uri");
+        DagCborWriter::appendText(out, uri);
+    }
+
+    // A CAR with the given blocks, rooted at the first
+    std::string makeCar(const std::vector<std::pair<std::string, std::string>>& blocks) {
+        std::string header;
+        DagCborWriter::appendMap(header, 2);
+        DagCborWriter::appendText(header, "roots");
+        DagCborWriter::appendArray(header, 1);
+        DagCborWriter::appendCid(header, blocks.front().first);
+        DagCborWriter::appendText(header, "version");
+        DagCborWriter::appendUnsigned(header, 1);
+
+        std::string car;
+        Varint::append(car, header.size());
+        car += header;
+        for (const auto& [cid, block] : blocks) {
+            Varint::append(car, cid.size() + block.size());
+            car += cid;
+            car += block;
+        }
+        return car;
+    }
+}
+
+FirehoseGenerator::FirehoseGenerator(Options options)
+    : options(std::move(options)), random(this->options.seed),
+      activity(this->options.accounts, this->options.activityExponent),
+      popularity(std::max<size_t>(1, this->options.recentPosts), this->options.popularityExponent),
+      operation({this->options.posts, this->options.likes, this->options.reposts, this->options.follows,
+                 this->options.deletes, this->options.takedownsPerMillion / 1e6}) {
+    std::vector<double> weights;
+    for (const auto& entry : languages()) {
+        weights.push_back(entry.weight);
+    }
+    language = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+
+    if (this->options.accounts == 0 || this->options.eventsPerSecond <= 0) {
+        throw FirehoseGeneratorException("Need at least one account and a positive event rate");
+    }
+    // Timestamps run up to the present, so ingest treats the records as fresh
+    const auto span = static_cast<uint64_t>(static_cast<double>(this->options.events) * 1e6 /
+                                            this->options.eventsPerSecond);
+    const auto now = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    clockUs = static_cast<uint64_t>(now) - span;
+    posts.reserve(this->options.recentPosts);
+    deletable.reserve(this->options.recentPosts);
+}
+
+std::string FirehoseGenerator::didOf(const uint64_t account) {
+    static constexpr char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz234567";
+    std::string did = "did:plc:";
+    auto bits = Hash::mix(account + 1);
+    for (int i = 0; i < 24; ++i) {
+        if (i == 12) {
+            bits = Hash::mix(bits ^ account);
+        }
+        did += ALPHABET[bits & 31];
+        bits >>= 5;
+    }
+    return did;
+}
+
+// Record keys are TIDs of the generator's clock, which ticks once per frame
+std::string FirehoseGenerator::tid() {
+    static constexpr char ALPHABET[] = "234567abcdefghijklmnopqrstuvwxyz";
+    const auto value = (clockUs << 10) | (random() & 1023);
+    std::string out(13, '2');
+    for (size_t i = 0; i < 13; ++i) {
+        out[i] = ALPHABET[(value >> (60 - 5 * i)) & 31];
+    }
+    return out;
+}
+
+void FirehoseGenerator::remember(std::vector<Record>& ring, size_t& next, const size_t capacity, Record record) {
+    if (capacity == 0) {
+        return;
+    }
+    if (ring.size() < capacity) {
+        ring.push_back(std::move(record));
+    } else {
+        ring[next++ % capacity] = std::move(record);
+    }
+}
+
+std::string FirehoseGenerator::postRecord(const std::string& createdAt) {
+    const auto& language = languages()[this->language(random)];
+
+    std::string text;
+    for (auto words = 3 + random() % 28; words > 0; --words) {
+        if (!text.empty()) {
+            text += language.separator;
+        }
+        text += language.words[random() % language.words.size()];
+    }
+
+    const auto subject = [&]() -> const Record* {
+        return posts.empty() ? nullptr : &posts[Hash::mix(popularity(random)) % posts.size()];
+    };
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    const auto reply = chance(random) < options.replyShare ? subject() : nullptr;
+    const auto quote = chance(random) < options.quoteShare ? subject() : nullptr;
+    const auto media = chance(random) < options.mediaShare;
+
+    std::string out;
+    DagCborWriter::appendMap(out, 4 + (reply ? 1 : 0) + (quote || media ? 1 : 0));
+    DagCborWriter::appendText(out, "text");
+    DagCborWriter::appendText(out, text);
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, POST);
+    if (quote || media) {
+        DagCborWriter::appendText(out, "embed");
+        DagCborWriter::appendMap(out, 2);
+        DagCborWriter::appendText(out, "$type");
+        if (quote) {
+            DagCborWriter::appendText(out, "app.bsky.embed.record");
+            DagCborWriter::appendText(out, "record");
+            appendStrongRef(out, "at://" + didOf(quote->account) + "/" + quote->path, quote->cid);
+        } else {
+            DagCborWriter::appendText(out, "app.bsky.embed.images");
+            DagCborWriter::appendText(out, "images");
+            DagCborWriter::appendArray(out, 1);
+            DagCborWriter::appendMap(out, 2);
+            DagCborWriter::appendText(out, "alt");
+            DagCborWriter::appendText(out, "");
+            DagCborWriter::appendText(out, "image");
+            DagCborWriter::appendMap(out, 1);
+            DagCborWriter::appendText(out, "ref");
+            DagCborWriter::appendCid(out, cidOf(text));
+        }
+    }
+    DagCborWriter::appendText(out, "langs");
+    DagCborWriter::appendArray(out, 1);
+    DagCborWriter::appendText(out, language.code);
+    if (reply) {
+        const auto uri = "at://" + didOf(reply->account) + "/" + reply->path;
+        DagCborWriter::appendText(out, "reply");
+        DagCborWriter::appendMap(out, 2);
+        DagCborWriter::appendText(out, "root");
+        appendStrongRef(out, uri, reply->cid);
+        DagCborWriter::appendText(out, "parent");
+        appendStrongRef(out, uri, reply->cid);
+    }
+    DagCborWriter::appendText(out, "createdAt");
+    DagCborWriter::appendText(out, createdAt);
+    return out;
+}
+
+std::string FirehoseGenerator::commitFrame(const uint64_t account, const std::string_view action,
+                                           const std::string& path, const std::string& record) {
+    const auto did = didOf(account);
+    const auto rev = tid();
+    const auto recordCid = record.empty() ? std::string() : cidOf(record);
+
+    // The signed commit object, which relays always include; ingest skips over it
+    std::string commit;
+    DagCborWriter::appendMap(commit, 6);
+    DagCborWriter::appendText(commit, "did");
+    DagCborWriter::appendText(commit, did);
+    DagCborWriter::appendText(commit, "rev");
+    DagCborWriter::appendText(commit, rev);
+    DagCborWriter::appendText(commit, "sig");
+    DagCborWriter::appendBytes(commit, std::string(64, static_cast<char>(sequence)));
+    DagCborWriter::appendText(commit, "data");
+    DagCborWriter::appendCid(commit, cidOf(rev));
+    DagCborWriter::appendText(commit, "prev");
+    DagCborWriter::appendNull(commit);
+    DagCborWriter::appendText(commit, "version");
+    DagCborWriter::appendUnsigned(commit, 3);
+    const auto commitCid = cidOf(commit);
+
+    std::vector<std::pair<std::string, std::string>> blocks = {{commitCid, commit}};
+    if (!record.empty()) {
+        blocks.emplace_back(recordCid, record);
+    }
+
+    std::string frame;
+    DagCborWriter::appendMap(frame, 2);
+    DagCborWriter::appendText(frame, "t");
+    DagCborWriter::appendText(frame, "#commit");
+    DagCborWriter::appendText(frame, "op");
+    DagCborWriter::appendInteger(frame, 1);
+
+    DagCborWriter::appendMap(frame, 11);
+    DagCborWriter::appendText(frame, "ops");
+    DagCborWriter::appendArray(frame, 1);
+    DagCborWriter::appendMap(frame, 3);
+    DagCborWriter::appendText(frame, "cid");
+    if (recordCid.empty()) {
+        DagCborWriter::appendNull(frame);
+    } else {
+        DagCborWriter::appendCid(frame, recordCid);
+    }
+    DagCborWriter::appendText(frame, "path");
+    DagCborWriter::appendText(frame, path);
+    DagCborWriter::appendText(frame, "action");
+    DagCborWriter::appendText(frame, action);
+    DagCborWriter::appendText(frame, "rev");
+    DagCborWriter::appendText(frame, rev);
+    DagCborWriter::appendText(frame, "seq");
+    DagCborWriter::appendUnsigned(frame, static_cast<uint64_t>(sequence));
+    DagCborWriter::appendText(frame, "repo");
+    DagCborWriter::appendText(frame, did);
+    DagCborWriter::appendText(frame, "time");
+    DagCborWriter::appendText(frame, Timestamp::formatIso8601(clockUs));
+    DagCborWriter::appendText(frame, "blobs");
+    DagCborWriter::appendArray(frame, 0);
+    DagCborWriter::appendText(frame, "since");
+    DagCborWriter::appendNull(frame);
+    DagCborWriter::appendText(frame, "blocks");
+    DagCborWriter::appendBytes(frame, makeCar(blocks));
+    DagCborWriter::appendText(frame, "commit");
+    DagCborWriter::appendCid(frame, commitCid);
+    DagCborWriter::appendText(frame, "rebase");
+    DagCborWriter::appendBool(frame, false);
+    DagCborWriter::appendText(frame, "tooBig");
+    DagCborWriter::appendBool(frame, false);
+    return frame;
+}
+
+std::string FirehoseGenerator::accountFrame(const uint64_t account) {
+    std::string frame;
+    DagCborWriter::appendMap(frame, 2);
+    DagCborWriter::appendText(frame, "t");
+    DagCborWriter::appendText(frame, "#account");
+    DagCborWriter::appendText(frame, "op");
+    DagCborWriter::appendInteger(frame, 1);
+
+    DagCborWriter::appendMap(frame, 5);
+    DagCborWriter::appendText(frame, "seq");
+    DagCborWriter::appendUnsigned(frame, static_cast<uint64_t>(sequence));
+    DagCborWriter::appendText(frame, "did");
+    DagCborWriter::appendText(frame, didOf(account));
+    DagCborWriter::appendText(frame, "time");
+    DagCborWriter::appendText(frame, Timestamp::formatIso8601(clockUs));
+    DagCborWriter::appendText(frame, "active");
+    DagCborWriter::appendBool(frame, false);
+    DagCborWriter::appendText(frame, "status");
+    DagCborWriter::appendText(frame, "takendown");
+    return frame;
+}
+
+std::string FirehoseGenerator::next() {
+    ++sequence;
+    clockUs += std::max<uint64_t>(1, static_cast<uint64_t>(1e6 / options.eventsPerSecond));
+    const auto account = activity(random) - 1;
+    const auto createdAt = Timestamp::formatIso8601(clockUs);
+
+    auto op = static_cast<Operation>(operation(random));
+    if (op == DELETE_OP && deletable.empty()) {
+        op = POST_OP;
+    }
+    if ((op == LIKE_OP || op == REPOST_OP) && posts.empty()) {
+        op = POST_OP;
+    }
+
+    switch (op) {
+        case POST_OP: {
+            auto record = postRecord(createdAt);
+            auto path = std::string(POST) + "/" + tid();
+            auto frame = commitFrame(account, "create", path, record);
+            const auto cid = cidOf(record);
+            remember(posts, nextPost, options.recentPosts, {account, path, cid});
+            remember(deletable, nextDeletable, options.recentPosts, {account, std::move(path), cid});
+            return frame;
+        }
+        case LIKE_OP:
+        case REPOST_OP: {
+            const auto& subject = posts[Hash::mix(popularity(random)) % posts.size()];
+            const auto collection = op == LIKE_OP ? LIKE : REPOST;
+            std::string record;
+            DagCborWriter::appendMap(record, 3);
+            DagCborWriter::appendText(record, "$type");
+            DagCborWriter::appendText(record, collection);
+            DagCborWriter::appendText(record, "subject");
+            appendStrongRef(record, "at://" + didOf(subject.account) + "/" + subject.path, subject.cid);
+            DagCborWriter::appendText(record, "createdAt");
+            DagCborWriter::appendText(record, createdAt);
+
+            auto path = std::string(collection) + "/" + tid();
+            auto frame = commitFrame(account, "create", path, record);
+            if (op == LIKE_OP) {
+                remember(deletable, nextDeletable, options.recentPosts, {account, std::move(path), {}});
+            }
+            return frame;
+        }
+        case FOLLOW_OP: {
+            // Active accounts are followed more, as on the network
+            std::string record;
+            DagCborWriter::appendMap(record, 3);
+            DagCborWriter::appendText(record, "$type");
+            DagCborWriter::appendText(record, FOLLOW);
+            DagCborWriter::appendText(record, "subject");
+            DagCborWriter::appendText(record, didOf(activity(random) - 1));
+            DagCborWriter::appendText(record, "createdAt");
+            DagCborWriter::appendText(record, createdAt);
+            return commitFrame(account, "create", std::string(FOLLOW) + "/" + tid(), record);
+        }
+        case DELETE_OP: {
+            // Swap the deleted record out of the ring so it is deleted only once
+            const auto at = random() % deletable.size();
+            std::swap(deletable[at], deletable.back());
+            const auto removed = std::move(deletable.back());
+            deletable.pop_back();
+            return commitFrame(removed.account, "delete", removed.path, {});
+        }
+        case TAKEDOWN_OP:
+            return accountFrame(account);
+    }
+    return {};
+}
+
+uint64_t FirehoseGenerator::writeFile(const std::string& path, const Options& options) {
+    ReplayFile::Writer writer(path);
+    FirehoseGenerator generator(options);
+    for (uint64_t i = 0; i < options.events; ++i) {
+        writer.write(generator.next());
+    }
+    return writer.bytes();
+}
+
+ReplayFile::Writer::Writer(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {
+    out.write(MAGIC.data(), static_cast<std::streamsize>(MAGIC.size()));
+    if (!out) {
+        throw FirehoseGeneratorException("Cannot write " + path);
+    }
+    written = MAGIC.size();
+}
+
+void ReplayFile::Writer::write(const std::string_view frame) {
+    std::string length;
+    Varint::append(length, frame.size());
+    out.write(length.data(), static_cast<std::streamsize>(length.size()));
+    out.write(frame.data(), static_cast<std::streamsize>(frame.size()));
+    if (!out) {
+        throw FirehoseGeneratorException("Failed to write a replay frame");
+    }
+    written += length.size() + frame.size();
+}
+
+ReplayFile::Reader::Reader(const std::string& path) : in(path, std::ios::binary) {
+    std::string magic(MAGIC.size(), '\0');
+    in.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    if (!in || magic != MAGIC) {
+        throw FirehoseGeneratorException(path + " is not a firehose replay file");
+    }
+}
+
+bool ReplayFile::Reader::read(std::string& frame) {
+    uint64_t length = 0;
+    for (int shift = 0;; shift += 7) {
+        const auto byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            if (shift == 0) {
+                return false;
+            }
+            throw FirehoseGeneratorException("Truncated replay file");
+        }
+        if (shift > 63) {
+            throw FirehoseGeneratorException("Malformed replay frame length");
+        }
+        length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    frame.resize(length);
+    in.read(frame.data(), static_cast<std::streamsize>(length));
+    if (static_cast<uint64_t>(in.gcount()) != length) {
+        throw FirehoseGeneratorException("Truncated replay file");
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FIREHOSE_GENERATOR_H
+#define FIREHOSE_GENERATOR_H
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class FirehoseGeneratorException final : public std::exception {
+    std::string message;
+
+public:
+    explicit FirehoseGeneratorException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Zipf-distributed ranks in [1, n] by rejection-inversion (Hörmann and Derflinger), in constant memory
+// however many ranks there are
+class ZipfDistribution {
+public:
+    ZipfDistribution(uint64_t n, double exponent);
+
+    template <typename Random>
+    uint64_t operator()(Random& random) {
+        while (true) {
+            const auto u = integralN + uniform(random) * (integralX1 - integralN);
+            const auto x = integralInverse(u);
+            const auto k = std::clamp<uint64_t>(static_cast<uint64_t>(x + 0.5), 1, n);
+            const auto rank = static_cast<double>(k);
+            if (rank - x <= cutoff || u >= integral(rank + 0.5) - h(rank)) {
+                return k;
+            }
+        }
+    }
+
+private:
+    uint64_t n;
+    double exponent;
+    double integralX1;
+    double integralN;
+    double cutoff;
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+
+    [[nodiscard]] double h(double x) const;
+    [[nodiscard]] double integral(double x) const;
+    [[nodiscard]] double integralInverse(double x) const;
+};
+
+// Synthetic com.atproto.sync.subscribeRepos frames with the shape of the real network, for offline ingest
+// benchmarks.
+//
+// Account activity is Zipfian, so a few accounts write most records, as on the network. Likes and reposts
+// pick their subject from recent posts, again by a Zipfian popularity rank, so a few posts draw a large
+// fan-out of engagement. Posts carry text in a weighted mix of languages, and some are replies, quotes or
+// have images; deletes remove the author's own recent posts and likes; rare #account frames take accounts
+// down. Every frame is a one-op #commit with a CAR holding its record, as relays send them. The same options
+// give the same records; only their timestamps differ, since they lead up to when the generator was made.
+class FirehoseGenerator {
+public:
+    struct Options {
+        uint64_t accounts = 1'000'000;
+        double activityExponent = 1.0;  // Zipf exponent of how often each account writes
+        double popularityExponent = 1.2; // Zipf exponent of which recent post a like or repost is for
+        size_t recentPosts = 100'000;    // Posts that likes, reposts, replies and quotes can refer to
+
+        // Relative weights of each record operation
+        double posts = 0.20;
+        double likes = 0.60;
+        double reposts = 0.08;
+        double follows = 0.09;
+        double deletes = 0.03;
+        double takedownsPerMillion = 20.0; // #account frames per million commits
+
+        double replyShare = 0.35; // Of posts
+        double quoteShare = 0.05;
+        double mediaShare = 0.20;
+
+        double eventsPerSecond = 2000; // Spacing of the records' timestamps, which end at the present
+        uint64_t events = 1'000'000;   // Frames in all, for the timestamps
+        uint64_t seed = 1;
+    };
+
+    explicit FirehoseGenerator(Options options);
+
+    // The next frame, with a sequence number one past the last
+    std::string next();
+
+    [[nodiscard]] int64_t seq() const { return sequence; }
+
+    // The DID of account index, as it appears in generated frames
+    [[nodiscard]] static std::string didOf(uint64_t account);
+
+    // Write options.events frames to path in the replay format; returns the bytes written
+    static uint64_t writeFile(const std::string& path, const Options& options);
+
+private:
+    struct Record {
+        uint64_t account;
+        std::string path; // "<collection>/<rkey>"
+        std::string cid;  // Binary
+    };
+
+    Options options;
+    std::mt19937_64 random;
+    ZipfDistribution activity;
+    ZipfDistribution popularity;
+    std::discrete_distribution<int> operation;
+    std::discrete_distribution<size_t> language;
+    int64_t sequence = 0;
+    uint64_t clockUs;
+
+    // Rings of recent posts (for subjects) and of recent posts and likes (for deletes)
+    std::vector<Record> posts;
+    std::vector<Record> deletable;
+    size_t nextPost = 0;
+    size_t nextDeletable = 0;
+
+    std::string tid();
+    std::string postRecord(const std::string& createdAt);
+    std::string commitFrame(uint64_t account, std::string_view action, const std::string& path,
+                            const std::string& record);
+    std::string accountFrame(uint64_t account);
+    void remember(std::vector<Record>& ring, size_t& next, size_t capacity, Record record);
+};
+
+// Replay files: "BSKYFH01" followed by each frame as an unsigned LEB128 length and its bytes
+class ReplayFile {
+public:
+    static constexpr std::string_view MAGIC = "BSKYFH01";
+
+    class Writer {
+    public:
+        explicit Writer(const std::string& path);
+        void write(std::string_view frame);
+        [[nodiscard]] uint64_t bytes() const { return written; }
+
+    private:
+        std::ofstream out;
+        uint64_t written = 0;
+    };
+
+    class Reader {
+    public:
+        // Throws FirehoseGeneratorException if path is not a replay file
+        explicit Reader(const std::string& path);
+
+        // The next frame into frame, reusing its capacity; false at the end. Throws if the file is truncated.
+        bool read(std::string& frame);
+
+    private:
+        std::ifstream in;
+    };
+};
+
+#endif // FIREHOSE_GENERATOR_H
@@ -0,0 +1,99 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "firehose_generator.hpp"
+#include "replay_benchmark.hpp"
+
+static void printUsage() {
+    std::cerr << "Usage: firehose_bench generate <file> [options]\n"
+                 "  --events <n>           Frames to write (1000000)\n"
+                 "  --accounts <n>         Distinct accounts (1000000)\n"
+                 "  --activity <s>         Zipf exponent of account activity (1.0)\n"
+                 "  --popularity <s>       Zipf exponent of which recent post gets a like or repost (1.2)\n"
+                 "  --rate <events/s>      Spacing of record timestamps, which end now (2000)\n"
+                 "  --seed <n>             Random seed (1)\n"
+                 "\n"
+                 "       firehose_bench replay <file> [options]\n"
+                 "  --shards <n>           Ingest shards (one per two hardware threads)\n"
+                 "  --batch <n>            Items a stage takes from its queue at once (256)\n"
+                 "  --frames <n>           Stop after this many frames (the whole file)\n"
+                 "  --feeds <settings.json> Host the \"feeds\" of this settings file instead of the defaults\n";
+}
+
+static std::vector<FeedDefinition> feedsFrom(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw FirehoseGeneratorException("Cannot read " + path);
+    }
+    const auto settings = nlohmann::json::parse(in);
+    std::vector<FeedDefinition> feeds;
+    for (const auto& definition : settings.value("feeds", nlohmann::json::array())) {
+        feeds.push_back(FeedDefinition::fromJson(definition));
+    }
+    return feeds;
+}
+
+int main(const int argc, char** argv) {
+    if (argc < 3 || (std::string(argv[1]) != "generate" && std::string(argv[1]) != "replay")) {
+        printUsage();
+        return argc > 1 && std::string(argv[1]) == "--help" ? 0 : 1;
+    }
+    const std::string mode = argv[1];
+    const std::string path = argv[2];
+
+    try {
+        FirehoseGenerator::Options generate;
+        ReplayBenchmark::Options replay;
+        replay.path = path;
+        for (int i = 3; i < argc; ++i) {
+            const std::string flag = argv[i];
+            if (i + 1 >= argc) {
+                throw FirehoseGeneratorException("Missing value for " + flag);
+            }
+            const std::string value = argv[++i];
+            if (mode == "generate" && flag == "--events") {
+                generate.events = std::stoull(value);
+            } else if (mode == "generate" && flag == "--accounts") {
+                generate.accounts = std::stoull(value);
+            } else if (mode == "generate" && flag == "--activity") {
+                generate.activityExponent = std::stod(value);
+            } else if (mode == "generate" && flag == "--popularity") {
+                generate.popularityExponent = std::stod(value);
+            } else if (mode == "generate" && flag == "--rate") {
+                generate.eventsPerSecond = std::stod(value);
+            } else if (mode == "generate" && flag == "--seed") {
+                generate.seed = std::stoull(value);
+            } else if (mode == "replay" && flag == "--shards") {
+                replay.pipeline.shards = std::stoul(value);
+            } else if (mode == "replay" && flag == "--batch") {
+                replay.pipeline.batchSize = std::stoul(value);
+            } else if (mode == "replay" && flag == "--frames") {
+                replay.maxFrames = std::stoull(value);
+            } else if (mode == "replay" && flag == "--feeds") {
+                replay.feeds = feedsFrom(value);
+            } else {
+                throw FirehoseGeneratorException("Unknown option " + flag + " for " + mode);
+            }
+        }
+
+        if (mode == "generate") {
+            const auto started = std::chrono::steady_clock::now();
+            const auto bytes = FirehoseGenerator::writeFile(path, generate);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+            std::cout << "Wrote " << generate.events << " frames (" << bytes / 1'000'000 << " MB) to " << path
+                      << " in " << elapsed.count() << "s" << std::endl;
+        } else {
+            std::cout << ReplayBenchmark::format(ReplayBenchmark(replay).run());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage();
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,273 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "load_generator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include "../auth/service_auth.hpp"
+#include "../cpp-httplib/httplib.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // The most recent cursors seen for each feed and page depth, shared by every connection
+    class CursorPool {
+    public:
+        CursorPool(const size_t feeds, const size_t depths) : pools(feeds, std::vector<Pool>(depths)) {}
+
+        void add(const size_t feed, const size_t depth, std::string cursor) {
+            std::lock_guard lock(mutex);
+            auto& pool = pools[feed][depth];
+            if (pool.cursors.size() < PER_DEPTH) {
+                pool.cursors.push_back(std::move(cursor));
+            } else {
+                pool.cursors[pool.next++ % PER_DEPTH] = std::move(cursor);
+            }
+        }
+
+        // A cursor for the deepest page up to depth that has one; depth becomes the one picked
+        std::optional<std::string> pick(const size_t feed, size_t& depth, const uint64_t random) {
+            std::lock_guard lock(mutex);
+            for (; depth > 0; --depth) {
+                const auto& cursors = pools[feed][depth].cursors;
+                if (!cursors.empty()) {
+                    return cursors[random % cursors.size()];
+                }
+            }
+            return std::nullopt;
+        }
+
+    private:
+        static constexpr size_t PER_DEPTH = 256;
+
+        struct Pool {
+            std::vector<std::string> cursors;
+            size_t next = 0;
+        };
+
+        std::mutex mutex;
+        std::vector<std::vector<Pool>> pools;
+    };
+
+    struct Shared {
+        const LoadGenerator::Options& options;
+        const std::vector<std::string>& tokens;
+        CursorPool cursors;
+        Clock::time_point start;
+        Clock::time_point end;
+
+        Histogram responseTime;
+        Histogram serviceTime;
+        std::atomic<uint64_t> sent{0};
+        std::atomic<uint64_t> succeeded{0};
+        std::atomic<uint64_t> noResponse{0};
+        std::atomic<uint64_t> authenticated{0};
+        std::atomic<uint64_t> lateStarts{0};
+        std::vector<std::atomic<uint64_t>> sentByDepth;
+
+        std::mutex errorsMutex;
+        std::map<int, uint64_t> errors;
+
+        Shared(const LoadGenerator::Options& options, const std::vector<std::string>& tokens)
+            : options(options), tokens(tokens), cursors(options.feeds.size(), options.depthWeights.size()),
+              sentByDepth(options.depthWeights.size()) {}
+    };
+
+    // The cursor a getFeedSkeleton body hands out, from {"cursor":"...","feed":[...]}
+    std::optional<std::string> nextCursor(const std::string& body) {
+        static constexpr std::string_view KEY = "\"cursor\":\"";
+        const auto at = body.find(KEY);
+        if (at == std::string::npos) {
+            return std::nullopt;
+        }
+        const auto begin = at + KEY.size();
+        const auto end = body.find('"', begin);
+        return end == std::string::npos ? std::nullopt : std::optional(body.substr(begin, end - begin));
+    }
+
+    void runConnection(Shared& shared, const size_t index) {
+        const auto& options = shared.options;
+        std::mt19937_64 random(options.seed * 1'000'003 + index);
+        std::exponential_distribution<double> gap(options.requestsPerSecond / static_cast<double>(options.connections));
+        std::discrete_distribution<size_t> depthOf(options.depthWeights.begin(), options.depthWeights.end());
+        std::bernoulli_distribution signedIn(options.authenticatedFraction);
+
+        httplib::Client client(options.host, options.port);
+        client.set_keep_alive(true);
+        client.set_tcp_nodelay(true);
+
+        auto scheduled = shared.start;
+        std::string path;
+        while (true) {
+            scheduled += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(gap(random)));
+            if (scheduled >= shared.end) {
+                break;
+            }
+            std::this_thread::sleep_until(scheduled);
+
+            const auto feed = static_cast<size_t>(random() % options.feeds.size());
+            auto depth = depthOf(random);
+            const auto cursor = shared.cursors.pick(feed, depth, random());
+            path = "/xrpc/app.bsky.feed.getFeedSkeleton?feed=" +
+                   httplib::detail::encode_query_param(options.feeds[feed]) + "&limit=" + std::to_string(options.limit);
+            if (cursor) {
+                path += "&cursor=" + httplib::detail::encode_query_param(*cursor);
+            }
+            httplib::Headers headers;
+            if (!shared.tokens.empty() && signedIn(random)) {
+                headers.emplace("Authorization", "Bearer " + shared.tokens[random() % shared.tokens.size()]);
+                shared.authenticated.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            const auto sentAt = Clock::now();
+            if (sentAt - scheduled > std::chrono::milliseconds(1)) {
+                shared.lateStarts.fetch_add(1, std::memory_order_relaxed);
+            }
+            shared.sent.fetch_add(1, std::memory_order_relaxed);
+            shared.sentByDepth[depth].fetch_add(1, std::memory_order_relaxed);
+            const auto result = client.Get(path, headers);
+            shared.responseTime.recordSince(scheduled);
+            shared.serviceTime.recordSince(sentAt);
+
+            if (!result) {
+                shared.noResponse.fetch_add(1, std::memory_order_relaxed);
+                client.stop(); // Reconnect for the next request
+                continue;
+            }
+            if (result->status != 200) {
+                std::lock_guard lock(shared.errorsMutex);
+                ++shared.errors[result->status];
+                continue;
+            }
+            shared.succeeded.fetch_add(1, std::memory_order_relaxed);
+            if (depth + 1 < options.depthWeights.size()) {
+                if (auto next = nextCursor(result->body)) {
+                    shared.cursors.add(feed, depth + 1, std::move(*next));
+                }
+            }
+        }
+    }
+}
+
+LoadGenerator::LoadGenerator(Options options) : options(std::move(options)) {
+    if (this->options.feeds.empty()) {
+        throw LoadGeneratorException("No feeds to request");
+    }
+    if (this->options.requestsPerSecond <= 0 || this->options.connections == 0) {
+        throw LoadGeneratorException("The request rate and connection count must be positive");
+    }
+    if (this->options.depthWeights.empty() ||
+        std::none_of(this->options.depthWeights.begin(), this->options.depthWeights.end(),
+                     [](const double weight) { return weight > 0; })) {
+        throw LoadGeneratorException("At least one page depth needs a positive weight");
+    }
+    if (this->options.authenticatedFraction > 0 && (this->options.serviceDid.empty() || this->options.viewers == 0)) {
+        throw LoadGeneratorException("Authenticated requests need the server's service DID and some viewers");
+    }
+}
+
+LoadGenerator::Report LoadGenerator::run() {
+    // Viewers sign in once for the whole run, like AppView sessions, so the server's token memo is exercised
+    std::vector<std::string> tokens;
+    if (options.authenticatedFraction > 0) {
+        const auto lifetime = std::chrono::duration_cast<std::chrono::seconds>(options.duration) +
+                              std::chrono::minutes(5);
+        tokens.reserve(options.viewers);
+        for (size_t i = 0; i < options.viewers; ++i) {
+            const auto key = SigningKey::generate(SigningKey::Curve::Secp256k1);
+            tokens.push_back(ServiceAuth::createToken(key, key.didKey(), options.serviceDid,
+                                                      "app.bsky.feed.getFeedSkeleton", lifetime));
+        }
+    }
+
+    Shared shared(options, tokens);
+    shared.start = Clock::now() + std::chrono::milliseconds(20); // Let every connection start first
+    shared.end = shared.start + options.duration;
+
+    std::vector<std::thread> connections;
+    connections.reserve(options.connections);
+    for (size_t i = 0; i < options.connections; ++i) {
+        connections.emplace_back(runConnection, std::ref(shared), i);
+    }
+    for (auto& connection : connections) {
+        connection.join();
+    }
+
+    Report report;
+    report.elapsed = Clock::now() - shared.start;
+    report.sent = shared.sent;
+    report.succeeded = shared.succeeded;
+    report.noResponse = shared.noResponse;
+    report.authenticated = shared.authenticated;
+    report.lateStarts = shared.lateStarts;
+    report.errors = shared.errors;
+    for (const auto& count : shared.sentByDepth) {
+        report.sentByDepth.push_back(count.load());
+    }
+    report.responseTime = shared.responseTime.snapshot();
+    report.serviceTime = shared.serviceTime.snapshot();
+    return report;
+}
+
+std::string LoadGenerator::format(const Options& options, const Report& report) {
+    static constexpr std::pair<double, const char*> PERCENTILES[] = {
+        {0.5, "p50"}, {0.9, "p90"}, {0.99, "p99"}, {0.999, "p99.9"}, {1.0, "max"}
+    };
+
+    std::string out;
+    char line[256];
+    const auto seconds = report.elapsed.count();
+    std::snprintf(line, sizeof(line), "target %.1f req/s for %.1fs over %zu connections\n",
+                  options.requestsPerSecond, static_cast<double>(options.duration.count()) / 1e3, options.connections);
+    out += line;
+
+    uint64_t errors = 0;
+    std::string byStatus;
+    for (const auto& [status, count] : report.errors) {
+        errors += count;
+        byStatus += (byStatus.empty() ? " (" : ", ") + std::to_string(status) + ": " + std::to_string(count);
+    }
+    if (!byStatus.empty()) {
+        byStatus += ")";
+    }
+    std::snprintf(line, sizeof(line), "sent %llu (%.1f req/s), %llu ok, %llu errors%s, %llu without response, "
+                  "%llu late starts\n", static_cast<unsigned long long>(report.sent),
+                  seconds > 0 ? static_cast<double>(report.sent) / seconds : 0.0,
+                  static_cast<unsigned long long>(report.succeeded), static_cast<unsigned long long>(errors),
+                  byStatus.c_str(), static_cast<unsigned long long>(report.noResponse),
+                  static_cast<unsigned long long>(report.lateStarts));
+    out += line;
+
+    out += "pages:";
+    for (size_t depth = 0; depth < report.sentByDepth.size(); ++depth) {
+        out += (depth == 0 ? " " : ", ") + std::to_string(depth + 1) + ": " + std::to_string(report.sentByDepth[depth]);
+    }
+    out += "; " + std::to_string(report.authenticated) + " authenticated across " +
+           std::to_string(options.authenticatedFraction > 0 ? options.viewers : 0) + " viewers\n";
+
+    std::snprintf(line, sizeof(line), "%-10s", "");
+    out += line;
+    for (const auto& [q, name] : PERCENTILES) {
+        std::snprintf(line, sizeof(line), "%11s", name);
+        out += line;
+    }
+    out += "\n";
+    for (const auto& [name, snapshot] : {std::pair{"response", &report.responseTime},
+                                         std::pair{"service", &report.serviceTime}}) {
+        std::snprintf(line, sizeof(line), "%-10s", name);
+        out += line;
+        for (const auto& [q, label] : PERCENTILES) {
+            std::snprintf(line, sizeof(line), "%9.3fms", static_cast<double>(snapshot->quantile(q)) / 1e6);
+            out += line;
+        }
+        out += "\n";
+    }
+    return out;
+}
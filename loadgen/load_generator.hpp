@@ -0,0 +1,83 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "../tools/metrics.hpp"
+
+class LoadGeneratorException final : public std::exception {
+    std::string message;
+
+public:
+    explicit LoadGeneratorException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Open-loop load against a feed server's getFeedSkeleton.
+//
+// Each connection follows its own Poisson arrival schedule at requestsPerSecond / connections, so the
+// offered load does not drop when the server slows down. A request that could not be sent on time
+// because its connection was still busy is sent as soon as it frees up, and its latency is measured from
+// when it was scheduled, not sent, so queueing behind a slow response is counted rather than hidden
+// (coordinated omission). Service time, from the actual send, is reported alongside for comparison.
+//
+// Requests pick a feed at random, a page depth from depthWeights (later pages reuse cursors returned by
+// earlier responses) and, with probability authenticatedFraction, one of `viewers` did:key viewers whose
+// service-auth token the server can verify without resolving anything.
+class LoadGenerator {
+public:
+    struct Options {
+        std::string host = "127.0.0.1";
+        int port = 3000;
+        std::vector<std::string> feeds;      // at://<publisher>/app.bsky.feed.generator/<name>
+        std::string serviceDid;              // Audience of the viewers' tokens
+        double requestsPerSecond = 100.0;
+        std::chrono::milliseconds duration{10'000};
+        size_t connections = 16;
+        size_t limit = 30;
+        std::vector<double> depthWeights{0.70, 0.20, 0.07, 0.03}; // Weight of page 1, 2, 3, ...
+        double authenticatedFraction = 0.5;
+        size_t viewers = 1000;
+        uint64_t seed = 1;
+    };
+
+    struct Report {
+        std::chrono::duration<double> elapsed{0};
+        uint64_t sent = 0;
+        uint64_t succeeded = 0;
+        uint64_t noResponse = 0;
+        uint64_t authenticated = 0;
+        uint64_t lateStarts = 0;               // Sent over a millisecond after they were scheduled
+        std::map<int, uint64_t> errors;        // Non-200 responses by status
+        std::vector<uint64_t> sentByDepth;     // Index 0 is the first page
+        Histogram::Snapshot responseTime;      // From the scheduled start, nanoseconds
+        Histogram::Snapshot serviceTime;       // From the actual send, nanoseconds
+    };
+
+    // Throws LoadGeneratorException if the options cannot produce any load
+    explicit LoadGenerator(Options options);
+
+    // Drive the server for the configured duration and wait for the last response
+    Report run();
+
+    // A plain-text summary: throughput, errors, and both latency distributions by percentile
+    static std::string format(const Options& options, const Report& report);
+
+private:
+    Options options;
+};
+
+#endif // LOAD_GENERATOR_H
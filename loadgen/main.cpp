@@ -0,0 +1,86 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "load_generator.hpp"
+
+static void printUsage() {
+    std::cerr << "Usage: feed_loadgen --feed <at-uri> [--feed <at-uri>...] [options]\n"
+                 "  --host <host>          Feed server host (127.0.0.1)\n"
+                 "  --port <port>          Feed server port (3000)\n"
+                 "  --rate <req/s>         Open-loop arrival rate (100)\n"
+                 "  --duration <seconds>   How long to offer load (10)\n"
+                 "  --connections <n>      Keep-alive connections, one schedule each (16)\n"
+                 "  --limit <n>            Posts per page (30)\n"
+                 "  --depths <w1,w2,...>   Relative weights of page 1, 2, ... (0.7,0.2,0.07,0.03)\n"
+                 "  --auth <fraction>      Share of requests signed in as a viewer (0.5)\n"
+                 "  --viewers <n>          Distinct did:key viewers (1000)\n"
+                 "  --service-did <did>    The server's service_did, the audience of viewer tokens\n"
+                 "  --seed <n>             Random seed, for repeatable request mixes (1)\n";
+}
+
+static std::vector<double> parseWeights(const std::string& text) {
+    std::vector<double> weights;
+    std::istringstream stream(text);
+    std::string weight;
+    while (std::getline(stream, weight, ',')) {
+        weights.push_back(std::stod(weight));
+    }
+    return weights;
+}
+
+int main(const int argc, char** argv) {
+    LoadGenerator::Options options;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            const std::string flag = argv[i];
+            if (flag == "--help") {
+                printUsage();
+                return 0;
+            }
+            if (i + 1 >= argc) {
+                throw LoadGeneratorException("Missing value for " + flag);
+            }
+            const std::string value = argv[++i];
+            if (flag == "--host") {
+                options.host = value;
+            } else if (flag == "--port") {
+                options.port = std::stoi(value);
+            } else if (flag == "--feed") {
+                options.feeds.push_back(value);
+            } else if (flag == "--rate") {
+                options.requestsPerSecond = std::stod(value);
+            } else if (flag == "--duration") {
+                options.duration = std::chrono::milliseconds(static_cast<int64_t>(std::stod(value) * 1000));
+            } else if (flag == "--connections") {
+                options.connections = std::stoul(value);
+            } else if (flag == "--limit") {
+                options.limit = std::stoul(value);
+            } else if (flag == "--depths") {
+                options.depthWeights = parseWeights(value);
+            } else if (flag == "--auth") {
+                options.authenticatedFraction = std::stod(value);
+            } else if (flag == "--viewers") {
+                options.viewers = std::stoul(value);
+            } else if (flag == "--service-did") {
+                options.serviceDid = value;
+            } else if (flag == "--seed") {
+                options.seed = std::stoull(value);
+            } else {
+                throw LoadGeneratorException("Unknown option " + flag);
+            }
+        }
+
+        LoadGenerator generator(options);
+        std::cout << LoadGenerator::format(options, generator.run());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        printUsage();
+        return 1;
+    }
+    return 0;
+}
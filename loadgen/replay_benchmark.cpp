@@ -0,0 +1,186 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "replay_benchmark.hpp"
+#include <cstdio>
+#include "firehose_generator.hpp"
+#include "../feed/index_compactor.hpp"
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+ReplayBenchmark::ReplayBenchmark(Options options) : options(std::move(options)) {
+    if (this->options.feeds.empty()) {
+        this->options.feeds = defaultFeeds();
+    }
+}
+
+std::vector<FeedDefinition> ReplayBenchmark::defaultFeeds() {
+    std::vector<FeedDefinition> feeds(6);
+    feeds[0].name = "everything";
+    feeds[0].sort = FeedSort::Chronological;
+    feeds[1].name = "english";
+    feeds[1].langs = {"en"};
+    feeds[2].name = "japanese";
+    feeds[2].langs = {"ja"};
+    feeds[3].name = "rust";
+    feeds[3].keywords = {"rust", "#rust", "programming"};
+    feeds[4].name = "cats";
+    feeds[4].sort = FeedSort::Chronological;
+    feeds[4].rule = "cats or gato or chat or katze or contains:猫 or contains:고양이";
+    feeds[5].name = "art";
+    feeds[5].rule = "has:media and not is:reply and (art or \"#art\" or contains:絵)";
+    return feeds;
+}
+
+uint64_t ReplayBenchmark::peakRssBytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss); // Bytes on macOS
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024; // Kilobytes elsewhere
+#endif
+#endif
+}
+
+ReplayBenchmark::Report ReplayBenchmark::run() {
+    Report report;
+    report.startRssBytes = peakRssBytes();
+
+    // Built the way the firehose command builds its ingest, so the replay measures the same work
+    auto pipelineOptions = options.pipeline;
+    pipelineOptions.shards = IngestPipeline::shardCountFor(pipelineOptions);
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>(), pipelineOptions.shards);
+    for (const auto& feed : options.feeds) {
+        registry->addFeed(feed);
+    }
+    registry->build();
+    const auto actorDids = std::make_shared<StringInterner>();
+    const auto engagement = std::make_shared<EngagementCounters>();
+    const auto follows = std::make_shared<FollowGraph>();
+    engagement->startMerging(std::chrono::seconds(1));
+
+    auto dedupe = options.dedupe;
+    dedupe.itemsPerGeneration = std::max<size_t>(1, dedupe.itemsPerGeneration / pipelineOptions.shards);
+    std::vector<std::unique_ptr<Ingestor>> ingestors;
+    for (size_t i = 0; i < pipelineOptions.shards; ++i) {
+        ingestors.push_back(std::make_unique<Ingestor>(registry, actorDids, engagement, dedupe, follows));
+    }
+    IngestPipeline pipeline(pipelineOptions, [&ingestors](const size_t shard, const IngestEvent& event) {
+        ingestors[shard]->ingest(event);
+    });
+
+    ReplayFile::Reader reader(options.path);
+    Stage read{"read"}, route{"route"};
+    std::string frame;
+    pipeline.start();
+    const auto started = std::chrono::steady_clock::now();
+    while (options.maxFrames == 0 || report.frames < options.maxFrames) {
+        const auto reading = std::chrono::steady_clock::now();
+        if (!reader.read(frame)) {
+            break;
+        }
+        const auto routing = std::chrono::steady_clock::now();
+        read.busyNs += static_cast<uint64_t>(std::chrono::nanoseconds(routing - reading).count());
+        report.bytes += frame.size();
+        pipeline.pushFrame(std::move(frame));
+        const auto routed = std::chrono::steady_clock::now();
+        route.busyNs += static_cast<uint64_t>(std::chrono::nanoseconds(routed - routing).count());
+        ++report.frames;
+        frame = std::string();
+    }
+    pipeline.stop(); // Drains every stage
+    report.elapsed = std::chrono::steady_clock::now() - started;
+    engagement->stopMerging();
+
+    read.items = route.items = report.frames;
+    Stage decode{"decode", 0, 0, pipelineOptions.shards}, index{"index", 0, 0, pipelineOptions.shards};
+    for (const auto& stage : pipeline.stats()) {
+        auto& total = stage.name.rfind("decode/", 0) == 0 ? decode : index;
+        total.items += stage.processed;
+        total.busyNs += stage.busyNs;
+    }
+
+    // Deletes and takedowns only marked their posts; purging them is the rest of their cost
+    Stage compact{"compact"};
+    const auto compacting = std::chrono::steady_clock::now();
+    report.entriesPurged = IndexCompactor(registry).compact();
+    compact.busyNs = static_cast<uint64_t>(
+        std::chrono::nanoseconds(std::chrono::steady_clock::now() - compacting).count());
+    compact.items = report.entriesPurged;
+    report.stages = {read, route, decode, index, compact};
+
+    for (const auto& ingestor : ingestors) {
+        const auto& stats = ingestor->stats();
+        report.ingest.events += stats.events;
+        report.ingest.duplicates += stats.duplicates;
+        report.ingest.postsMatched += stats.postsMatched;
+        report.ingest.postsUnmatched += stats.postsUnmatched;
+        report.ingest.engagements += stats.engagements;
+        report.ingest.deletes += stats.deletes;
+        report.ingest.retractions += stats.retractions;
+        report.ingest.takedowns += stats.takedowns;
+        report.ingest.unfollows += stats.unfollows;
+    }
+    report.malformed = pipeline.malformedFrames();
+    report.shards = pipelineOptions.shards;
+    report.feeds = registry->size();
+    report.peakRssBytes = peakRssBytes();
+    return report;
+}
+
+std::string ReplayBenchmark::format(const Report& report) {
+    std::string out;
+    char line[256];
+    const auto seconds = report.elapsed.count();
+    const auto perSecond = [seconds](const uint64_t count) {
+        return seconds > 0 ? static_cast<double>(count) / seconds : 0.0;
+    };
+
+    std::snprintf(line, sizeof(line), "replayed %llu frames (%.1f MB) in %.2fs over %zu shards into %zu feeds\n",
+                  static_cast<unsigned long long>(report.frames), static_cast<double>(report.bytes) / 1e6, seconds,
+                  report.shards, report.feeds);
+    out += line;
+    std::snprintf(line, sizeof(line), "sustained %.0f frames/s, %.0f events/s, %.1f MB/s; %llu malformed\n",
+                  perSecond(report.frames), perSecond(report.ingest.events),
+                  perSecond(report.bytes) / 1e6, static_cast<unsigned long long>(report.malformed));
+    out += line;
+
+    std::snprintf(line, sizeof(line), "%-8s %12s %12s %12s %12s\n", "stage", "items", "busy", "per item",
+                  "utilization");
+    out += line;
+    for (const auto& stage : report.stages) {
+        const auto busyMs = static_cast<double>(stage.busyNs) / 1e6;
+        const auto perItemUs = stage.items > 0 ? static_cast<double>(stage.busyNs) / 1e3 /
+                                                 static_cast<double>(stage.items) : 0.0;
+        // Share of the replay's wall time that the stage's threads spent working
+        const auto utilization = seconds > 0 ? busyMs / 1e3 / (seconds * static_cast<double>(stage.threads)) : 0.0;
+        std::snprintf(line, sizeof(line), "%-8s %12llu %10.1fms %10.3fus %11.1f%%\n", stage.name.c_str(),
+                      static_cast<unsigned long long>(stage.items), busyMs, perItemUs, utilization * 100);
+        out += line;
+    }
+
+    const auto& ingest = report.ingest;
+    std::snprintf(line, sizeof(line), "ingest: %llu posts matched, %llu unmatched, %llu duplicates, %llu engagements, "
+                  "%llu deletes, %llu retractions, %llu takedowns; %llu entries purged\n",
+                  static_cast<unsigned long long>(ingest.postsMatched),
+                  static_cast<unsigned long long>(ingest.postsUnmatched),
+                  static_cast<unsigned long long>(ingest.duplicates),
+                  static_cast<unsigned long long>(ingest.engagements),
+                  static_cast<unsigned long long>(ingest.deletes), static_cast<unsigned long long>(ingest.retractions),
+                  static_cast<unsigned long long>(ingest.takedowns),
+                  static_cast<unsigned long long>(report.entriesPurged));
+    out += line;
+    std::snprintf(line, sizeof(line), "memory: peak RSS %.1f MB (%.1f MB before the replay)\n",
+                  static_cast<double>(report.peakRssBytes) / 1e6, static_cast<double>(report.startRssBytes) / 1e6);
+    out += line;
+    return out;
+}
@@ -0,0 +1,76 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef REPLAY_BENCHMARK_H
+#define REPLAY_BENCHMARK_H
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../feed/feed_registry.hpp"
+#include "../ingest/dedupe_filter.hpp"
+#include "../ingest/ingest_pipeline.hpp"
+#include "../ingest/ingestor.hpp"
+
+// End-to-end ingest throughput: replays a firehose file (see FirehoseGenerator) through the same pipeline
+// the firehose command builds (routing, sharded decode, Ingestor into every hosted feed) as fast as the
+// pipeline accepts it, then runs one compaction pass over what the replay deleted.
+//
+// Reading the file stands in for the network reader, so the receive thread's time is split into read
+// (file I/O) and route (pushFrame, including waits on full decode queues). Decode and index times are
+// summed over shards. Peak memory is the process's peak resident set, which on a fresh process is the
+// replay's own footprint: the file is streamed, never held whole.
+class ReplayBenchmark {
+public:
+    struct Options {
+        std::string path;
+        IngestPipeline::Options pipeline;
+        DedupeFilter::Options dedupe;
+        std::vector<FeedDefinition> feeds; // Empty for defaultFeeds()
+        uint64_t maxFrames = 0;            // 0 replays the whole file
+    };
+
+    struct Stage {
+        std::string name;
+        uint64_t items = 0;
+        uint64_t busyNs = 0;
+        size_t threads = 1;
+    };
+
+    struct Report {
+        std::chrono::duration<double> elapsed{0}; // First frame read to last event indexed
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        uint64_t malformed = 0;
+        size_t shards = 0;
+        size_t feeds = 0;
+        Ingestor::Stats ingest;   // Summed over shards
+        std::vector<Stage> stages; // read, route, decode, index, compact (its items are entries purged)
+        uint64_t entriesPurged = 0;
+        uint64_t peakRssBytes = 0;
+        uint64_t startRssBytes = 0; // Peak before the replay began
+    };
+
+    explicit ReplayBenchmark(Options options);
+
+    Report run();
+
+    // Feeds of the kinds a deployment hosts: everything, by language, by keyword, and by rule
+    static std::vector<FeedDefinition> defaultFeeds();
+
+    // A plain-text summary: throughput, time per stage, ingest outcomes and memory
+    static std::string format(const Report& report);
+
+    // The process's peak resident set so far; 0 where the platform does not report it
+    static uint64_t peakRssBytes();
+
+private:
+    Options options;
+};
+
+#endif // REPLAY_BENCHMARK_H
@@ -4,10 +4,14 @@
 //
 
 #include <iostream>
+#include <optional>
 #include <sstream>
+#include <thread>
 #include "handlers/command_handler.hpp"
 #include "config/settings.hpp"
 #include "tools/logging.hpp"
+#include "tools/process_signals.hpp"
+#include "tools/tracing.hpp"
 
 // Helper function to split input into command and arguments
 std::pair<std::string, std::vector<std::string>> parseInput(const std::string& input) {
@@ -24,16 +28,55 @@ std::pair<std::string, std::vector<std::string>> parseInput(const std::string& i
     return {command, args};
 }
 
-int main() {
-    const auto settings = Settings::createInstance();
+// Headless: run the daemon_commands (firehose and serve by default), report readiness, then wait for the
+// supervisor's signals: SIGHUP reloads settings, SIGTERM or SIGINT drains and exits. Returns false without
+// reporting readiness when a service failed to start. backfill_on_start runs in the background once
+// ready, and is interrupted by shutdown.
+static bool runDaemon(Settings& settings, ProcessSignals& signals) {
+    const auto commands = settings.get<std::vector<std::string>>("daemon_commands", {"firehose", "serve"});
+    for (const auto& line : commands) {
+        auto [command, args] = parseInput(line);
+        CommandHandler::executeCommand(command, args);
+        if (!CommandHandler::isRunning(command)) {
+            Logging::error("'" + line + "' failed to start; exiting.");
+            return false;
+        }
+    }
+    CommandHandler::setReady(true);
+    ProcessSignals::notify("READY=1");
+    Logging::info("Ready; send SIGHUP to reload settings, SIGTERM to stop.");
 
-    Logging::info("Welcome to " + settings->get<std::string>("feed_name") + " feed Console!");
+    std::thread backfill;
+    if (settings.get<bool>("backfill_on_start", false)) {
+        backfill = std::thread([] { CommandHandler::executeCommand("backfill", {}); });
+    }
+
+    while (signals.wait() == ProcessSignals::Request::Reload) {
+        ProcessSignals::notify("RELOADING=1");
+        CommandHandler::reload();
+        ProcessSignals::notify("READY=1");
+    }
+    ProcessSignals::notify("STOPPING=1");
+    Logging::info("Draining before exit.");
+    if (backfill.joinable()) {
+        CommandHandler::stopBackfill();
+        backfill.join();
+    }
+    return true;
+}
+
+static void runConsole() {
     Logging::info("Type 'help' for a list of commands.");
+    CommandHandler::setReady(true);
 
     std::string input;
     while (true) {
         std::cout << "> ";
-        std::getline(std::cin, input);
+        // Closed stdin (a pipe that ended, or no terminal at all) ends the session like 'exit'
+        if (!std::getline(std::cin, input)) {
+            std::cout << std::endl;
+            break;
+        }
 
         auto [command, args] = parseInput(input);
 
@@ -44,6 +87,36 @@ int main() {
 
         CommandHandler::executeCommand(command, args);
     }
+}
+
+int main(const int argc, char** argv) {
+    const auto daemon = argc > 1 && std::string(argv[1]) == "--daemon";
+    ProcessSignals::ignoreBrokenPipes(); // Before the firehose or any client can write to a socket
+
+    // Taken before any service starts a thread, so that every thread inherits the blocked signals
+    std::optional<ProcessSignals> signals;
+    if (daemon) {
+        signals.emplace();
+    }
 
-    return 0;
-}
\ No newline at end of file
+    const auto settings = Settings::createInstance();
+
+    Logging::info("Welcome to " + settings->get<std::string>("feed_name") + " feed Console!");
+    Tracing::setSampleEvery(settings->get<uint32_t>("trace_sample_every", 0));
+
+    auto succeeded = true;
+    if (daemon) {
+        succeeded = runDaemon(*settings, *signals);
+        signals.reset(); // A second SIGTERM while draining ends the process at once
+    } else {
+        // Optionally warm the feeds with recent history before taking commands
+        if (settings->get<bool>("backfill_on_start", false)) {
+            CommandHandler::executeCommand("backfill", {});
+        }
+        runConsole();
+    }
+
+    CommandHandler::shutdown();
+
+    return succeeded ? 0 : 1;
+}
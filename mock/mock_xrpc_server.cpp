@@ -0,0 +1,395 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "mock_xrpc_server.hpp"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include "../cpp-httplib/httplib.h"
+#include "../tools/hash.hpp"
+#include "../tools/timestamp.hpp"
+
+namespace {
+    constexpr size_t MAX_PROFILES = 25;
+    constexpr size_t DEFAULT_PAGE = 50;
+    constexpr size_t MAX_PAGE = 100;
+
+    // An XRPC error response: {"error": name, "message": message} with status
+    struct XrpcError {
+        int status;
+        std::string name;
+        std::string message;
+    };
+
+    // The process-wide self-signed key and certificate, made once since every server can present the same one
+    struct Identity {
+        EVP_PKEY* key = nullptr;
+        X509* certificate = nullptr;
+        std::string pem;
+    };
+
+    const Identity& identity() {
+        static const Identity made = [] {
+            Identity identity;
+            identity.key = EVP_PKEY_Q_keygen(nullptr, nullptr, "EC", "P-256");
+            identity.certificate = X509_new();
+            if (!identity.key || !identity.certificate) {
+                throw MockXrpcServerException("Could not generate the mock server's key");
+            }
+
+            const auto certificate = identity.certificate;
+            X509_set_version(certificate, X509_VERSION_3);
+            ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+            X509_gmtime_adj(X509_getm_notBefore(certificate), -60 * 60);
+            X509_gmtime_adj(X509_getm_notAfter(certificate), 365L * 24 * 60 * 60);
+            X509_set_pubkey(certificate, identity.key);
+            const auto name = X509_get_subject_name(certificate);
+            X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                       reinterpret_cast<const unsigned char*>("bluesky_feed mock XRPC"), -1, -1, 0);
+            X509_set_issuer_name(certificate, name);
+
+            X509V3_CTX context;
+            X509V3_set_ctx_nodb(&context);
+            X509V3_set_ctx(&context, certificate, certificate, nullptr, nullptr, 0);
+            for (const auto& [nid, value] : {std::pair{NID_subject_alt_name, "IP:127.0.0.1,DNS:localhost"},
+                                             std::pair{NID_basic_constraints, "critical,CA:TRUE"}}) {
+                const auto extension = X509V3_EXT_conf_nid(nullptr, &context, nid, value);
+                X509_add_ext(certificate, extension, -1);
+                X509_EXTENSION_free(extension);
+            }
+            if (X509_sign(certificate, identity.key, EVP_sha256()) == 0) {
+                throw MockXrpcServerException("Could not sign the mock server's certificate");
+            }
+
+            const std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new(BIO_s_mem()), BIO_free);
+            PEM_write_bio_X509(bio.get(), certificate);
+            char* data = nullptr;
+            const auto length = BIO_get_mem_data(bio.get(), &data);
+            identity.pem.assign(data, static_cast<size_t>(length));
+            return identity;
+        }();
+        return made;
+    }
+
+    // n characters of RFC 4648 lowercase base32 drawn from the hash of text
+    std::string hashedBase32(const std::string_view text, const uint64_t seed, const size_t n) {
+        static constexpr char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz234567";
+        std::string out;
+        out.reserve(n);
+        uint64_t bits = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (i % 12 == 0) {
+                bits = Hash::bytes(text, seed + i / 12);
+            }
+            out += ALPHABET[bits & 31];
+            bits >>= 5;
+        }
+        return out;
+    }
+
+    // Encode a TID: 53 bits of microseconds and a 10-bit clock id in the base32-sortable alphabet
+    std::string tid(const uint64_t micros, const uint64_t clockId) {
+        static constexpr char ALPHABET[] = "234567abcdefghijklmnopqrstuvwxyz";
+        const auto value = (micros << 10) | (clockId & 1023);
+        std::string out(13, '2');
+        for (size_t i = 0; i < 13; ++i) {
+            out[i] = ALPHABET[(value >> (60 - 5 * i)) & 31];
+        }
+        return out;
+    }
+
+    std::string requiredParam(const httplib::Request& request, const std::string& name) {
+        auto value = request.get_param_value(name);
+        if (value.empty()) {
+            throw XrpcError{400, "InvalidRequest", "Error: Params must have the property \"" + name + "\""};
+        }
+        return value;
+    }
+
+    // The page a request asks for: [offset, offset + limit) of total, from its cursor and limit
+    std::pair<size_t, size_t> page(const httplib::Request& request, const size_t total) {
+        size_t offset = 0, limit = DEFAULT_PAGE;
+        try {
+            if (request.has_param("cursor")) {
+                offset = std::stoul(request.get_param_value("cursor"));
+            }
+            if (request.has_param("limit")) {
+                limit = std::stoul(request.get_param_value("limit"));
+            }
+        } catch (const std::exception&) {
+            throw XrpcError{400, "InvalidRequest", "Error: cursor and limit must be integers"};
+        }
+        if (limit == 0 || limit > MAX_PAGE) {
+            throw XrpcError{400, "InvalidRequest", "Error: limit must be between 1 and " + std::to_string(MAX_PAGE)};
+        }
+        offset = std::min(offset, total);
+        return {offset, std::min(total, offset + limit)};
+    }
+
+    // The synthetic accounts: an actor's DID and handle are derived from whichever of the two it was asked by
+    std::string didOf(const std::string& actor, const uint64_t seed) {
+        return actor.rfind("did:", 0) == 0 ? actor : "did:plc:" + hashedBase32(actor, seed, 24);
+    }
+
+    std::string handleOf(const std::string& actor, const uint64_t seed) {
+        if (actor.rfind("did:", 0) != 0) {
+            return actor;
+        }
+        return "user-" + hashedBase32(actor, seed + 1000, 8) + ".bsky.social";
+    }
+
+    nlohmann::json profileView(const std::string& actor, const uint64_t seed) {
+        const auto handle = handleOf(actor, seed);
+        const auto did = didOf(actor, seed);
+        return {
+            {"did", did},
+            {"handle", handle},
+            {"displayName", handle.substr(0, handle.find('.'))},
+            {"avatar", "https://cdn.bsky.app/img/avatar/plain/" + did + "/bafkreiavatar@jpeg"},
+            {"viewer", {{"muted", false}, {"blockedBy", false}}},
+            {"labels", nlohmann::json::array()},
+            {"createdAt", "2023-04-12T18:00:00.000Z"}
+        };
+    }
+}
+
+MockXrpcServer::MockXrpcServer(Options options)
+    : options(std::move(options)), certificate(identity().pem), random(this->options.seed) {
+    server = std::make_unique<httplib::SSLServer>(identity().certificate, identity().key);
+    if (!server->is_valid()) {
+        throw MockXrpcServerException("Could not set up TLS for the mock XRPC server");
+    }
+    server->new_task_queue = [threads = this->options.threads] { return new httplib::ThreadPool(threads); };
+    // Like the AppView, keep connections open across many requests, so client-side pooling is what is measured
+    server->set_keep_alive_max_count(10'000);
+    server->set_tcp_nodelay(true);
+
+    // Clients may send the absolute URL as the request target, so the method is found rather than routed
+    server->Get(".*", [this](const httplib::Request& request, httplib::Response& response) {
+        handle(request, response);
+    });
+}
+
+MockXrpcServer::~MockXrpcServer() {
+    stop();
+}
+
+bool MockXrpcServer::start(const int port) {
+    if (server->is_running()) {
+        return true;
+    }
+    boundPort = port == 0 ? server->bind_to_any_port("127.0.0.1")
+                          : (server->bind_to_port("127.0.0.1", port) ? port : -1);
+    if (boundPort <= 0) {
+        return false;
+    }
+    listener = std::thread([this] { server->listen_after_bind(); });
+    server->wait_until_ready();
+    return true;
+}
+
+void MockXrpcServer::stop() {
+    if (server->is_running()) {
+        server->stop();
+    }
+    if (listener.joinable()) {
+        listener.join();
+    }
+}
+
+void MockXrpcServer::setRecorded(const std::string& method, nlohmann::json body) {
+    std::lock_guard lock(mutex);
+    recorded[method] = std::move(body);
+}
+
+void MockXrpcServer::failNext(const size_t count, const int status, const size_t after) {
+    std::lock_guard lock(mutex);
+    failures = count;
+    failuresAfter = after;
+    failureStatus = status;
+}
+
+uint64_t MockXrpcServer::requests(const std::string& method) const {
+    std::lock_guard lock(mutex);
+    const auto it = counts.find(method);
+    return it == counts.end() ? 0 : it->second;
+}
+
+std::chrono::microseconds MockXrpcServer::sampleLatency() {
+    if (options.medianLatency.count() <= 0) {
+        return std::chrono::microseconds(0);
+    }
+    std::lognormal_distribution<double> latency(std::log(static_cast<double>(options.medianLatency.count())),
+                                                options.latencySigma);
+    std::lock_guard lock(mutex);
+    return std::chrono::microseconds(static_cast<int64_t>(latency(random)));
+}
+
+int MockXrpcServer::injectFailure(httplib::Response& response) {
+    std::lock_guard lock(mutex);
+    if (failures > 0 && failuresAfter > 0) {
+        --failuresAfter;
+    } else if (failures > 0) {
+        --failures;
+        return failureStatus;
+    }
+
+    if (options.rateLimit > 0) {
+        const auto now = std::chrono::system_clock::now();
+        if (now >= windowEnd) {
+            windowEnd = now + options.rateLimitWindow;
+            windowRequests = 0;
+        }
+        ++windowRequests;
+        const auto reset = std::chrono::ceil<std::chrono::seconds>(windowEnd.time_since_epoch()).count();
+        response.set_header("RateLimit-Limit", std::to_string(options.rateLimit));
+        response.set_header("RateLimit-Remaining",
+                            std::to_string(options.rateLimit - std::min(windowRequests, options.rateLimit)));
+        response.set_header("RateLimit-Reset", std::to_string(reset));
+        response.set_header("RateLimit-Policy", std::to_string(options.rateLimit) + ";w=" +
+                                                std::to_string(options.rateLimitWindow.count()));
+        if (windowRequests > options.rateLimit) {
+            return 429;
+        }
+    }
+
+    if (options.errorRate > 0 && std::bernoulli_distribution(options.errorRate)(random)) {
+        return 500;
+    }
+    return 0;
+}
+
+void MockXrpcServer::handle(const httplib::Request& request, httplib::Response& response) {
+    const auto at = request.path.find("/xrpc/");
+    const auto method = at == std::string::npos ? std::string() : request.path.substr(at + 6);
+    ++total;
+    std::optional<nlohmann::json> replay;
+    {
+        std::lock_guard lock(mutex);
+        ++counts[method];
+        if (const auto it = recorded.find(method); it != recorded.end()) {
+            replay = it->second;
+        }
+    }
+
+    const auto latency = sampleLatency();
+    const auto failure = injectFailure(response);
+    if (latency.count() > 0) {
+        std::this_thread::sleep_for(latency);
+    }
+
+    try {
+        if (failure == 429) {
+            throw XrpcError{429, "RateLimitExceeded", "Rate Limit Exceeded"};
+        }
+        if (failure != 0) {
+            throw XrpcError{failure, "InternalServerError", "Injected failure"};
+        }
+
+        nlohmann::json body;
+        if (replay) {
+            body = std::move(*replay);
+        } else if (method == "app.bsky.actor.getProfile") {
+            body = getProfile(request);
+        } else if (method == "app.bsky.actor.getProfiles") {
+            body = getProfiles(request);
+        } else if (method == "app.bsky.graph.getFollows") {
+            body = getFollows(request);
+        } else if (method == "app.bsky.feed.getAuthorFeed") {
+            body = getAuthorFeed(request);
+        } else {
+            throw XrpcError{501, "MethodNotImplemented", "Method Not Implemented"};
+        }
+        response.set_content(body.dump(), "application/json");
+    } catch (const XrpcError& error) {
+        response.status = error.status;
+        response.set_content(nlohmann::json{{"error", error.name}, {"message", error.message}}.dump(),
+                             "application/json");
+    }
+}
+
+nlohmann::json MockXrpcServer::getProfile(const httplib::Request& request) const {
+    const auto actor = requiredParam(request, "actor");
+    auto profile = profileView(actor, options.seed);
+    profile["description"] = "A synthetic account for offline testing";
+    profile["banner"] = "https://cdn.bsky.app/img/banner/plain/" + profile["did"].get<std::string>() +
+                        "/bafkreibanner@jpeg";
+    profile["followersCount"] = Hash::bytes(actor, options.seed) % 10'000;
+    profile["followsCount"] = options.followsPerActor;
+    profile["postsCount"] = options.postsPerActor;
+    profile["indexedAt"] = "2024-11-20T09:30:00.000Z";
+    return profile;
+}
+
+nlohmann::json MockXrpcServer::getProfiles(const httplib::Request& request) const {
+    const auto count = request.get_param_value_count("actors");
+    if (count == 0) {
+        throw XrpcError{400, "InvalidRequest", "Error: Params must have the property \"actors\""};
+    }
+    if (count > MAX_PROFILES) {
+        throw XrpcError{400, "InvalidRequest",
+                        "Error: actors must not have more than " + std::to_string(MAX_PROFILES) + " elements"};
+    }
+    auto profiles = nlohmann::json::array();
+    for (size_t i = 0; i < count; ++i) {
+        profiles.push_back(profileView(request.get_param_value("actors", i), options.seed));
+    }
+    return {{"profiles", std::move(profiles)}};
+}
+
+nlohmann::json MockXrpcServer::getFollows(const httplib::Request& request) const {
+    const auto actor = requiredParam(request, "actor");
+    const auto did = didOf(actor, options.seed);
+    const auto [begin, end] = page(request, options.followsPerActor);
+
+    auto follows = nlohmann::json::array();
+    for (auto i = begin; i < end; ++i) {
+        follows.push_back(profileView(didOf(did + "/follows/" + std::to_string(i), options.seed), options.seed));
+    }
+    nlohmann::json body = {{"subject", profileView(actor, options.seed)}, {"follows", std::move(follows)}};
+    if (end < options.followsPerActor) {
+        body["cursor"] = std::to_string(end);
+    }
+    return body;
+}
+
+nlohmann::json MockXrpcServer::getAuthorFeed(const httplib::Request& request) const {
+    const auto actor = requiredParam(request, "actor");
+    const auto author = profileView(actor, options.seed);
+    const auto did = author["did"].get<std::string>();
+    const auto [begin, end] = page(request, options.postsPerActor);
+
+    // Newest first, one a minute back from the start of the current hour, so a page is the same all hour
+    const auto newest = std::chrono::floor<std::chrono::hours>(std::chrono::system_clock::now());
+    auto feed = nlohmann::json::array();
+    for (auto i = begin; i < end; ++i) {
+        const auto created = newest - std::chrono::minutes(i);
+        const auto micros = std::chrono::duration_cast<std::chrono::microseconds>(created.time_since_epoch()).count();
+        const auto key = did + "/" + std::to_string(i);
+        const auto at = Timestamp::formatIso8601(static_cast<uint64_t>(micros));
+        feed.push_back({{"post", {
+            {"uri", "at://" + did + "/app.bsky.feed.post/" + tid(static_cast<uint64_t>(micros), Hash::bytes(key))},
+            {"cid", "bafyrei" + hashedBase32(key, options.seed, 52)},
+            {"author", author},
+            {"record", {
+                {"$type", "app.bsky.feed.post"},
+                {"text", "Synthetic post " + std::to_string(i) + " by " + author["handle"].get<std::string>()},
+                {"createdAt", at},
+                {"langs", {"en"}}
+            }},
+            {"replyCount", Hash::bytes(key, 1) % 20},
+            {"repostCount", Hash::bytes(key, 2) % 50},
+            {"likeCount", Hash::bytes(key, 3) % 200},
+            {"quoteCount", Hash::bytes(key, 4) % 5},
+            {"indexedAt", at},
+            {"labels", nlohmann::json::array()}
+        }}});
+    }
+    nlohmann::json body = {{"feed", std::move(feed)}};
+    if (end < options.postsPerActor) {
+        body["cursor"] = std::to_string(end);
+    }
+    return body;
+}
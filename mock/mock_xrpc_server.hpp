@@ -0,0 +1,123 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef MOCK_XRPC_SERVER_H
+#define MOCK_XRPC_SERVER_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include "../nlohmann/json.hpp"
+
+namespace httplib {
+    class SSLServer;
+    struct Request;
+    struct Response;
+}
+
+class MockXrpcServerException final : public std::exception {
+    std::string message;
+
+public:
+    explicit MockXrpcServerException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// A local stand-in for the AppView's XRPC API, so the client stack (pooling, retries, rate limiting,
+// paging) can be tested and benchmarked without a network.
+//
+// Serves app.bsky.actor.getProfile, app.bsky.actor.getProfiles, app.bsky.graph.getFollows and
+// app.bsky.feed.getAuthorFeed over HTTPS on 127.0.0.1 with a self-signed certificate generated at
+// construction; pass certificatePem() to HTTPSClient::trustCertificate. Responses are synthetic but
+// deterministic: the same actor always has the same DID, follows and posts, paged with offset cursors.
+// setRecorded replaces a method's responses with a recorded body instead.
+//
+// Every request is answered after a log-normal latency, and may instead be failed: first by failNext,
+// then by the rate limit (429 with RateLimit-* headers, as the AppView sends), then at random by errorRate.
+class MockXrpcServer {
+public:
+    struct Options {
+        std::chrono::microseconds medianLatency{0};
+        double latencySigma = 0.0;              // Of the log-normal; 0 answers every request after the median
+        double errorRate = 0.0;                 // Share of requests answered 500 InternalServerError
+        size_t rateLimit = 0;                   // Requests per window before 429s; 0 for no limit
+        std::chrono::seconds rateLimitWindow{300};
+        size_t followsPerActor = 250;
+        size_t postsPerActor = 100;
+        size_t threads = 64;                    // Enough that injected latency does not queue requests
+        uint64_t seed = 1;
+    };
+
+    MockXrpcServer() : MockXrpcServer(Options{}) {}
+    explicit MockXrpcServer(Options options);
+    ~MockXrpcServer();
+
+    MockXrpcServer(const MockXrpcServer&) = delete;
+    MockXrpcServer& operator=(const MockXrpcServer&) = delete;
+
+    // Listen on 127.0.0.1; port 0 picks a free one. Returns false if the port could not be bound.
+    bool start(int port = 0);
+    void stop();
+
+    [[nodiscard]] int port() const { return boundPort; }
+
+    // "127.0.0.1:<port>", for HTTPSClient::setHost
+    [[nodiscard]] std::string host() const { return "127.0.0.1:" + std::to_string(boundPort); }
+
+    // The self-signed certificate the server presents, valid for 127.0.0.1 and localhost
+    [[nodiscard]] const std::string& certificatePem() const { return certificate; }
+
+    // Answer every request for method (e.g. "app.bsky.actor.getProfile") with this body instead
+    void setRecorded(const std::string& method, nlohmann::json body);
+
+    // Answer count requests with status, before any other injection, once the next after have been let through
+    void failNext(size_t count, int status = 503, size_t after = 0);
+
+    // Requests received for method, including failed ones
+    [[nodiscard]] uint64_t requests(const std::string& method) const;
+    [[nodiscard]] uint64_t totalRequests() const { return total; }
+
+private:
+    void handle(const httplib::Request& request, httplib::Response& response);
+
+    // The status to fail this request with, or 0 to answer it; sets the rate limit headers
+    int injectFailure(httplib::Response& response);
+    std::chrono::microseconds sampleLatency();
+
+    nlohmann::json getProfile(const httplib::Request& request) const;
+    nlohmann::json getProfiles(const httplib::Request& request) const;
+    nlohmann::json getFollows(const httplib::Request& request) const;
+    nlohmann::json getAuthorFeed(const httplib::Request& request) const;
+
+    Options options;
+    std::string certificate;
+    std::unique_ptr<httplib::SSLServer> server;
+    std::thread listener;
+    int boundPort = 0;
+
+    mutable std::mutex mutex;
+    std::mt19937_64 random;
+    std::map<std::string, nlohmann::json, std::less<>> recorded;
+    std::map<std::string, uint64_t, std::less<>> counts;
+    size_t failures = 0;
+    size_t failuresAfter = 0;
+    int failureStatus = 503;
+    std::chrono::system_clock::time_point windowEnd;
+    size_t windowRequests = 0;
+    std::atomic<uint64_t> total{0};
+};
+
+#endif // MOCK_XRPC_SERVER_H
@@ -4,9 +4,19 @@
 //
 
 #include "https_client.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include "../cpp-httplib/httplib.h"
 #include "../tools/logging.hpp"
+#include "../tools/metrics.hpp"
+#include "../tools/rate_limiter.hpp"
+#include "../tools/tracing.hpp"
 
 // Setters
 void HTTPSClient::setHost(const std::string_view h) {
@@ -21,6 +31,15 @@ void HTTPSClient::setHost(const std::string_view h) {
         host.pop_back();
     }
 
+    hostname = host;
+    port = 443;
+    if (const auto colon = host.rfind(':'); colon != std::string::npos && colon + 1 < host.size() &&
+        std::all_of(host.begin() + static_cast<std::ptrdiff_t>(colon) + 1, host.end(),
+                    [](const unsigned char c) { return std::isdigit(c); })) {
+        hostname = host.substr(0, colon);
+        port = std::stoi(host.substr(colon + 1));
+    }
+
     Logging::debug("Host set to: " + host);
 }
 
@@ -29,9 +48,13 @@ void HTTPSClient::setBearerToken(const std::string_view token) { bearerToken = t
 void HTTPSClient::addQueryParam(const std::string_view key, const std::string_view value) {
     queryParams[std::string(key)] = value;
 }
+void HTTPSClient::setRateLimiter(std::shared_ptr<RateLimiter> limiter) { rateLimiter = std::move(limiter); }
+void HTTPSClient::setMaxRetries(const int retries) { maxRetries = std::max(0, retries); }
+void HTTPSClient::setCancelFlag(const std::atomic<bool>* flag) { cancelled = flag; }
 
 // Construct the full URL including query parameters
 std::string HTTPSClient::constructUrl() const {
+    Span span("https.url");
     std::ostringstream urlStream;
 
     // Ensure the URL starts with https://
@@ -53,6 +76,137 @@ std::string HTTPSClient::constructUrl() const {
     return urlStream.str();
 }
 
+// Bodies are read into one buffer sized from Content-Length up to this; larger ones grow as they arrive
+static constexpr uint64_t MAX_RESERVED_BODY = 16 << 20;
+
+// When each phase of the traced request attempt on this thread ended; 0 if it did not happen, e.g. no
+// connect or handshake on a reused keep-alive connection. Set from httplib and OpenSSL callbacks.
+struct AttemptPhases {
+    uint64_t started = 0;
+    uint64_t resolved = 0;
+    uint64_t connected = 0;
+    uint64_t handshaken = 0;
+    uint64_t firstByte = 0;
+};
+thread_local AttemptPhases* tracedAttempt = nullptr;
+
+// The socket is created once the host name is resolved, and the handshake starts once it is connected
+static void onSocketCreated(socket_t) {
+    if (tracedAttempt && tracedAttempt->resolved == 0) {
+        tracedAttempt->resolved = Tracing::now();
+    }
+}
+
+static void onHandshakeProgress(const SSL*, const int where, int) {
+    if (!tracedAttempt) {
+        return;
+    }
+    if ((where & SSL_CB_HANDSHAKE_START) && tracedAttempt->connected == 0) {
+        tracedAttempt->connected = Tracing::now();
+    } else if ((where & SSL_CB_HANDSHAKE_DONE) && tracedAttempt->handshaken == 0) {
+        tracedAttempt->handshaken = Tracing::now();
+    }
+}
+
+// Certificates added with trustCertificate, on top of the system's trust store
+static std::mutex trustedMutex;
+static std::vector<std::shared_ptr<X509>> trustedCertificates;
+static std::atomic<size_t> trustedCount{0};
+
+void HTTPSClient::trustCertificate(const std::string_view pem) {
+    const std::unique_ptr<BIO, decltype(&BIO_free)> bio(BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size())),
+                                                        BIO_free);
+    X509* certificate = bio ? PEM_read_bio_X509(bio.get(), nullptr, nullptr, nullptr) : nullptr;
+    if (!certificate) {
+        throw HTTPException("Not a PEM certificate");
+    }
+    std::lock_guard lock(trustedMutex);
+    trustedCertificates.emplace_back(certificate, X509_free);
+    trustedCount = trustedCertificates.size();
+}
+
+// Reuse one keep-alive connection per host and thread, so paging through a collection
+// does not pay for a TCP and TLS handshake on every request. Hosts can come from requests
+// (did:web issuers), so each thread keeps only the most recently used few; evicting one
+// closes its connection.
+static constexpr size_t MAX_POOLED_HOSTS = 16;
+
+static httplib::SSLClient& pooledClient(const std::string& host, const std::string& hostname, const int port) {
+    struct Pooled {
+        std::string host;
+        std::unique_ptr<httplib::SSLClient> client;
+        size_t trusted = 0; // How many of trustedCertificates its store holds
+        uint64_t lastUsed = 0;
+    };
+    thread_local std::vector<Pooled> clients;
+    thread_local uint64_t uses = 0;
+
+    auto found = std::find_if(clients.begin(), clients.end(),
+                              [&host](const Pooled& pooled) { return pooled.host == host; });
+    if (found == clients.end()) {
+        if (clients.size() < MAX_POOLED_HOSTS) {
+            found = clients.emplace(clients.end());
+        } else {
+            found = std::min_element(clients.begin(), clients.end(), [](const Pooled& a, const Pooled& b) {
+                return a.lastUsed < b.lastUsed;
+            });
+            *found = Pooled{};
+        }
+        found->host = host;
+        found->client = std::make_unique<httplib::SSLClient>(hostname, port);
+        found->client->set_follow_location(true); // Follow redirects automatically
+        found->client->set_keep_alive(true);
+        found->client->set_socket_options(onSocketCreated);
+        SSL_CTX_set_info_callback(found->client->ssl_context(), onHandshakeProgress);
+    }
+    found->lastUsed = ++uses;
+
+    auto& client = found->client;
+    auto& trusted = found->trusted;
+    if (trusted != trustedCount.load(std::memory_order_acquire)) {
+        std::lock_guard lock(trustedMutex);
+        const auto store = SSL_CTX_get_cert_store(client->ssl_context());
+        for (; trusted < trustedCertificates.size(); ++trusted) {
+            X509_STORE_add_cert(store, trustedCertificates[trusted].get());
+        }
+    }
+    return *client;
+}
+
+// Spans for the phases of one attempt that ended at end
+static void recordPhases(const AttemptPhases& phases, const uint64_t end) {
+    auto mark = phases.started;
+    const auto phase = [&](const char* name, const uint64_t until) {
+        if (until != 0) {
+            Tracing::record(name, mark, until);
+            mark = until;
+        }
+    };
+    phase("https.dns", phases.resolved);
+    phase("https.connect", phases.connected);
+    phase("https.tls", phases.handshaken);
+    phase("https.ttfb", phases.firstByte);
+    phase("https.body", phases.firstByte != 0 ? end : 0);
+}
+
+// How long a 429 response asks us to wait: Retry-After seconds, or the RateLimit-Reset epoch time
+static std::chrono::milliseconds retryAfter(const httplib::Response& response) {
+    try {
+        if (response.has_header("Retry-After")) {
+            return std::chrono::seconds(std::stoll(response.get_header_value("Retry-After")));
+        }
+        if (response.has_header("RateLimit-Reset")) {
+            const auto reset = std::chrono::system_clock::time_point(
+                std::chrono::seconds(std::stoll(response.get_header_value("RateLimit-Reset"))));
+            return std::max(std::chrono::milliseconds(0),
+                            std::chrono::duration_cast<std::chrono::milliseconds>(reset - std::chrono::system_clock::now()));
+        }
+    } catch (const std::exception&) {
+        // Malformed header; fall back to exponential backoff
+    }
+    return std::chrono::milliseconds(0);
+}
+
 // Perform a GET request and return JSON
 nlohmann::json HTTPSClient::get() const {
     if (host.empty()) {
@@ -60,8 +214,8 @@ nlohmann::json HTTPSClient::get() const {
         return {};
     }
 
-    httplib::SSLClient client(host, 443);
-    client.set_follow_location(true); // Follow redirects automatically
+    Trace trace("https.get");
+    auto& client = pooledClient(host, hostname, port);
 
     // Set headers
     httplib::Headers headers;
@@ -70,14 +224,81 @@ nlohmann::json HTTPSClient::get() const {
         headers.insert({"Authorization", "Bearer " + bearerToken});
     }
 
-    // Perform the GET request
-    auto res = client.Get(constructUrl(), headers);
+    static auto& latency = Metrics::global().histogram("bluesky_https_request_seconds",
+                                                       "Outbound HTTPS request latency per attempt");
+    static auto& retries = Metrics::global().counter("bluesky_https_retries_total",
+                                                     "Outbound HTTPS requests retried after a 429, 5xx or no response");
+    static auto& failures = Metrics::global().counter("bluesky_https_failures_total",
+                                                      "Outbound HTTPS requests that did not end in a 200");
+
+    const auto url = constructUrl();
+
+    // The body is collected here rather than in res->body so the first byte can be timed
+    std::string body;
+    const auto onResponse = [&](const httplib::Response& response) {
+        if (tracedAttempt) {
+            tracedAttempt->firstByte = Tracing::now();
+        }
+        body.clear();
+        body.reserve(std::min<uint64_t>(response.get_header_value_u64("Content-Length"), MAX_RESERVED_BODY));
+        return true;
+    };
+    const auto onContent = [&](const char* data, const size_t length) {
+        body.append(data, length);
+        return true;
+    };
+
+    // Perform the GET request, backing off on rate limits and transient failures
+    httplib::Result res;
+    for (int attempt = 0;; ++attempt) {
+        if (rateLimiter) {
+            rateLimiter->acquire();
+        }
+        AttemptPhases phases;
+        if (Tracing::active()) {
+            phases.started = Tracing::now();
+            tracedAttempt = &phases;
+        }
+        const auto started = std::chrono::steady_clock::now(); // After the limiter, so waits are not counted
+        res = client.Get(url, headers, onResponse, onContent);
+        latency.recordSince(started);
+        if (tracedAttempt) {
+            tracedAttempt = nullptr;
+            recordPhases(phases, Tracing::now());
+        }
+        lastStatus = res ? res->status : 0;
+
+        const auto transient = !res || res->status == 429 || res->status >= 500;
+        if (!transient || attempt >= maxRetries) {
+            break;
+        }
+        retries.add();
+
+        // A server may ask for a day; waiting that long inside one request would stall its caller instead
+        auto delay = std::chrono::milliseconds(250) * (1 << std::min(attempt, 6));
+        if (res && res->status == 429) {
+            delay = std::min<std::chrono::milliseconds>(std::max(delay, retryAfter(*res)), MAX_RETRY_DELAY);
+            if (rateLimiter) {
+                rateLimiter->pauseUntil(RateLimiter::Clock::now() + delay);
+            }
+        }
+        Logging::debug("Retrying " + endpoint + " in " + std::to_string(delay.count()) + "ms");
+        const auto wake = std::chrono::steady_clock::now() + delay;
+        for (auto now = std::chrono::steady_clock::now(); now < wake && !(cancelled && *cancelled);
+             now = std::chrono::steady_clock::now()) {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(wake - now, CANCEL_POLL));
+        }
+        if (cancelled && *cancelled) {
+            break;
+        }
+    }
 
     // Check response status
     if (!res || res->status != 200) {
+        failures.add();
         Logging::error("HTTP GET failed with status: " + (res ? std::to_string(res->status) : "No response"));
         if (res) {
-            Logging::error("Response body: " + res->body);
+            Logging::error("Response body: " + body);
         }
         for (const auto& [key, value] : queryParams) {
             Logging::debug("Query Param: " + key + " = " + value);
@@ -86,6 +307,6 @@ nlohmann::json HTTPSClient::get() const {
     }
 
     // Parse JSON response body
-    const auto& body = res->body;
+    Span parseSpan("https.json_parse");
     return nlohmann::json::parse(body.data(), body.data() + body.size());
 }
\ No newline at end of file
@@ -8,8 +8,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <map>
+#include <memory>
 #include <string>
+#include <string_view>
 #include "../nlohmann/json.hpp"
 
 // Custom HTTP exception
@@ -24,24 +28,53 @@ public:
     }
 };
 
+class RateLimiter;
+
 class HTTPSClient {
-    std::string host;
+    std::string host; // Including any :port, as it appears in the URL
+    std::string hostname;
+    int port = 443;
     std::string endpoint;
     std::string bearerToken;
     std::map<std::string, std::string, std::less<>> queryParams;
+    std::shared_ptr<RateLimiter> rateLimiter;
+    int maxRetries = 0;
+    const std::atomic<bool>* cancelled = nullptr;
+    mutable int lastStatus = 0;
 
-    // Construct the full URL including query parameters
-    [[nodiscard]] std::string constructUrl() const;
+    static constexpr std::chrono::seconds MAX_RETRY_DELAY{60}; // Longest a 429 may make us wait per retry
+    static constexpr std::chrono::milliseconds CANCEL_POLL{100};
 
 public:
-    // Setters
+    // Setters; the host may carry a port, as in "127.0.0.1:8443"
     void setHost(std::string_view h);
     void setEndpoint(std::string_view ep);
     void setBearerToken(std::string_view token);
     void addQueryParam(std::string_view key, std::string_view value);
 
+    // Share a request budget with other clients; 429 responses pause the limiter until the server's reset time
+    void setRateLimiter(std::shared_ptr<RateLimiter> limiter);
+
+    // Retry 429, 5xx and connection failures up to this many times with exponential backoff
+    void setMaxRetries(int retries);
+
+    // Stop waiting to retry once *flag is set, e.g. by a backfill being stopped; get() then returns the failure.
+    // The flag must outlive the client.
+    void setCancelFlag(const std::atomic<bool>* flag);
+
+    // HTTP status of the last get(); 0 if no response was received
+    [[nodiscard]] int status() const { return lastStatus; }
+
+    // Construct the full URL including query parameters
+    [[nodiscard]] std::string constructUrl() const;
+
     // Perform a GET request and return JSON
     [[nodiscard]] nlohmann::json get() const;
+
+    // Also accept servers whose chain ends in this PEM certificate, e.g. a local mock server's self-signed one.
+    // Applies to every client in the process, including connections already pooled. Throws HTTPException if
+    // the PEM does not hold a certificate.
+    static void trustCertificate(std::string_view pem);
 };
 
 #endif // HTTPSCLIENT_H
\ No newline at end of file
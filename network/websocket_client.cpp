@@ -0,0 +1,311 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "websocket_client.hpp"
+#include <algorithm>
+#include <cctype>
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/sha.h>
+#include <openssl/ssl.h>
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <sys/socket.h>
+    #include <sys/time.h>
+#endif
+
+static constexpr std::string_view HANDSHAKE_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+static constexpr size_t MAX_HANDSHAKE_SIZE = 16 << 10;
+static constexpr size_t READ_CHUNK = 64 << 10;
+
+static std::string base64(const unsigned char* bytes, const size_t length) {
+    std::string out(4 * ((length + 2) / 3), '\0');
+    EVP_EncodeBlock(reinterpret_cast<unsigned char*>(out.data()), bytes, static_cast<int>(length));
+    return out;
+}
+
+static uint32_t randomMask() {
+    uint32_t mask = 0;
+    RAND_bytes(reinterpret_cast<unsigned char*>(&mask), sizeof(mask));
+    return mask;
+}
+
+WebSocketClient::~WebSocketClient() {
+    close();
+    release();
+}
+
+std::string WebSocketClient::acceptKey(const std::string_view key) {
+    const auto input = std::string(key) + std::string(HANDSHAKE_GUID);
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(input.data()), input.size(), digest);
+    return base64(digest, sizeof(digest));
+}
+
+std::string WebSocketClient::encodeFrame(const uint8_t opcode, const std::string_view payload, const uint32_t mask) {
+    std::string frame;
+    frame.reserve(payload.size() + 14);
+    frame += static_cast<char>(0x80 | opcode);
+    if (payload.size() < 126) {
+        frame += static_cast<char>(0x80 | payload.size());
+    } else if (payload.size() <= 0xFFFF) {
+        frame += static_cast<char>(0x80 | 126);
+        frame += static_cast<char>(payload.size() >> 8);
+        frame += static_cast<char>(payload.size() & 0xFF);
+    } else {
+        frame += static_cast<char>(0x80 | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame += static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF);
+        }
+    }
+
+    const char maskBytes[4] = {static_cast<char>(mask >> 24), static_cast<char>(mask >> 16),
+                               static_cast<char>(mask >> 8), static_cast<char>(mask)};
+    frame.append(maskBytes, 4);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        frame += static_cast<char>(payload[i] ^ maskBytes[i & 3]);
+    }
+    return frame;
+}
+
+void WebSocketClient::connect(const std::string& url, const std::chrono::seconds readTimeout) {
+    close();
+    release();
+
+    const auto secure = url.rfind("wss://", 0) == 0;
+    if (!secure && url.rfind("ws://", 0) != 0) {
+        throw WebSocketException("Unsupported WebSocket URL: " + url);
+    }
+    const auto rest = url.substr(secure ? 6 : 5);
+    const auto slash = rest.find('/');
+    const auto authority = rest.substr(0, slash);
+    const auto path = slash == std::string::npos ? "/" : rest.substr(slash);
+    const auto colon = authority.find(':');
+    const auto host = authority.substr(0, colon);
+    const auto port = colon == std::string::npos ? std::string(secure ? "443" : "80") : authority.substr(colon + 1);
+    const auto address = host + ":" + port;
+
+    if (secure) {
+        context = SSL_CTX_new(TLS_client_method());
+        if (!context) {
+            throw WebSocketException("Unable to create TLS context");
+        }
+        SSL_CTX_set_default_verify_paths(context);
+        SSL_CTX_set_verify(context, SSL_VERIFY_PEER, nullptr);
+        bio = BIO_new_ssl_connect(context);
+        SSL* ssl = nullptr;
+        if (bio) {
+            BIO_get_ssl(bio, &ssl);
+        }
+        if (!ssl) {
+            throw WebSocketException("Unable to create TLS connection");
+        }
+        SSL_set_tlsext_host_name(ssl, host.c_str());
+        SSL_set1_host(ssl, host.c_str());
+        BIO_set_conn_hostname(bio, address.c_str());
+    } else {
+        bio = BIO_new_connect(address.c_str());
+    }
+
+    if (!bio || BIO_do_connect(bio) <= 0 || (secure && BIO_do_handshake(bio) <= 0)) {
+        release();
+        throw WebSocketException("Unable to connect to " + address);
+    }
+
+    // A silent connection fails the read instead of hanging, so the caller can reconnect
+    if (const auto fd = BIO_get_fd(bio, nullptr); fd >= 0) {
+#ifdef _WIN32
+        const DWORD timeout = static_cast<DWORD>(readTimeout.count() * 1000);
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+#else
+        timeval timeout{};
+        timeout.tv_sec = static_cast<time_t>(readTimeout.count());
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+    }
+
+    open = true;
+    try {
+        handshake(host, path);
+    } catch (const WebSocketException&) {
+        close();
+        release();
+        throw;
+    }
+}
+
+void WebSocketClient::handshake(const std::string& host, const std::string& path) {
+    unsigned char nonce[16];
+    RAND_bytes(nonce, sizeof(nonce));
+    const auto key = base64(nonce, sizeof(nonce));
+
+    const auto request = "GET " + path + " HTTP/1.1\r\nHost: " + host +
+                         "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                         "\r\nSec-WebSocket-Version: 13\r\nUser-Agent: bluesky_feed\r\n\r\n";
+    if (BIO_write(bio, request.data(), static_cast<int>(request.size())) != static_cast<int>(request.size())) {
+        throw WebSocketException("Unable to send WebSocket handshake");
+    }
+
+    size_t end;
+    while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+        if (buffer.size() > MAX_HANDSHAKE_SIZE || !fill(buffer.size() + 1)) {
+            throw WebSocketException("No WebSocket handshake response");
+        }
+    }
+    auto headers = buffer.substr(0, end);
+    consumed = end + 4;
+
+    if (headers.rfind("HTTP/1.1 101", 0) != 0) {
+        throw WebSocketException("WebSocket upgrade refused: " + headers.substr(0, headers.find('\r')));
+    }
+    std::transform(headers.begin(), headers.end(), headers.begin(), [](const unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    auto expected = acceptKey(key);
+    std::transform(expected.begin(), expected.end(), expected.begin(), [](const unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (headers.find("\r\nsec-websocket-accept: " + expected) == std::string::npos) {
+        throw WebSocketException("WebSocket handshake has a bad Sec-WebSocket-Accept");
+    }
+}
+
+bool WebSocketClient::fill(const size_t bytes) {
+    while (buffer.size() - consumed < bytes) {
+        if (!open) {
+            return false;
+        }
+        // Only the unread tail of the previous frame moves, which is less than one frame
+        buffer.erase(0, consumed);
+        consumed = 0;
+
+        const auto size = buffer.size();
+        buffer.resize(size + std::max(READ_CHUNK, bytes - size));
+        const auto read = BIO_read(bio, buffer.data() + size, static_cast<int>(buffer.size() - size));
+        buffer.resize(size + std::max(read, 0));
+        if (read <= 0) {
+            open = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Only called from the reading thread, which is the only one touching the TLS session
+bool WebSocketClient::send(const uint8_t opcode, const std::string_view payload) {
+    const auto frame = encodeFrame(opcode, payload, randomMask());
+    return BIO_write(bio, frame.data(), static_cast<int>(frame.size())) == static_cast<int>(frame.size());
+}
+
+bool WebSocketClient::readMessage(std::string& message) {
+    message.clear();
+    auto inMessage = false;
+
+    while (open) {
+        if (!fill(2)) {
+            break;
+        }
+        const auto first = static_cast<unsigned char>(buffer[consumed]);
+        const auto second = static_cast<unsigned char>(buffer[consumed + 1]);
+        const auto last = (first & 0x80) != 0;
+        const auto opcode = static_cast<uint8_t>(first & 0x0F);
+        const auto masked = (second & 0x80) != 0;
+
+        uint64_t length = second & 0x7F;
+        size_t header = 2;
+        if (length >= 126) {
+            const size_t width = length == 126 ? 2 : 8;
+            if (!fill(2 + width)) {
+                break;
+            }
+            length = 0;
+            for (size_t i = 0; i < width; ++i) {
+                length = (length << 8) | static_cast<unsigned char>(buffer[consumed + 2 + i]);
+            }
+            header += width;
+        }
+        if (length > MAX_MESSAGE_SIZE || message.size() + length > MAX_MESSAGE_SIZE) {
+            close();
+            break;
+        }
+        const auto maskOffset = header;
+        header += masked ? 4 : 0;
+        if (!fill(header + length)) {
+            break;
+        }
+
+        std::string_view payload(buffer.data() + consumed + header, length);
+        std::string unmasked;
+        if (masked) {
+            unmasked.assign(payload);
+            for (size_t i = 0; i < unmasked.size(); ++i) {
+                unmasked[i] ^= buffer[consumed + maskOffset + (i & 3)];
+            }
+            payload = unmasked;
+        }
+
+        switch (opcode) {
+            case OPCODE_PING:
+                send(OPCODE_PONG, payload);
+                break;
+            case OPCODE_PONG:
+                break;
+            case OPCODE_CLOSE:
+                send(OPCODE_CLOSE, payload.substr(0, 2));
+                consumed += header + length;
+                open = false;
+                return false;
+            case OPCODE_TEXT:
+            case OPCODE_BINARY:
+            case OPCODE_CONTINUATION:
+                if ((opcode == OPCODE_CONTINUATION) != inMessage) {
+                    close(); // A continuation without a message, or a new message inside one
+                    return false;
+                }
+                inMessage = true;
+                message.append(payload);
+                break;
+            default:
+                close();
+                return false;
+        }
+        consumed += header + length;
+
+        if (inMessage && last) {
+            return true;
+        }
+    }
+    open = false;
+    return false;
+}
+
+// Shutting the socket down wakes a thread blocked in readMessage(); the BIO itself is freed by its owner
+void WebSocketClient::close() {
+    open = false;
+    if (bio) {
+        if (const auto fd = BIO_get_fd(bio, nullptr); fd >= 0) {
+#ifdef _WIN32
+            shutdown(fd, SD_BOTH);
+#else
+            shutdown(fd, SHUT_RDWR);
+#endif
+        }
+    }
+}
+
+void WebSocketClient::release() {
+    if (bio) {
+        BIO_free_all(bio);
+        bio = nullptr;
+    }
+    if (context) {
+        SSL_CTX_free(context);
+        context = nullptr;
+    }
+    buffer.clear();
+    consumed = 0;
+}
@@ -0,0 +1,85 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef WEBSOCKET_CLIENT_H
+#define WEBSOCKET_CLIENT_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+typedef struct bio_st BIO;
+typedef struct ssl_ctx_st SSL_CTX;
+
+class WebSocketException final : public std::exception {
+    std::string message;
+
+public:
+    explicit WebSocketException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Minimal RFC 6455 client for streaming endpoints such as com.atproto.sync.subscribeRepos.
+//
+// One thread reads messages; close() may be called from any other thread to unblock it. Bytes are only
+// read from the socket when readMessage() is called, so a reader that stops calling it (because the
+// pipeline behind it is full) lets the TCP window close and pushes back on the server.
+class WebSocketClient {
+public:
+    static constexpr size_t MAX_MESSAGE_SIZE = 32 << 20;
+
+    WebSocketClient() = default;
+    ~WebSocketClient();
+
+    WebSocketClient(const WebSocketClient&) = delete;
+    WebSocketClient& operator=(const WebSocketClient&) = delete;
+
+    // Connect to ws://host[:port]/path or wss://host[:port]/path and complete the opening handshake.
+    // readTimeout bounds how long a silent connection is kept before readMessage() gives up.
+    void connect(const std::string& url, std::chrono::seconds readTimeout = std::chrono::seconds(60));
+
+    // Wait for the next complete text or binary message, answering pings on the way; false once the
+    // connection is closed or fails
+    bool readMessage(std::string& message);
+
+    void close();
+
+    [[nodiscard]] bool isOpen() const { return open; }
+
+    // Sec-WebSocket-Accept for a Sec-WebSocket-Key
+    static std::string acceptKey(std::string_view key);
+
+    // A single final frame; clients must mask what they send
+    static std::string encodeFrame(uint8_t opcode, std::string_view payload, uint32_t mask);
+
+private:
+    static constexpr uint8_t OPCODE_CONTINUATION = 0x0;
+    static constexpr uint8_t OPCODE_TEXT = 0x1;
+    static constexpr uint8_t OPCODE_BINARY = 0x2;
+    static constexpr uint8_t OPCODE_CLOSE = 0x8;
+    static constexpr uint8_t OPCODE_PING = 0x9;
+    static constexpr uint8_t OPCODE_PONG = 0xA;
+
+    BIO* bio = nullptr;
+    SSL_CTX* context = nullptr;
+    std::atomic<bool> open{false};
+
+    std::string buffer;
+    size_t consumed = 0;
+
+    bool fill(size_t bytes);
+    bool send(uint8_t opcode, std::string_view payload);
+    void handshake(const std::string& host, const std::string& path);
+    void release();
+};
+
+#endif // WEBSOCKET_CLIENT_H
@@ -0,0 +1,240 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "feed_server.hpp"
+#include <mutex>
+#include "../auth/service_auth.hpp"
+#include "../cpp-httplib/httplib.h"
+#include "../feed/feed.hpp"
+#include "../nlohmann/json.hpp"
+#include "../tools/logging.hpp"
+#include "../tools/metrics.hpp"
+#include "../tools/tracing.hpp"
+
+FeedServer::FeedServer(std::string serviceDid, std::string publisherDid, std::string cursorSecret)
+    : serviceDid(std::move(serviceDid)),
+      publisherDid(std::move(publisherDid)),
+      server(std::make_unique<httplib::Server>()),
+      admin(std::make_unique<httplib::Server>()),
+      cursors(std::move(cursorSecret)),
+      cache(cursors) {
+    // Headers and the pre-rendered body go out in separate writes; with Nagle the body would wait for the
+    // client's delayed ACK of the headers, about 40ms on every keep-alive request
+    server->set_tcp_nodelay(true);
+    registerRoutes();
+    registerAdminRoutes();
+}
+
+FeedServer::~FeedServer() {
+    stop();
+}
+
+void FeedServer::addFeed(std::shared_ptr<Feed> feed) {
+    std::unique_lock lock(feedsMutex);
+    const auto name = feed->name();
+    feeds[name] = std::move(feed);
+}
+
+std::shared_ptr<Feed> FeedServer::findFeed(const std::string& name) const {
+    std::shared_lock lock(feedsMutex);
+    const auto it = feeds.find(name);
+    return it == feeds.end() ? nullptr : it->second;
+}
+
+bool FeedServer::start(const std::string& host, const int port) {
+    if (isRunning()) {
+        return true;
+    }
+    boundPort = listen(*server, listener, host, port, "Feed server");
+    return boundPort > 0;
+}
+
+bool FeedServer::startAdmin(const std::string& host, const int port) {
+    if (admin->is_running()) {
+        return true;
+    }
+    boundAdminPort = listen(*admin, adminListener, host, port, "Admin server");
+    return boundAdminPort > 0;
+}
+
+int FeedServer::listen(httplib::Server& target, std::thread& thread, const std::string& host, const int port,
+                       const std::string& label) {
+    const auto bound = port == 0 ? target.bind_to_any_port(host) : (target.bind_to_port(host, port) ? port : -1);
+    if (bound <= 0) {
+        Logging::error(label + " failed to bind " + host + ":" + std::to_string(port));
+        return -1;
+    }
+
+    thread = std::thread([&target] { target.listen_after_bind(); });
+    target.wait_until_ready(); // stop() is a no-op until the accept loop is running
+    Logging::info(label + " listening on " + host + ":" + std::to_string(bound));
+    return bound;
+}
+
+void FeedServer::stop() {
+    if (server->is_running()) {
+        server->stop();
+    }
+    if (listener.joinable()) {
+        listener.join();
+    }
+    if (admin->is_running()) {
+        admin->stop();
+    }
+    if (adminListener.joinable()) {
+        adminListener.join();
+    }
+}
+
+bool FeedServer::isRunning() const {
+    return server->is_running();
+}
+
+void FeedServer::registerRoutes() {
+    server->Get("/xrpc/app.bsky.feed.getFeedSkeleton", [this](const httplib::Request& req, httplib::Response& res) {
+        handleGetFeedSkeleton(req, res);
+    });
+    server->Get("/xrpc/app.bsky.feed.describeFeedGenerator", [this](const httplib::Request& req, httplib::Response& res) {
+        handleDescribeFeedGenerator(req, res);
+    });
+    server->Get("/.well-known/did.json", [this](const httplib::Request& req, httplib::Response& res) {
+        handleDidDocument(req, res);
+    });
+    server->Get("/ready", [this](const httplib::Request&, httplib::Response& res) {
+        res.status = isReady() ? 200 : 503;
+        res.set_content(nlohmann::json{{"ready", isReady()}}.dump(), "application/json");
+    });
+}
+
+// Process internals: kept off the public listener so they are not readable from the internet
+void FeedServer::registerAdminRoutes() {
+    admin->Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Metrics::global().render(), Metrics::CONTENT_TYPE);
+    });
+    admin->Get("/debug/trace", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(Tracing::exportChromeJson(), "application/json");
+    });
+}
+
+void FeedServer::handleGetFeedSkeleton(const httplib::Request& req, httplib::Response& res) {
+    static auto& latency = Metrics::global().histogram("bluesky_feed_skeleton_seconds",
+                                                       "getFeedSkeleton time until the body is handed to the socket");
+    const auto started = std::chrono::steady_clock::now();
+    Trace trace("getFeedSkeleton");
+    serveFeedSkeleton(req, res);
+    latency.recordSince(started);
+}
+
+void FeedServer::serveFeedSkeleton(const httplib::Request& req, httplib::Response& res) {
+    const auto feedUri = req.get_param_value("feed");
+    const auto slash = feedUri.find_last_of('/');
+    const auto feed = slash == std::string::npos ? nullptr : findFeed(feedUri.substr(slash + 1));
+    if (!feed) {
+        sendError(res, 400, "UnknownFeed", "Unknown feed: " + feedUri);
+        return;
+    }
+
+    size_t limit = DEFAULT_LIMIT;
+    try {
+        if (req.has_param("limit")) {
+            limit = std::stoul(req.get_param_value("limit"));
+        }
+    } catch (const std::exception&) {
+        sendError(res, 400, "InvalidRequest", "limit must be an integer");
+        return;
+    }
+    if (limit < 1 || limit > MAX_LIMIT) {
+        sendError(res, 400, "InvalidRequest", "limit must be between 1 and " + std::to_string(MAX_LIMIT));
+        return;
+    }
+
+    const auto cursorToken = req.get_param_value("cursor");
+    std::optional<FeedCursor> cursor;
+    if (!cursorToken.empty()) {
+        cursor = cursors.decode(cursorToken);
+        if (!cursor) {
+            sendError(res, 400, "InvalidRequest", "Malformed cursor");
+            return;
+        }
+    }
+
+    // The requester is only known from a valid service-auth token; anonymous requests are allowed
+    std::string viewer;
+    if (req.has_header("Authorization")) {
+        Span span("auth.verify");
+        const auto authorization = req.get_header_value("Authorization");
+        const auto token = ServiceAuth::bearerToken(authorization);
+        const auto issuer = auth && token ? auth->verify(*token, "app.bsky.feed.getFeedSkeleton") : std::nullopt;
+        if (!issuer) {
+            sendError(res, 401, "AuthenticationRequired", "Invalid service auth token");
+            return;
+        }
+        viewer = *issuer;
+    }
+
+    // Personalized pages differ per viewer, so they bypass the shared page cache.
+    // Otherwise the shared pre-rendered buffer is written straight to the socket instead of copied into res.body.
+    std::shared_ptr<const std::string> body;
+    if (feed->followingOnly()) {
+        if (viewer.empty()) {
+            sendError(res, 401, "AuthenticationRequired", "This feed requires a signed-in viewer");
+            return;
+        }
+        const auto followed = followsLookup ? followsLookup(viewer) : std::nullopt;
+        const std::vector<uint32_t> none;
+        Span rank("feed.rank");
+        const auto page = feed->page(cursor, limit, followed ? &*followed : &none);
+        rank.end();
+        Span render("skeleton.render");
+        body = std::make_shared<const std::string>(SkeletonPageCache::render(*feed, page, cursors));
+    } else {
+        body = cache.page(*feed, cursorToken, cursor, limit);
+    }
+    const auto size = body->size();
+    res.set_content_provider(size, "application/json",
+        [body = std::move(body)](const size_t position, const size_t length, httplib::DataSink& sink) {
+            return sink.write(body->data() + position, length);
+        });
+}
+
+void FeedServer::handleDescribeFeedGenerator(const httplib::Request&, httplib::Response& res) const {
+    nlohmann::json description = {{"did", serviceDid}, {"feeds", nlohmann::json::array()}};
+    {
+        std::shared_lock lock(feedsMutex);
+        for (const auto& [name, feed] : feeds) {
+            description["feeds"].push_back({{"uri", "at://" + publisherDid + "/app.bsky.feed.generator/" + name}});
+        }
+    }
+    res.set_content(description.dump(), "application/json");
+}
+
+// did:web service DIDs are resolved by fetching this document from the service's own host
+void FeedServer::handleDidDocument(const httplib::Request&, httplib::Response& res) const {
+    static constexpr std::string_view DID_WEB_PREFIX = "did:web:";
+    if (serviceDid.compare(0, DID_WEB_PREFIX.size(), DID_WEB_PREFIX) != 0) {
+        sendError(res, 404, "NotFound", "Service DID is not a did:web");
+        return;
+    }
+
+    const auto hostname = serviceDid.substr(DID_WEB_PREFIX.size());
+    const nlohmann::json document = {
+        {"@context", {"https://www.w3.org/ns/did/v1"}},
+        {"id", serviceDid},
+        {"service", {{
+            {"id", "#bsky_fg"},
+            {"type", "BskyFeedGenerator"},
+            {"serviceEndpoint", "https://" + hostname}
+        }}}
+    };
+    res.set_content(document.dump(), "application/json");
+}
+
+void FeedServer::sendError(httplib::Response& res, const int status, const std::string& error, const std::string& message) {
+    static auto& errors = Metrics::global().counter("bluesky_xrpc_errors_total",
+                                                    "XRPC requests answered with an error");
+    errors.add();
+    res.status = status;
+    res.set_content(nlohmann::json{{"error", error}, {"message", message}}.dump(), "application/json");
+}
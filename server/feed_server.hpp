@@ -0,0 +1,103 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef FEED_SERVER_H
+#define FEED_SERVER_H
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "skeleton_cache.hpp"
+
+class ServiceAuth;
+
+namespace httplib {
+class Server;
+struct Request;
+struct Response;
+}
+
+// Serves the feed generator XRPC endpoints (getFeedSkeleton, describeFeedGenerator), did.json and
+// readiness on /ready. The process metrics on /metrics and the sampled trace spans on /debug/trace are
+// only served by a separate admin listener, meant to be bound to localhost.
+class FeedServer {
+public:
+    // Sorted interned DIDs that a viewer follows; nullopt if their follow list is not loaded
+    using FollowsLookup = std::function<std::optional<std::vector<uint32_t>>(const std::string& viewerDid)>;
+
+    FeedServer(std::string serviceDid, std::string publisherDid, std::string cursorSecret);
+    ~FeedServer();
+
+    FeedServer(const FeedServer&) = delete;
+    FeedServer& operator=(const FeedServer&) = delete;
+
+    // Feeds are looked up by record key, e.g. at://<publisher>/app.bsky.feed.generator/<name>
+    void addFeed(std::shared_ptr<Feed> feed);
+    [[nodiscard]] std::shared_ptr<Feed> findFeed(const std::string& name) const;
+
+    // Verify requester JWTs; without this, personalized feeds reject every request
+    void setAuth(std::shared_ptr<ServiceAuth> serviceAuth) { auth = std::move(serviceAuth); }
+    void setFollowsLookup(FollowsLookup lookup) { followsLookup = std::move(lookup); }
+
+    // Bind and serve on a background thread; port 0 picks a free port. Returns false if binding fails.
+    bool start(const std::string& host, int port);
+
+    // Bind the admin endpoints the same way; independent of start()
+    bool startAdmin(const std::string& host, int port);
+
+    // Stops both listeners
+    void stop();
+
+    [[nodiscard]] bool isRunning() const;
+
+    // /ready answers 503 until the owner marks the service ready, and again once it starts draining
+    void setReady(const bool value) { ready.store(value, std::memory_order_relaxed); }
+    [[nodiscard]] bool isReady() const { return ready.load(std::memory_order_relaxed); }
+    [[nodiscard]] int port() const { return boundPort; }
+    [[nodiscard]] int adminPort() const { return boundAdminPort; }
+    [[nodiscard]] SkeletonPageCache& pageCache() { return cache; }
+
+private:
+    static constexpr size_t DEFAULT_LIMIT = 50;
+    static constexpr size_t MAX_LIMIT = 100;
+
+    std::string serviceDid;
+    std::string publisherDid;
+    std::unique_ptr<httplib::Server> server;
+    std::thread listener;
+    int boundPort = 0;
+    std::unique_ptr<httplib::Server> admin;
+    std::thread adminListener;
+    int boundAdminPort = 0;
+    std::atomic<bool> ready{false};
+
+    mutable std::shared_mutex feedsMutex;
+    std::unordered_map<std::string, std::shared_ptr<Feed>> feeds;
+    CursorCodec cursors;
+    SkeletonPageCache cache;
+    std::shared_ptr<ServiceAuth> auth;
+    FollowsLookup followsLookup;
+
+    void registerRoutes();
+    void registerAdminRoutes();
+    void handleGetFeedSkeleton(const httplib::Request& req, httplib::Response& res);
+    void serveFeedSkeleton(const httplib::Request& req, httplib::Response& res);
+    void handleDescribeFeedGenerator(const httplib::Request& req, httplib::Response& res) const;
+    void handleDidDocument(const httplib::Request& req, httplib::Response& res) const;
+
+    static int listen(httplib::Server& target, std::thread& thread, const std::string& host, int port,
+                      const std::string& label);
+    static void sendError(httplib::Response& res, int status, const std::string& error, const std::string& message);
+};
+
+#endif // FEED_SERVER_H
@@ -0,0 +1,149 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "skeleton_cache.hpp"
+#include <mutex>
+#include "../tools/metrics.hpp"
+#include "../tools/tracing.hpp"
+
+SkeletonPageCache::SkeletonPageCache(const CursorCodec& codec, const size_t cachedPages)
+    : codec(codec), pageLimit(cachedPages) {}
+
+// Escape the few characters that may not appear raw inside a JSON string
+static void appendJsonString(std::string& out, const std::string_view value) {
+    out += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static constexpr char HEX[] = "0123456789abcdef";
+                    out += "\\u00";
+                    out += HEX[(c >> 4) & 0xF];
+                    out += HEX[c & 0xF];
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+static std::string cacheKey(const size_t limit, const std::string_view cursorToken) {
+    auto key = std::to_string(limit);
+    key += '\n';
+    key += cursorToken;
+    return key;
+}
+
+// {"cursor":"<token>","feed":[{"post":"at://..."},...]}; the cursor is omitted on the last page
+std::string SkeletonPageCache::render(const Feed& feed, const Feed::Page& page, const CursorCodec& codec) {
+    std::string body;
+    body.reserve(64 + page.posts.size() * 96);
+
+    body += '{';
+    if (page.next) {
+        body += "\"cursor\":";
+        appendJsonString(body, codec.encode(*page.next));
+        body += ',';
+    }
+    body += "\"feed\":[";
+    for (size_t i = 0; i < page.posts.size(); ++i) {
+        if (i != 0) {
+            body += ',';
+        }
+        body += "{\"post\":";
+        appendJsonString(body, feed.postUri(page.posts[i]));
+        body += '}';
+    }
+    body += "]}";
+    return body;
+}
+
+SkeletonPageCache::Body SkeletonPageCache::page(const Feed& feed, const std::string_view cursorToken,
+                                                const std::optional<FeedCursor>& cursor, const size_t limit) {
+    static auto& hits = Metrics::global().counter("bluesky_skeleton_cache_hits_total",
+                                                  "Skeleton pages served from the pre-rendered cache");
+    static auto& misses = Metrics::global().counter("bluesky_skeleton_cache_misses_total",
+                                                    "Cacheable skeleton pages that had to be rendered");
+
+    // Read the epoch before the list so a concurrent change leaves the entry stale, never wrong
+    const auto epoch = feed.epoch();
+    const auto key = cacheKey(limit, cursorToken);
+
+    std::optional<size_t> depth;
+    {
+        Span lookup("cache.lookup");
+        std::shared_lock lock(mutex);
+        const auto pages = feeds.find(feed.name());
+        if (cursorToken.empty()) {
+            depth = 0;
+        } else if (pages != feeds.end()) {
+            if (const auto issued = pages->second.issuedDepth.find(key); issued != pages->second.issuedDepth.end()) {
+                depth = issued->second;
+            }
+        }
+
+        if (depth && *depth < pageLimit && pages != feeds.end() && pages->second.epoch == epoch) {
+            const auto it = pages->second.bodies.find(key);
+            if (it != pages->second.bodies.end()) {
+                hitCount.fetch_add(1, std::memory_order_relaxed);
+                hits.add();
+                return it->second;
+            }
+        }
+    }
+
+    Span rank("feed.rank");
+    const auto rendered = feed.page(cursor, limit);
+    rank.end();
+    Span rendering("skeleton.render");
+    auto body = std::make_shared<const std::string>(render(feed, rendered, codec));
+    rendering.end();
+    if (!depth || *depth >= pageLimit) {
+        return body;
+    }
+
+    missCount.fetch_add(1, std::memory_order_relaxed);
+    misses.add();
+    std::unique_lock lock(mutex);
+    auto& pages = feeds[feed.name()];
+    if (epoch < pages.epoch) {
+        return body; // A newer epoch was cached meanwhile; this page is already stale
+    }
+    if (epoch > pages.epoch) {
+        pages.bodies.clear();
+        pages.issuedDepth.clear();
+        pages.epoch = epoch;
+    }
+    if (pages.bodies.size() >= MAX_ISSUED_CURSORS) {
+        pages.bodies.clear();
+    }
+    pages.bodies[key] = body;
+
+    // Remember the cursor this page hands out so the next page can be cached too
+    if (rendered.next && *depth + 1 < pageLimit) {
+        if (pages.issuedDepth.size() >= MAX_ISSUED_CURSORS) {
+            pages.issuedDepth.clear();
+        }
+        pages.issuedDepth[cacheKey(limit, codec.encode(*rendered.next))] = *depth + 1;
+    }
+    return body;
+}
+
+void SkeletonPageCache::clear() {
+    std::unique_lock lock(mutex);
+    feeds.clear();
+}
+
+size_t SkeletonPageCache::size() {
+    std::shared_lock lock(mutex);
+    size_t total = 0;
+    for (const auto& [name, pages] : feeds) {
+        total += pages.bodies.size();
+    }
+    return total;
+}
@@ -0,0 +1,63 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef SKELETON_CACHE_H
+#define SKELETON_CACHE_H
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "../feed/feed.hpp"
+
+// Pre-rendered getFeedSkeleton response bodies for the first pages of each feed.
+// A page is re-rendered only when its feed's epoch has moved since it was rendered;
+// hits hand out a shared immutable buffer that the server writes to the socket as-is.
+// Deeper pages are cacheable only when their cursor was issued by a cached page.
+// Pages are grouped by feed, and rendering a page for a newer epoch drops every page of the older one.
+class SkeletonPageCache {
+public:
+    using Body = std::shared_ptr<const std::string>;
+
+    explicit SkeletonPageCache(const CursorCodec& codec, size_t cachedPages = 3);
+
+    // Body for the page after cursor (decoded from cursorToken by the caller)
+    Body page(const Feed& feed, std::string_view cursorToken, const std::optional<FeedCursor>& cursor, size_t limit);
+
+    // Render a page without consulting the cache
+    static std::string render(const Feed& feed, const Feed::Page& page, const CursorCodec& codec);
+
+    void clear();
+
+    // Cached bodies across all feeds
+    [[nodiscard]] size_t size();
+
+    [[nodiscard]] uint64_t hits() const { return hitCount.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t misses() const { return missCount.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t MAX_ISSUED_CURSORS = 16384;
+
+    // Pages of one feed, all rendered at the same epoch; keyed by limit and cursor token
+    struct FeedPages {
+        uint64_t epoch = 0;
+        std::unordered_map<std::string, Body> bodies;
+        std::unordered_map<std::string, size_t> issuedDepth; // Cursors we handed out -> page depth
+    };
+
+    const CursorCodec& codec;
+    const size_t pageLimit;
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, FeedPages> feeds;
+    std::atomic<uint64_t> hitCount{0};
+    std::atomic<uint64_t> missCount{0};
+};
+
+#endif // SKELETON_CACHE_H
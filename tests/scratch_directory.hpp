@@ -0,0 +1,36 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef SCRATCH_DIRECTORY_H
+#define SCRATCH_DIRECTORY_H
+
+#pragma once
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <string>
+
+// Runs a test binary from a directory under the system temp path, since Logging and Settings write log.txt
+// and settings.json to the working directory. Register once per binary with
+// testing::AddGlobalTestEnvironment(new ScratchDirectory("name")).
+class ScratchDirectory : public testing::Environment {
+public:
+    explicit ScratchDirectory(std::string name) : name(std::move(name)) {}
+
+    void SetUp() override {
+        const auto scratch = std::filesystem::temp_directory_path() / name;
+        std::filesystem::create_directories(scratch);
+        previous = std::filesystem::current_path();
+        std::filesystem::current_path(scratch);
+    }
+
+    void TearDown() override { std::filesystem::current_path(previous); }
+
+private:
+    std::string name;
+    std::filesystem::path previous;
+};
+
+#endif // SCRATCH_DIRECTORY_H
@@ -0,0 +1,128 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include "../ingest/backfill.hpp"
+#include "../mock/mock_xrpc_server.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/rate_limiter.hpp"
+#include "../tools/timestamp.hpp"
+#include "scratch_directory.hpp"
+
+[[maybe_unused]] static const auto* const scratch =
+    testing::AddGlobalTestEnvironment(new ScratchDirectory("bluesky_feed_backfill_test"));
+
+TEST(TimestampTest, ParsesRfc3339) {
+    EXPECT_EQ(Timestamp::parseIso8601("1970-01-01T00:00:00Z"), 0u);
+    EXPECT_EQ(Timestamp::parseIso8601("2024-02-29T12:00:00.5Z"), 1709208000500000u);
+    EXPECT_EQ(Timestamp::parseIso8601("2024-02-29T14:00:00.500+02:00"), 1709208000500000u);
+    EXPECT_EQ(Timestamp::parseIso8601("2024-02-29T12:00:00.123456789Z"), 1709208000123456u);
+    EXPECT_FALSE(Timestamp::parseIso8601("2024-02-29T12:00:00").has_value()); // No offset
+    EXPECT_FALSE(Timestamp::parseIso8601("2024-13-01T00:00:00Z").has_value());
+    EXPECT_FALSE(Timestamp::parseIso8601("yesterday").has_value());
+}
+
+TEST(TimestampTest, FormatsRfc3339InUtc) {
+    EXPECT_EQ(Timestamp::formatIso8601(0), "1970-01-01T00:00:00.000Z");
+    EXPECT_EQ(Timestamp::formatIso8601(1709208000500000), "2024-02-29T12:00:00.500Z");
+    EXPECT_EQ(Timestamp::parseIso8601(Timestamp::formatIso8601(1709208000123000)), 1709208000123000u);
+}
+
+TEST(RateLimiterTest, AllowsBurstThenLimits) {
+    RateLimiter limiter(1.0, 3);
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_TRUE(limiter.tryAcquire());
+    EXPECT_FALSE(limiter.tryAcquire());
+}
+
+TEST(RateLimiterTest, SpacesQueuedRequests) {
+    RateLimiter limiter(200.0, 1);
+    const auto started = RateLimiter::Clock::now();
+    for (int i = 0; i < 11; ++i) {
+        limiter.acquire();
+    }
+    // The first token is available immediately; the other ten wait 5ms each
+    EXPECT_GE(RateLimiter::Clock::now() - started, std::chrono::milliseconds(45));
+}
+
+TEST(RateLimiterTest, PauseBlocksUntilReset) {
+    RateLimiter limiter(1000.0, 10);
+    limiter.pauseUntil(RateLimiter::Clock::now() + std::chrono::milliseconds(30));
+    EXPECT_FALSE(limiter.tryAcquire());
+
+    const auto started = RateLimiter::Clock::now();
+    limiter.acquire();
+    EXPECT_GE(RateLimiter::Clock::now() - started, std::chrono::milliseconds(25));
+}
+
+TEST(BackfillTest, ConvertsPostRecords) {
+    const auto record = nlohmann::json::parse(R"({
+        "$type": "app.bsky.feed.post",
+        "text": "hello world",
+        "langs": ["en"],
+        "createdAt": "2024-02-29T12:00:00Z",
+        "reply": {"parent": {"uri": "at://did:plc:b/app.bsky.feed.post/3kabc"}},
+        "embed": {"$type": "app.bsky.embed.recordWithMedia",
+                  "record": {"record": {"uri": "at://did:plc:c/app.bsky.feed.post/3kdef"}}}
+    })");
+    const auto labels = nlohmann::json::parse(R"([{"val": "nsfw"}])");
+
+    const auto event = Backfill::eventFromPost("at://did:plc:a/app.bsky.feed.post/3kxyz", "bafy", "did:plc:a",
+                                               record, labels);
+    ASSERT_TRUE(event.has_value());
+    EXPECT_EQ(event->kind, EventKind::Post);
+    EXPECT_EQ(event->repo, "did:plc:a");
+    EXPECT_EQ(event->post.text, "hello world");
+    EXPECT_EQ(event->post.langs, std::vector<std::string>{"en"});
+    EXPECT_TRUE(event->post.isReply());
+    EXPECT_TRUE(event->post.isQuote());
+    EXPECT_TRUE(event->post.hasMedia);
+    EXPECT_EQ(event->post.labels, std::vector<std::string>{"nsfw"});
+    EXPECT_EQ(event->post.createdAtUs, 1709208000000000u);
+    EXPECT_EQ(event->time, std::chrono::system_clock::time_point(std::chrono::microseconds(1709208000000000)));
+}
+
+TEST(BackfillTest, RejectsRecordsThatAreNotPosts) {
+    const auto like = nlohmann::json::parse(R"({"$type": "app.bsky.feed.like"})");
+    EXPECT_FALSE(Backfill::eventFromPost("at://did:plc:a/app.bsky.feed.like/3k", "", "did:plc:a", like,
+                                         nlohmann::json::array()).has_value());
+
+    const auto malformed = nlohmann::json::parse(R"({"text": 42})");
+    EXPECT_FALSE(Backfill::eventFromPost("at://did:plc:a/app.bsky.feed.post/3k", "", "did:plc:a", malformed,
+                                         nlohmann::json::array()).has_value());
+}
+
+TEST(BackfillTest, AnAuthorThatThrowsOnlyFailsItself) {
+    MockXrpcServer mock;
+    HTTPSClient::trustCertificate(mock.certificatePem());
+    ASSERT_TRUE(mock.start());
+
+    Backfill::Options options;
+    options.host = mock.host();
+    options.parallelism = 1;
+    options.statePath = (std::filesystem::temp_directory_path() / "backfill_test_state.json").string();
+    std::filesystem::remove(options.statePath);
+
+    // The first author's posts make the sink throw, as a full or stopped pipeline would
+    std::string failing;
+    size_t posts = 0;
+    Backfill backfill(options, std::make_shared<RateLimiter>(1000.0, 100.0), [&](const IngestEvent& event) {
+        if (failing.empty()) {
+            failing = event.repo;
+        }
+        if (event.repo == failing) {
+            throw std::runtime_error("sink is closed");
+        }
+        ++posts;
+    });
+
+    const auto result = backfill.run({"broken.test", "fine.test"});
+    EXPECT_EQ(result.authorsFailed, 1u);
+    EXPECT_EQ(result.authorsCompleted, 1u);
+    EXPECT_GT(posts, 0u);
+    std::filesystem::remove(options.statePath);
+}
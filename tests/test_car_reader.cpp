@@ -0,0 +1,183 @@
+//
+// Created by jayian on 2/7/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "../ingest/car_reader.hpp"
+#include "../tools/dag_cbor.hpp"
+#include "../tools/varint.hpp"
+
+static std::string makeCid(const char fill) {
+    return std::string("\x01\x71\x12\x20", 4) + std::string(32, fill);
+}
+
+static std::string makeCar(const std::string& root, const std::vector<std::pair<std::string, std::string>>& blocks) {
+    std::string header;
+    DagCborWriter::appendMap(header, 2);
+    DagCborWriter::appendText(header, "roots");
+    DagCborWriter::appendArray(header, 1);
+    DagCborWriter::appendCid(header, root);
+    DagCborWriter::appendText(header, "version");
+    DagCborWriter::appendUnsigned(header, 1);
+
+    std::string car;
+    Varint::append(car, header.size());
+    car += header;
+    for (const auto& [cid, block] : blocks) {
+        Varint::append(car, cid.size() + block.size());
+        car += cid;
+        car += block;
+    }
+    return car;
+}
+
+static std::string makeRecord(const std::string& text) {
+    std::string out;
+    DagCborWriter::appendMap(out, 1);
+    DagCborWriter::appendText(out, "text");
+    DagCborWriter::appendText(out, text);
+    return out;
+}
+
+struct TreeEntry {
+    std::string key;
+    std::string value;
+    std::string tree;
+};
+
+// A tree node with prefix-compressed keys
+static std::string makeNode(const std::string& left, const std::vector<TreeEntry>& entries) {
+    std::string out;
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "e");
+    DagCborWriter::appendArray(out, entries.size());
+    std::string previous;
+    for (const auto& entry : entries) {
+        size_t prefix = 0;
+        while (prefix < previous.size() && prefix < entry.key.size() && previous[prefix] == entry.key[prefix]) {
+            ++prefix;
+        }
+        DagCborWriter::appendMap(out, 4);
+        DagCborWriter::appendText(out, "k");
+        DagCborWriter::appendBytes(out, entry.key.substr(prefix));
+        DagCborWriter::appendText(out, "p");
+        DagCborWriter::appendUnsigned(out, prefix);
+        DagCborWriter::appendText(out, "t");
+        if (entry.tree.empty()) {
+            DagCborWriter::appendNull(out);
+        } else {
+            DagCborWriter::appendCid(out, entry.tree);
+        }
+        DagCborWriter::appendText(out, "v");
+        DagCborWriter::appendCid(out, entry.value);
+        previous = entry.key;
+    }
+    DagCborWriter::appendText(out, "l");
+    if (left.empty()) {
+        DagCborWriter::appendNull(out);
+    } else {
+        DagCborWriter::appendCid(out, left);
+    }
+    return out;
+}
+
+static std::string makeCommit(const std::string& did, const std::string& data) {
+    std::string out;
+    DagCborWriter::appendMap(out, 3);
+    DagCborWriter::appendText(out, "did");
+    DagCborWriter::appendText(out, did);
+    DagCborWriter::appendText(out, "data");
+    DagCborWriter::appendCid(out, data);
+    DagCborWriter::appendText(out, "version");
+    DagCborWriter::appendUnsigned(out, 3);
+    return out;
+}
+
+// root: l=left, e=[post/b -> right]; left: [profile/self, post/a]; right: [post/c, follow/x]
+static std::string makeRepo(const std::string& leftBlock) {
+    const auto commit = makeCid('C'), root = makeCid('R'), left = makeCid('L'), right = makeCid('G');
+    const auto profile = makeCid('1'), postA = makeCid('2'), postB = makeCid('3'), postC = makeCid('4');
+    const auto follow = makeCid('5');
+
+    return makeCar(commit, {
+        {commit, makeCommit("did:plc:alice", root)},
+        {root, makeNode(left, {{"app.bsky.feed.post/b", postB, right}})},
+        {left, leftBlock.empty() ? makeNode("", {{"app.bsky.actor.profile/self", profile, ""},
+                                                 {"app.bsky.feed.post/a", postA, ""}})
+                                 : leftBlock},
+        {right, makeNode("", {{"app.bsky.feed.post/c", postC, ""}, {"app.bsky.graph.follow/x", follow, ""}})},
+        {profile, makeRecord("profile")},
+        {postA, makeRecord("a")},
+        {postB, makeRecord("b")},
+        {postC, makeRecord("c")},
+        {follow, makeRecord("follow")},
+    });
+}
+
+static std::vector<std::string> recordPaths(const CarReader& car, const std::string& collection) {
+    std::vector<std::string> paths;
+    car.forEachRecord(collection, [&](const std::string_view path, std::string_view, std::string_view) {
+        paths.emplace_back(path);
+    });
+    return paths;
+}
+
+TEST(CarReaderTest, IndexesBlocksInPlace) {
+    const auto data = makeRepo("");
+    const CarReader car(data);
+    EXPECT_EQ(car.blockCount(), 9u);
+    ASSERT_EQ(car.roots().size(), 1u);
+    EXPECT_EQ(car.roots().front(), makeCid('C'));
+    EXPECT_EQ(car.did(), "did:plc:alice");
+
+    const auto block = car.block(makeCid('3'));
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(*block, makeRecord("b"));
+    EXPECT_GE(block->data(), data.data());
+    EXPECT_LT(block->data(), data.data() + data.size());
+    EXPECT_FALSE(car.block(makeCid('z')).has_value());
+
+    size_t visited = 0;
+    car.forEachBlock([&](std::string_view, std::string_view) { ++visited; });
+    EXPECT_EQ(visited, 9u);
+}
+
+TEST(CarReaderTest, IteratesRecordsByCollection) {
+    const auto data = makeRepo("");
+    const CarReader car(data);
+    EXPECT_EQ(recordPaths(car, "app.bsky.feed.post"),
+              (std::vector<std::string>{"app.bsky.feed.post/a", "app.bsky.feed.post/b", "app.bsky.feed.post/c"}));
+    EXPECT_EQ(recordPaths(car, "app.bsky.graph.follow"), std::vector<std::string>{"app.bsky.graph.follow/x"});
+    EXPECT_TRUE(recordPaths(car, "app.bsky.feed.like").empty());
+}
+
+TEST(CarReaderTest, SkipsSubtreesOutsideTheCollection) {
+    // The left subtree holds only keys before "app.bsky.feed.post/b", so a follow scan never decodes it
+    const auto data = makeRepo(std::string("\xFF\xFF", 2));
+    const CarReader car(data);
+    EXPECT_EQ(recordPaths(car, "app.bsky.graph.follow"), std::vector<std::string>{"app.bsky.graph.follow/x"});
+    EXPECT_THROW(recordPaths(car, "app.bsky.actor.profile"), CarReaderException);
+}
+
+TEST(CarReaderTest, MapsFiles) {
+    const auto path = (std::filesystem::temp_directory_path() / "car_reader_test.car").string();
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << makeRepo("");
+    }
+    const auto car = CarReader::open(path);
+    EXPECT_EQ(car->blockCount(), 9u);
+    EXPECT_EQ(recordPaths(*car, "app.bsky.feed.post").size(), 3u);
+    std::filesystem::remove(path);
+
+    EXPECT_THROW(CarReader::open(path), CarReaderException);
+}
+
+TEST(CarReaderTest, RejectsMalformedArchives) {
+    const auto data = makeRepo("");
+    EXPECT_THROW(CarReader(std::string_view(data).substr(0, data.size() - 5)), CarReaderException);
+    EXPECT_THROW(CarReader(std::string_view("\x05\xA0", 2)), CarReaderException);
+}
@@ -0,0 +1,68 @@
+//
+// Created by jayian on 1/15/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <string>
+#include "../ingest/dedupe_filter.hpp"
+
+using namespace std::chrono_literals;
+
+static std::string postUri(const int i) {
+    return "at://did:plc:author" + std::to_string(i % 97) + "/app.bsky.feed.post/" + std::to_string(i);
+}
+
+TEST(DedupeFilterTest, DetectsReplays) {
+    DedupeFilter filter({10'000, 0.001, 2, 600s});
+    const auto now = DedupeFilter::Clock::now();
+
+    EXPECT_FALSE(filter.checkAndInsert(postUri(1), "bafycid1", now));
+    EXPECT_TRUE(filter.checkAndInsert(postUri(1), "bafycid1", now));
+    EXPECT_FALSE(filter.checkAndInsert(postUri(1), "bafycid2", now));
+    EXPECT_EQ(filter.duplicates(), 1u);
+}
+
+TEST(DedupeFilterTest, FalsePositiveRateStaysNearTarget) {
+    DedupeFilter filter({100'000, 0.001, 2, 600s});
+    const auto now = DedupeFilter::Clock::now();
+    for (int i = 0; i < 100'000; ++i) {
+        filter.checkAndInsert(postUri(i), now);
+    }
+
+    int falsePositives = 0;
+    for (int i = 100'000; i < 200'000; ++i) {
+        falsePositives += filter.probablyContains(postUri(i)) ? 1 : 0;
+    }
+    EXPECT_LT(falsePositives, 300); // 0.3% upper bound for a 0.1% target
+}
+
+TEST(DedupeFilterTest, RotationForgetsOldGenerations) {
+    DedupeFilter filter({1000, 0.01, 2, 600s});
+    const auto memory = filter.memoryBytes();
+    const auto now = DedupeFilter::Clock::now();
+
+    filter.checkAndInsert("old-event", now);
+    EXPECT_TRUE(filter.probablyContains("old-event"));
+
+    // Two window expiries push the first generation out of the ring
+    filter.checkAndInsert("second", now + 601s);
+    filter.checkAndInsert("third", now + 1202s);
+
+    EXPECT_FALSE(filter.probablyContains("old-event"));
+    EXPECT_TRUE(filter.probablyContains("second"));
+    EXPECT_EQ(filter.rotations(), 2u);
+    EXPECT_EQ(filter.memoryBytes(), memory);
+}
+
+TEST(DedupeFilterTest, RotatesWhenGenerationIsFull) {
+    DedupeFilter filter({100, 0.01, 3, 600s});
+    const auto now = DedupeFilter::Clock::now();
+    for (int i = 0; i < 1000; ++i) {
+        filter.checkAndInsert(postUri(i), now);
+    }
+
+    EXPECT_GE(filter.rotations(), 9u);
+    EXPECT_TRUE(filter.probablyContains(postUri(999)));
+    EXPECT_FALSE(filter.probablyContains(postUri(0)));
+}
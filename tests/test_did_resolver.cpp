@@ -0,0 +1,122 @@
+//
+// Created by jayian on 2/5/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include "../identity/did_resolver.hpp"
+
+static const std::string ALICE = "did:plc:alice";
+
+static nlohmann::json documentFor(const std::string& did, const std::string& key) {
+    return {
+        {"id", did},
+        {"alsoKnownAs", {"at://alice.test"}},
+        {"verificationMethod", {{{"id", did + "#atproto"}, {"type", "Multikey"}, {"publicKeyMultibase", key}}}},
+        {"service", {{{"id", "#atproto_pds"}, {"type", "AtprotoPersonalDataServer"}, {"serviceEndpoint", "https://pds.test"}}}}
+    };
+}
+
+static DidResolver::Options testOptions() {
+    DidResolver::Options options;
+    options.storePath = (std::filesystem::temp_directory_path() / "did_resolver_test.json").string();
+    return options;
+}
+
+TEST(DidDocumentTest, ExtractsAtprotoFields) {
+    const auto document = DidDocument::fromJson(ALICE, documentFor(ALICE, "zKey"));
+    ASSERT_TRUE(document.has_value());
+    EXPECT_EQ(document->handle, "alice.test");
+    EXPECT_EQ(document->signingKey, "zKey");
+    EXPECT_EQ(document->pdsEndpoint, "https://pds.test");
+
+    // A document served for a different DID is not trusted
+    EXPECT_FALSE(DidDocument::fromJson("did:plc:mallory", documentFor(ALICE, "zKey")).has_value());
+}
+
+TEST(DidResolverTest, CachesDocumentsAndFailures) {
+    std::atomic<int> fetches{0};
+    DidResolver resolver(testOptions(), [&](const std::string& did) -> std::optional<nlohmann::json> {
+        ++fetches;
+        if (did == ALICE) {
+            return documentFor(did, "zKey");
+        }
+        return std::nullopt;
+    }, nullptr);
+
+    ASSERT_NE(resolver.resolveDid(ALICE), nullptr);
+    EXPECT_EQ(resolver.resolveDid(ALICE)->signingKey, "zKey");
+    EXPECT_EQ(fetches, 1);
+
+    EXPECT_EQ(resolver.resolveDid("did:plc:missing"), nullptr);
+    EXPECT_EQ(resolver.resolveDid("did:plc:missing"), nullptr);
+    EXPECT_EQ(fetches, 2); // The failure is cached too
+
+    resolver.invalidate(ALICE);
+    EXPECT_NE(resolver.resolveDid(ALICE), nullptr);
+    EXPECT_EQ(fetches, 3);
+}
+
+TEST(DidResolverTest, CollapsesConcurrentMisses) {
+    std::atomic<int> fetches{0};
+    DidResolver resolver(testOptions(), [&](const std::string& did) -> std::optional<nlohmann::json> {
+        ++fetches;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return documentFor(did, "zKey");
+    }, nullptr);
+
+    std::vector<std::thread> threads;
+    std::atomic<int> resolved{0};
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&] {
+            if (resolver.resolveDid(ALICE)) {
+                ++resolved;
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(resolved, 8);
+    EXPECT_EQ(fetches, 1);
+}
+
+TEST(DidResolverTest, ResolvesActors) {
+    DidResolver resolver(testOptions(), nullptr, [](const std::string& handle) -> std::optional<std::string> {
+        return handle == "alice.test" ? std::optional<std::string>(ALICE) : std::nullopt;
+    });
+    EXPECT_EQ(resolver.resolveActor("alice.test"), ALICE);
+    EXPECT_EQ(resolver.resolveActor(ALICE), ALICE);
+    EXPECT_FALSE(resolver.resolveActor("nobody.test").has_value());
+}
+
+TEST(DidResolverTest, RestoresSavedEntries) {
+    const auto options = testOptions();
+    {
+        DidResolver resolver(options, [](const std::string& did) -> std::optional<nlohmann::json> {
+            return documentFor(did, "zKey");
+        }, [](const std::string&) { return std::optional<std::string>(ALICE); });
+        ASSERT_NE(resolver.resolveDid(ALICE), nullptr);
+        ASSERT_TRUE(resolver.resolveHandle("alice.test").has_value());
+        ASSERT_TRUE(resolver.save());
+    }
+
+    // A restarted resolver answers from the store without fetching
+    DidResolver restored(options, [](const std::string&) -> std::optional<nlohmann::json> {
+        ADD_FAILURE() << "unexpected fetch";
+        return std::nullopt;
+    }, [](const std::string&) -> std::optional<std::string> {
+        ADD_FAILURE() << "unexpected fetch";
+        return std::nullopt;
+    });
+    EXPECT_EQ(restored.load(), 2u);
+    ASSERT_NE(restored.resolveDid(ALICE), nullptr);
+    EXPECT_EQ(restored.resolveDid(ALICE)->pdsEndpoint, "https://pds.test");
+    EXPECT_EQ(restored.resolveHandle("alice.test"), ALICE);
+    EXPECT_EQ(restored.fetches(), 0u);
+
+    std::filesystem::remove(options.storePath);
+}
@@ -0,0 +1,97 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../feed/engagement_counters.hpp"
+#include "../tools/string_interner.hpp"
+
+TEST(StringInternerTest, AssignsDenseStableIds) {
+    StringInterner interner;
+    const auto a = interner.intern("at://did:plc:a/app.bsky.feed.post/1");
+    const auto b = interner.intern("at://did:plc:b/app.bsky.feed.post/2");
+
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 1u);
+    EXPECT_EQ(interner.intern("at://did:plc:a/app.bsky.feed.post/1"), a);
+    EXPECT_EQ(interner.lookup(b), "at://did:plc:b/app.bsky.feed.post/2");
+    EXPECT_EQ(interner.find("missing"), std::nullopt);
+    EXPECT_TRUE(interner.lookup(42).empty());
+}
+
+TEST(StringInternerTest, ConcurrentInterningAgrees) {
+    StringInterner interner;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&interner] {
+            for (int i = 0; i < 20000; ++i) {
+                interner.intern("did:plc:" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(interner.size(), 20000u);
+    const auto id = interner.find("did:plc:1234");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(interner.lookup(*id), "did:plc:1234");
+}
+
+TEST(EngagementCountersTest, ReadsOnlyMergedTotals) {
+    EngagementCounters counters;
+    counters.add(7, Engagement::Like);
+    counters.add(7, Engagement::Repost, 2);
+
+    EXPECT_EQ(counters.read(7).likes, 0);
+
+    EXPECT_EQ(counters.merge(), 1u);
+    EXPECT_EQ(counters.read(7).likes, 1);
+    EXPECT_EQ(counters.read(7).reposts, 2);
+    EXPECT_EQ(counters.read(8).likes, 0);
+
+    counters.add(7, Engagement::Like, -1);
+    counters.merge();
+    EXPECT_EQ(counters.read(7).likes, 0);
+}
+
+TEST(EngagementCountersTest, ConcurrentWritersMergeExactly) {
+    EngagementCounters counters;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&counters] {
+            for (uint32_t i = 0; i < 50000; ++i) {
+                counters.add(i % 100, Engagement::Like);
+                counters.add(i % 100, Engagement::Reply);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(counters.shardCount(), 4u); // One per writer thread
+
+    std::vector<int64_t> seen(100, 0);
+    counters.merge([&seen](const uint32_t postId, const EngagementCounts& totals) { seen[postId] = totals.likes; });
+
+    for (uint32_t postId = 0; postId < 100; ++postId) {
+        EXPECT_EQ(seen[postId], 2000);
+        EXPECT_EQ(counters.read(postId).replies, 2000);
+    }
+}
+
+TEST(EngagementCountersTest, BackgroundMergerDrainsOnStop) {
+    EngagementCounters counters;
+    counters.startMerging(std::chrono::milliseconds(5));
+    for (int i = 0; i < 1000; ++i) {
+        counters.add(1'000'000, Engagement::Repost);
+    }
+    counters.stopMerging();
+
+    EXPECT_EQ(counters.read(1'000'000).reposts, 1000);
+}
@@ -0,0 +1,201 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../feed/feed.hpp"
+#include "../tools/base32.hpp"
+
+TEST(Base32Test, RoundTripsAndSorts) {
+    const std::string bytes("\x00\x01\xfe\xff hello", 10);
+    EXPECT_EQ(Base32::decode(Base32::encode(bytes)), bytes);
+    EXPECT_LT(Base32::encode("\x01\x02"), Base32::encode("\x01\x03"));
+    EXPECT_FALSE(Base32::decode("not-base32!").has_value());
+}
+
+TEST(Base32Test, DecodesTidTimestamps) {
+    // 3jzfcijpj2z2a: a real post rkey from 2023
+    const auto timestamp = Base32::tidTimestamp("3jzfcijpj2z2a");
+    ASSERT_TRUE(timestamp.has_value());
+    EXPECT_GT(*timestamp, 1'672'531'200'000'000ULL);
+    EXPECT_LT(*timestamp, 1'704'067'200'000'000ULL);
+    EXPECT_FALSE(Base32::tidTimestamp("short").has_value());
+}
+
+TEST(CursorCodecTest, RoundTripsCompactTokens) {
+    const CursorCodec codec("secret");
+    const FeedCursor cursor{7, 1'736'000'000'000'000ULL, 0xdeadbeef};
+
+    const auto token = codec.encode(cursor);
+    EXPECT_LE(token.size(), 40u);
+    EXPECT_EQ(codec.decode(token), cursor);
+}
+
+TEST(CursorCodecTest, RejectsTamperedOrForeignTokens) {
+    const CursorCodec codec("secret");
+    auto token = codec.encode({1, 100, 5});
+
+    EXPECT_FALSE(CursorCodec("other-secret").decode(token).has_value());
+    token[3] = token[3] == 'a' ? 'b' : 'a';
+    EXPECT_FALSE(codec.decode(token).has_value());
+    EXPECT_FALSE(codec.decode("").has_value());
+    EXPECT_FALSE(codec.decode("abc").has_value());
+}
+
+TEST(FeedIndexTest, SeeksToPositionNewestFirst) {
+    FeedIndex index;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        index.insert(1000 + i * 10, i, i);
+    }
+    index.insert(1005, 77, 5000); // Late arrival lands in order
+    EXPECT_FALSE(index.insert(1005, 77, 5001));
+
+    const auto head = index.page(std::nullopt, 3);
+    ASSERT_EQ(head.size(), 3u);
+    EXPECT_EQ(head[0].postId, 999u);
+
+    const auto deep = index.page(FeedIndex::Position{1010, 1}, 2);
+    ASSERT_EQ(deep.size(), 2u);
+    EXPECT_EQ(deep[0].postId, 5000u);
+    EXPECT_EQ(deep[1].postId, 0u);
+
+    EXPECT_TRUE(index.remove(1005, 77));
+    EXPECT_EQ(index.size(), 1000u);
+}
+
+TEST(FeedIndexTest, EvictsOldestBeyondCapacity) {
+    FeedIndex index(3);
+    for (uint32_t i = 0; i < 5; ++i) {
+        index.insert(i, 0, i);
+    }
+    const auto all = index.page(std::nullopt, 10);
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all.back().postId, 2u);
+}
+
+TEST(FeedIndexTest, CompactionRewritesOneSliceWithoutDeadEntries) {
+    FeedIndex index(0, 2);
+    for (uint32_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(index.insert(i, 0, i, 0, i % 2));
+    }
+    const auto version = index.version();
+
+    size_t examined = 0;
+    const auto dead = [&examined](const FeedIndex::Entry& entry) {
+        ++examined;
+        return entry.postId % 4 == 0;
+    };
+    EXPECT_EQ(index.compact(0, dead), 25u);
+    EXPECT_EQ(examined, 50u);
+    EXPECT_EQ(index.size(), 75u);
+    EXPECT_GT(index.version(), version);
+    EXPECT_EQ(index.compact(0, dead), 0u);
+
+    const auto page = index.page(std::nullopt, 100);
+    ASSERT_EQ(page.size(), 75u);
+    for (size_t i = 1; i < page.size(); ++i) {
+        EXPECT_LT(page[i], page[i - 1]);
+        EXPECT_NE(page[i].postId % 4, 0u);
+    }
+}
+
+TEST(FeedIndexTest, SlicedPagesMergeNewestFirst) {
+    FeedIndex index(0, 4);
+    for (uint32_t i = 0; i < 100; ++i) {
+        index.insert(1000 + i, i, i, i % 7, i % 4 == 0 ? 3 : i % 3);
+    }
+    EXPECT_EQ(index.slices(), 4u);
+    EXPECT_EQ(index.size(), 100u);
+
+    std::vector<uint32_t> seen;
+    std::optional<FeedIndex::Position> after;
+    while (true) {
+        const auto page = index.page(after, 9);
+        if (page.empty()) {
+            break;
+        }
+        for (const auto& entry : page) {
+            seen.push_back(entry.postId);
+        }
+        after = FeedIndex::Position{page.back().key, page.back().tie};
+    }
+    ASSERT_EQ(seen.size(), 100u);
+    for (uint32_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(seen[i], 99 - i);
+    }
+
+    EXPECT_FALSE(index.remove(1010, 10, 0)); // Lives in another slice
+    EXPECT_TRUE(index.remove(1010, 10, 1));
+    EXPECT_EQ(index.size(), 99u);
+}
+
+TEST(FeedIndexTest, SlicedAuthorScanFindsEveryMatchAcrossPages) {
+    FeedIndex sliced(0, 3);
+    FeedIndex single;
+    for (uint32_t i = 0; i < 500; ++i) {
+        // Slices fill unevenly, so they stop at different depths for the same scan budget
+        const auto slice = i % 10 == 0 ? 0 : i % 2 + 1;
+        sliced.insert(1000 + i, 0, i, i % 13, slice);
+        single.insert(1000 + i, 0, i, i % 13);
+    }
+    const std::vector<uint32_t> authors{2, 5, 11};
+
+    const auto walk = [&](const FeedIndex& index) {
+        std::vector<uint32_t> found;
+        std::optional<FeedIndex::Position> after;
+        while (true) {
+            const auto scan = index.pageByAuthors(after, 5, authors, 30);
+            for (const auto& entry : scan.entries) {
+                found.push_back(entry.postId);
+            }
+            if (scan.exhausted || !scan.lastScanned) {
+                break;
+            }
+            after = scan.lastScanned;
+        }
+        return found;
+    };
+    const auto expected = walk(single);
+    EXPECT_EQ(expected.size(), 116u);
+    EXPECT_EQ(walk(sliced), expected);
+}
+
+TEST(FeedTest, ChronologicalCursorsWalkWholeFeed) {
+    const auto posts = std::make_shared<StringInterner>();
+    Feed feed("new", posts, FeedSort::Chronological);
+    for (int i = 0; i < 25; ++i) {
+        const auto uri = "at://did:plc:x/app.bsky.feed.post/" + std::to_string(i);
+        feed.index().insert(1000 + i, Feed::tieFor(uri), posts->intern(uri));
+    }
+
+    std::vector<uint32_t> seen;
+    std::optional<FeedCursor> cursor;
+    do {
+        const auto page = feed.page(cursor, 10);
+        seen.insert(seen.end(), page.posts.begin(), page.posts.end());
+        cursor = page.next;
+    } while (cursor);
+
+    ASSERT_EQ(seen.size(), 25u);
+    EXPECT_EQ(posts->lookup(seen.front()), "at://did:plc:x/app.bsky.feed.post/24");
+    EXPECT_EQ(posts->lookup(seen.back()), "at://did:plc:x/app.bsky.feed.post/0");
+}
+
+TEST(FeedTest, RankedCursorResumesAfterLastSeenPostWhenRankingMoves) {
+    const auto posts = std::make_shared<StringInterner>();
+    Feed feed("top", posts, FeedSort::Top);
+    const auto now = DecayedTopK::Clock::now();
+    for (int i = 0; i < 6; ++i) {
+        feed.ranking().add(posts->intern("post" + std::to_string(i)), 10 - i, now);
+    }
+
+    const auto first = feed.page(std::nullopt, 2);
+    ASSERT_TRUE(first.next.has_value());
+
+    // A new post jumps to the top; the second page still continues after post1
+    feed.ranking().add(posts->intern("fresh"), 100, now);
+    const auto second = feed.page(first.next, 2);
+    ASSERT_EQ(second.posts.size(), 2u);
+    EXPECT_EQ(posts->lookup(second.posts[0]), "post2");
+}
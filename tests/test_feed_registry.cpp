@@ -0,0 +1,543 @@
+//
+// Created by jayian on 1/27/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../feed/feed_registry.hpp"
+#include "../feed/index_compactor.hpp"
+#include "../ingest/ingest_pipeline.hpp"
+#include "../ingest/ingestor.hpp"
+
+namespace {
+    FeedDefinition definition(const std::string& name, std::vector<std::string> keywords, const FeedSort sort = FeedSort::Top) {
+        FeedDefinition result;
+        result.name = name;
+        result.sort = sort;
+        result.keywords = std::move(keywords);
+        return result;
+    }
+
+    Post post(const std::string& text, std::vector<std::string> langs = {}) {
+        Post result;
+        result.text = text;
+        result.langs = std::move(langs);
+        return result;
+    }
+
+    IngestEvent postEvent(const std::string& rkey, const std::string& text) {
+        IngestEvent event;
+        event.kind = EventKind::Post;
+        event.repo = "did:plc:author";
+        event.uri = "at://did:plc:author/app.bsky.feed.post/" + rkey;
+        event.cid = "cid-" + rkey;
+        event.post = post(text);
+        return event;
+    }
+
+    IngestEvent likeEvent(const std::string& rkey, const std::string& subject) {
+        IngestEvent event;
+        event.kind = EventKind::Like;
+        event.repo = "did:plc:liker";
+        event.uri = "at://did:plc:liker/app.bsky.feed.like/" + rkey;
+        event.cid = "cid-" + rkey;
+        event.subject = subject;
+        return event;
+    }
+
+    DedupeFilter::Options smallDedupe() {
+        DedupeFilter::Options options;
+        options.itemsPerGeneration = 1000;
+        return options;
+    }
+}
+
+TEST(FeedMaskTest, SetTestAndIterate) {
+    FeedMask mask;
+    EXPECT_FALSE(mask.any());
+    mask.set(3);
+    mask.set(64);
+    mask.set(255);
+    EXPECT_TRUE(mask.test(64));
+    EXPECT_FALSE(mask.test(63));
+    EXPECT_EQ(mask.count(), 3u);
+
+    std::vector<size_t> seen;
+    mask.forEach([&seen](const size_t index) { seen.push_back(index); });
+    EXPECT_EQ(seen, (std::vector<size_t>{3, 64, 255}));
+
+    FeedMask other;
+    other.set(64);
+    EXPECT_EQ(mask & other, other);
+}
+
+TEST(FeedRegistryTest, EvaluatesEveryFeedInOnePass) {
+    FeedRegistry registry(std::make_shared<StringInterner>());
+    registry.addFeed(definition("cats", {"cat", "kitten"}));
+    registry.addFeed(definition("dogs", {"dog"}));
+    registry.addFeed(definition("pets", {"cat", "dog"}));
+    registry.addFeed(definition("everything", {}));
+    registry.build();
+
+    const auto mask = registry.evaluate(post("My Cat met a dog today"));
+    EXPECT_TRUE(mask.test(0));
+    EXPECT_TRUE(mask.test(1));
+    EXPECT_TRUE(mask.test(2));
+    EXPECT_TRUE(mask.test(3));
+    EXPECT_EQ(mask.count(), 4u);
+
+    const auto none = registry.evaluate(post("nothing relevant"));
+    EXPECT_EQ(none.count(), 1u);
+    EXPECT_TRUE(none.test(3));
+}
+
+TEST(FeedRegistryTest, AppliesLanguageAndReplyFilters) {
+    FeedRegistry registry(std::make_shared<StringInterner>());
+    auto english = definition("english", {"news"});
+    english.langs = {"en"};
+    auto noReplies = definition("no-replies", {"news"});
+    noReplies.includeReplies = false;
+    registry.addFeed(english);
+    registry.addFeed(noReplies);
+    registry.build();
+
+    EXPECT_TRUE(registry.evaluate(post("news", {"en-US"})).test(0));
+    EXPECT_FALSE(registry.evaluate(post("news", {"de"})).test(0));
+    EXPECT_TRUE(registry.evaluate(post("news", {"de"})).test(1));
+
+    auto reply = post("news", {"en"});
+    reply.replyParent = "at://did:plc:x/app.bsky.feed.post/3jzfcijpj2z2a";
+    const auto mask = registry.evaluate(reply);
+    EXPECT_TRUE(mask.test(0));
+    EXPECT_FALSE(mask.test(1));
+}
+
+TEST(FeedRegistryTest, RejectsDuplicateNames) {
+    FeedRegistry registry(std::make_shared<StringInterner>());
+    registry.addFeed(definition("cats", {"cat"}));
+    EXPECT_THROW(registry.addFeed(definition("cats", {"kitten"})), FeedRegistryException);
+}
+
+TEST(FeedRegistryTest, FollowingOnlyFeedsAreChronological) {
+    const auto parsed = FeedDefinition::fromJson(nlohmann::json::parse(R"({"name": "mutuals", "following_only": true})"));
+    EXPECT_TRUE(parsed.followingOnly);
+    EXPECT_EQ(parsed.sort, FeedSort::Chronological);
+
+    // A top-ranked list is the same for every viewer, so it cannot honour following_only
+    FeedRegistry registry(std::make_shared<StringInterner>());
+    registry.addFeed(parsed);
+    auto ranked = FeedDefinition::fromJson(nlohmann::json::parse(R"({"name": "top", "following_only": true,
+                                                                     "sort": "top"})"));
+    EXPECT_THROW(registry.addFeed(ranked), FeedRegistryException);
+    EXPECT_EQ(registry.size(), 1u);
+}
+
+TEST(FeedRegistryTest, ParsesSettingsDefinition) {
+    const auto json = nlohmann::json::parse(R"({"name": "rust", "keywords": ["rustlang"], "sort": "new",
+                                                "langs": ["en"], "include_replies": false, "case_sensitive": true,
+                                                "rule": "not label:nsfw"})");
+    const auto parsed = FeedDefinition::fromJson(json);
+    EXPECT_EQ(parsed.name, "rust");
+    EXPECT_EQ(parsed.sort, FeedSort::Chronological);
+    EXPECT_EQ(parsed.langs, std::vector<std::string>{"en"});
+    EXPECT_FALSE(parsed.includeReplies);
+    EXPECT_FALSE(parsed.keywordOptions.caseInsensitive);
+    EXPECT_EQ(parsed.rule, "not label:nsfw");
+
+    FeedRegistry registry(std::make_shared<StringInterner>());
+    registry.addFeed(parsed);
+    registry.build();
+    auto labelled = post("rustlang", {"en"});
+    EXPECT_TRUE(registry.evaluate(labelled).test(0));
+    labelled.labels = {"nsfw"};
+    EXPECT_FALSE(registry.evaluate(labelled).test(0));
+    EXPECT_FALSE(registry.evaluate(post("RustLang", {"en"})).test(0)); // Case-sensitive keywords
+}
+
+TEST(IngestorTest, RoutesPostsAndEngagementToMatchingFeeds) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->addFeed(definition("cats-new", {"cat"}, FeedSort::Chronological));
+    registry->addFeed(definition("dogs", {"dog"}));
+    registry->build();
+
+    auto engagement = std::make_shared<EngagementCounters>();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), engagement, smallDedupe());
+
+    const auto cat = postEvent("3jzfcijpj2z2a", "a cat");
+    EXPECT_TRUE(ingestor.ingest(cat));
+    EXPECT_FALSE(ingestor.ingest(cat)); // Replayed event
+    EXPECT_FALSE(ingestor.ingest(postEvent("3jzfcijpj2z2b", "nothing")));
+
+    EXPECT_EQ(registry->feed(0)->index().size(), 1u);
+    EXPECT_EQ(registry->feed(1)->index().size(), 1u);
+    EXPECT_EQ(registry->feed(2)->index().size(), 0u);
+    EXPECT_EQ(registry->feed(0)->ranked()->size(), 1u);
+
+    EXPECT_TRUE(ingestor.ingest(likeEvent("3jzfcijpj2z2c", cat.uri)));
+    EXPECT_FALSE(ingestor.ingest(likeEvent("3jzfcijpj2z2d", "at://did:plc:x/app.bsky.feed.post/unknown")));
+    engagement->merge();
+    const auto postId = registry->postUris()->find(cat.uri);
+    ASSERT_TRUE(postId.has_value());
+    EXPECT_EQ(engagement->read(*postId).likes, 1);
+
+    const auto& stats = ingestor.stats();
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.postsMatched, 1u);
+    EXPECT_EQ(stats.postsUnmatched, 1u);
+    EXPECT_EQ(stats.engagements, 1u);
+}
+
+TEST(IngestorTest, DeletesRemovePostsFromEveryFeed) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->addFeed(definition("cats-new", {"cat"}, FeedSort::Chronological));
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+
+    const auto cat = postEvent("3jzfcijpj2z2a", "cat");
+    const auto kitten = postEvent("3jzfcijpj2z2b", "kitten cat");
+    ASSERT_TRUE(ingestor.ingest(cat));
+    ASSERT_TRUE(ingestor.ingest(kitten));
+    const auto epoch = registry->feed(0)->epoch();
+
+    IngestEvent removal;
+    removal.kind = EventKind::Delete;
+    removal.repo = cat.repo;
+    removal.uri = cat.uri;
+    EXPECT_TRUE(ingestor.ingest(removal));
+    EXPECT_FALSE(registry->membership(*registry->postUris()->find(cat.uri)).any());
+
+    // Gone from every page at once, while the index still holds it until compaction
+    const auto kittenId = *registry->postUris()->find(kitten.uri);
+    EXPECT_NE(registry->feed(0)->epoch(), epoch);
+    EXPECT_EQ(registry->feed(0)->page(std::nullopt, 10).posts, std::vector<uint32_t>{kittenId});
+    EXPECT_EQ(registry->feed(1)->page(std::nullopt, 10).posts, std::vector<uint32_t>{kittenId});
+    EXPECT_EQ(registry->feed(1)->index().size(), 2u);
+    EXPECT_EQ(registry->tombstones().postCount(), 1u);
+
+    IndexCompactor compactor(registry);
+    EXPECT_TRUE(compactor.due());
+    EXPECT_EQ(compactor.compact(), 2u);
+    EXPECT_EQ(registry->feed(0)->ranked()->size(), 1u);
+    EXPECT_EQ(registry->feed(1)->index().size(), 1u);
+    EXPECT_EQ(registry->tombstones().postCount(), 0u);
+    EXPECT_FALSE(compactor.due());
+    EXPECT_EQ(registry->feed(1)->page(std::nullopt, 10).posts, std::vector<uint32_t>{kittenId});
+}
+
+TEST(IngestorTest, UnlikesUndoTheirCount) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->build();
+    auto engagement = std::make_shared<EngagementCounters>();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), engagement, smallDedupe());
+
+    const auto cat = postEvent("3jzfcijpj2z2a", "cat");
+    ASSERT_TRUE(ingestor.ingest(cat));
+    const auto postId = *registry->postUris()->find(cat.uri);
+    const auto now = std::chrono::system_clock::now();
+    const auto unliked = registry->feed(0)->ranking().score(postId, now);
+
+    auto like = likeEvent("3jzfcijpj2z2c", cat.uri);
+    like.time = cat.time;
+    ASSERT_TRUE(ingestor.ingest(like));
+    EXPECT_GT(registry->feed(0)->ranking().score(postId, now), unliked);
+
+    IngestEvent unlike;
+    unlike.kind = EventKind::Delete;
+    unlike.repo = like.repo;
+    unlike.uri = like.uri;
+    EXPECT_TRUE(ingestor.ingest(unlike));
+    engagement->merge();
+    EXPECT_EQ(engagement->read(postId).likes, 0);
+    EXPECT_NEAR(registry->feed(0)->ranking().score(postId, now), unliked, 1e-9);
+    EXPECT_EQ(ingestor.stats().retractions, 1u);
+
+    // A like the Ingestor never counted cannot be undone
+    unlike.uri = "at://did:plc:liker/app.bsky.feed.like/unknown";
+    EXPECT_FALSE(ingestor.ingest(unlike));
+}
+
+TEST(IngestorTest, TakedownsHideEveryPostOfTheAccount) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>(), 2);
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->addFeed(definition("cats-new", {"cat"}, FeedSort::Chronological));
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+
+    auto other = postEvent("3jzfcijpj2z2c", "another cat");
+    other.repo = "did:plc:other";
+    other.uri = "at://did:plc:other/app.bsky.feed.post/3jzfcijpj2z2c";
+    ASSERT_TRUE(ingestor.ingest(postEvent("3jzfcijpj2z2a", "cat")));
+    ASSERT_TRUE(ingestor.ingest(postEvent("3jzfcijpj2z2b", "cat again")));
+    ASSERT_TRUE(ingestor.ingest(other));
+    const auto otherId = *registry->postUris()->find(other.uri);
+
+    IngestEvent takedown;
+    takedown.kind = EventKind::Takedown;
+    takedown.repo = "did:plc:author";
+    EXPECT_TRUE(ingestor.ingest(takedown));
+    EXPECT_FALSE(ingestor.ingest(takedown));
+    EXPECT_EQ(ingestor.stats().takedowns, 1u);
+    for (const auto& feed : registry->feeds()) {
+        EXPECT_EQ(feed->page(std::nullopt, 10).posts, std::vector<uint32_t>{otherId}) << feed->name();
+    }
+
+    IndexCompactor compactor(registry);
+    EXPECT_TRUE(compactor.due());
+    EXPECT_EQ(compactor.compact(), 4u);
+    EXPECT_FALSE(compactor.due());
+    EXPECT_EQ(registry->feed(0)->ranked()->size(), 1u);
+    EXPECT_EQ(registry->feed(1)->index().size(), 1u);
+    EXPECT_EQ(compactor.stats().entriesPurged, 4u);
+}
+
+TEST(IngestorTest, UnfollowsFromTheStreamReachTheFollowGraph) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>(), 2);
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->build();
+    const auto actorDids = std::make_shared<StringInterner>();
+    const auto follows = std::make_shared<FollowGraph>();
+    const auto viewer = actorDids->intern("did:plc:viewer");
+    const auto carol = actorDids->intern("did:plc:carol");
+    follows->setFollows(viewer, {carol});
+
+    std::vector<std::unique_ptr<Ingestor>> ingestors;
+    for (int i = 0; i < 2; ++i) {
+        ingestors.push_back(std::make_unique<Ingestor>(registry, actorDids, std::make_shared<EngagementCounters>(),
+                                                       smallDedupe(), follows));
+    }
+    IngestPipeline::Options options;
+    options.shards = 2;
+    IngestPipeline pipeline(options, [&ingestors](const size_t shard, const IngestEvent& event) {
+        ingestors[shard]->ingest(event);
+    });
+    pipeline.start();
+
+    IngestEvent follow;
+    follow.kind = EventKind::Follow;
+    follow.repo = "did:plc:viewer";
+    follow.uri = "at://did:plc:viewer/app.bsky.graph.follow/3jzfcijpj2z2a";
+    follow.cid = "cid-follow";
+    follow.subject = "did:plc:bob";
+    pipeline.pushEvent(follow);
+    auto other = follow; // By an account whose list was never fetched
+    other.repo = "did:plc:stranger";
+    other.uri = "at://did:plc:stranger/app.bsky.graph.follow/3jzfcijpj2z2b";
+    pipeline.pushEvent(other);
+
+    IngestEvent unfollow;
+    unfollow.kind = EventKind::Delete;
+    unfollow.repo = follow.repo;
+    unfollow.uri = follow.uri;
+    pipeline.pushEvent(unfollow);
+    unfollow.uri = other.uri;
+    unfollow.repo = other.repo;
+    pipeline.pushEvent(unfollow);
+    pipeline.stop();
+
+    const auto bob = actorDids->find("did:plc:bob");
+    ASSERT_TRUE(bob.has_value());
+    EXPECT_FALSE(follows->follows(viewer, *bob));
+    EXPECT_TRUE(follows->follows(viewer, carol));
+    EXPECT_EQ(ingestors[0]->stats().unfollows + ingestors[1]->stats().unfollows, 1u);
+}
+
+TEST(IngestorTest, ReinstatedAccountsAreServedAgain) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}, FeedSort::Chronological));
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+    ASSERT_TRUE(ingestor.ingest(postEvent("3jzfcijpj2z2a", "cat")));
+
+    IngestEvent account;
+    account.kind = EventKind::Takedown;
+    account.repo = "did:plc:author";
+    ASSERT_TRUE(ingestor.ingest(account));
+    EXPECT_TRUE(registry->feed(0)->page(std::nullopt, 10).posts.empty());
+    const auto epoch = registry->feed(0)->epoch();
+
+    account.kind = EventKind::Reinstate;
+    EXPECT_TRUE(ingestor.ingest(account));
+    EXPECT_FALSE(ingestor.ingest(account));
+    EXPECT_EQ(ingestor.stats().reinstatements, 1u);
+    EXPECT_NE(registry->feed(0)->epoch(), epoch);
+    EXPECT_EQ(registry->feed(0)->page(std::nullopt, 10).posts.size(), 1u);
+}
+
+TEST(IndexCompactorTest, WaitsForTheTombstoneRatio) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}, FeedSort::Chronological));
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(ingestor.ingest(postEvent("post" + std::to_string(i), "cat")));
+    }
+
+    IndexCompactor::Options options;
+    options.threshold = 0.25;
+    IndexCompactor compactor(options, registry);
+    IngestEvent removal;
+    removal.kind = EventKind::Delete;
+    removal.repo = "did:plc:author";
+    for (int i = 0; i < 3; ++i) {
+        removal.uri = "at://did:plc:author/app.bsky.feed.post/post" + std::to_string(i);
+        ASSERT_TRUE(ingestor.ingest(removal));
+        EXPECT_EQ(compactor.due(), i == 2) << i;
+    }
+
+    // Pages step over the gaps and still come back full
+    const auto page = registry->feed(0)->page(std::nullopt, 10);
+    EXPECT_EQ(page.posts.size(), 7u);
+    EXPECT_FALSE(page.next.has_value());
+    const auto first = registry->feed(0)->page(std::nullopt, 4);
+    ASSERT_TRUE(first.next.has_value());
+    EXPECT_EQ(registry->feed(0)->page(first.next, 4).posts.size(), 3u);
+}
+
+TEST(IndexCompactorTest, PublishesTopRankingsOnTheRefreshInterval) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+    const auto older = postEvent("3jzfcijpj2z2a", "a cat");
+    ASSERT_TRUE(ingestor.ingest(older));
+    ASSERT_TRUE(ingestor.ingest(postEvent("3jzfcijpj2z2b", "another cat")));
+
+    const auto feed = registry->feed(0);
+    const auto before = feed->ranked();
+    const auto epoch = feed->epoch();
+    const auto olderId = registry->postUris()->find(older.uri);
+    ASSERT_TRUE(olderId.has_value());
+    feed->ranking().add(*olderId, 100, DecayedTopK::Clock::now());
+    EXPECT_EQ(feed->ranked(), before);
+    EXPECT_EQ(feed->epoch(), epoch);
+
+    IndexCompactor::Options options;
+    options.rankingInterval = std::chrono::seconds(0);
+    IndexCompactor(options, registry).refreshRankings();
+    EXPECT_NE(feed->epoch(), epoch);
+    EXPECT_EQ(feed->ranked()->front(), *olderId);
+}
+
+TEST(IndexCompactorTest, ReleasesMembershipsOfEvictedPosts) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    auto small = definition("cats", {"cat"}, FeedSort::Chronological);
+    small.capacity = 1; // Indexes keep capacity * 100 entries
+    registry->addFeed(small);
+    registry->build();
+    Ingestor ingestor(registry, std::make_shared<StringInterner>(), std::make_shared<EngagementCounters>(),
+                      smallDedupe());
+    for (int i = 0; i < 300; ++i) {
+        ASSERT_TRUE(ingestor.ingest(postEvent("post" + std::to_string(i), "cat")));
+    }
+    ASSERT_EQ(registry->feed(0)->index().size(), 100u);
+    EXPECT_EQ(registry->membershipCount(), 300u);
+
+    // Posts must be missing from every index in two passes in a row before they are released
+    IndexCompactor compactor(registry);
+    EXPECT_TRUE(compactor.due());
+    compactor.compact();
+    EXPECT_EQ(registry->membershipCount(), 300u);
+    compactor.compact();
+    EXPECT_EQ(registry->membershipCount(), 100u);
+    EXPECT_EQ(compactor.stats().membershipsReleased, 200u);
+    EXPECT_FALSE(compactor.due());
+}
+
+TEST(IngestorTest, FollowsByAuthorsWhoAreNotViewersInternNothing) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->build();
+    const auto actorDids = std::make_shared<StringInterner>();
+    Ingestor ingestor(registry, actorDids, std::make_shared<EngagementCounters>(), smallDedupe(),
+                      std::make_shared<FollowGraph>());
+    ASSERT_TRUE(ingestor.ingest(postEvent("3jzfcijpj2z2a", "a cat")));
+    ASSERT_TRUE(actorDids->find("did:plc:author").has_value());
+
+    IngestEvent follow;
+    follow.kind = EventKind::Follow;
+    follow.repo = "did:plc:author";
+    follow.uri = "at://did:plc:author/app.bsky.graph.follow/3jzfcijpj2z2b";
+    follow.cid = "cid-follow";
+    follow.subject = "did:plc:someone";
+    EXPECT_FALSE(ingestor.ingest(follow));
+    EXPECT_FALSE(actorDids->find("did:plc:someone").has_value());
+}
+
+TEST(IngestorTest, FollowRecordsOfEvictedViewersAreSwept) {
+    auto registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+    registry->addFeed(definition("cats", {"cat"}));
+    registry->build();
+    const auto actorDids = std::make_shared<StringInterner>();
+    const auto follows = std::make_shared<FollowGraph>();
+    const auto evicted = actorDids->intern("did:plc:evicted");
+    const auto viewer = actorDids->intern("did:plc:viewer");
+    follows->setFollows(evicted, {});
+    follows->setFollows(viewer, {});
+    auto dedupe = smallDedupe();
+    dedupe.falsePositiveRate = 1e-9; // No follow may be dropped as a duplicate here
+    Ingestor ingestor(registry, actorDids, std::make_shared<EngagementCounters>(), dedupe, follows);
+
+    const auto follow = [](const std::string& repo, const int i) {
+        IngestEvent event;
+        event.kind = EventKind::Follow;
+        event.repo = repo;
+        event.uri = "at://" + repo + "/app.bsky.graph.follow/" + std::to_string(i);
+        event.cid = "cid-" + std::to_string(i);
+        event.subject = "did:plc:subject" + std::to_string(i);
+        return event;
+    };
+    for (int i = 0; i < 500; ++i) {
+        ASSERT_TRUE(ingestor.ingest(follow("did:plc:evicted", i)));
+    }
+    follows->removeViewer(evicted);
+    for (int i = 0; i < 600; ++i) {
+        ASSERT_TRUE(ingestor.ingest(follow("did:plc:viewer", i)));
+    }
+    EXPECT_EQ(ingestor.followRecordCount(), 600u); // Swept when the map reached a dedupe generation
+
+    IngestEvent unfollow;
+    unfollow.kind = EventKind::Delete;
+    unfollow.repo = "did:plc:viewer";
+    unfollow.uri = follow("did:plc:viewer", 7).uri;
+    EXPECT_TRUE(ingestor.ingest(unfollow));
+    EXPECT_FALSE(follows->follows(viewer, *actorDids->find("did:plc:subject7")));
+    EXPECT_EQ(ingestor.followRecordCount(), 599u);
+}
+
+TEST(TombstonesTest, MarksPostsAndAuthors) {
+    Tombstones tombstones;
+    StringInterner uris;
+    const auto a = uris.intern("at://did:plc:a/app.bsky.feed.post/1");
+    const auto b = uris.intern("at://did:plc:b/app.bsky.feed.post/1");
+
+    EXPECT_TRUE(tombstones.markPost(a));
+    EXPECT_FALSE(tombstones.markPost(a));
+    EXPECT_TRUE(tombstones.markPost(70000)); // In a second chunk
+    EXPECT_EQ(tombstones.posts(), (std::vector<uint32_t>{a, 70000}));
+    EXPECT_TRUE(tombstones.removed(a, uris));
+    EXPECT_FALSE(tombstones.removed(b, uris));
+
+    EXPECT_TRUE(tombstones.markAuthor("did:plc:b"));
+    EXPECT_TRUE(tombstones.removed(b, uris));
+    EXPECT_EQ(Tombstones::authorOf("at://did:plc:b/app.bsky.feed.post/1"), "did:plc:b");
+
+    tombstones.clearPosts({a, 70000});
+    EXPECT_EQ(tombstones.postCount(), 0u);
+    EXPECT_FALSE(tombstones.postRemoved(a));
+    EXPECT_EQ(tombstones.version(), 3u);
+
+    EXPECT_EQ(tombstones.authorDids(), std::vector<std::string>{"did:plc:b"});
+    EXPECT_TRUE(tombstones.unmarkAuthor("did:plc:b"));
+    EXPECT_FALSE(tombstones.unmarkAuthor("did:plc:b"));
+    EXPECT_FALSE(tombstones.removed(b, uris));
+    EXPECT_EQ(tombstones.authorCount(), 0u);
+    EXPECT_EQ(tombstones.version(), 4u);
+}
@@ -0,0 +1,108 @@
+//
+// Created by jayian on 1/29/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../feed/feed_rule.hpp"
+
+namespace {
+    Post post(const std::string& text, std::vector<std::string> langs = {}, const std::string& author = "did:plc:a") {
+        Post result;
+        result.text = text;
+        result.langs = std::move(langs);
+        result.authorDid = author;
+        return result;
+    }
+
+    bool matches(const std::string& rule, const Post& candidate) {
+        RuleProgram program;
+        const auto entry = program.add(FeedRule::parse(rule));
+        program.build();
+        RuleProgram::Evaluation evaluation;
+        program.begin(evaluation, candidate);
+        return program.matches(entry, evaluation);
+    }
+}
+
+TEST(FeedRuleTest, EmptyRuleMatchesEverything) {
+    EXPECT_EQ(FeedRule::parse("  ").type, RuleNode::Type::All);
+    EXPECT_TRUE(matches("", post("anything")));
+}
+
+TEST(FeedRuleTest, EvaluatesPredicatesAndCombinators) {
+    const auto english = post("Learning Rust today", {"en-US"});
+    EXPECT_TRUE(matches("rust", english));
+    EXPECT_TRUE(matches("lang:en and rust", english));
+    EXPECT_TRUE(matches("lang:en rust", english)); // Implicit and
+    EXPECT_FALSE(matches("lang:de and rust", english));
+    EXPECT_TRUE(matches("lang:de,en && (go || rust)", english));
+    EXPECT_FALSE(matches("not rust", english));
+    EXPECT_TRUE(matches("!is:reply", english));
+    EXPECT_TRUE(matches("\"learning rust\"", english));
+    EXPECT_TRUE(matches("keyword:\"learning rust\"", english));
+    EXPECT_FALSE(matches("keyword:rus", english));
+    EXPECT_TRUE(matches("contains:rus", english));
+    EXPECT_TRUE(matches("author:did:plc:b,did:plc:a", english));
+    EXPECT_FALSE(matches("author:did:plc:b", english));
+
+    auto reply = post("rust", {"en"});
+    reply.replyParent = "at://did:plc:b/app.bsky.feed.post/3jzfcijpj2z2a";
+    reply.labels = {"nsfw"};
+    reply.hasMedia = true;
+    EXPECT_TRUE(matches("is:reply and has:media", reply));
+    EXPECT_FALSE(matches("rust and not (is:quote or label:nsfw,spam)", reply));
+    EXPECT_TRUE(matches("not not label:nsfw", reply));
+}
+
+TEST(FeedRuleTest, ReportsSyntaxErrors) {
+    EXPECT_THROW(FeedRule::parse("(rust"), FeedRuleException);
+    EXPECT_THROW(FeedRule::parse("rust and"), FeedRuleException);
+    EXPECT_THROW(FeedRule::parse("colour:red"), FeedRuleException);
+    EXPECT_THROW(FeedRule::parse("lang:"), FeedRuleException);
+    EXPECT_THROW(FeedRule::parse("\"unterminated"), FeedRuleException);
+    EXPECT_THROW(FeedRule::parse("rust)"), FeedRuleException);
+}
+
+TEST(FeedRuleTest, SharesPredicatesAcrossRules) {
+    RuleProgram program;
+    const auto first = program.add(FeedRule::parse("lang:en and (rust or cargo)"));
+    const auto second = program.add(FeedRule::parse("rust and not is:reply"));
+    const auto third = program.add(FeedRule::parse("(rust or rust) and lang:EN"));
+    program.build();
+
+    // lang:en, rust, cargo, is:reply
+    EXPECT_EQ(program.predicateCount(), 4u);
+
+    RuleProgram::Evaluation evaluation;
+    const auto candidate = post("cargo build", {"en"});
+    program.begin(evaluation, candidate);
+    EXPECT_TRUE(program.matches(first, evaluation));
+    EXPECT_FALSE(program.matches(second, evaluation));
+    EXPECT_FALSE(program.matches(third, evaluation));
+}
+
+TEST(FeedRuleTest, ReusedEvaluationStartsFreshForEachPost) {
+    RuleProgram program;
+    const auto rule = program.add(FeedRule::parse("(rust or cargo) and not is:reply"));
+    program.build();
+
+    // Results from the previous post, keyword hits included, must not carry over
+    RuleProgram::Evaluation evaluation;
+    const auto posts = {post("rust and cargo", {"en"}), post("nothing here", {"en"}), post("cargo", {"en"})};
+    std::vector<bool> matched;
+    for (const auto& candidate : posts) {
+        program.begin(evaluation, candidate);
+        matched.push_back(program.matches(rule, evaluation));
+    }
+    EXPECT_EQ(matched, (std::vector<bool>{true, false, true}));
+}
+
+TEST(FeedRuleTest, OrdersCheapPredicatesFirst) {
+    // The flag test is emitted first, so it is the entry point and the keyword test comes after it
+    RuleProgram program;
+    const auto entry = program.add(FeedRule::parse("rust and not is:reply"));
+    program.build();
+    EXPECT_EQ(program.instructionCount(), 2u);
+    EXPECT_EQ(entry, 1u);
+}
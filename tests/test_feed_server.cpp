@@ -0,0 +1,171 @@
+//
+// Created by jayian on 1/17/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <set>
+#include "../cpp-httplib/httplib.h"
+#include "../feed/feed.hpp"
+#include "../nlohmann/json.hpp"
+#include "../server/feed_server.hpp"
+#include "../tools/metrics.hpp"
+#include "../tools/tracing.hpp"
+
+static std::shared_ptr<Feed> makeFeed(const std::shared_ptr<StringInterner>& posts, const int count) {
+    auto feed = std::make_shared<Feed>("test", posts, FeedSort::Top, 100);
+    const auto now = DecayedTopK::Clock::now();
+    for (int i = 0; i < count; ++i) {
+        const auto postId = posts->intern("at://did:plc:x/app.bsky.feed.post/" + std::to_string(i));
+        feed->ranking().add(postId, i + 1, now);
+    }
+    return feed;
+}
+
+static const CursorCodec CODEC("test-secret");
+
+TEST(SkeletonPageCacheTest, RendersPagesWithCursor) {
+    const auto posts = std::make_shared<StringInterner>();
+    const auto feed = makeFeed(posts, 3);
+
+    const auto firstPage = feed->page(std::nullopt, 2);
+    const auto first = nlohmann::json::parse(SkeletonPageCache::render(*feed, firstPage, CODEC));
+    ASSERT_EQ(first["feed"].size(), 2u);
+    EXPECT_EQ(first["feed"][0]["post"], "at://did:plc:x/app.bsky.feed.post/2");
+
+    const auto cursor = CODEC.decode(first["cursor"].get<std::string>());
+    ASSERT_TRUE(cursor.has_value());
+    const auto last = nlohmann::json::parse(SkeletonPageCache::render(*feed, feed->page(cursor, 2), CODEC));
+    EXPECT_FALSE(last.contains("cursor"));
+    ASSERT_EQ(last["feed"].size(), 1u);
+    EXPECT_EQ(last["feed"][0]["post"], "at://did:plc:x/app.bsky.feed.post/0");
+}
+
+TEST(SkeletonPageCacheTest, ReRendersOnlyWhenEpochMoves) {
+    const auto posts = std::make_shared<StringInterner>();
+    const auto feed = makeFeed(posts, 5);
+    SkeletonPageCache cache(CODEC, 2);
+
+    const auto first = cache.page(*feed, "", std::nullopt, 2);
+    const auto second = cache.page(*feed, "", std::nullopt, 2);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(cache.hits(), 1u);
+    EXPECT_EQ(cache.misses(), 1u);
+
+    // The cursor handed out by a cached page makes the second page cacheable as well
+    const auto token = nlohmann::json::parse(*first)["cursor"].get<std::string>();
+    cache.page(*feed, token, CODEC.decode(token), 2);
+    cache.page(*feed, token, CODEC.decode(token), 2);
+    EXPECT_EQ(cache.hits(), 2u);
+
+    EXPECT_EQ(cache.size(), 2u);
+
+    // Engagement alone keeps serving the cached page; the next ranking rebuild moves the epoch
+    const auto now = DecayedTopK::Clock::now();
+    feed->ranking().add(posts->intern("at://did:plc:x/app.bsky.feed.post/new"), 100, now);
+    EXPECT_EQ(cache.page(*feed, "", std::nullopt, 2).get(), first.get());
+
+    feed->ranking().rebuild(now);
+    const auto third = cache.page(*feed, "", std::nullopt, 2);
+    EXPECT_NE(first.get(), third.get());
+    EXPECT_NE(third->find("post/new"), std::string::npos);
+
+    // Rendering at the new epoch dropped both pages of the old one
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(FeedServerTest, ServesSkeletonOverHttp) {
+    const auto posts = std::make_shared<StringInterner>();
+    FeedServer server("did:web:feeds.example.com", "did:plc:publisher", "test-secret");
+    server.addFeed(makeFeed(posts, 3));
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+
+    httplib::Client client("127.0.0.1", server.port());
+    const auto skeleton = client.Get(
+        "/xrpc/app.bsky.feed.getFeedSkeleton?feed=at://did:plc:publisher/app.bsky.feed.generator/test&limit=2");
+    ASSERT_TRUE(skeleton);
+    EXPECT_EQ(skeleton->status, 200);
+    EXPECT_EQ(nlohmann::json::parse(skeleton->body)["feed"].size(), 2u);
+
+    const auto badCursor = client.Get(
+        "/xrpc/app.bsky.feed.getFeedSkeleton?feed=at://did:plc:publisher/app.bsky.feed.generator/test&cursor=zzzz");
+    ASSERT_TRUE(badCursor);
+    EXPECT_EQ(badCursor->status, 400);
+
+    const auto unknown = client.Get("/xrpc/app.bsky.feed.getFeedSkeleton?feed=at://x/app.bsky.feed.generator/nope");
+    ASSERT_TRUE(unknown);
+    EXPECT_EQ(unknown->status, 400);
+    EXPECT_EQ(nlohmann::json::parse(unknown->body)["error"], "UnknownFeed");
+
+    const auto describe = client.Get("/xrpc/app.bsky.feed.describeFeedGenerator");
+    ASSERT_TRUE(describe);
+    EXPECT_EQ(nlohmann::json::parse(describe->body)["feeds"][0]["uri"],
+              "at://did:plc:publisher/app.bsky.feed.generator/test");
+
+    // Process internals are only on the admin listener
+    const auto publicMetrics = client.Get("/metrics");
+    ASSERT_TRUE(publicMetrics);
+    EXPECT_EQ(publicMetrics->status, 404);
+    ASSERT_TRUE(server.startAdmin("127.0.0.1", 0));
+    EXPECT_NE(server.adminPort(), server.port());
+    httplib::Client adminClient("127.0.0.1", server.adminPort());
+    const auto metrics = adminClient.Get("/metrics");
+    ASSERT_TRUE(metrics);
+    EXPECT_EQ(metrics->get_header_value("Content-Type"), Metrics::CONTENT_TYPE);
+    EXPECT_NE(metrics->body.find("# TYPE bluesky_feed_skeleton_seconds histogram"), std::string::npos);
+    EXPECT_NE(metrics->body.find("bluesky_feed_skeleton_seconds_count 3\n"), std::string::npos);
+    EXPECT_NE(metrics->body.find("bluesky_xrpc_errors_total 2\n"), std::string::npos);
+
+    server.stop();
+    EXPECT_FALSE(server.isRunning());
+    EXPECT_FALSE(adminClient.Get("/metrics"));
+}
+
+TEST(FeedServerTest, TracesSampledRequests) {
+    const auto posts = std::make_shared<StringInterner>();
+    FeedServer server("did:web:feeds.example.com", "did:plc:publisher", "test-secret");
+    server.addFeed(makeFeed(posts, 3));
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+    Tracing::clear();
+    Tracing::setSampleEvery(1);
+
+    httplib::Client client("127.0.0.1", server.port());
+    ASSERT_TRUE(client.Get(
+        "/xrpc/app.bsky.feed.getFeedSkeleton?feed=at://did:plc:publisher/app.bsky.feed.generator/test&limit=2"));
+    Tracing::setSampleEvery(0);
+
+    const auto publicTrace = client.Get("/debug/trace");
+    ASSERT_TRUE(publicTrace);
+    EXPECT_EQ(publicTrace->status, 404);
+    ASSERT_TRUE(server.startAdmin("127.0.0.1", 0));
+    const auto trace = httplib::Client("127.0.0.1", server.adminPort()).Get("/debug/trace");
+    ASSERT_TRUE(trace);
+    const auto exported = nlohmann::json::parse(trace->body);
+    std::set<std::string> names;
+    for (const auto& event : exported["traceEvents"]) {
+        names.insert(event["name"].get<std::string>());
+    }
+    EXPECT_EQ(names, (std::set<std::string>{"getFeedSkeleton", "cache.lookup", "feed.rank", "skeleton.render"}));
+}
+
+TEST(FeedServerTest, ReportsReadiness) {
+    FeedServer server("did:web:feeds.example.com", "did:plc:publisher", "test-secret");
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+
+    httplib::Client client("127.0.0.1", server.port());
+    const auto starting = client.Get("/ready");
+    ASSERT_TRUE(starting);
+    EXPECT_EQ(starting->status, 503);
+    EXPECT_FALSE(nlohmann::json::parse(starting->body)["ready"].get<bool>());
+
+    server.setReady(true);
+    const auto ready = client.Get("/ready");
+    ASSERT_TRUE(ready);
+    EXPECT_EQ(ready->status, 200);
+
+    // Draining: still serving, but no longer taking new traffic
+    server.setReady(false);
+    const auto draining = client.Get("/ready");
+    ASSERT_TRUE(draining);
+    EXPECT_EQ(draining->status, 503);
+}
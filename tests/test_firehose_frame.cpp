@@ -0,0 +1,339 @@
+//
+// Created by jayian on 2/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../ingest/firehose_frame.hpp"
+#include "../tools/base32.hpp"
+#include "../tools/dag_cbor.hpp"
+#include "../tools/varint.hpp"
+
+static const std::string REPO = "did:plc:alice";
+
+// A CIDv1 (dag-cbor, sha2-256) with every digest byte set to fill
+static std::string makeCid(const char fill) {
+    return std::string("\x01\x71\x12\x20", 4) + std::string(32, fill);
+}
+
+static std::string makeCar(const std::vector<std::pair<std::string, std::string>>& blocks) {
+    std::string header;
+    DagCborWriter::appendMap(header, 2);
+    DagCborWriter::appendText(header, "roots");
+    DagCborWriter::appendArray(header, 0);
+    DagCborWriter::appendText(header, "version");
+    DagCborWriter::appendUnsigned(header, 1);
+
+    std::string car;
+    Varint::append(car, header.size());
+    car += header;
+    for (const auto& [cid, block] : blocks) {
+        Varint::append(car, cid.size() + block.size());
+        car += cid;
+        car += block;
+    }
+    return car;
+}
+
+static std::string makeStrongRef(const std::string& uri) {
+    std::string out;
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "cid");
+    DagCborWriter::appendText(out, "bafyreib");
+    DagCborWriter::appendText(out, "uri");
+    DagCborWriter::appendText(out, uri);
+    return out;
+}
+
+static std::string makePost() {
+    std::string out;
+    DagCborWriter::appendMap(out, 7);
+    DagCborWriter::appendText(out, "text");
+    DagCborWriter::appendText(out, "Hello firehose");
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, "app.bsky.feed.post");
+    DagCborWriter::appendText(out, "embed");
+    DagCborWriter::appendMap(out, 3);
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, "app.bsky.embed.recordWithMedia");
+    DagCborWriter::appendText(out, "media");
+    DagCborWriter::appendMap(out, 1);
+    DagCborWriter::appendText(out, "images");
+    DagCborWriter::appendArray(out, 0);
+    DagCborWriter::appendText(out, "record");
+    DagCborWriter::appendMap(out, 1);
+    DagCborWriter::appendText(out, "record");
+    out += makeStrongRef("at://did:plc:bob/app.bsky.feed.post/quoted");
+    DagCborWriter::appendText(out, "langs");
+    DagCborWriter::appendArray(out, 2);
+    DagCborWriter::appendText(out, "en");
+    DagCborWriter::appendText(out, "ja");
+    DagCborWriter::appendText(out, "reply");
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "root");
+    out += makeStrongRef("at://did:plc:bob/app.bsky.feed.post/root");
+    DagCborWriter::appendText(out, "parent");
+    out += makeStrongRef("at://did:plc:bob/app.bsky.feed.post/parent");
+    DagCborWriter::appendText(out, "labels");
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, "com.atproto.label.defs#selfLabels");
+    DagCborWriter::appendText(out, "values");
+    DagCborWriter::appendArray(out, 1);
+    DagCborWriter::appendMap(out, 1);
+    DagCborWriter::appendText(out, "val");
+    DagCborWriter::appendText(out, "nsfw");
+    DagCborWriter::appendText(out, "createdAt");
+    DagCborWriter::appendText(out, "2024-02-29T12:00:00.000Z");
+    return out;
+}
+
+static std::string makeLike(const std::string& subject) {
+    std::string out;
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, "app.bsky.feed.like");
+    DagCborWriter::appendText(out, "subject");
+    out += makeStrongRef(subject);
+    return out;
+}
+
+static void appendOp(std::string& out, const std::string& action, const std::string& path, const std::string& cid) {
+    DagCborWriter::appendMap(out, 3);
+    DagCborWriter::appendText(out, "cid");
+    if (cid.empty()) {
+        DagCborWriter::appendNull(out);
+    } else {
+        DagCborWriter::appendCid(out, cid);
+    }
+    DagCborWriter::appendText(out, "path");
+    DagCborWriter::appendText(out, path);
+    DagCborWriter::appendText(out, "action");
+    DagCborWriter::appendText(out, action);
+}
+
+static std::string makeCommitFrame() {
+    const auto postCid = makeCid('p');
+    const auto likeCid = makeCid('l');
+
+    std::string frame;
+    DagCborWriter::appendMap(frame, 2);
+    DagCborWriter::appendText(frame, "t");
+    DagCborWriter::appendText(frame, "#commit");
+    DagCborWriter::appendText(frame, "op");
+    DagCborWriter::appendInteger(frame, 1);
+
+    DagCborWriter::appendMap(frame, 7);
+    DagCborWriter::appendText(frame, "ops");
+    DagCborWriter::appendArray(frame, 4);
+    appendOp(frame, "create", "app.bsky.feed.post/3kgc2m3kxbs2a", postCid);
+    appendOp(frame, "create", "app.bsky.feed.like/3kgc2m3kxbs2b", likeCid);
+    appendOp(frame, "create", "app.bsky.actor.profile/self", makeCid('x'));
+    appendOp(frame, "delete", "app.bsky.feed.post/3kgc2m3kxbs29", "");
+    DagCborWriter::appendText(frame, "rev");
+    DagCborWriter::appendText(frame, "3kgc2m3kxbs2c");
+    DagCborWriter::appendText(frame, "seq");
+    DagCborWriter::appendUnsigned(frame, 123456789);
+    DagCborWriter::appendText(frame, "repo");
+    DagCborWriter::appendText(frame, REPO);
+    DagCborWriter::appendText(frame, "blobs");
+    DagCborWriter::appendArray(frame, 0);
+    DagCborWriter::appendText(frame, "blocks");
+    DagCborWriter::appendBytes(frame, makeCar({{likeCid, makeLike("at://did:plc:bob/app.bsky.feed.post/liked")},
+                                               {postCid, makePost()}}));
+    DagCborWriter::appendText(frame, "tooBig");
+    DagCborWriter::appendBool(frame, false);
+    return frame;
+}
+
+TEST(DagCborTest, ReadsScalars) {
+    std::string data;
+    DagCborWriter::appendUnsigned(data, 23);
+    DagCborWriter::appendUnsigned(data, 500);
+    DagCborWriter::appendInteger(data, -1'000'000);
+    DagCborWriter::appendUnsigned(data, UINT64_MAX);
+    DagCborWriter::appendText(data, "text");
+    DagCborWriter::appendBool(data, true);
+    DagCborWriter::appendNull(data);
+    data += std::string("\xFB\x3F\xF8\x00\x00\x00\x00\x00\x00", 9); // 1.5
+
+    DagCborReader reader(data);
+    EXPECT_EQ(reader.readUnsigned(), 23u);
+    EXPECT_EQ(reader.readInteger(), 500);
+    EXPECT_EQ(reader.readInteger(), -1'000'000);
+    EXPECT_EQ(reader.readUnsigned(), UINT64_MAX);
+    EXPECT_EQ(reader.readText(), "text");
+    EXPECT_TRUE(reader.readBool());
+    EXPECT_TRUE(reader.readNull());
+    EXPECT_EQ(reader.readFloat(), 1.5);
+    EXPECT_TRUE(reader.atEnd());
+}
+
+TEST(DagCborTest, StringsAreViewsIntoTheInput) {
+    std::string data;
+    DagCborWriter::appendText(data, "in place");
+    DagCborReader reader(data);
+    const auto text = reader.readText();
+    EXPECT_EQ(text.data(), data.data() + 1);
+}
+
+TEST(DagCborTest, SkipsNestedItems) {
+    const auto post = makePost();
+    std::string data = post;
+    DagCborWriter::appendUnsigned(data, 7);
+
+    DagCborReader reader(data);
+    reader.skip();
+    EXPECT_EQ(reader.offset(), post.size());
+    EXPECT_EQ(reader.readUnsigned(), 7u);
+}
+
+TEST(DagCborTest, RejectsNonDagCbor) {
+    // Indefinite-length text, a half-precision float, a non-CID tag and a truncated string
+    for (const auto& data : {std::string("\x7F\x61\x61\xFF", 4), std::string("\xF9\x3C\x00", 3),
+                             std::string("\xC1\x00", 2), std::string("\x65\x61\x62", 3)}) {
+        DagCborReader reader(data);
+        EXPECT_THROW(reader.skip(), DagCborException);
+    }
+
+    std::string deep(DagCborReader::MAX_DEPTH + 2, '\x81');
+    deep += '\x00';
+    DagCborReader reader(deep);
+    EXPECT_THROW(reader.skip(), DagCborException);
+}
+
+TEST(FirehoseFrameTest, FormatsCids) {
+    EXPECT_EQ(Base32::encodeMultibase("foobar"), "bmzxw6ytboi"); // RFC 4648 test vector
+}
+
+TEST(FirehoseFrameTest, DecodesCommit) {
+    const auto frame = makeCommitFrame();
+    std::string_view body;
+    const auto header = FirehoseFrame::decodeHeader(frame, body);
+    ASSERT_TRUE(header.has_value());
+    EXPECT_EQ(header->op, 1);
+    EXPECT_EQ(header->type, "#commit");
+
+    CommitFrame commit;
+    ASSERT_TRUE(FirehoseFrame::decodeCommit(body, commit));
+    EXPECT_EQ(commit.seq, 123456789);
+    EXPECT_EQ(commit.repo, REPO);
+    EXPECT_EQ(commit.rev, "3kgc2m3kxbs2c");
+    EXPECT_FALSE(commit.tooBig);
+    ASSERT_EQ(commit.ops.size(), 4u);
+    EXPECT_EQ(commit.ops[0].collection(), "app.bsky.feed.post");
+    EXPECT_EQ(commit.ops[0].cid, makeCid('p'));
+    EXPECT_TRUE(commit.ops[3].cid.empty());
+
+    const auto block = FirehoseFrame::findBlock(commit.blocks, makeCid('p'));
+    ASSERT_TRUE(block.has_value());
+    EXPECT_EQ(*block, makePost());
+    EXPECT_FALSE(FirehoseFrame::findBlock(commit.blocks, makeCid('z')).has_value());
+}
+
+TEST(FirehoseFrameTest, DecodesAccountEvents) {
+    std::string body;
+    DagCborWriter::appendMap(body, 5);
+    DagCborWriter::appendText(body, "seq");
+    DagCborWriter::appendUnsigned(body, 42);
+    DagCborWriter::appendText(body, "did");
+    DagCborWriter::appendText(body, REPO);
+    DagCborWriter::appendText(body, "time");
+    DagCborWriter::appendText(body, "2024-11-20T10:00:00.000Z");
+    DagCborWriter::appendText(body, "active");
+    DagCborWriter::appendBool(body, false);
+    DagCborWriter::appendText(body, "status");
+    DagCborWriter::appendText(body, "takendown");
+
+    AccountFrame account;
+    ASSERT_TRUE(FirehoseFrame::decodeAccount(body, account));
+    EXPECT_EQ(account.seq, 42);
+    EXPECT_EQ(account.did, REPO);
+    EXPECT_FALSE(account.active);
+    EXPECT_EQ(account.status, "takendown");
+
+    std::vector<IngestEvent> events;
+    EXPECT_EQ(FirehoseFrame::events(account, [&](const IngestEvent& event) { events.push_back(event); }), 1u);
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].kind, EventKind::Takedown);
+    EXPECT_EQ(events[0].repo, REPO);
+
+    // Deactivating one's own account is not a takedown
+    account.status = "deactivated";
+    EXPECT_EQ(FirehoseFrame::events(account, [](const IngestEvent&) {}), 0u);
+
+    account.active = true;
+    account.status = {};
+    events.clear();
+    EXPECT_EQ(FirehoseFrame::events(account, [&](const IngestEvent& event) { events.push_back(event); }), 1u);
+    ASSERT_EQ(events.size(), 1u);
+    EXPECT_EQ(events[0].kind, EventKind::Reinstate);
+}
+
+TEST(FirehoseFrameTest, DecodesPostRecords) {
+    Post post;
+    ASSERT_TRUE(FirehoseFrame::decodePost(makePost(), post));
+    EXPECT_EQ(post.text, "Hello firehose");
+    EXPECT_EQ(post.langs, (std::vector<std::string>{"en", "ja"}));
+    EXPECT_EQ(post.labels, std::vector<std::string>{"nsfw"});
+    EXPECT_EQ(post.replyParent, "at://did:plc:bob/app.bsky.feed.post/parent");
+    EXPECT_EQ(post.quoteUri, "at://did:plc:bob/app.bsky.feed.post/quoted");
+    EXPECT_TRUE(post.hasMedia);
+    EXPECT_EQ(post.createdAtUs, 1709208000000000u);
+
+    EXPECT_FALSE(FirehoseFrame::decodePost(makeLike("at://x"), post));
+    EXPECT_FALSE(FirehoseFrame::decodePost(makePost().substr(0, 20), post));
+}
+
+TEST(FirehoseFrameTest, RejectsDeeplyNestedEmbedRecords) {
+    // {"record": {"record": ...}} nested far past any real embed, small enough to fit in one frame
+    std::string out;
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "text");
+    DagCborWriter::appendText(out, "nested");
+    DagCborWriter::appendText(out, "embed");
+    DagCborWriter::appendMap(out, 2);
+    DagCborWriter::appendText(out, "$type");
+    DagCborWriter::appendText(out, "app.bsky.embed.record");
+    for (int i = 0; i < 300'000; ++i) {
+        DagCborWriter::appendText(out, "record");
+        DagCborWriter::appendMap(out, 1);
+    }
+    DagCborWriter::appendText(out, "uri");
+    DagCborWriter::appendText(out, "at://did:plc:bob/app.bsky.feed.post/deep");
+
+    Post post;
+    EXPECT_FALSE(FirehoseFrame::decodePost(out, post));
+}
+
+TEST(FirehoseFrameTest, EmitsIngestEvents) {
+    const auto frame = makeCommitFrame();
+    std::string_view body;
+    ASSERT_TRUE(FirehoseFrame::decodeHeader(frame, body).has_value());
+    CommitFrame commit;
+    ASSERT_TRUE(FirehoseFrame::decodeCommit(body, commit));
+
+    std::vector<IngestEvent> events;
+    EXPECT_EQ(FirehoseFrame::events(commit, [&](const IngestEvent& event) { events.push_back(event); }), 3u);
+    ASSERT_EQ(events.size(), 3u);
+
+    EXPECT_EQ(events[0].kind, EventKind::Post);
+    EXPECT_EQ(events[0].uri, "at://did:plc:alice/app.bsky.feed.post/3kgc2m3kxbs2a");
+    EXPECT_EQ(events[0].cid.substr(0, 1), "b");
+    EXPECT_EQ(events[0].post.authorDid, REPO);
+    EXPECT_EQ(events[0].post.text, "Hello firehose");
+
+    EXPECT_EQ(events[1].kind, EventKind::Like);
+    EXPECT_EQ(events[1].subject, "at://did:plc:bob/app.bsky.feed.post/liked");
+
+    EXPECT_EQ(events[2].kind, EventKind::Delete);
+    EXPECT_EQ(events[2].uri, "at://did:plc:alice/app.bsky.feed.post/3kgc2m3kxbs29");
+}
+
+TEST(FirehoseFrameTest, RejectsTruncatedFrames) {
+    const auto frame = makeCommitFrame();
+    std::string_view body;
+    ASSERT_TRUE(FirehoseFrame::decodeHeader(frame, body).has_value());
+    CommitFrame commit;
+    EXPECT_FALSE(FirehoseFrame::decodeCommit(body.substr(0, body.size() / 2), commit));
+}
@@ -0,0 +1,152 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <map>
+#include <set>
+#include "../ingest/firehose_frame.hpp"
+#include "../loadgen/firehose_generator.hpp"
+#include "../loadgen/replay_benchmark.hpp"
+
+TEST(ZipfDistributionTest, SkewsTowardsLowRanks) {
+    ZipfDistribution zipf(1'000'000, 1.0);
+    std::mt19937_64 random(7);
+    size_t top = 0;
+    uint64_t highest = 0;
+    for (int i = 0; i < 100'000; ++i) {
+        const auto rank = zipf(random);
+        ASSERT_GE(rank, 1u);
+        ASSERT_LE(rank, 1'000'000u);
+        top += rank <= 10 ? 1 : 0;
+        highest = std::max(highest, rank);
+    }
+    // With s = 1, ranks 1-10 carry H(10) / H(1e6), about 20% of the mass
+    EXPECT_GT(top, 17'000u);
+    EXPECT_LT(top, 23'000u);
+    EXPECT_GT(highest, 100'000u); // The long tail is still reached
+}
+
+TEST(FirehoseGeneratorTest, FramesDecodeLikeTheFirehose) {
+    FirehoseGenerator::Options options;
+    options.accounts = 1000;
+    options.recentPosts = 500;
+    options.events = 5000;
+    options.takedownsPerMillion = 2000;
+    FirehoseGenerator generator(options);
+
+    std::map<EventKind, size_t> kinds;
+    std::set<std::string> langs;
+    std::map<std::string, size_t> byRepo;
+    size_t replies = 0;
+    CommitFrame commit;
+    AccountFrame account;
+    for (uint64_t i = 0; i < options.events; ++i) {
+        const auto frame = generator.next();
+        std::string_view body;
+        const auto header = FirehoseFrame::decodeHeader(frame, body);
+        ASSERT_TRUE(header);
+        const auto sink = [&](const IngestEvent& event) {
+            ++kinds[event.kind];
+            ++byRepo[event.repo];
+            if (event.kind == EventKind::Post) {
+                langs.insert(event.post.langs.begin(), event.post.langs.end());
+                replies += event.post.isReply() ? 1 : 0;
+            }
+        };
+        if (header->type == "#account") {
+            ASSERT_TRUE(FirehoseFrame::decodeAccount(body, account));
+            EXPECT_EQ(account.seq, static_cast<int64_t>(i + 1));
+            FirehoseFrame::events(account, sink);
+        } else {
+            ASSERT_EQ(header->type, "#commit");
+            ASSERT_TRUE(FirehoseFrame::decodeCommit(body, commit));
+            EXPECT_EQ(commit.seq, static_cast<int64_t>(i + 1));
+            EXPECT_EQ(FirehoseFrame::events(commit, sink), 1u) << "frame " << i;
+        }
+    }
+
+    // Every kind of record shows up in about its configured share
+    EXPECT_NEAR(static_cast<double>(kinds[EventKind::Like]) / options.events, 0.6, 0.05);
+    EXPECT_NEAR(static_cast<double>(kinds[EventKind::Post]) / options.events, 0.2, 0.05);
+    EXPECT_GT(kinds[EventKind::Repost], 0u);
+    EXPECT_GT(kinds[EventKind::Follow], 0u);
+    EXPECT_GT(kinds[EventKind::Delete], 0u);
+    EXPECT_GT(kinds[EventKind::Takedown], 0u);
+    EXPECT_GT(replies, 0u);
+    EXPECT_GE(langs.size(), 5u);
+
+    // A few accounts write much of the stream
+    EXPECT_GT(byRepo[FirehoseGenerator::didOf(0)], options.events / 20);
+}
+
+TEST(FirehoseGeneratorTest, SameSeedSameRecords) {
+    FirehoseGenerator::Options options;
+    options.accounts = 100;
+    FirehoseGenerator first(options), second(options);
+    options.seed = 2;
+    FirehoseGenerator other(options);
+
+    CommitFrame a, b, c;
+    size_t differing = 0;
+    for (int i = 0; i < 200; ++i) {
+        const auto x = first.next(), y = second.next(), z = other.next();
+        std::string_view bodyX, bodyY, bodyZ;
+        FirehoseFrame::decodeHeader(x, bodyX);
+        FirehoseFrame::decodeHeader(y, bodyY);
+        FirehoseFrame::decodeHeader(z, bodyZ);
+        FirehoseFrame::decodeCommit(bodyX, a);
+        FirehoseFrame::decodeCommit(bodyY, b);
+        FirehoseFrame::decodeCommit(bodyZ, c);
+        ASSERT_EQ(a.repo, b.repo);
+        ASSERT_EQ(a.ops.size(), b.ops.size());
+        if (!a.ops.empty()) {
+            EXPECT_EQ(a.ops[0].collection(), b.ops[0].collection());
+        }
+        differing += a.repo != c.repo ? 1 : 0;
+    }
+    EXPECT_GT(differing, 100u);
+}
+
+TEST(ReplayBenchmarkTest, ReplaysAFileThroughThePipeline) {
+    const auto path = testing::TempDir() + "replay_benchmark_test.bin";
+    FirehoseGenerator::Options generate;
+    generate.accounts = 2000;
+    generate.recentPosts = 1000;
+    generate.events = 20'000;
+    const auto bytes = FirehoseGenerator::writeFile(path, generate);
+    EXPECT_GT(bytes, generate.events * 100);
+
+    ReplayBenchmark::Options options;
+    options.path = path;
+    options.pipeline.shards = 2;
+    const auto report = ReplayBenchmark(options).run();
+    std::remove(path.c_str());
+
+    EXPECT_EQ(report.frames, generate.events);
+    EXPECT_EQ(report.bytes + report.frames * 2 + ReplayFile::MAGIC.size(), bytes); // Lengths are 2-byte varints
+    EXPECT_EQ(report.malformed, 0u);
+    EXPECT_EQ(report.shards, 2u);
+    EXPECT_EQ(report.feeds, ReplayBenchmark::defaultFeeds().size());
+    EXPECT_EQ(report.ingest.events, generate.events);
+    EXPECT_GT(report.ingest.postsMatched, 0u);
+    EXPECT_GT(report.ingest.engagements, 0u);
+    EXPECT_GT(report.ingest.deletes, 0u);
+    EXPECT_GT(report.entriesPurged, 0u);
+    EXPECT_GT(report.peakRssBytes, 0u);
+
+    ASSERT_EQ(report.stages.size(), 5u);
+    EXPECT_EQ(report.stages[2].name, "decode");
+    EXPECT_EQ(report.stages[2].items, generate.events);
+    EXPECT_EQ(report.stages[3].items, generate.events);
+    EXPECT_GT(report.stages[3].busyNs, 0u);
+
+    const auto summary = ReplayBenchmark::format(report);
+    EXPECT_NE(summary.find("events/s"), std::string::npos);
+    EXPECT_NE(summary.find("peak RSS"), std::string::npos);
+
+    options.maxFrames = 100;
+    EXPECT_THROW(ReplayBenchmark(options).run(), FirehoseGeneratorException); // The file is gone
+}
@@ -0,0 +1,113 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../feed/feed.hpp"
+#include "../graph/follow_graph.hpp"
+#include "../graph/follows_fetcher.hpp"
+#include "../mock/mock_xrpc_server.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/string_interner.hpp"
+
+TEST(FollowGraphTest, StoresCompressedSortedLists) {
+    FollowGraph graph;
+    std::vector<uint32_t> subjects;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        subjects.push_back(999'000 - i * 37);
+    }
+    graph.setFollows(1, subjects);
+
+    const auto following = graph.following(1);
+    ASSERT_TRUE(following.has_value());
+    ASSERT_EQ(following->size(), 1000u);
+    EXPECT_TRUE(std::is_sorted(following->begin(), following->end()));
+    EXPECT_TRUE(graph.follows(1, 999'000));
+    EXPECT_FALSE(graph.follows(1, 999'001));
+    EXPECT_LT(graph.memoryBytes(), 1000 * sizeof(uint32_t));
+    EXPECT_FALSE(graph.following(2).has_value());
+}
+
+TEST(FollowGraphTest, AppliesStreamEventsToTrackedViewers) {
+    FollowGraph graph;
+    graph.setFollows(1, {10, 20, 30});
+
+    EXPECT_TRUE(graph.addFollow(1, 25));
+    EXPECT_TRUE(graph.removeFollow(1, 10));
+    EXPECT_TRUE(graph.removeFollow(1, 25));
+    EXPECT_TRUE(graph.addFollow(1, 10));
+    EXPECT_FALSE(graph.addFollow(2, 10));
+
+    EXPECT_EQ(*graph.following(1), (std::vector<uint32_t>{10, 20, 30}));
+
+    for (uint32_t i = 100; i < 200; ++i) {
+        graph.addFollow(1, i); // Forces compaction
+    }
+    EXPECT_EQ(graph.following(1)->size(), 103u);
+    EXPECT_TRUE(graph.follows(1, 150));
+}
+
+TEST(FollowGraphTest, EvictsLeastRecentlyUsedOverBudget) {
+    FollowGraph graph(2000);
+    for (uint32_t viewer = 0; viewer < 50; ++viewer) {
+        graph.setFollows(viewer, {1, 2, 3, viewer + 10});
+        EXPECT_TRUE(graph.follows(0, 1)); // Keep viewer 0 hot
+    }
+
+    EXPECT_LE(graph.memoryBytes(), 2000u);
+    EXPECT_GT(graph.evictions(), 0u);
+    EXPECT_TRUE(graph.hasViewer(0));
+    EXPECT_TRUE(graph.hasViewer(49));
+    EXPECT_FALSE(graph.hasViewer(1));
+}
+
+TEST(FollowGraphTest, FiltersChronologicalFeedByFollows) {
+    const auto posts = std::make_shared<StringInterner>();
+    Feed feed("following", posts, FeedSort::Chronological);
+    for (uint32_t i = 0; i < 300; ++i) {
+        const auto uri = "at://author" + std::to_string(i % 30) + "/app.bsky.feed.post/" + std::to_string(i);
+        feed.index().insert(i, Feed::tieFor(uri), posts->intern(uri), i % 30);
+    }
+
+    FollowGraph graph;
+    graph.setFollows(7, {3, 29, 1000});
+    const auto followed = *graph.following(7);
+
+    std::vector<uint32_t> seen;
+    std::optional<FeedCursor> cursor;
+    do {
+        const auto page = feed.page(cursor, 4, &followed);
+        seen.insert(seen.end(), page.posts.begin(), page.posts.end());
+        cursor = page.next;
+    } while (cursor);
+
+    ASSERT_EQ(seen.size(), 20u);
+    EXPECT_EQ(posts->lookup(seen.front()), "at://author29/app.bsky.feed.post/299");
+    EXPECT_EQ(FollowGraph::intersect({1, 3, 5, 7}, {3, 4, 7}), (std::vector<uint32_t>{3, 7}));
+}
+
+TEST(FollowsFetcherTest, AFailedPageKeepsThePreviousFollows) {
+    MockXrpcServer::Options options;
+    options.followsPerActor = 250; // Three pages
+    MockXrpcServer mock(options);
+    ASSERT_TRUE(mock.start());
+    HTTPSClient::trustCertificate(mock.certificatePem());
+
+    FollowGraph graph;
+    StringInterner dids;
+    const FollowsFetcher fetcher(mock.host(), "", 1);
+    ASSERT_EQ(fetcher.load(graph, dids, {"alice.test"}), 1u);
+    const auto viewer = dids.find(fetcher.fetch("alice.test").did);
+    ASSERT_TRUE(viewer.has_value());
+    const auto loaded = graph.following(*viewer);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->size(), 250u);
+
+    // The first page answers, the second fails: nothing is stored
+    mock.failNext(1, 500, 1);
+    EXPECT_TRUE(fetcher.fetch("alice.test").did.empty());
+    mock.failNext(1, 500, 1);
+    EXPECT_EQ(fetcher.load(graph, dids, {"alice.test"}), 0u);
+    EXPECT_EQ(graph.following(*viewer), loaded);
+}
@@ -4,41 +4,185 @@
 //
 
 #include <gtest/gtest.h>
-#include "../network/https_client.h"
-#include "../tools/logging.hpp"
-
-// Mock or real endpoint for testing
-const std::string TEST_HOST = "api.github.com";
-const std::string TEST_ENDPOINT = "/";
-
-TEST(HTTPSClientTest, SuccessfulGETRequest) {
-    HTTPSClient client;
-    client.setHost(TEST_HOST);
-    client.setEndpoint(TEST_ENDPOINT);
-    client.addQueryParam("test", "value");
-
-    EXPECT_NO_THROW({
-        auto response = client.get();
-        ASSERT_FALSE(response.is_null()) << "Response should not be null";
-        ASSERT_TRUE(response.is_object()) << "Response should be a valid JSON object";
+#include <set>
+#include <thread>
+#include "../mock/mock_xrpc_server.hpp"
+#include "../network/https_client.hpp"
+#include "../tools/base32.hpp"
+#include "../tools/rate_limiter.hpp"
+#include "../tools/timestamp.hpp"
+
+// Every test talks to a local mock XRPC server, so the suite needs no network
+class HTTPSClientTest : public ::testing::Test {
+protected:
+    void startMock(const MockXrpcServer::Options& options = {}) {
+        mock = std::make_unique<MockXrpcServer>(options);
+        HTTPSClient::trustCertificate(mock->certificatePem());
+        ASSERT_TRUE(mock->start());
+    }
+
+    [[nodiscard]] HTTPSClient clientFor(const std::string& method) const {
+        HTTPSClient client;
+        client.setHost("https://" + mock->host() + "/");
+        client.setEndpoint("/xrpc/" + method);
+        return client;
+    }
+
+    std::unique_ptr<MockXrpcServer> mock;
+};
+
+TEST_F(HTTPSClientTest, GetsAProfileFromTheMock) {
+    startMock();
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+
+    const auto profile = client.get();
+    EXPECT_EQ(client.status(), 200);
+    ASSERT_TRUE(profile.is_object());
+    EXPECT_EQ(profile["handle"], "alice.bsky.social");
+    EXPECT_EQ(profile["did"].get<std::string>().rfind("did:plc:", 0), 0u);
+    EXPECT_EQ(profile["postsCount"], 100);
+
+    // The same actor is the same account every time
+    EXPECT_EQ(client.get()["did"], profile["did"]);
+    EXPECT_EQ(mock->requests("app.bsky.actor.getProfile"), 2u);
+}
+
+TEST_F(HTTPSClientTest, ReportsXrpcErrors) {
+    startMock();
+    auto client = clientFor("app.bsky.actor.getProfile");
+    EXPECT_TRUE(client.get().is_null()); // No actor
+    EXPECT_EQ(client.status(), 400);
+
+    client.setEndpoint("/xrpc/app.bsky.unspecced.getPopular");
+    EXPECT_TRUE(client.get().is_null());
+    EXPECT_EQ(client.status(), 501);
+}
+
+TEST_F(HTTPSClientTest, ServesRecordedResponses) {
+    startMock();
+    mock->setRecorded("app.bsky.actor.getProfile", {{"did", "did:plc:recorded"}, {"handle", "recorded.test"}});
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "anyone.test");
+    EXPECT_EQ(client.get()["did"], "did:plc:recorded");
+}
+
+TEST_F(HTTPSClientTest, RetriesInjectedFailures) {
+    startMock();
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+    client.setMaxRetries(2);
+
+    mock->failNext(2, 503);
+    EXPECT_TRUE(client.get().is_object());
+    EXPECT_EQ(client.status(), 200);
+    EXPECT_EQ(mock->totalRequests(), 3u);
+
+    client.setMaxRetries(0);
+    mock->failNext(1, 502);
+    EXPECT_TRUE(client.get().is_null());
+    EXPECT_EQ(client.status(), 502);
+}
+
+TEST_F(HTTPSClientTest, WaitsOutTheRateLimit) {
+    MockXrpcServer::Options options;
+    options.rateLimit = 2;
+    options.rateLimitWindow = std::chrono::seconds(1);
+    startMock(options);
+
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+    client.setMaxRetries(1);
+    client.setRateLimiter(std::make_shared<RateLimiter>(1000.0, 10.0));
+
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(client.get().is_object()) << "request " << i;
+    }
+    // The third was refused with a 429 and retried once the window named in RateLimit-Reset was over
+    EXPECT_EQ(mock->totalRequests(), 4u);
+    EXPECT_EQ(client.status(), 200);
+}
+
+TEST_F(HTTPSClientTest, CancellingStopsALongRateLimitWait) {
+    MockXrpcServer::Options options;
+    options.rateLimit = 1;
+    options.rateLimitWindow = std::chrono::hours(24);
+    startMock(options);
+
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+    client.setMaxRetries(3);
+    std::atomic<bool> cancelled{false};
+    client.setCancelFlag(&cancelled);
+    EXPECT_TRUE(client.get().is_object());
+
+    // The server asks for a day; the wait ends as soon as the flag is set
+    std::thread canceller([&cancelled] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        cancelled = true;
     });
+    const auto started = std::chrono::steady_clock::now();
+    EXPECT_TRUE(client.get().is_null());
+    canceller.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(5));
+    EXPECT_EQ(client.status(), 429);
+    EXPECT_EQ(mock->totalRequests(), 2u);
+}
+
+TEST_F(HTTPSClientTest, InjectsLatency) {
+    MockXrpcServer::Options options;
+    options.medianLatency = std::chrono::milliseconds(30);
+    startMock(options);
+
+    auto client = clientFor("app.bsky.actor.getProfile");
+    client.addQueryParam("actor", "alice.bsky.social");
+    const auto started = std::chrono::steady_clock::now();
+    EXPECT_TRUE(client.get().is_object());
+    EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(30));
 }
 
-TEST(HTTPSClientTest, InvalidHost) {
-    HTTPSClient client;
-    client.setHost("invalid.host");
-    client.setEndpoint("/invalid");
+TEST_F(HTTPSClientTest, PagesThroughAnAuthorFeed) {
+    MockXrpcServer::Options options;
+    options.postsPerActor = 120;
+    startMock(options);
+
+    auto client = clientFor("app.bsky.feed.getAuthorFeed");
+    client.addQueryParam("actor", "alice.bsky.social");
+    client.addQueryParam("limit", "50");
 
-    EXPECT_THROW({
-        client.get();
-    }, HTTPException);
+    std::set<std::string> uris;
+    size_t pages = 0;
+    for (auto page = client.get(); page.is_object(); page = client.get()) {
+        ++pages;
+        for (const auto& item : page["feed"]) {
+            const auto& post = item["post"];
+            const std::string uri = post["uri"];
+            uris.insert(uri);
+            // Record keys are TIDs of the posts' own creation times, as the backfill expects
+            EXPECT_EQ(Base32::tidTimestamp(uri.substr(uri.rfind('/') + 1)),
+                      Timestamp::parseIso8601(post["record"]["createdAt"].get<std::string>()));
+        }
+        if (!page.contains("cursor")) {
+            break;
+        }
+        client.addQueryParam("cursor", page["cursor"].get<std::string>());
+    }
+    EXPECT_EQ(pages, 3u);
+    EXPECT_EQ(uris.size(), 120u);
 }
 
-TEST(HTTPSClientTest, MissingHost) {
-    HTTPSClient client;
-    client.setEndpoint("/");
+TEST_F(HTTPSClientTest, FailsWithoutAResponse) {
+    HTTPSClient missing;
+    missing.setEndpoint("/");
+    EXPECT_TRUE(missing.get().is_null());
+    EXPECT_EQ(missing.status(), 0);
 
-    EXPECT_THROW({
-        client.get();
-    }, HTTPException);
+    startMock();
+    const auto host = mock->host();
+    mock->stop();
+    HTTPSClient closed;
+    closed.setHost(host);
+    closed.setEndpoint("/xrpc/app.bsky.actor.getProfile");
+    EXPECT_TRUE(closed.get().is_null());
+    EXPECT_EQ(closed.status(), 0);
 }
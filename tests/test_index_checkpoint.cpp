@@ -0,0 +1,240 @@
+//
+// Created by jayian on 2/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "../feed/index_compactor.hpp"
+#include "../ingest/index_checkpoint.hpp"
+#include "../ingest/ingestor.hpp"
+#include "../tools/durable_file.hpp"
+#include "scratch_directory.hpp"
+
+[[maybe_unused]] static const auto* const scratch =
+    testing::AddGlobalTestEnvironment(new ScratchDirectory("bluesky_feed_checkpoint_test"));
+
+namespace {
+    struct Index {
+        std::shared_ptr<FeedRegistry> registry = std::make_shared<FeedRegistry>(std::make_shared<StringInterner>());
+        std::shared_ptr<StringInterner> actorDids = std::make_shared<StringInterner>();
+        std::shared_ptr<EngagementCounters> engagement = std::make_shared<EngagementCounters>();
+        std::unique_ptr<Ingestor> ingestor;
+
+        explicit Index(const std::vector<std::string>& feeds) {
+            for (const auto& name : feeds) {
+                FeedDefinition definition;
+                definition.name = name;
+                definition.sort = name == "new" ? FeedSort::Chronological : FeedSort::Top;
+                definition.keywords = {name == "new" ? "cat" : name};
+                registry->addFeed(definition);
+            }
+            registry->build();
+            DedupeFilter::Options dedupe;
+            dedupe.itemsPerGeneration = 1000;
+            ingestor = std::make_unique<Ingestor>(registry, actorDids, engagement, dedupe);
+        }
+
+        IndexCheckpoint checkpoint(const std::string& path) const {
+            IndexCheckpoint::Options options;
+            options.path = path;
+            return IndexCheckpoint(options, registry, actorDids, engagement);
+        }
+
+        [[nodiscard]] std::shared_ptr<Feed> feed(const std::string& name) const {
+            for (const auto& feed : registry->feeds()) {
+                if (feed->name() == name) {
+                    return feed;
+                }
+            }
+            return nullptr;
+        }
+    };
+
+    IngestEvent postEvent(const std::string& rkey, const std::string& text) {
+        IngestEvent event;
+        event.kind = EventKind::Post;
+        event.repo = "did:plc:author";
+        event.uri = "at://did:plc:author/app.bsky.feed.post/" + rkey;
+        event.cid = "cid-" + rkey;
+        event.post.text = text;
+        event.post.createdAtUs = 1'700'000'000'000'000;
+        return event;
+    }
+
+    IngestEvent likeEvent(const std::string& rkey, const std::string& subject) {
+        IngestEvent event;
+        event.kind = EventKind::Like;
+        event.repo = "did:plc:liker";
+        event.uri = "at://did:plc:liker/app.bsky.feed.like/" + rkey;
+        event.cid = "cid-" + rkey;
+        event.subject = subject;
+        return event;
+    }
+}
+
+class IndexCheckpointTest : public testing::Test {
+protected:
+    std::string path;
+
+    void SetUp() override {
+        path = (std::filesystem::temp_directory_path() / "bluesky_feed_checkpoint_test.json").string();
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+};
+
+TEST_F(IndexCheckpointTest, RestoresFeedsRankingAndCursor) {
+    Index before({"cat", "dog", "new"});
+    before.ingestor->ingest(postEvent("3kgc2m3kxbs2a", "a cat"));
+    before.ingestor->ingest(postEvent("3kgc2m3kxbs2b", "a cat and a dog"));
+    before.ingestor->ingest(postEvent("3kgc2m3kxbs2c", "a dog"));
+    for (int i = 0; i < 3; ++i) {
+        before.ingestor->ingest(likeEvent("like" + std::to_string(i), "at://did:plc:author/app.bsky.feed.post/3kgc2m3kxbs2a"));
+    }
+    ASSERT_TRUE(before.checkpoint(path).save(4242));
+
+    // Restored into a registry with a feed removed and one added
+    Index after({"cat", "new", "bird"});
+    const auto seq = after.checkpoint(path).load();
+    ASSERT_TRUE(seq.has_value());
+    EXPECT_EQ(*seq, 4242);
+
+    EXPECT_EQ(after.feed("cat")->index().size(), 2u);
+    EXPECT_EQ(after.feed("new")->index().size(), 2u);
+    EXPECT_EQ(after.feed("bird")->index().size(), 0u);
+
+    const auto ranked = after.feed("cat")->ranked();
+    ASSERT_EQ(ranked->size(), 2u);
+    EXPECT_EQ(after.feed("cat")->postUri(ranked->front()), "at://did:plc:author/app.bsky.feed.post/3kgc2m3kxbs2a");
+
+    const auto liked = after.registry->postUris()->find("at://did:plc:author/app.bsky.feed.post/3kgc2m3kxbs2a");
+    ASSERT_TRUE(liked.has_value());
+    EXPECT_EQ(after.engagement->read(*liked).likes, 3);
+    EXPECT_TRUE(after.registry->membership(*liked).test(0));
+    EXPECT_TRUE(after.registry->membership(*liked).test(1));
+
+    // Deletes after the restore still find the post in every feed it was restored to
+    IngestEvent remove;
+    remove.kind = EventKind::Delete;
+    remove.uri = "at://did:plc:author/app.bsky.feed.post/3kgc2m3kxbs2a";
+    EXPECT_TRUE(after.ingestor->ingest(remove));
+    EXPECT_EQ(IndexCompactor(after.registry).compact(), 2u);
+    EXPECT_EQ(after.feed("cat")->index().size(), 1u);
+    EXPECT_EQ(after.feed("new")->index().size(), 1u);
+}
+
+TEST_F(IndexCheckpointTest, MissingOrCorruptCheckpointIsIgnored) {
+    Index index({"cat"});
+    EXPECT_FALSE(index.checkpoint(path).load().has_value());
+
+    std::ofstream(path) << "{\"seq\": 12, \"posts\": [";
+    EXPECT_FALSE(index.checkpoint(path).load().has_value());
+    EXPECT_EQ(index.feed("cat")->index().size(), 0u);
+}
+
+TEST_F(IndexCheckpointTest, SaveReplacesThePreviousCheckpointWhole) {
+    Index index({"cat"});
+    index.ingestor->ingest(postEvent("3kgc2m3kxbs2a", "a cat"));
+    ASSERT_TRUE(index.checkpoint(path).save(1));
+    index.ingestor->ingest(postEvent("3kgc2m3kxbs2b", "another cat"));
+    ASSERT_TRUE(index.checkpoint(path).save(2));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    Index restored({"cat"});
+    EXPECT_EQ(restored.checkpoint(path).load(), 2);
+    EXPECT_EQ(restored.feed("cat")->index().size(), 2u);
+}
+
+TEST_F(IndexCheckpointTest, DeletedPostsAreNotSavedBeforeCompaction) {
+    Index index({"cat"});
+    const auto deleted = postEvent("3kgc2m3kxbs2a", "a cat");
+    index.ingestor->ingest(deleted);
+    index.ingestor->ingest(postEvent("3kgc2m3kxbs2b", "another cat"));
+    IngestEvent remove;
+    remove.kind = EventKind::Delete;
+    remove.uri = deleted.uri;
+    ASSERT_TRUE(index.ingestor->ingest(remove));
+    ASSERT_TRUE(index.checkpoint(path).save(1));
+
+    Index restored({"cat"});
+    EXPECT_EQ(restored.checkpoint(path).load(), 1);
+    EXPECT_EQ(restored.feed("cat")->index().size(), 1u);
+    EXPECT_FALSE(restored.registry->postUris()->find(deleted.uri).has_value());
+}
+
+TEST_F(IndexCheckpointTest, TakenDownAccountsStayHiddenAfterARestart) {
+    Index index({"cat"});
+    IngestEvent takedown;
+    takedown.kind = EventKind::Takedown;
+    takedown.repo = "did:plc:author";
+    ASSERT_TRUE(index.ingestor->ingest(takedown));
+    ASSERT_TRUE(index.checkpoint(path).save(1));
+
+    Index restored({"cat"});
+    EXPECT_EQ(restored.checkpoint(path).load(), 1);
+    EXPECT_TRUE(restored.registry->tombstones().authorRemoved("did:plc:author"));
+    auto fresh = postEvent("3kgc2m3kxbs2a", "a cat");
+    fresh.time = DecayedTopK::Clock::now();
+    ASSERT_TRUE(restored.ingestor->ingest(fresh));
+    restored.feed("cat")->ranking().rebuild(fresh.time); // Publishes the new post
+    EXPECT_TRUE(restored.feed("cat")->page(std::nullopt, 10).posts.empty());
+
+    IngestEvent reinstate = takedown;
+    reinstate.kind = EventKind::Reinstate;
+    EXPECT_TRUE(restored.ingestor->ingest(reinstate));
+    EXPECT_EQ(restored.feed("cat")->page(std::nullopt, 10).posts.size(), 1u);
+}
+
+TEST_F(IndexCheckpointTest, DurableFileReplacesTheOldContentsOnlyOnCommit) {
+    std::ofstream(path) << "old";
+    const auto contents = [this] {
+        std::ifstream file(path);
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    };
+    {
+        DurableFile file(path);
+        ASSERT_TRUE(file.isOpen());
+        EXPECT_TRUE(file.write("abandoned"));
+    }
+    EXPECT_EQ(contents(), "old");
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    DurableFile file(path);
+    EXPECT_TRUE(file.write("new "));
+    EXPECT_TRUE(file.write(std::string(3 << 20, 'x'))); // Past the buffer, so written in several chunks
+    EXPECT_TRUE(file.commit());
+    EXPECT_EQ(contents().size(), 4u + (3 << 20));
+    EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+
+    EXPECT_FALSE(DurableFile((std::filesystem::path(path) / "missing" / "file").string()).commit());
+}
+
+TEST_F(IndexCheckpointTest, BackgroundSavesWriteTheStateAtTheirCursor) {
+    Index index({"cat"});
+    index.ingestor->ingest(postEvent("3kgc2m3kxbs2a", "a cat"));
+    {
+        auto checkpoint = index.checkpoint(path);
+        checkpoint.saveInBackground(7);
+        // Indexed after the snapshot, so not part of the checkpoint at seq 7
+        index.ingestor->ingest(postEvent("3kgc2m3kxbs2b", "another cat"));
+    } // Waits for the write
+
+    Index restored({"cat"});
+    EXPECT_EQ(restored.checkpoint(path).load(), 7);
+    EXPECT_EQ(restored.feed("cat")->index().size(), 1u);
+}
+
+TEST_F(IndexCheckpointTest, ACheckpointThatFailsValidationRestoresNothing) {
+    // Valid JSON, but the second feed entry points past the saved posts
+    std::ofstream(path) << R"({"seq": 3, "posts": [["at://did:plc:author/app.bsky.feed.post/3kgc2m3kxbs2a",)"
+                        << R"("did:plc:author", 1, 0, 0, 0]], "feeds": {"cat": [[0, 0.0], [5, 0.0]]}})";
+    Index index({"cat"});
+    EXPECT_FALSE(index.checkpoint(path).load().has_value());
+    EXPECT_EQ(index.feed("cat")->index().size(), 0u);
+    EXPECT_EQ(index.registry->postUris()->size(), 0u);
+}
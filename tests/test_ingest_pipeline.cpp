@@ -0,0 +1,284 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <map>
+#include <mutex>
+#include <set>
+#include "../ingest/firehose_subscriber.hpp"
+#include "../ingest/ingest_pipeline.hpp"
+#include "../network/websocket_client.hpp"
+#include "../tools/dag_cbor.hpp"
+
+// A #commit frame deleting posts; deletes need no blocks
+static std::string makeDeleteFrame(const uint64_t seq, const std::vector<std::string>& rkeys,
+                                   const std::string& repo = "did:plc:alice") {
+    std::string frame;
+    DagCborWriter::appendMap(frame, 2);
+    DagCborWriter::appendText(frame, "t");
+    DagCborWriter::appendText(frame, "#commit");
+    DagCborWriter::appendText(frame, "op");
+    DagCborWriter::appendInteger(frame, 1);
+
+    DagCborWriter::appendMap(frame, 4);
+    DagCborWriter::appendText(frame, "seq");
+    DagCborWriter::appendUnsigned(frame, seq);
+    DagCborWriter::appendText(frame, "repo");
+    DagCborWriter::appendText(frame, repo);
+    DagCborWriter::appendText(frame, "ops");
+    DagCborWriter::appendArray(frame, rkeys.size());
+    for (const auto& rkey : rkeys) {
+        DagCborWriter::appendMap(frame, 3);
+        DagCborWriter::appendText(frame, "cid");
+        DagCborWriter::appendNull(frame);
+        DagCborWriter::appendText(frame, "path");
+        DagCborWriter::appendText(frame, "app.bsky.feed.post/" + rkey);
+        DagCborWriter::appendText(frame, "action");
+        DagCborWriter::appendText(frame, "delete");
+    }
+    DagCborWriter::appendText(frame, "blocks");
+    DagCborWriter::appendBytes(frame, "");
+    return frame;
+}
+
+static std::string makeAccountFrame(const uint64_t seq, const std::string& did, const bool active,
+                                    const std::string& status = "takendown") {
+    std::string frame;
+    DagCborWriter::appendMap(frame, 2);
+    DagCborWriter::appendText(frame, "t");
+    DagCborWriter::appendText(frame, "#account");
+    DagCborWriter::appendText(frame, "op");
+    DagCborWriter::appendInteger(frame, 1);
+
+    DagCborWriter::appendMap(frame, 4);
+    DagCborWriter::appendText(frame, "seq");
+    DagCborWriter::appendUnsigned(frame, seq);
+    DagCborWriter::appendText(frame, "did");
+    DagCborWriter::appendText(frame, did);
+    DagCborWriter::appendText(frame, "active");
+    DagCborWriter::appendBool(frame, active);
+    DagCborWriter::appendText(frame, "status");
+    if (active) {
+        DagCborWriter::appendNull(frame);
+    } else {
+        DagCborWriter::appendText(frame, status);
+    }
+    return frame;
+}
+
+struct Collected {
+    std::mutex mutex;
+    std::vector<IngestEvent> events;
+
+    std::vector<size_t> shards;
+
+    IngestPipeline::Indexer indexer() {
+        return [this](const size_t shard, const IngestEvent& event) {
+            std::lock_guard lock(mutex);
+            events.push_back(event);
+            shards.push_back(shard);
+        };
+    }
+};
+
+TEST(IngestPipelineTest, FramesAreDecodedAndIndexedInOrder) {
+    Collected collected;
+    IngestPipeline::Options options;
+    options.shards = 1;
+    options.frameCapacity = 4;
+    options.eventCapacity = 4;
+    IngestPipeline pipeline(options, collected.indexer());
+    pipeline.start();
+
+    // Far more frames than the queues hold, so producers must wait on the stages behind them
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(pipeline.pushFrame(makeDeleteFrame(i + 1, {"rkey" + std::to_string(i)})));
+    }
+    pipeline.pushFrame("not cbor");
+    pipeline.stop();
+
+    ASSERT_EQ(collected.events.size(), 1000u);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_EQ(collected.events[i].kind, EventKind::Delete);
+        EXPECT_EQ(collected.events[i].uri, "at://did:plc:alice/app.bsky.feed.post/rkey" + std::to_string(i));
+    }
+    EXPECT_EQ(pipeline.lastSeq(), 1000);
+    EXPECT_EQ(pipeline.malformedFrames(), 1u);
+
+    const auto stats = pipeline.stats();
+    ASSERT_EQ(stats.size(), 2u);
+    EXPECT_EQ(stats[0].name, "decode/0");
+    EXPECT_EQ(stats[0].processed, 1000u); // The malformed frame never reaches a shard
+    EXPECT_EQ(stats[0].queue.capacity, 4u);
+    EXPECT_EQ(stats[1].name, "index/0");
+    EXPECT_EQ(stats[1].processed, 1000u);
+    EXPECT_EQ(stats[1].queue.depth, 0u);
+}
+
+TEST(IngestPipelineTest, EventsFromManyProducersReachTheIndexer) {
+    Collected collected;
+    IngestPipeline pipeline(collected.indexer());
+    pipeline.start();
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&pipeline, p] {
+            for (int i = 0; i < 500; ++i) {
+                IngestEvent event;
+                event.kind = EventKind::Like;
+                event.repo = "did:plc:" + std::to_string(p);
+                ASSERT_TRUE(pipeline.pushEvent(std::move(event)));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    pipeline.stop();
+
+    EXPECT_EQ(collected.events.size(), 2000u);
+    EXPECT_FALSE(pipeline.pushEvent(IngestEvent{}));
+}
+
+TEST(IngestPipelineTest, ShardsKeepEachAccountInOrderOnOneShard) {
+    Collected collected;
+    IngestPipeline::Options options;
+    options.shards = 4;
+    options.frameCapacity = 8;
+    IngestPipeline pipeline(options, collected.indexer());
+    EXPECT_EQ(pipeline.shardCount(), 4u);
+    pipeline.start();
+
+    const std::vector<std::string> repos{"did:plc:alice", "did:plc:bob", "did:plc:carol", "did:plc:dave",
+                                         "did:plc:erin", "did:plc:frank"};
+    for (int seq = 1; seq <= 600; ++seq) {
+        const auto& repo = repos[seq % repos.size()];
+        ASSERT_TRUE(pipeline.pushFrame(makeDeleteFrame(seq, {std::to_string(seq)}, repo)));
+    }
+    pipeline.stop();
+
+    ASSERT_EQ(collected.events.size(), 600u);
+    std::map<std::string, int> lastRkey;
+    std::set<size_t> usedShards;
+    for (size_t i = 0; i < collected.events.size(); ++i) {
+        const auto& event = collected.events[i];
+        EXPECT_EQ(collected.shards[i], IngestEvent::shardFor(event.repo, 4));
+        usedShards.insert(collected.shards[i]);
+        const auto rkey = std::stoi(event.uri.substr(event.uri.rfind('/') + 1));
+        EXPECT_GT(rkey, lastRkey[event.repo]) << event.repo;
+        lastRkey[event.repo] = rkey;
+    }
+    EXPECT_GT(usedShards.size(), 1u);
+    EXPECT_EQ(pipeline.stats().size(), 8u);
+    EXPECT_EQ(pipeline.indexedSeq(), 600);
+}
+
+TEST(IngestPipelineTest, CheckpointSeesEveryRoutedCommitIndexed) {
+    Collected collected;
+    std::vector<std::pair<int64_t, size_t>> checkpoints; // seq and events indexed at that moment
+    IngestPipeline::Options options;
+    options.shards = 3;
+    IngestPipeline pipeline(options, collected.indexer());
+    pipeline.setCheckpointer(std::chrono::seconds(0), [&](const int64_t seq) {
+        std::lock_guard lock(collected.mutex);
+        checkpoints.emplace_back(seq, collected.events.size());
+    });
+    pipeline.start();
+    for (int seq = 1; seq <= 50; ++seq) {
+        pipeline.pushFrame(makeDeleteFrame(seq, {"a" + std::to_string(seq), "b" + std::to_string(seq)},
+                                           "did:plc:" + std::to_string(seq % 5)));
+    }
+    pipeline.stop();
+
+    ASSERT_EQ(checkpoints.size(), 50u);
+    for (const auto& [seq, indexed] : checkpoints) {
+        EXPECT_EQ(indexed, static_cast<size_t>(seq) * 2);
+    }
+    EXPECT_EQ(pipeline.indexedSeq(), 50);
+}
+
+TEST(IngestPipelineTest, CommitsUpToTheResumeCursorAreNotIndexedAgain) {
+    Collected collected;
+    IngestPipeline::Options options;
+    options.shards = 2;
+    IngestPipeline pipeline(options, collected.indexer());
+    pipeline.resumeAfter(3);
+    pipeline.start();
+    for (int seq = 1; seq <= 5; ++seq) {
+        pipeline.pushFrame(makeDeleteFrame(seq, {"rkey" + std::to_string(seq)}));
+    }
+    pipeline.pushFrame(makeDeleteFrame(4, {"again"})); // Redelivered after a reconnect
+    pipeline.stop();
+
+    ASSERT_EQ(collected.events.size(), 2u);
+    EXPECT_EQ(collected.events[0].uri, "at://did:plc:alice/app.bsky.feed.post/rkey4");
+    EXPECT_EQ(collected.events[1].uri, "at://did:plc:alice/app.bsky.feed.post/rkey5");
+    EXPECT_EQ(pipeline.replayedFrames(), 4u);
+    EXPECT_EQ(pipeline.lastSeq(), 5);
+}
+
+TEST(IngestPipelineTest, AnotherRelayStartsItsOwnSequence) {
+    Collected collected;
+    IngestPipeline pipeline(IngestPipeline::Options{}, collected.indexer());
+    pipeline.start();
+    pipeline.pushFrame(makeDeleteFrame(900, {"old"}));
+
+    // Moving to a relay whose numbering is far behind the old one
+    pipeline.resetSequence();
+    EXPECT_EQ(pipeline.lastSeq(), 0);
+    EXPECT_EQ(collected.events.size(), 1u); // Drained before forgetting
+    pipeline.pushFrame(makeDeleteFrame(7, {"new"}));
+    pipeline.stop();
+
+    ASSERT_EQ(collected.events.size(), 2u);
+    EXPECT_EQ(collected.events[1].uri, "at://did:plc:alice/app.bsky.feed.post/new");
+    EXPECT_EQ(pipeline.replayedFrames(), 0u);
+    EXPECT_EQ(pipeline.lastSeq(), 7);
+}
+
+TEST(IngestPipelineTest, TakedownsFollowTheAccountsEarlierCommits) {
+    Collected collected;
+    IngestPipeline::Options options;
+    options.shards = 3;
+    IngestPipeline pipeline(options, collected.indexer());
+    pipeline.start();
+    pipeline.pushFrame(makeDeleteFrame(1, {"a"}, "did:plc:bob"));
+    pipeline.pushFrame(makeAccountFrame(2, "did:plc:bob", false));
+    pipeline.pushFrame(makeAccountFrame(3, "did:plc:carol", false, "deactivated")); // By its owner
+    pipeline.pushFrame(makeAccountFrame(4, "did:plc:bob", true));
+    pipeline.pushFrame(makeAccountFrame(2, "did:plc:bob", false)); // Replayed
+    pipeline.stop();
+
+    ASSERT_EQ(collected.events.size(), 3u);
+    EXPECT_EQ(collected.events[0].kind, EventKind::Delete);
+    EXPECT_EQ(collected.events[1].kind, EventKind::Takedown);
+    EXPECT_EQ(collected.events[1].repo, "did:plc:bob");
+    EXPECT_EQ(collected.events[2].kind, EventKind::Reinstate);
+    EXPECT_EQ(collected.events[2].repo, "did:plc:bob");
+    EXPECT_EQ(collected.shards[1], collected.shards[0]);
+    EXPECT_EQ(collected.shards[2], collected.shards[0]);
+    EXPECT_EQ(pipeline.replayedFrames(), 1u);
+    EXPECT_EQ(pipeline.lastSeq(), 4);
+}
+
+TEST(IngestPipelineTest, SubscriptionResumesAfterCursor) {
+    const std::string url = "wss://bsky.network/xrpc/com.atproto.sync.subscribeRepos";
+    EXPECT_EQ(FirehoseSubscriber::urlWithCursor(url, 0), url);
+    EXPECT_EQ(FirehoseSubscriber::urlWithCursor(url, 42), url + "?cursor=42");
+    EXPECT_EQ(FirehoseSubscriber::urlWithCursor(url + "?x=1", 42), url + "?x=1&cursor=42");
+}
+
+TEST(IngestPipelineTest, WebSocketHandshakeAndFraming) {
+    // RFC 6455 section 1.3
+    EXPECT_EQ(WebSocketClient::acceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    // RFC 6455 section 5.7: masked "Hello"
+    const auto frame = WebSocketClient::encodeFrame(0x1, "Hello", 0x37fa213d);
+    EXPECT_EQ(frame, std::string("\x81\x85\x37\xfa\x21\x3d\x7f\x9f\x4d\x51\x58", 11));
+
+    const auto large = WebSocketClient::encodeFrame(0x2, std::string(70000, 'x'), 0);
+    EXPECT_EQ(static_cast<unsigned char>(large[1]), 0x80 | 127);
+    EXPECT_EQ(large.size(), 2 + 8 + 4 + 70000u);
+}
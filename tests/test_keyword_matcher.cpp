@@ -0,0 +1,110 @@
+//
+// Created by jayian on 1/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include "../config/settings.hpp"
+#include "../feed/keyword_matcher.hpp"
+
+static std::vector<std::string> matchedTerms(const KeywordMatcher& matcher, const std::string_view text) {
+    std::vector<std::string> result;
+    for (const auto& match : matcher.findAll(text)) {
+        result.push_back(matcher.term(match.termId));
+    }
+    return result;
+}
+
+TEST(KeywordMatcherTest, FindsOverlappingTermsInOnePass) {
+    KeywordMatcher matcher;
+    const KeywordMatcher::Options substring{true, false};
+    matcher.addTerm("he", substring);
+    matcher.addTerm("she", substring);
+    matcher.addTerm("his", substring);
+    matcher.addTerm("hers", substring);
+    matcher.build();
+
+    const auto matches = matcher.findAll("ushers");
+    ASSERT_EQ(matches.size(), 3u);
+    EXPECT_EQ(matcher.term(matches[0].termId), "she");
+    EXPECT_EQ(matches[0].begin, 1u);
+    EXPECT_EQ(matcher.term(matches[1].termId), "he");
+    EXPECT_EQ(matcher.term(matches[2].termId), "hers");
+    EXPECT_EQ(matches[2].end, 6u);
+}
+
+TEST(KeywordMatcherTest, CaseInsensitiveByDefault) {
+    KeywordMatcher matcher;
+    matcher.addTerm("Rust");
+    matcher.addTerm("GPU", {false, true});
+    matcher.build();
+
+    EXPECT_EQ(matchedTerms(matcher, "I love RUST and rust"), (std::vector<std::string>{"Rust", "Rust"}));
+    EXPECT_EQ(matchedTerms(matcher, "new GPU, old gpu"), std::vector<std::string>{"GPU"});
+}
+
+TEST(KeywordMatcherTest, WholeWordRespectsBoundaries) {
+    KeywordMatcher matcher;
+    matcher.addTerm("cat");
+    matcher.addTerm("#art");
+    matcher.addTerm("dog", {true, false});
+    matcher.build();
+
+    EXPECT_TRUE(matchedTerms(matcher, "concatenate category").empty());
+    EXPECT_EQ(matchedTerms(matcher, "a cat. (cat)"), (std::vector<std::string>{"cat", "cat"}));
+    EXPECT_EQ(matchedTerms(matcher, "daily #art post"), std::vector<std::string>{"#art"});
+    EXPECT_EQ(matchedTerms(matcher, "hotdogs"), std::vector<std::string>{"dog"});
+    EXPECT_TRUE(matchedTerms(matcher, "catépillar").empty());
+}
+
+TEST(KeywordMatcherTest, MatchesAnyAndTags) {
+    KeywordMatcher matcher;
+    matcher.addTerm("bluesky", {}, 3);
+    matcher.addTerm("atproto", {}, 7);
+    matcher.build();
+
+    EXPECT_TRUE(matcher.matchesAny("Building on ATProto today"));
+    EXPECT_FALSE(matcher.matchesAny("nothing to see here"));
+    EXPECT_EQ(matcher.tag(matcher.findAll("bluesky")[0].termId), 3u);
+}
+
+TEST(KeywordMatcherTest, RejectsMisuse) {
+    KeywordMatcher matcher;
+    EXPECT_THROW(matcher.addTerm(""), KeywordMatcherException);
+    EXPECT_THROW(matcher.findAll("text"), KeywordMatcherException);
+    matcher.build();
+    EXPECT_THROW(matcher.addTerm("late"), KeywordMatcherException);
+}
+
+TEST(KeywordMatcherTest, ScalesToManyTerms) {
+    KeywordMatcher matcher;
+    for (int i = 0; i < 5000; ++i) {
+        matcher.addTerm("term" + std::to_string(i));
+    }
+    matcher.build();
+
+    const auto matches = matcher.findAll("only term4999 and term12 match, term50000 does not");
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matcher.term(matches[0].termId), "term4999");
+    EXPECT_EQ(matcher.term(matches[1].termId), "term12");
+}
+
+TEST(KeywordMatcherTest, BuildsFromSettingsFeeds) {
+    const auto path = (std::filesystem::temp_directory_path() / "keyword_matcher_settings.json").string();
+    {
+        std::ofstream out(path, std::ios::trunc);
+        out << R"({"feeds": [{"name": "a", "keywords": ["alpha"]},
+                             {"name": "b", "keywords": ["Beta"], "case_sensitive": true, "whole_word": false}]})";
+    }
+
+    const auto settings = Settings::createInstance(path);
+    const auto matcher = KeywordMatcher::fromSettings(*settings);
+    std::filesystem::remove(path);
+
+    const auto matches = matcher.findAll("alpha Betamax beta");
+    ASSERT_EQ(matches.size(), 2u);
+    EXPECT_EQ(matcher.tag(matches[0].termId), 0u);
+    EXPECT_EQ(matcher.tag(matches[1].termId), 1u);
+}
@@ -0,0 +1,80 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../auth/service_auth.hpp"
+#include "../feed/feed.hpp"
+#include "../loadgen/load_generator.hpp"
+#include "../server/feed_server.hpp"
+
+static constexpr auto SERVICE_DID = "did:web:feeds.example.com";
+
+static std::shared_ptr<Feed> makeFeed(const std::shared_ptr<StringInterner>& posts) {
+    auto feed = std::make_shared<Feed>("test", posts, FeedSort::Chronological, 1000);
+    for (uint32_t i = 0; i < 200; ++i) {
+        feed->index().insert(1000 + i, i, posts->intern("at://did:plc:x/app.bsky.feed.post/" + std::to_string(i)), 1);
+    }
+    return feed;
+}
+
+TEST(LoadGeneratorTest, RejectsOptionsThatCannotMakeLoad) {
+    LoadGenerator::Options options;
+    EXPECT_THROW(LoadGenerator{options}, LoadGeneratorException); // No feeds
+
+    options.feeds = {"at://did:plc:publisher/app.bsky.feed.generator/test"};
+    EXPECT_THROW(LoadGenerator{options}, LoadGeneratorException); // Signed-in requests without an audience
+
+    options.authenticatedFraction = 0;
+    options.depthWeights = {0, 0};
+    EXPECT_THROW(LoadGenerator{options}, LoadGeneratorException);
+
+    options.depthWeights = {1};
+    EXPECT_NO_THROW(LoadGenerator{options});
+}
+
+TEST(LoadGeneratorTest, DrivesAFeedServerWithTheRequestMix) {
+    const auto posts = std::make_shared<StringInterner>();
+    FeedServer server(SERVICE_DID, "did:plc:publisher", "test-secret");
+    server.addFeed(makeFeed(posts));
+    server.setAuth(std::make_shared<ServiceAuth>(SERVICE_DID, nullptr));
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+
+    LoadGenerator::Options options;
+    options.port = server.port();
+    options.feeds = {"at://did:plc:publisher/app.bsky.feed.generator/test"};
+    options.serviceDid = SERVICE_DID;
+    options.requestsPerSecond = 400;
+    options.duration = std::chrono::milliseconds(500);
+    options.connections = 4;
+    options.limit = 10;
+    options.depthWeights = {0.4, 0.3, 0.3};
+    options.viewers = 20;
+    const auto report = LoadGenerator(options).run();
+    server.stop();
+
+    // Poisson arrivals: 200 expected, far outside these bounds only if the schedule is wrong
+    EXPECT_GT(report.sent, 100u);
+    EXPECT_LT(report.sent, 300u);
+    EXPECT_EQ(report.succeeded, report.sent);
+    EXPECT_EQ(report.noResponse, 0u);
+    EXPECT_TRUE(report.errors.empty());
+    EXPECT_GT(report.authenticated, 0u);
+    EXPECT_LT(report.authenticated, report.sent);
+
+    ASSERT_EQ(report.sentByDepth.size(), 3u);
+    EXPECT_EQ(report.sentByDepth[0] + report.sentByDepth[1] + report.sentByDepth[2], report.sent);
+    EXPECT_GT(report.sentByDepth[2], 0u); // Third pages follow cursors from second pages
+
+    EXPECT_EQ(report.responseTime.count, report.sent);
+    EXPECT_EQ(report.serviceTime.count, report.sent);
+    // Measured from the scheduled start, so never shorter than from the send
+    EXPECT_GE(report.responseTime.sum, report.serviceTime.sum);
+    // A local page takes well under a millisecond; 40ms would be Nagle holding the body for a delayed ACK
+    EXPECT_LT(report.serviceTime.quantile(0.5), 20'000'000u);
+
+    const auto summary = LoadGenerator::format(options, report);
+    EXPECT_NE(summary.find("sent " + std::to_string(report.sent)), std::string::npos);
+    EXPECT_NE(summary.find("p99.9"), std::string::npos);
+}
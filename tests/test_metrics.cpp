@@ -0,0 +1,105 @@
+//
+// Created by jayian on 2/11/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../tools/metrics.hpp"
+
+TEST(HistogramTest, BucketsCoverEveryValueWithinAnEighth) {
+    uint32_t previous = 0;
+    for (uint64_t value = 0; value < 100000; ++value) {
+        const auto bucket = Histogram::bucketFor(value);
+        EXPECT_GE(value, Histogram::bucketLowerBound(bucket));
+        EXPECT_LE(value, Histogram::bucketUpperBound(bucket));
+        EXPECT_LE(Histogram::bucketUpperBound(bucket) - Histogram::bucketLowerBound(bucket), value / 8);
+        EXPECT_LE(bucket - previous, 1u) << value; // No bucket is skipped
+        previous = bucket;
+    }
+    EXPECT_EQ(Histogram::bucketFor(UINT64_MAX), Histogram::BUCKETS - 1);
+    EXPECT_EQ(Histogram::bucketUpperBound(Histogram::BUCKETS - 1), UINT64_MAX);
+}
+
+TEST(HistogramTest, QuantilesOfAUniformSpread) {
+    Histogram histogram;
+    for (uint64_t i = 1; i <= 10000; ++i) {
+        histogram.record(i * 1000);
+    }
+    const auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, 10000u);
+    EXPECT_EQ(snapshot.sum, uint64_t{1000} * 10000 * 10001 / 2);
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.5)), 5e6, 5e6 / 8);
+    EXPECT_NEAR(static_cast<double>(snapshot.quantile(0.99)), 9.9e6, 9.9e6 / 8);
+    EXPECT_EQ(Histogram().snapshot().quantile(0.5), 0u);
+}
+
+TEST(HistogramTest, ThreadsRecordWithoutLosingCounts) {
+    Histogram histogram;
+    Counter counter;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 100000; ++i) {
+                histogram.record(static_cast<uint64_t>(i));
+                counter.add();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(histogram.snapshot().count, 800000u);
+    EXPECT_EQ(counter.value(), 800000u);
+}
+
+TEST(MetricsTest, RendersPrometheusText) {
+    Metrics metrics;
+    metrics.counter("requests_total", "Requests").add(3);
+    metrics.counter("requests_total{route=\"a\"}", "Requests").add(2);
+    metrics.gauge("temperature", "Degrees").set(21.5);
+    metrics.sample("queue_depth{stage=\"decode/0\"}", "Depth", Metrics::Type::Gauge, [] { return 7.0; });
+    metrics.histogram("latency_seconds{route=\"a\"}", "Latency").record(2'000'000);
+
+    EXPECT_EQ(&metrics.counter("requests_total", "ignored"), &metrics.counter("requests_total", "Requests"));
+    EXPECT_THROW(metrics.gauge("requests_total{route=\"b\"}", "Requests"), MetricsException);
+    EXPECT_THROW(metrics.counter("broken{", "Broken"), MetricsException);
+
+    const auto text = metrics.render();
+    EXPECT_EQ(text,
+              "# HELP latency_seconds Latency\n"
+              "# TYPE latency_seconds histogram\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.0001\"} 0\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.00025\"} 0\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.0005\"} 0\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.001\"} 0\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.0025\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.005\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.01\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.025\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.05\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.1\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.25\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"0.5\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"1\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"2.5\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"5\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"10\"} 1\n"
+              "latency_seconds_bucket{route=\"a\",le=\"+Inf\"} 1\n"
+              "latency_seconds_sum{route=\"a\"} 0.002\n"
+              "latency_seconds_count{route=\"a\"} 1\n"
+              "# HELP queue_depth Depth\n"
+              "# TYPE queue_depth gauge\n"
+              "queue_depth{stage=\"decode/0\"} 7\n"
+              "# HELP requests_total Requests\n"
+              "# TYPE requests_total counter\n"
+              "requests_total 3\n"
+              "requests_total{route=\"a\"} 2\n"
+              "# HELP temperature Degrees\n"
+              "# TYPE temperature gauge\n"
+              "temperature 21.5\n");
+
+    metrics.remove("queue_depth{stage=\"decode/0\"}");
+    EXPECT_EQ(metrics.render().find("queue_depth"), std::string::npos);
+}
@@ -0,0 +1,61 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../tools/process_signals.hpp"
+
+TEST(ProcessSignalsTest, TurnsSignalsIntoRequests) {
+    ProcessSignals signals;
+
+    // Blocked, so raising them leaves them pending instead of running the default action
+    ASSERT_EQ(kill(getpid(), SIGHUP), 0);
+    EXPECT_EQ(signals.wait(), ProcessSignals::Request::Reload);
+    ASSERT_EQ(kill(getpid(), SIGTERM), 0);
+    EXPECT_EQ(signals.wait(), ProcessSignals::Request::Shutdown);
+    ASSERT_EQ(kill(getpid(), SIGINT), 0);
+    EXPECT_EQ(signals.wait(), ProcessSignals::Request::Shutdown);
+}
+
+TEST(ProcessSignalsTest, NotifiesTheSupervisorSocket) {
+    unsetenv("NOTIFY_SOCKET");
+    EXPECT_FALSE(ProcessSignals::notify("READY=1"));
+
+    const auto path = testing::TempDir() + "process_signals_notify.sock";
+    std::remove(path.c_str());
+    const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    ASSERT_LT(path.size(), sizeof(address.sun_path));
+    path.copy(address.sun_path, path.size());
+    ASSERT_EQ(bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+
+    setenv("NOTIFY_SOCKET", path.c_str(), 1);
+    EXPECT_TRUE(ProcessSignals::notify("READY=1"));
+    char buffer[64];
+    const auto received = recv(fd, buffer, sizeof(buffer), 0);
+    EXPECT_EQ(std::string(buffer, received > 0 ? received : 0), "READY=1");
+
+    unsetenv("NOTIFY_SOCKET");
+    close(fd);
+    std::remove(path.c_str());
+}
+
+TEST(ProcessSignalsTest, WritesToAResetPeerFailInsteadOfKillingTheProcess) {
+    ProcessSignals::ignoreBrokenPipes();
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), 0);
+    close(sockets[1]);
+    EXPECT_EQ(write(sockets[0], "x", 1), -1);
+    EXPECT_EQ(errno, EPIPE);
+    close(sockets[0]);
+}
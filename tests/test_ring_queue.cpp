@@ -0,0 +1,166 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include "../tools/ring_queue.hpp"
+
+TEST(RingQueueTest, SpscKeepsOrderAcrossThreads) {
+    SpscQueue<uint64_t> queue(64);
+    constexpr uint64_t count = 200'000;
+
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < count; ++i) {
+            ASSERT_TRUE(queue.push(i));
+        }
+        queue.close();
+    });
+
+    std::vector<uint64_t> batch;
+    uint64_t expected = 0;
+    while (queue.popBatch(batch, 32) > 0) {
+        for (const auto value : batch) {
+            ASSERT_EQ(value, expected++);
+        }
+        batch.clear();
+    }
+    producer.join();
+
+    EXPECT_EQ(expected, count);
+    const auto stats = queue.stats();
+    EXPECT_EQ(stats.pushed, count);
+    EXPECT_EQ(stats.popped, count);
+    EXPECT_EQ(stats.depth, 0u);
+}
+
+TEST(RingQueueTest, MpscDeliversEveryValueOncePerProducerInOrder) {
+    MpscQueue<uint64_t> queue(128);
+    constexpr uint64_t producers = 4;
+    constexpr uint64_t perProducer = 50'000;
+
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p] {
+            for (uint64_t i = 0; i < perProducer; ++i) {
+                ASSERT_TRUE(queue.push(p << 32 | i));
+            }
+        });
+    }
+
+    std::vector<uint64_t> next(producers, 0);
+    std::vector<uint64_t> batch;
+    uint64_t received = 0;
+    while (received < producers * perProducer) {
+        queue.popBatch(batch, 64);
+        for (const auto value : batch) {
+            const auto producer = value >> 32;
+            ASSERT_EQ(value & 0xFFFFFFFF, next[producer]++);
+        }
+        received += batch.size();
+        batch.clear();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(RingQueueTest, HighWaterMarkBoundsDepth) {
+    SpscQueue<int> queue(16, 4);
+    EXPECT_EQ(queue.stats().capacity, 16u);
+    EXPECT_EQ(queue.stats().highWaterMark, 4u);
+
+    for (int i = 0; i < 4; ++i) {
+        auto value = i;
+        EXPECT_TRUE(queue.tryPush(value));
+    }
+    auto value = 4;
+    EXPECT_FALSE(queue.tryPush(value));
+
+    MpscQueue<int> events(16, 2);
+    auto first = 1, second = 2, third = 3;
+    EXPECT_TRUE(events.tryPush(first));
+    EXPECT_TRUE(events.tryPush(second));
+    EXPECT_FALSE(events.tryPush(third));
+}
+
+TEST(RingQueueTest, FullQueueBlocksProducerUntilConsumerCatchesUp) {
+    SpscQueue<int> queue(2);
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+
+    std::atomic<bool> pushed{false};
+    std::thread producer([&] {
+        pushed = queue.push(3);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(pushed);
+
+    std::vector<int> batch;
+    EXPECT_EQ(queue.popBatch(batch, 1), 1u);
+    producer.join();
+    EXPECT_TRUE(pushed);
+    EXPECT_GT(queue.stats().pushStallNs, 0u);
+}
+
+TEST(RingQueueTest, CloseDrainsRemainingValuesAndRejectsNewOnes) {
+    MpscQueue<std::string> queue(8);
+    ASSERT_TRUE(queue.push("a"));
+    ASSERT_TRUE(queue.push("b"));
+    queue.close();
+    EXPECT_FALSE(queue.push("c"));
+
+    std::vector<std::string> batch;
+    EXPECT_EQ(queue.popBatch(batch, 8), 2u);
+    EXPECT_EQ(batch, (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(queue.popBatch(batch, 8), 0u);
+}
+
+TEST(RingQueueTest, CloseWakesBlockedProducer) {
+    SpscQueue<int> queue(2);
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+
+    std::thread producer([&] {
+        EXPECT_FALSE(queue.push(3));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+    producer.join();
+}
+
+TEST(RingQueueTest, IdleConsumerParksUntilAPushWakesIt) {
+    SpscQueue<int> frames(8);
+    MpscQueue<int> events(8);
+
+    std::vector<int> fromFrames;
+    std::vector<int> fromEvents;
+    std::thread consumer([&] {
+        EXPECT_EQ(frames.popBatch(fromFrames, 8), 1u);
+        EXPECT_EQ(events.popBatch(fromEvents, 8), 1u);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(frames.stats().consumerParks, 1u);
+
+    ASSERT_TRUE(frames.push(7));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(events.stats().consumerParks, 1u);
+    ASSERT_TRUE(events.push(9));
+    consumer.join();
+
+    EXPECT_EQ(fromFrames, std::vector<int>{7});
+    EXPECT_EQ(fromEvents, std::vector<int>{9});
+}
+
+TEST(RingQueueTest, CloseWakesParkedConsumer) {
+    MpscQueue<int> queue(8);
+    std::thread consumer([&] {
+        std::vector<int> batch;
+        EXPECT_EQ(queue.popBatch(batch, 8), 0u);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.close();
+    consumer.join();
+}
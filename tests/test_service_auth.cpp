@@ -0,0 +1,181 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include "../auth/service_auth.hpp"
+#include "../cpp-httplib/httplib.h"
+#include "../server/feed_server.hpp"
+#include "../tools/base64.hpp"
+
+static constexpr auto SERVICE_DID = "did:web:feeds.example.com";
+static constexpr auto METHOD = "app.bsky.feed.getFeedSkeleton";
+
+TEST(EncodingTest, Base64UrlAndBase58RoundTrip) {
+    const std::string bytes("\x00\x00\xff\x10hello\xfb", 10);
+    EXPECT_EQ(Base64::decodeUrl(Base64::encodeUrl(bytes)), bytes);
+    EXPECT_EQ(Base64::encodeUrl("\xfb\xff"), "-_8");
+    EXPECT_FALSE(Base64::decodeUrl("not base64!").has_value());
+
+    EXPECT_EQ(Base58::encode("hello world"), "StV1DL6CwTryKyV");
+    EXPECT_EQ(Base58::decode(Base58::encode(bytes)), bytes);
+    EXPECT_FALSE(Base58::decode("0OIl").has_value());
+}
+
+TEST(SigningKeyTest, SignsAndVerifiesOnBothCurves) {
+    for (const auto curve : {SigningKey::Curve::Secp256k1, SigningKey::Curve::P256}) {
+        const auto key = SigningKey::generate(curve);
+        const auto signature = key.sign("message");
+        EXPECT_EQ(signature.size(), 64u);
+        EXPECT_TRUE(key.verify("message", signature));
+        EXPECT_FALSE(key.verify("other message", signature));
+
+        const auto publicKey = SigningKey::fromDidKey(key.didKey());
+        ASSERT_TRUE(publicKey.has_value());
+        EXPECT_EQ(publicKey->curve(), curve);
+        EXPECT_FALSE(publicKey->hasPrivateKey());
+        EXPECT_TRUE(publicKey->verify("message", signature));
+        EXPECT_EQ(publicKey->multibase(), key.multibase());
+    }
+}
+
+TEST(SigningKeyTest, DecodesMultikeyPrefixes) {
+    EXPECT_EQ(SigningKey::generate(SigningKey::Curve::Secp256k1).multibase().substr(0, 4), "zQ3s");
+    EXPECT_EQ(SigningKey::generate(SigningKey::Curve::P256).multibase().substr(0, 4), "zDna");
+    EXPECT_FALSE(SigningKey::fromMultibase("zQ3shnotakey").has_value());
+    EXPECT_FALSE(SigningKey::fromDidKey("did:plc:abc").has_value());
+}
+
+TEST(ServiceAuthTest, VerifiesTokensAndMemoizesResults) {
+    const auto key = SigningKey::generate(SigningKey::Curve::Secp256k1);
+    const auto multibase = key.multibase();
+    int resolved = 0;
+    ServiceAuth auth(SERVICE_DID, [&](const std::string& did, bool) -> std::optional<std::string> {
+        ++resolved;
+        return did == "did:plc:viewer" ? std::optional<std::string>(multibase) : std::nullopt;
+    });
+
+    const auto token = ServiceAuth::createToken(key, "did:plc:viewer", SERVICE_DID, METHOD, std::chrono::seconds(60));
+    EXPECT_EQ(auth.verify(token, METHOD), "did:plc:viewer");
+    EXPECT_EQ(auth.verify(token, METHOD), "did:plc:viewer");
+    EXPECT_EQ(auth.memoHits(), 1u);
+    EXPECT_EQ(resolved, 1);
+
+    // A second token from the same issuer reuses the cached key
+    const auto another = ServiceAuth::createToken(key, "did:plc:viewer#atproto", SERVICE_DID, METHOD, std::chrono::seconds(120));
+    EXPECT_EQ(auth.verify(another, METHOD), "did:plc:viewer");
+    EXPECT_EQ(resolved, 1);
+
+    EXPECT_FALSE(auth.verify(token, "app.bsky.feed.getTimeline").has_value());
+    EXPECT_FALSE(auth.verify(token, METHOD, ServiceAuth::Clock::now() + std::chrono::hours(1)).has_value());
+}
+
+TEST(ServiceAuthTest, RejectsForgedAndMisaddressedTokens) {
+    const auto key = SigningKey::generate(SigningKey::Curve::P256);
+    const auto impostor = SigningKey::generate(SigningKey::Curve::P256);
+    ServiceAuth auth(SERVICE_DID, [&](const std::string&, bool) {
+        return std::optional<std::string>(key.multibase());
+    });
+
+    const auto forged = ServiceAuth::createToken(impostor, "did:plc:viewer", SERVICE_DID, METHOD, std::chrono::seconds(60));
+    EXPECT_FALSE(auth.verify(forged, METHOD).has_value());
+
+    const auto elsewhere = ServiceAuth::createToken(key, "did:plc:viewer", "did:web:other", METHOD, std::chrono::seconds(60));
+    EXPECT_FALSE(auth.verify(elsewhere, METHOD).has_value());
+
+    auto tampered = ServiceAuth::createToken(key, "did:plc:viewer", SERVICE_DID, METHOD, std::chrono::seconds(60));
+    tampered[tampered.size() / 2] = tampered[tampered.size() / 2] == 'A' ? 'B' : 'A';
+    EXPECT_FALSE(auth.verify(tampered, METHOD).has_value());
+
+    EXPECT_FALSE(auth.verify("garbage", METHOD).has_value());
+    EXPECT_FALSE(auth.verify("a.b.c", METHOD).has_value());
+}
+
+TEST(ServiceAuthTest, AsksForRefreshedKeysAndBoundsTheKeyCache) {
+    const auto rotated = SigningKey::generate(SigningKey::Curve::P256);
+    const auto previous = SigningKey::generate(SigningKey::Curve::P256);
+    std::vector<bool> refreshes;
+    ServiceAuth::Options options;
+    options.maxCachedKeys = 4;
+    ServiceAuth auth(SERVICE_DID, [&](const std::string&, const bool refresh) {
+        refreshes.push_back(refresh);
+        return std::optional<std::string>((refreshes.size() == 1 ? previous : rotated).multibase());
+    }, options);
+
+    // The key cached from the first lookup fails; the refetch asks the resolver to bypass its caches
+    const auto now = ServiceAuth::Clock::now();
+    const auto token = ServiceAuth::createToken(rotated, "did:plc:viewer", SERVICE_DID, METHOD, std::chrono::hours(1));
+    EXPECT_FALSE(auth.verify(token, METHOD, now).has_value());
+    EXPECT_EQ(auth.verify(token, METHOD, now + std::chrono::minutes(2)), "did:plc:viewer");
+    EXPECT_EQ(refreshes, (std::vector<bool>{false, true}));
+
+    for (int i = 0; i < 20; ++i) {
+        const auto issuer = "did:plc:issuer" + std::to_string(i);
+        const auto token = ServiceAuth::createToken(rotated, issuer, SERVICE_DID, METHOD, std::chrono::hours(1));
+        EXPECT_EQ(auth.verify(token, METHOD, now), issuer);
+    }
+    EXPECT_LE(auth.cachedKeys(), 4u);
+
+    // Issuers that could never be resolved, or tokens we could never verify, cost no lookup at all
+    const auto lookups = auth.keyResolutions();
+    EXPECT_FALSE(auth.verify(ServiceAuth::createToken(rotated, "did:example:x", SERVICE_DID, METHOD,
+                                                      std::chrono::hours(1)), METHOD, now).has_value());
+    EXPECT_EQ(auth.keyResolutions(), lookups);
+}
+
+TEST(ServiceAuthTest, AcceptsDidKeyIssuersWithoutResolving) {
+    const auto key = SigningKey::generate(SigningKey::Curve::Secp256k1);
+    ServiceAuth auth(SERVICE_DID, nullptr);
+    const auto token = ServiceAuth::createToken(key, key.didKey(), SERVICE_DID, METHOD, std::chrono::seconds(60));
+    EXPECT_EQ(auth.verify(token, METHOD), key.didKey());
+    EXPECT_EQ(auth.keyResolutions(), 0u);
+}
+
+TEST(ServiceAuthTest, ReadsSigningKeyFromDidDocument) {
+    const auto document = nlohmann::json::parse(R"({
+        "id": "did:plc:abc",
+        "verificationMethod": [
+            {"id": "did:plc:abc#other", "publicKeyMultibase": "zOther"},
+            {"id": "did:plc:abc#atproto", "type": "Multikey", "publicKeyMultibase": "zQ3shKey"}
+        ]
+    })");
+    EXPECT_EQ(ServiceAuth::signingKeyFromDocument(document), "zQ3shKey");
+    EXPECT_FALSE(ServiceAuth::signingKeyFromDocument(nlohmann::json::object()).has_value());
+}
+
+TEST(ServiceAuthTest, PersonalizedFeedRequiresValidToken) {
+    const auto posts = std::make_shared<StringInterner>();
+    auto feed = std::make_shared<Feed>("following", posts, FeedSort::Chronological, 100);
+    feed->setFollowingOnly(true);
+    feed->index().insert(1000, 1, posts->intern("at://did:plc:a/app.bsky.feed.post/1"), 7);
+    feed->index().insert(2000, 2, posts->intern("at://did:plc:b/app.bsky.feed.post/2"), 8);
+
+    const auto viewerKey = SigningKey::generate(SigningKey::Curve::Secp256k1);
+    FeedServer server(SERVICE_DID, "did:plc:publisher", "test-secret");
+    server.addFeed(feed);
+    server.setAuth(std::make_shared<ServiceAuth>(SERVICE_DID, nullptr));
+    server.setFollowsLookup([](const std::string&) { return std::optional<std::vector<uint32_t>>(std::vector<uint32_t>{7}); });
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+
+    httplib::Client client("127.0.0.1", server.port());
+    const std::string path = "/xrpc/app.bsky.feed.getFeedSkeleton?feed=at://did:plc:publisher/app.bsky.feed.generator/following";
+
+    const auto anonymous = client.Get(path);
+    ASSERT_TRUE(anonymous);
+    EXPECT_EQ(anonymous->status, 401);
+
+    const auto bad = client.Get(path, {{"Authorization", "Bearer not.a.token"}});
+    ASSERT_TRUE(bad);
+    EXPECT_EQ(bad->status, 401);
+
+    const auto token = ServiceAuth::createToken(viewerKey, viewerKey.didKey(), SERVICE_DID, METHOD, std::chrono::seconds(60));
+    const auto signedIn = client.Get(path, {{"Authorization", "Bearer " + token}});
+    ASSERT_TRUE(signedIn);
+    EXPECT_EQ(signedIn->status, 200);
+    const auto body = nlohmann::json::parse(signedIn->body);
+    ASSERT_EQ(body["feed"].size(), 1u);
+    EXPECT_EQ(body["feed"][0]["post"], "at://did:plc:a/app.bsky.feed.post/1");
+
+    server.stop();
+}
@@ -0,0 +1,107 @@
+//
+// Created by jayian on 1/13/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <random>
+#include "../feed/top_k.hpp"
+
+using namespace std::chrono_literals;
+
+static const DecayedTopK::Clock::time_point START{std::chrono::hours(480000)};
+
+TEST(DecayedTopKTest, KeepsHighestScoresInOrder) {
+    DecayedTopK topK(3, 3600s);
+    for (uint32_t postId = 1; postId <= 5; ++postId) {
+        topK.add(postId, postId, START);
+    }
+
+    EXPECT_EQ(*topK.ranked(), (std::vector<uint32_t>{5, 4, 3}));
+
+    // Engagement reorders the live heap but readers keep the published ranking until the next rebuild
+    const auto version = topK.version();
+    topK.add(1, 10, START);
+    EXPECT_EQ(topK.version(), version);
+    EXPECT_EQ(*topK.ranked(), (std::vector<uint32_t>{5, 4, 3}));
+
+    topK.rebuild(START);
+    EXPECT_GT(topK.version(), version);
+    EXPECT_EQ(*topK.ranked(), (std::vector<uint32_t>{1, 5, 4}));
+    EXPECT_EQ(topK.candidateCount(), 5u);
+}
+
+TEST(DecayedTopKTest, RecentEngagementOutranksOlder) {
+    DecayedTopK topK(2, 3600s);
+    topK.add(1, 10, START);
+    topK.add(2, 6, START + 3600s);
+
+    // One half-life later post 1 is worth 5 against post 2's 6
+    EXPECT_EQ(topK.ranked()->front(), 2u);
+    EXPECT_NEAR(topK.score(1, START + 3600s), 5.0, 1e-9);
+}
+
+TEST(DecayedTopKTest, RebasesWithoutChangingOrder) {
+    DecayedTopK topK(2, 1s);
+    topK.add(1, 1, START);
+    topK.add(2, 2, START + 100s); // Forces a rebase past 2^60
+    topK.add(1, 1, START + 100s);
+
+    EXPECT_EQ(*topK.ranked(), (std::vector<uint32_t>{2, 1}));
+    EXPECT_NEAR(topK.score(2, START + 100s), 2.0, 1e-9);
+}
+
+TEST(DecayedTopKTest, RebuildRestoresDisplacedCandidates) {
+    DecayedTopK topK(2, 3600s);
+    topK.add(1, 5, START);
+    topK.add(2, 4, START);
+    topK.add(3, 3, START);
+
+    // Removing and weakening members leaves better candidates outside until rebuild
+    topK.remove(1);
+    topK.add(2, -3.5, START);
+    EXPECT_EQ(topK.size(), 1u);
+
+    const auto before = topK.version();
+    topK.rebuild(START);
+    EXPECT_GT(topK.version(), before);
+    EXPECT_EQ(*topK.ranked(), (std::vector<uint32_t>{3, 2}));
+}
+
+TEST(DecayedTopKTest, RebuildPrunesAndBoundsCandidates) {
+    DecayedTopK topK(2, 60s, 4);
+    for (uint32_t postId = 0; postId < 10; ++postId) {
+        topK.add(postId, 1 + postId, START);
+    }
+    topK.rebuild(START);
+    EXPECT_EQ(topK.candidateCount(), 4u);
+
+    EXPECT_FALSE(topK.rebuildIfDue(START + 30s, 60s));
+    EXPECT_TRUE(topK.rebuildIfDue(START + 24h, 60s));
+    EXPECT_EQ(topK.candidateCount(), 0u);
+    EXPECT_TRUE(topK.ranked()->empty());
+}
+
+TEST(DecayedTopKTest, MatchesFullSortUnderRandomEvents) {
+    DecayedTopK topK(10, 600s);
+    std::vector<double> expected(200, 0.0);
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<uint32_t> post(0, 199);
+
+    for (int i = 0; i < 5000; ++i) {
+        const auto postId = post(rng);
+        topK.add(postId, 1.0, START);
+        expected[postId] += 1.0;
+    }
+
+    std::vector<uint32_t> ids(200);
+    for (uint32_t i = 0; i < 200; ++i) {
+        ids[i] = i;
+    }
+    std::sort(ids.begin(), ids.end(), [&](const uint32_t a, const uint32_t b) {
+        return expected[a] != expected[b] ? expected[a] > expected[b] : a > b;
+    });
+    ids.resize(10);
+
+    EXPECT_EQ(*topK.ranked(), ids);
+}
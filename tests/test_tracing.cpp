@@ -0,0 +1,141 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+#include "../nlohmann/json.hpp"
+#include "../tools/tracing.hpp"
+
+static nlohmann::json exportedEvents() {
+    return nlohmann::json::parse(Tracing::exportChromeJson())["traceEvents"];
+}
+
+class TracingTest : public testing::Test {
+protected:
+    void SetUp() override { Tracing::clear(); }
+    void TearDown() override { Tracing::setSampleEvery(0); }
+};
+
+TEST_F(TracingTest, NothingIsRecordedWhileOff) {
+    Tracing::setSampleEvery(0);
+    {
+        const Trace trace("request");
+        EXPECT_FALSE(trace.sampled());
+        EXPECT_FALSE(Tracing::active());
+        Span span("step");
+    }
+    Span outside("outside"); // Not in any trace
+    outside.end();
+    EXPECT_TRUE(exportedEvents().empty());
+}
+
+TEST_F(TracingTest, SpansJoinTheTraceTheyRunIn) {
+    Tracing::setSampleEvery(1);
+    {
+        const Trace trace("request");
+        EXPECT_TRUE(trace.sampled());
+        {
+            Span span("step");
+        }
+        const Trace nested("call"); // Inside a trace, just another span
+        EXPECT_FALSE(nested.sampled());
+        const auto now = Tracing::now();
+        Tracing::record("phase", now, now + 1500);
+    }
+    EXPECT_FALSE(Tracing::active());
+
+    const auto events = exportedEvents();
+    ASSERT_EQ(events.size(), 4u);
+    std::map<std::string, nlohmann::json> byName;
+    for (const auto& event : events) {
+        EXPECT_EQ(event["ph"], "X");
+        EXPECT_EQ(event["args"]["trace"], events[0]["args"]["trace"]);
+        byName[event["name"].get<std::string>()] = event;
+    }
+    EXPECT_EQ(byName["request"]["ts"], 0.0); // Timestamps start at the earliest span
+    EXPECT_DOUBLE_EQ(byName["phase"]["dur"].get<double>(), 1.5);
+    EXPECT_GE(byName["request"]["dur"].get<double>(), byName["step"]["dur"].get<double>());
+    EXPECT_GE(byName["request"]["dur"].get<double>(), byName["call"]["dur"].get<double>());
+}
+
+TEST_F(TracingTest, SamplesOneInEveryNTracesPerThread) {
+    Tracing::setSampleEvery(3);
+    std::thread([] {
+        for (int i = 0; i < 7; ++i) {
+            const Trace trace("request");
+            Span span("step");
+        }
+    }).join();
+
+    const auto events = exportedEvents();
+    EXPECT_EQ(events.size(), 6u); // Traces 1, 4 and 7 with one step each
+    std::set<uint64_t> traces;
+    for (const auto& event : events) {
+        traces.insert(event["args"]["trace"].get<uint64_t>());
+    }
+    EXPECT_EQ(traces.size(), 3u);
+}
+
+TEST_F(TracingTest, RingsKeepTheNewestSpans) {
+    Tracing::setSampleEvery(1);
+    std::thread([] {
+        const Trace trace("request");
+        for (uint64_t i = 1; i <= Tracing::RING_CAPACITY + 100; ++i) {
+            Tracing::record("step", i * 1000, i * 1000 + 10);
+        }
+    }).join();
+
+    const auto events = exportedEvents();
+    ASSERT_EQ(events.size(), Tracing::RING_CAPACITY);
+    // The oldest steps were overwritten; the trace's own span was recorded last
+    EXPECT_EQ(events[0]["name"], "step");
+    EXPECT_DOUBLE_EQ(events[1]["ts"].get<double>() - events[0]["ts"].get<double>(), 1.0);
+    EXPECT_EQ(events[0]["tid"], events[Tracing::RING_CAPACITY - 1]["tid"]);
+
+    Tracing::clear();
+    EXPECT_TRUE(exportedEvents().empty());
+}
+
+TEST_F(TracingTest, ExportsWhileThreadsRecord) {
+    Tracing::setSampleEvery(1);
+    std::atomic<bool> stop{false};
+    std::atomic<int> recording{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&stop, &recording] {
+            for (bool first = true; !stop; first = false) {
+                {
+                    const Trace trace("request");
+                    Span span("step");
+                }
+                if (first) {
+                    ++recording;
+                }
+            }
+        });
+    }
+    while (recording < 4) {
+        std::this_thread::yield();
+    }
+
+    std::set<uint64_t> threadIds;
+    for (int i = 0; i < 20; ++i) {
+        for (const auto& event : exportedEvents()) {
+            ASSERT_TRUE(event["name"] == "request" || event["name"] == "step");
+            ASSERT_GE(event["dur"].get<double>(), 0.0);
+            threadIds.insert(event["tid"].get<uint64_t>());
+        }
+    }
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_LE(exportedEvents().size(), 4 * Tracing::RING_CAPACITY);
+    EXPECT_EQ(threadIds.size(), 4u);
+}
@@ -0,0 +1,91 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "base32.hpp"
+#include <array>
+
+static constexpr std::string_view ALPHABET = "234567abcdefghijklmnopqrstuvwxyz";
+static constexpr std::string_view MULTIBASE_ALPHABET = "abcdefghijklmnopqrstuvwxyz234567";
+
+static constexpr std::array<int8_t, 256> makeDecodeTable() {
+    std::array<int8_t, 256> table{};
+    for (auto& entry : table) {
+        entry = -1;
+    }
+    for (size_t i = 0; i < ALPHABET.size(); ++i) {
+        table[static_cast<unsigned char>(ALPHABET[i])] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+static constexpr auto DECODE_TABLE = makeDecodeTable();
+
+static void encodeWith(const std::string_view alphabet, const std::string_view bytes, std::string& out) {
+    out.reserve(out.size() + (bytes.size() * 8 + 4) / 5);
+
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char c : bytes) {
+        buffer = (buffer << 8) | c;
+        bits += 8;
+        while (bits >= 5) {
+            out += alphabet[(buffer >> (bits - 5)) & 0x1F];
+            bits -= 5;
+        }
+    }
+    if (bits > 0) {
+        out += alphabet[(buffer << (5 - bits)) & 0x1F];
+    }
+}
+
+std::string Base32::encode(const std::string_view bytes) {
+    std::string out;
+    encodeWith(ALPHABET, bytes, out);
+    return out;
+}
+
+std::string Base32::encodeMultibase(const std::string_view bytes) {
+    std::string out = "b";
+    encodeWith(MULTIBASE_ALPHABET, bytes, out);
+    return out;
+}
+
+std::optional<std::string> Base32::decode(const std::string_view text) {
+    std::string out;
+    out.reserve(text.size() * 5 / 8);
+
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char c : text) {
+        const auto value = DECODE_TABLE[c];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        buffer = (buffer << 5) | static_cast<uint32_t>(value);
+        bits += 5;
+        if (bits >= 8) {
+            out += static_cast<char>((buffer >> (bits - 8)) & 0xFF);
+            bits -= 8;
+        }
+    }
+    return out;
+}
+
+// A TID is a 64-bit integer written as 13 base32-sortable digits: 53 bits of microseconds, 10 bits of clock id
+std::optional<uint64_t> Base32::tidTimestamp(const std::string_view tid) {
+    if (tid.size() != 13) {
+        return std::nullopt;
+    }
+
+    uint64_t value = 0;
+    for (const unsigned char c : tid) {
+        const auto digit = DECODE_TABLE[c];
+        if (digit < 0) {
+            return std::nullopt;
+        }
+        value = (value << 5) | static_cast<uint64_t>(digit);
+    }
+    return (value >> 10) & ((1ULL << 53) - 1);
+}
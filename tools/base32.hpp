@@ -0,0 +1,32 @@
+//
+// Created by jayian on 1/21/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef BASE32_H
+#define BASE32_H
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// atproto's base32-sortable alphabet ("234567abcdefghijklmnopqrstuvwxyz"), unpadded.
+// Encoded strings sort in the same order as the bytes they encode, which is what makes TIDs sortable.
+class Base32 {
+public:
+    static std::string encode(std::string_view bytes);
+
+    // nullopt if the input contains characters outside the alphabet
+    static std::optional<std::string> decode(std::string_view text);
+
+    // RFC 4648 lowercase base32 with the "b" multibase prefix: the string form of a binary CIDv1
+    static std::string encodeMultibase(std::string_view bytes);
+
+    // Decode a 13-character TID record key into its microsecond timestamp
+    static std::optional<uint64_t> tidTimestamp(std::string_view tid);
+};
+
+#endif // BASE32_H
@@ -0,0 +1,130 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "base64.hpp"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+static constexpr std::string_view BASE64URL_ALPHABET = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static constexpr std::string_view BASE58_ALPHABET = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+static constexpr std::array<int8_t, 256> makeDecodeTable(const std::string_view alphabet) {
+    std::array<int8_t, 256> table{};
+    for (auto& entry : table) {
+        entry = -1;
+    }
+    for (size_t i = 0; i < alphabet.size(); ++i) {
+        table[static_cast<unsigned char>(alphabet[i])] = static_cast<int8_t>(i);
+    }
+    return table;
+}
+
+static constexpr auto BASE64URL_TABLE = makeDecodeTable(BASE64URL_ALPHABET);
+static constexpr auto BASE58_TABLE = makeDecodeTable(BASE58_ALPHABET);
+
+std::string Base64::encodeUrl(const std::string_view bytes) {
+    std::string out;
+    out.reserve((bytes.size() * 4 + 2) / 3);
+
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char c : bytes) {
+        buffer = (buffer << 8) | c;
+        bits += 8;
+        while (bits >= 6) {
+            out += BASE64URL_ALPHABET[(buffer >> (bits - 6)) & 0x3F];
+            bits -= 6;
+        }
+    }
+    if (bits > 0) {
+        out += BASE64URL_ALPHABET[(buffer << (6 - bits)) & 0x3F];
+    }
+    return out;
+}
+
+std::optional<std::string> Base64::decodeUrl(std::string_view text) {
+    while (!text.empty() && text.back() == '=') {
+        text.remove_suffix(1);
+    }
+
+    std::string out;
+    out.reserve(text.size() * 3 / 4);
+
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (const unsigned char c : text) {
+        const auto value = BASE64URL_TABLE[c];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            out += static_cast<char>((buffer >> (bits - 8)) & 0xFF);
+            bits -= 8;
+        }
+    }
+    return out;
+}
+
+// Base58 is a positional number system, so conversion is quadratic; inputs here are keys of ~35 bytes
+std::string Base58::encode(const std::string_view bytes) {
+    size_t zeros = 0;
+    while (zeros < bytes.size() && bytes[zeros] == 0) {
+        ++zeros;
+    }
+
+    std::vector<uint8_t> digits; // Little-endian base-58 digits
+    for (size_t i = zeros; i < bytes.size(); ++i) {
+        uint32_t carry = static_cast<unsigned char>(bytes[i]);
+        for (auto& digit : digits) {
+            carry += static_cast<uint32_t>(digit) << 8;
+            digit = static_cast<uint8_t>(carry % 58);
+            carry /= 58;
+        }
+        while (carry > 0) {
+            digits.push_back(static_cast<uint8_t>(carry % 58));
+            carry /= 58;
+        }
+    }
+
+    std::string out(zeros, BASE58_ALPHABET[0]);
+    for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+        out += BASE58_ALPHABET[*it];
+    }
+    return out;
+}
+
+std::optional<std::string> Base58::decode(const std::string_view text) {
+    size_t zeros = 0;
+    while (zeros < text.size() && text[zeros] == BASE58_ALPHABET[0]) {
+        ++zeros;
+    }
+
+    std::vector<uint8_t> bytes; // Little-endian
+    for (size_t i = zeros; i < text.size(); ++i) {
+        const auto value = BASE58_TABLE[static_cast<unsigned char>(text[i])];
+        if (value < 0) {
+            return std::nullopt;
+        }
+        uint32_t carry = static_cast<uint32_t>(value);
+        for (auto& byte : bytes) {
+            carry += static_cast<uint32_t>(byte) * 58;
+            byte = static_cast<uint8_t>(carry & 0xFF);
+            carry >>= 8;
+        }
+        while (carry > 0) {
+            bytes.push_back(static_cast<uint8_t>(carry & 0xFF));
+            carry >>= 8;
+        }
+    }
+
+    std::string out(zeros, '\0');
+    for (auto it = bytes.rbegin(); it != bytes.rend(); ++it) {
+        out += static_cast<char>(*it);
+    }
+    return out;
+}
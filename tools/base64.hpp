@@ -0,0 +1,31 @@
+//
+// Created by jayian on 2/3/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef BASE64_H
+#define BASE64_H
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Unpadded base64url (RFC 4648 section 5), as used by JWT segments
+class Base64 {
+public:
+    static std::string encodeUrl(std::string_view bytes);
+
+    // nullopt on characters outside the alphabet; trailing '=' padding is accepted
+    static std::optional<std::string> decodeUrl(std::string_view text);
+};
+
+// Bitcoin base58 alphabet, as used by multibase 'z' strings (did:key and publicKeyMultibase)
+class Base58 {
+public:
+    static std::string encode(std::string_view bytes);
+    static std::optional<std::string> decode(std::string_view text);
+};
+
+#endif // BASE64_H
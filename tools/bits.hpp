@@ -0,0 +1,42 @@
+//
+// Created by jayian on 2/10/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef BITS_H
+#define BITS_H
+
+#pragma once
+
+#include <cstdint>
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+// Bit scans that compile to one instruction on GCC, Clang and MSVC
+class Bits {
+public:
+    // Index of the lowest set bit; word must not be 0
+    static uint32_t lowest(const uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanForward64(&index, word);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(word));
+#endif
+    }
+
+    // Index of the highest set bit; word must not be 0
+    static uint32_t highest(const uint64_t word) {
+#ifdef _MSC_VER
+        unsigned long index = 0;
+        _BitScanReverse64(&index, word);
+        return static_cast<uint32_t>(index);
+#else
+        return 63u - static_cast<uint32_t>(__builtin_clzll(word));
+#endif
+    }
+};
+
+#endif // BITS_H
@@ -0,0 +1,268 @@
+//
+// Created by jayian on 2/6/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef DAG_CBOR_H
+#define DAG_CBOR_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+class DagCborException final : public std::exception {
+    std::string message;
+
+public:
+    explicit DagCborException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Pull decoder for DAG-CBOR, the strict CBOR subset used by atproto repos and the firehose.
+//
+// Items are read in place: strings, byte strings and CIDs come back as views into the input buffer, so
+// callers walk straight into typed structs without building a DOM. DAG-CBOR only allows definite
+// lengths, tag 42 (CIDs) and 64-bit floats; anything else, and any truncated item, throws
+// DagCborException.
+class DagCborReader {
+public:
+    enum class Type : uint8_t {
+        Unsigned,
+        Negative,
+        Bytes,
+        Text,
+        Array,
+        Map,
+        Tag,
+        Simple // false, true, null and floats
+    };
+
+    static constexpr uint64_t CID_TAG = 42;
+    static constexpr size_t MAX_DEPTH = 64;
+
+    explicit DagCborReader(const std::string_view data) : data(data) {}
+
+    [[nodiscard]] bool atEnd() const { return position >= data.size(); }
+    [[nodiscard]] size_t offset() const { return position; }
+    [[nodiscard]] std::string_view remaining() const { return data.substr(position); }
+
+    [[nodiscard]] Type peek() const {
+        if (atEnd()) {
+            throw DagCborException("Unexpected end of DAG-CBOR input");
+        }
+        return static_cast<Type>(static_cast<unsigned char>(data[position]) >> 5);
+    }
+
+    uint64_t readUnsigned() { return readHead(Type::Unsigned); }
+
+    int64_t readInteger() {
+        const auto type = peek();
+        const auto value = readHead(type == Type::Negative ? Type::Negative : Type::Unsigned);
+        if (value > static_cast<uint64_t>(INT64_MAX)) {
+            throw DagCborException("DAG-CBOR integer out of range");
+        }
+        return type == Type::Negative ? -1 - static_cast<int64_t>(value) : static_cast<int64_t>(value);
+    }
+
+    std::string_view readText() { return readString(Type::Text); }
+    std::string_view readBytes() { return readString(Type::Bytes); }
+
+    // The binary CID, without the identity multibase prefix byte that DAG-CBOR stores in front of it
+    std::string_view readCid() {
+        if (readHead(Type::Tag) != CID_TAG) {
+            throw DagCborException("Unsupported DAG-CBOR tag");
+        }
+        const auto bytes = readBytes();
+        if (bytes.empty() || bytes[0] != '\0') {
+            throw DagCborException("Malformed DAG-CBOR CID");
+        }
+        return bytes.substr(1);
+    }
+
+    // Element count of an array; the elements follow
+    uint64_t readArray() { return readHead(Type::Array); }
+
+    // Key/value pair count of a map; the pairs follow
+    uint64_t readMap() { return readHead(Type::Map); }
+
+    bool readBool() {
+        const auto value = readHead(Type::Simple);
+        if (value != SIMPLE_FALSE && value != SIMPLE_TRUE) {
+            throw DagCborException("Expected a DAG-CBOR boolean");
+        }
+        return value == SIMPLE_TRUE;
+    }
+
+    // Consume a null if one is next
+    bool readNull() {
+        if (!atEnd() && static_cast<unsigned char>(data[position]) == NULL_BYTE) {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    double readFloat() {
+        if (atEnd() || static_cast<unsigned char>(data[position]) != FLOAT64_BYTE) {
+            throw DagCborException("Expected a DAG-CBOR float");
+        }
+        const auto bits = readFixed(8, position + 1);
+        position += 9;
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Skip one complete item, including everything nested in it
+    void skip() { skip(0); }
+
+private:
+    static constexpr uint64_t SIMPLE_FALSE = 20;
+    static constexpr uint64_t SIMPLE_TRUE = 21;
+    static constexpr unsigned char NULL_BYTE = 0xF6;
+    static constexpr unsigned char FLOAT64_BYTE = 0xFB;
+
+    std::string_view data;
+    size_t position = 0;
+
+    // Big-endian unsigned integer of width bytes at offset
+    [[nodiscard]] uint64_t readFixed(const size_t width, const size_t offset) const {
+        if (offset + width > data.size()) {
+            throw DagCborException("Unexpected end of DAG-CBOR input");
+        }
+        uint64_t value = 0;
+        for (size_t i = 0; i < width; ++i) {
+            value = (value << 8) | static_cast<unsigned char>(data[offset + i]);
+        }
+        return value;
+    }
+
+    // Consume an item head of the expected major type and return its argument
+    uint64_t readHead(const Type expected) {
+        if (peek() != expected) {
+            throw DagCborException("Unexpected DAG-CBOR type");
+        }
+        const auto info = static_cast<unsigned char>(data[position]) & 0x1F;
+        if (info < 24) {
+            ++position;
+            return info;
+        }
+        if (info > 27) {
+            throw DagCborException("Indefinite or reserved DAG-CBOR length");
+        }
+        if (expected == Type::Simple && info != 24) {
+            throw DagCborException("Expected a DAG-CBOR simple value");
+        }
+        const size_t width = size_t{1} << (info - 24);
+        const auto value = readFixed(width, position + 1);
+        position += 1 + width;
+        return value;
+    }
+
+    std::string_view readString(const Type type) {
+        const auto length = readHead(type);
+        if (length > data.size() - position) {
+            throw DagCborException("Unexpected end of DAG-CBOR input");
+        }
+        const auto value = data.substr(position, length);
+        position += length;
+        return value;
+    }
+
+    void skip(const size_t depth) {
+        if (depth > MAX_DEPTH) {
+            throw DagCborException("DAG-CBOR nesting too deep");
+        }
+        switch (peek()) {
+            case Type::Unsigned:
+            case Type::Negative:
+                readHead(peek());
+                break;
+            case Type::Bytes:
+            case Type::Text:
+                readString(peek());
+                break;
+            case Type::Array:
+                for (auto count = readArray(); count > 0; --count) {
+                    skip(depth + 1);
+                }
+                break;
+            case Type::Map:
+                for (auto count = readMap(); count > 0; --count) {
+                    skip(depth + 1);
+                    skip(depth + 1);
+                }
+                break;
+            case Type::Tag:
+                readCid();
+                break;
+            case Type::Simple:
+                if (static_cast<unsigned char>(data[position]) == FLOAT64_BYTE) {
+                    readFloat();
+                } else if (!readNull()) {
+                    readBool();
+                }
+                break;
+        }
+    }
+};
+
+// Encoder for the same subset; callers are responsible for DAG-CBOR's canonical map key order
+class DagCborWriter {
+public:
+    static void appendUnsigned(std::string& out, const uint64_t value) { appendHead(out, 0, value); }
+
+    static void appendInteger(std::string& out, const int64_t value) {
+        if (value < 0) {
+            appendHead(out, 1, static_cast<uint64_t>(-1 - value));
+        } else {
+            appendHead(out, 0, static_cast<uint64_t>(value));
+        }
+    }
+
+    static void appendBytes(std::string& out, const std::string_view bytes) {
+        appendHead(out, 2, bytes.size());
+        out += bytes;
+    }
+
+    static void appendText(std::string& out, const std::string_view text) {
+        appendHead(out, 3, text.size());
+        out += text;
+    }
+
+    static void appendArray(std::string& out, const uint64_t count) { appendHead(out, 4, count); }
+    static void appendMap(std::string& out, const uint64_t count) { appendHead(out, 5, count); }
+
+    static void appendCid(std::string& out, const std::string_view cid) {
+        appendHead(out, 6, DagCborReader::CID_TAG);
+        appendHead(out, 2, cid.size() + 1);
+        out += '\0';
+        out += cid;
+    }
+
+    static void appendBool(std::string& out, const bool value) { out += static_cast<char>(value ? 0xF5 : 0xF4); }
+    static void appendNull(std::string& out) { out += static_cast<char>(0xF6); }
+
+private:
+    // Shortest head encoding, which DAG-CBOR requires
+    static void appendHead(std::string& out, const uint8_t majorType, const uint64_t value) {
+        const auto major = static_cast<uint8_t>(majorType << 5);
+        if (value < 24) {
+            out += static_cast<char>(major | value);
+            return;
+        }
+        int width = value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : value <= 0xFFFFFFFF ? 4 : 8;
+        out += static_cast<char>(major | (width == 1 ? 24 : width == 2 ? 25 : width == 4 ? 26 : 27));
+        while (width-- > 0) {
+            out += static_cast<char>((value >> (width * 8)) & 0xFF);
+        }
+    }
+};
+
+#endif // DAG_CBOR_H
@@ -0,0 +1,145 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "durable_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include "logging.hpp"
+#ifdef _WIN32
+#include <algorithm>
+#include <climits>
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+static int openTruncated(const std::string& path) {
+    int fd = -1;
+    _sopen_s(&fd, path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _SH_DENYWR, _S_IREAD | _S_IWRITE);
+    return fd;
+}
+
+static long writeSome(const int fd, const char* data, const size_t size) {
+    return _write(fd, data, static_cast<unsigned>(std::min<size_t>(size, INT_MAX)));
+}
+
+static bool syncFile(const int fd) {
+    return _commit(fd) == 0;
+}
+
+static int closeFile(const int fd) {
+    return _close(fd);
+}
+
+// Directories cannot be opened for flushing here; MoveFileEx already writes the rename through
+static bool syncDirectory(const std::filesystem::path&) {
+    return true;
+}
+#else
+static int openTruncated(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+}
+
+static long writeSome(const int fd, const char* data, const size_t size) {
+    return ::write(fd, data, size);
+}
+
+static bool syncFile(const int fd) {
+    return ::fsync(fd) == 0;
+}
+
+static int closeFile(const int fd) {
+    return ::close(fd);
+}
+
+static bool syncDirectory(const std::filesystem::path& directory) {
+    const int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const auto synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+#endif
+
+DurableFile::DurableFile(std::string path) : path(std::move(path)), temporary(this->path + ".tmp") {
+    fd = openTruncated(temporary);
+    if (fd < 0) {
+        fail("open");
+    }
+    buffer.reserve(BUFFER_SIZE);
+}
+
+DurableFile::~DurableFile() {
+    if (fd >= 0) {
+        closeFile(fd);
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+    }
+}
+
+bool DurableFile::write(const std::string_view data) {
+    if (failed) {
+        return false;
+    }
+    buffer.append(data);
+    return buffer.size() < BUFFER_SIZE || flush();
+}
+
+bool DurableFile::commit() {
+    if (failed || !flush()) {
+        return false;
+    }
+    if (!syncFile(fd)) {
+        return fail("sync");
+    }
+    const auto closed = closeFile(fd);
+    fd = -1;
+    if (closed != 0) {
+        return fail("close");
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        Logging::error("Unable to replace " + path + ": " + error.message());
+        std::filesystem::remove(temporary, error);
+        failed = true;
+        return false;
+    }
+    if (!syncDirectory(std::filesystem::path(path).parent_path())) {
+        Logging::error("Unable to sync the directory of " + path + ": " + std::strerror(errno));
+        failed = true;
+        return false;
+    }
+    return true;
+}
+
+bool DurableFile::flush() {
+    for (size_t written = 0; written < buffer.size();) {
+        const auto count = writeSome(fd, buffer.data() + written, buffer.size() - written);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return fail("write");
+        }
+        written += static_cast<size_t>(count);
+    }
+    buffer.clear();
+    return true;
+}
+
+bool DurableFile::fail(const std::string& what) {
+    Logging::error("Unable to " + what + " " + temporary + ": " + std::strerror(errno));
+    failed = true;
+    return false;
+}
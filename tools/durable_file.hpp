@@ -0,0 +1,47 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef DURABLE_FILE_H
+#define DURABLE_FILE_H
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Replaces a file so that the new contents survive a power loss once commit() returns true.
+//
+// Writes go through the descriptor of <path>.tmp in large chunks. commit() fsyncs it, renames it over
+// path and fsyncs the directory so the rename itself is on disk. Until then path keeps its previous
+// contents, and a writer destroyed without committing removes the temporary file.
+class DurableFile {
+public:
+    explicit DurableFile(std::string path);
+    ~DurableFile();
+
+    DurableFile(const DurableFile&) = delete;
+    DurableFile& operator=(const DurableFile&) = delete;
+
+    [[nodiscard]] bool isOpen() const { return fd >= 0; }
+
+    // Buffered; false once any write has failed
+    bool write(std::string_view data);
+
+    bool commit();
+
+private:
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
+    std::string path;
+    std::string temporary;
+    std::string buffer;
+    int fd = -1;
+    bool failed = false;
+
+    bool flush();
+    bool fail(const std::string& what);
+};
+
+#endif // DURABLE_FILE_H
@@ -0,0 +1,37 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef HASH_H
+#define HASH_H
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+class Hash {
+public:
+    // 64-bit FNV-1a followed by a murmur3 finalizer so every output bit is well mixed
+    static uint64_t bytes(const std::string_view data, const uint64_t seed = 0) {
+        uint64_t hash = 0xcbf29ce484222325ULL ^ seed;
+        for (const unsigned char c : data) {
+            hash ^= c;
+            hash *= 0x100000001b3ULL;
+        }
+        return mix(hash);
+    }
+
+    // murmur3 fmix64
+    static constexpr uint64_t mix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+};
+
+#endif // HASH_H
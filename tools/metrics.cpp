@@ -0,0 +1,246 @@
+//
+// Created by jayian on 2/11/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "metrics.hpp"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include "bits.hpp"
+
+size_t MetricShards::current() {
+    static std::atomic<size_t> nextShard{0};
+    thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % COUNT;
+    return shard;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const auto& slot : slots) {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Values below SUB_BUCKETS get a bucket each; above that, bucket = (exponent - 2) * 8 + the three bits
+// below the leading one
+uint32_t Histogram::bucketFor(const uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<uint32_t>(value);
+    }
+    const auto exponent = Bits::highest(value);
+    const auto shift = exponent - SUB_BUCKET_BITS;
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<uint32_t>((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+uint64_t Histogram::bucketLowerBound(const uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const auto shift = bucket / SUB_BUCKETS - 1;
+    return (uint64_t{SUB_BUCKETS} + bucket % SUB_BUCKETS) << shift;
+}
+
+uint64_t Histogram::bucketUpperBound(const uint32_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    return bucketLowerBound(bucket) + ((uint64_t{1} << (bucket / SUB_BUCKETS - 1)) - 1);
+}
+
+void Histogram::record(const uint64_t nanoseconds) {
+    auto& shard = shards[MetricShards::current()];
+    shard.buckets[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot result;
+    result.buckets.assign(BUCKETS, 0);
+    for (const auto& shard : shards) {
+        result.count += shard.count.load(std::memory_order_relaxed);
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < BUCKETS; ++i) {
+            result.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+// Counts the buckets themselves rather than trusting count, which a concurrent record() may have
+// bumped before or after its bucket
+uint64_t Histogram::Snapshot::quantile(const double q) const {
+    uint64_t total = 0;
+    for (const auto bucket : buckets) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total)));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            const auto lower = bucketLowerBound(i);
+            return lower + (bucketUpperBound(i) - lower) / 2;
+        }
+    }
+    return bucketUpperBound(BUCKETS - 1);
+}
+
+Metrics& Metrics::global() {
+    static Metrics instance;
+    return instance;
+}
+
+Metrics::Key Metrics::split(const std::string& name) {
+    const auto brace = name.find('{');
+    if (brace == std::string::npos) {
+        return {name, ""};
+    }
+    if (name.back() != '}') {
+        throw MetricsException("Malformed metric name: " + name);
+    }
+    return {name.substr(0, brace), name.substr(brace + 1, name.size() - brace - 2)};
+}
+
+Metrics::Entry& Metrics::entry(const std::string& name, const std::string& help, const Type type) {
+    auto key = split(name);
+    const auto family = entries.lower_bound(Key{key.first, ""});
+    if (family != entries.end() && family->first.first == key.first && family->second.type != type) {
+        throw MetricsException("Metric " + name + " registered with two different types");
+    }
+
+    auto [it, added] = entries.try_emplace(std::move(key));
+    if (added) {
+        it->second.type = type;
+        it->second.help = help;
+    }
+    return it->second;
+}
+
+Counter& Metrics::counter(const std::string& name, const std::string& help) {
+    std::lock_guard lock(mutex);
+    auto& found = entry(name, help, Type::Counter);
+    if (!found.counter) {
+        if (found.sampler) {
+            throw MetricsException("Metric " + name + " is already sampled");
+        }
+        found.counter = std::make_unique<Counter>();
+    }
+    return *found.counter;
+}
+
+Gauge& Metrics::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard lock(mutex);
+    auto& found = entry(name, help, Type::Gauge);
+    if (!found.gauge) {
+        if (found.sampler) {
+            throw MetricsException("Metric " + name + " is already sampled");
+        }
+        found.gauge = std::make_unique<Gauge>();
+    }
+    return *found.gauge;
+}
+
+Histogram& Metrics::histogram(const std::string& name, const std::string& help) {
+    std::lock_guard lock(mutex);
+    auto& found = entry(name, help, Type::Histogram);
+    if (!found.histogram) {
+        found.histogram = std::make_unique<Histogram>();
+    }
+    return *found.histogram;
+}
+
+void Metrics::sample(const std::string& name, const std::string& help, const Type type, std::function<double()> read) {
+    if (type == Type::Histogram) {
+        throw MetricsException("Histograms cannot be sampled: " + name);
+    }
+    std::lock_guard lock(mutex);
+    auto& found = entry(name, help, type);
+    if (found.counter || found.gauge) {
+        throw MetricsException("Metric " + name + " is already recorded directly");
+    }
+    found.sampler = std::move(read);
+}
+
+void Metrics::remove(const std::string& name) {
+    std::lock_guard lock(mutex);
+    entries.erase(split(name));
+}
+
+static void appendSample(std::string& out, const std::string& family, const std::string& suffix,
+                         const std::string& labels, const double value) {
+    out += family;
+    out += suffix;
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    char buffer[32];
+    if (std::isfinite(value) && value == std::floor(value) && std::fabs(value) < 1e15) {
+        std::snprintf(buffer, sizeof(buffer), " %" PRId64 "\n", static_cast<int64_t>(value));
+    } else {
+        std::snprintf(buffer, sizeof(buffer), " %.9g\n", value);
+    }
+    out += buffer;
+}
+
+std::string Metrics::render() const {
+    // Upper bounds of the exposed buckets in nanoseconds, with their le labels
+    static constexpr std::pair<uint64_t, const char*> BOUNDS[] = {
+        {100'000, "0.0001"}, {250'000, "0.00025"}, {500'000, "0.0005"}, {1'000'000, "0.001"},
+        {2'500'000, "0.0025"}, {5'000'000, "0.005"}, {10'000'000, "0.01"}, {25'000'000, "0.025"},
+        {50'000'000, "0.05"}, {100'000'000, "0.1"}, {250'000'000, "0.25"}, {500'000'000, "0.5"},
+        {1'000'000'000, "1"}, {2'500'000'000, "2.5"}, {5'000'000'000, "5"}, {10'000'000'000, "10"}
+    };
+
+    std::lock_guard lock(mutex);
+    std::string out;
+    const std::string* family = nullptr;
+    for (const auto& [key, metric] : entries) {
+        const auto& [name, labels] = key;
+        if (family == nullptr || *family != name) {
+            family = &name;
+            out += "# HELP " + name + " " + metric.help + "\n";
+            out += "# TYPE " + name + " ";
+            out += metric.type == Type::Counter ? "counter\n" : metric.type == Type::Gauge ? "gauge\n" : "histogram\n";
+        }
+
+        if (metric.histogram) {
+            // A recorded bucket counts towards a bound once all of it lies at or below the bound, so a
+            // bucket straddling one is reported under the next. Counts come from the buckets rather than
+            // from count, which a concurrent record() may have bumped before or after its bucket.
+            const auto snapshot = metric.histogram->snapshot();
+            const auto separator = labels.empty() ? "" : ",";
+            uint64_t cumulative = 0;
+            uint32_t bucket = 0;
+            for (const auto& [bound, text] : BOUNDS) {
+                for (; bucket < Histogram::BUCKETS && Histogram::bucketUpperBound(bucket) <= bound; ++bucket) {
+                    cumulative += snapshot.buckets[bucket];
+                }
+                appendSample(out, name, "_bucket", labels + separator + "le=\"" + text + "\"",
+                             static_cast<double>(cumulative));
+            }
+            for (; bucket < Histogram::BUCKETS; ++bucket) {
+                cumulative += snapshot.buckets[bucket];
+            }
+            appendSample(out, name, "_bucket", labels + separator + "le=\"+Inf\"", static_cast<double>(cumulative));
+            appendSample(out, name, "_sum", labels, static_cast<double>(snapshot.sum) / 1e9);
+            appendSample(out, name, "_count", labels, static_cast<double>(cumulative));
+        } else if (metric.counter) {
+            appendSample(out, name, "", labels, static_cast<double>(metric.counter->value()));
+        } else if (metric.gauge) {
+            appendSample(out, name, "", labels, metric.gauge->value());
+        } else if (metric.sampler) {
+            appendSample(out, name, "", labels, metric.sampler());
+        }
+    }
+    return out;
+}
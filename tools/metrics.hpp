@@ -0,0 +1,164 @@
+//
+// Created by jayian on 2/11/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class MetricsException final : public std::exception {
+    std::string message;
+
+public:
+    explicit MetricsException(std::string msg) : message(std::move(msg)) {}
+
+    [[nodiscard]] const char* what() const noexcept override {
+        return message.c_str();
+    }
+};
+
+// Hot-path metrics are split into per-thread shards: a thread only ever adds to its own shard with a
+// relaxed atomic, so recording takes no lock and never bounces a cache line between cores. Reads sum
+// the shards and are only as consistent as a scrape needs to be.
+namespace MetricShards {
+    constexpr size_t COUNT = 16;
+
+    // The calling thread's shard, fixed the first time it records anything
+    size_t current();
+}
+
+// Monotonic count of events
+class Counter {
+public:
+    void add(uint64_t amount = 1) {
+        slots[MetricShards::current()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t value() const;
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+    std::array<Slot, MetricShards::COUNT> slots;
+};
+
+// A value that goes up and down, set by its owner
+class Gauge {
+public:
+    void set(const double value) { current.store(value, std::memory_order_relaxed); }
+    [[nodiscard]] double value() const { return current.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> current{0.0};
+};
+
+// Latency distribution in nanoseconds, HDR-style: every power of two is split into 8 linear sub-buckets,
+// so any recorded value is known to within 12.5% from 1ns up to centuries, in a fixed 496 buckets.
+// Recording is one bucket lookup (a count-leading-zeros and a shift) and three relaxed adds.
+class Histogram {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 3;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0; // Nanoseconds
+        std::vector<uint64_t> buckets;
+
+        // Estimated value at quantile q in [0, 1]: the middle of the bucket holding it; 0 if empty
+        [[nodiscard]] uint64_t quantile(double q) const;
+    };
+
+    void record(uint64_t nanoseconds);
+
+    void recordSince(const std::chrono::steady_clock::time_point start) {
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    }
+
+    [[nodiscard]] Snapshot snapshot() const;
+
+    static uint32_t bucketFor(uint64_t value);
+    static uint64_t bucketLowerBound(uint32_t bucket);
+    static uint64_t bucketUpperBound(uint32_t bucket);
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> sum{0};
+        std::array<std::atomic<uint64_t>, BUCKETS> buckets{};
+    };
+    std::array<Shard, MetricShards::COUNT> shards;
+};
+
+// Named metrics and their Prometheus text exposition.
+//
+// Names may carry labels, e.g. bluesky_ingest_queue_depth{stage="decode/0"}; every metric of one family
+// (the name before the braces) must have the same type and shares its HELP line. Registering a name again
+// returns the same metric, so call sites keep the reference in a function-local static and pay for the
+// lookup once. Histograms are exposed as Prometheus histograms in seconds: cumulative counts at fixed
+// bounds from 100us to 10s, which a scraper can rate() over any window, rather than quantiles that would
+// cover everything since the process started.
+class Metrics {
+public:
+    enum class Type {
+        Counter,
+        Gauge,
+        Histogram
+    };
+
+    // The process-wide registry served on /metrics
+    static Metrics& global();
+
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    Histogram& histogram(const std::string& name, const std::string& help);
+
+    // A counter or gauge read from its owner at scrape time, e.g. a queue depth; replaces any sampler
+    // already registered under name
+    void sample(const std::string& name, const std::string& help, Type type, std::function<double()> read);
+
+    void remove(const std::string& name);
+
+    // Text exposition format 0.0.4
+    [[nodiscard]] std::string render() const;
+
+    static constexpr const char* CONTENT_TYPE = "text/plain; version=0.0.4";
+
+private:
+    struct Entry {
+        Type type;
+        std::string help;
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+        std::function<double()> sampler;
+    };
+
+    // Keyed by (family, labels) so that a family's metrics are adjacent when rendered
+    using Key = std::pair<std::string, std::string>;
+
+    mutable std::mutex mutex;
+    std::map<Key, Entry> entries;
+
+    Entry& entry(const std::string& name, const std::string& help, Type type);
+    static Key split(const std::string& name);
+};
+
+#endif // METRICS_H
@@ -0,0 +1,109 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "process_signals.hpp"
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <atomic>
+#include <chrono>
+#include <thread>
+#else
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+// No sigwait here: the handlers only raise a flag that wait() polls
+static std::atomic<int> pendingSignal{0};
+
+static void recordSignal(const int signal) {
+    pendingSignal.store(signal);
+}
+
+ProcessSignals::ProcessSignals() {
+    std::signal(SIGINT, recordSignal);
+    std::signal(SIGTERM, recordSignal);
+}
+
+ProcessSignals::~ProcessSignals() {
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+}
+
+ProcessSignals::Request ProcessSignals::wait() {
+    while (pendingSignal.exchange(0) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    return Request::Shutdown;
+}
+
+bool ProcessSignals::notify(std::string_view) {
+    return false;
+}
+
+void ProcessSignals::ignoreBrokenPipes() {
+    // Windows has no SIGPIPE; a reset socket only fails the write
+}
+#else
+static sigset_t handledSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGHUP);
+    return signals;
+}
+
+ProcessSignals::ProcessSignals() {
+    const auto signals = handledSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, &previousMask);
+}
+
+ProcessSignals::~ProcessSignals() {
+    pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+}
+
+void ProcessSignals::ignoreBrokenPipes() {
+    std::signal(SIGPIPE, SIG_IGN);
+}
+
+ProcessSignals::Request ProcessSignals::wait() {
+    const auto signals = handledSignals();
+    int signal = 0;
+    sigwait(&signals, &signal);
+    return signal == SIGHUP ? Request::Reload : Request::Shutdown;
+}
+
+bool ProcessSignals::notify(const std::string_view state) {
+    const char* path = std::getenv("NOTIFY_SOCKET");
+    if (path == nullptr || path[0] == '\0') {
+        return false;
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const auto length = std::strlen(path);
+    if (length >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::memcpy(address.sun_path, path, length);
+    if (path[0] == '@') {
+        address.sun_path[0] = '\0'; // Linux abstract namespace
+    }
+
+    const int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    const auto size = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + length);
+    const auto sent = sendto(fd, state.data(), state.size(), 0, reinterpret_cast<const sockaddr*>(&address), size);
+    close(fd);
+    return sent == static_cast<ssize_t>(state.size());
+}
+#endif
@@ -0,0 +1,49 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef PROCESS_SIGNALS_H
+#define PROCESS_SIGNALS_H
+
+#pragma once
+
+#include <csignal>
+#include <string_view>
+
+// Turns the signals a process supervisor sends into requests the main thread waits for, so shutdown and
+// reload run on an ordinary thread instead of inside a signal handler.
+//
+// On POSIX the signals are blocked rather than handled: the mask is inherited by every thread started
+// afterwards, so construct this before starting any, and wait() takes them with sigwait.
+class ProcessSignals {
+public:
+    enum class Request {
+        Shutdown, // SIGTERM or SIGINT: drain and exit
+        Reload,   // SIGHUP: re-read settings
+    };
+
+    ProcessSignals();
+    ~ProcessSignals(); // Restores the calling thread's mask
+
+    ProcessSignals(const ProcessSignals&) = delete;
+    ProcessSignals& operator=(const ProcessSignals&) = delete;
+
+    // Block until one of the signals arrives
+    Request wait();
+
+    // Tell a systemd-style supervisor about a state change ("READY=1", "RELOADING=1", "STOPPING=1") over
+    // the datagram socket named by $NOTIFY_SOCKET. Returns false when there is none or sending failed.
+    static bool notify(std::string_view state);
+
+    // Make writes to a socket the peer has reset fail with EPIPE instead of killing the process with
+    // SIGPIPE; relays and clients drop connections mid-write. Process-wide, so call it first in main.
+    static void ignoreBrokenPipes();
+
+private:
+#ifndef _WIN32
+    sigset_t previousMask{};
+#endif
+};
+
+#endif // PROCESS_SIGNALS_H
@@ -0,0 +1,61 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "rate_limiter.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+RateLimiter::RateLimiter(const double permitsPerSecond, const double burst)
+    : permitsPerSecond(permitsPerSecond), burst(std::max(1.0, burst)), tokens(this->burst), last(Clock::now()) {
+    if (permitsPerSecond <= 0) {
+        throw std::invalid_argument("RateLimiter needs a positive rate");
+    }
+}
+
+void RateLimiter::refill(const Clock::time_point now) {
+    if (now <= last) {
+        return;
+    }
+    const std::chrono::duration<double> elapsed = now - last;
+    tokens = std::min(burst, tokens + elapsed.count() * permitsPerSecond);
+    last = now;
+}
+
+void RateLimiter::acquire() {
+    Clock::time_point due;
+    {
+        std::lock_guard lock(mutex);
+        const auto now = Clock::now();
+        refill(now);
+        tokens -= 1;
+
+        due = std::max(now, last);
+        if (tokens < 0) {
+            due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens / permitsPerSecond));
+        }
+    }
+    std::this_thread::sleep_until(due);
+}
+
+bool RateLimiter::tryAcquire() {
+    std::lock_guard lock(mutex);
+    const auto now = Clock::now();
+    refill(now);
+    if (now < last || tokens < 1) {
+        return false;
+    }
+    tokens -= 1;
+    return true;
+}
+
+void RateLimiter::pauseUntil(const Clock::time_point until) {
+    std::lock_guard lock(mutex);
+    refill(Clock::now());
+    if (until > last) {
+        last = until;
+        tokens = std::min(tokens, 0.0);
+    }
+}
@@ -0,0 +1,45 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+
+// Token bucket shared by every thread that talks to one API, so concurrent workers stay under
+// a single global request rate. acquire() reserves a token up front and sleeps outside the lock
+// until it is due, which keeps waiters in arrival order without a condition variable.
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    RateLimiter(double permitsPerSecond, double burst);
+
+    // Block until a request may be sent
+    void acquire();
+
+    // Take a token only if one is available right now
+    bool tryAcquire();
+
+    // Stop handing out tokens until the given time, e.g. after a 429 with a reset time
+    void pauseUntil(Clock::time_point until);
+
+    [[nodiscard]] double rate() const { return permitsPerSecond; }
+
+private:
+    const double permitsPerSecond;
+    const double burst;
+
+    std::mutex mutex;
+    double tokens;         // Negative while requests are queued behind the limit
+    Clock::time_point last; // Time tokens were last refilled to; may be in the future after a pause
+
+    void refill(Clock::time_point now);
+};
+
+#endif // RATE_LIMITER_H
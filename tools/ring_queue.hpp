@@ -0,0 +1,149 @@
+//
+// Created by jayian on 2/8/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Point-in-time view of a queue for monitoring
+struct QueueStats {
+    size_t depth = 0;
+    size_t capacity = 0;
+    size_t highWaterMark = 0;
+    uint64_t pushed = 0;
+    uint64_t popped = 0;
+    uint64_t pushStallNs = 0; // Time producers spent blocked at the high-water mark (backpressure)
+    uint64_t popWaitNs = 0;   // Time the consumer spent waiting on an empty queue (starvation)
+    uint64_t consumerParks = 0; // Waits that outlasted spinning and blocked on the condition variable
+};
+
+// Spin, then yield, then sleep in short steps while waiting on the other side of a queue
+class QueueBackoff {
+public:
+    // Spin or yield once; false when both phases are used up and the caller should block instead
+    bool spin();
+
+    // spin(), falling back to a short sleep
+    void pause();
+
+private:
+    uint32_t attempts = 0;
+};
+
+// Where a consumer blocks on an empty queue once spinning has not helped.
+//
+// Parking and publishing each put a full fence between their write and the read of the other side's
+// state, so either the consumer sees the value before it blocks or the producer sees it parked. Producers
+// therefore only take the mutex when their push made the queue non-empty and someone is waiting.
+class QueueParking {
+public:
+    // Block until ready() holds; ready() reads queue state, so it is also checked before locking
+    template <typename Ready>
+    void park(Ready ready);
+
+    // Wake parked consumers; call after a fence that follows the write they are waiting on
+    void wake();
+
+    [[nodiscard]] uint64_t parks() const { return parkCount.load(std::memory_order_relaxed); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::atomic<uint32_t> parked{0};
+    std::atomic<uint64_t> parkCount{0};
+};
+
+// Bounded single-producer single-consumer ring buffer.
+//
+// Producer and consumer each own one index and only read the other's, so a handoff is one release
+// store with no read-modify-write. An idle consumer spins, yields, then parks until a push makes the
+// queue non-empty. Producers block (or tryPush fails) once depth reaches the high-water
+// mark, which is how a stalled stage pushes back on the one before it. T must be default-constructible
+// and movable; slots are reused, so popped values are moved out.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity, size_t highWaterMark = 0);
+
+    // Moves from value only on success
+    bool tryPush(T& value);
+
+    // Blocks while the queue is at its high-water mark; false once closed
+    bool push(T value);
+
+    // Move up to max values onto out; returns how many
+    size_t tryPopBatch(std::vector<T>& out, size_t max);
+
+    // Blocks until a value is available; 0 once the queue is closed and drained
+    size_t popBatch(std::vector<T>& out, size_t max);
+
+    // Wake blocked producers and consumers; values already queued can still be popped
+    void close();
+
+    [[nodiscard]] bool closed() const { return isClosed.load(std::memory_order_acquire); }
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] QueueStats stats() const;
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    size_t highWater;
+
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to pop; written by the consumer
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to push; written by the producer
+    alignas(64) std::atomic<bool> isClosed{false};
+    std::atomic<uint64_t> pushStallNs{0};
+    std::atomic<uint64_t> popWaitNs{0};
+    QueueParking parking;
+};
+
+// Bounded multi-producer single-consumer ring buffer (Vyukov's sequenced-slot design).
+//
+// Producers claim a slot with one compare-and-swap and publish it through the slot's sequence number, so
+// they never wait on each other's writes. Same blocking, parking and high-water behaviour as SpscQueue.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity, size_t highWaterMark = 0);
+
+    bool tryPush(T& value);
+    bool push(T value);
+    size_t tryPopBatch(std::vector<T>& out, size_t max);
+    size_t popBatch(std::vector<T>& out, size_t max);
+    void close();
+
+    [[nodiscard]] bool closed() const { return isClosed.load(std::memory_order_acquire); }
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] QueueStats stats() const;
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    size_t highWater;
+
+    alignas(64) std::atomic<size_t> enqueuePosition{0};
+    alignas(64) std::atomic<size_t> dequeuePosition{0};
+    alignas(64) std::atomic<bool> isClosed{false};
+    std::atomic<uint64_t> pushStallNs{0};
+    std::atomic<uint64_t> popWaitNs{0};
+    QueueParking parking;
+};
+
+#include "ring_queue.tpp"
+#endif // RING_QUEUE_H
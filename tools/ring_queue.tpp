@@ -0,0 +1,281 @@
+#ifndef RING_QUEUE_TPP
+#define RING_QUEUE_TPP
+
+#include <algorithm>
+#include <thread>
+
+inline bool QueueBackoff::spin() {
+    if (attempts < 64) {
+        ++attempts;
+        return true;
+    }
+    if (attempts < 128) {
+        ++attempts;
+        std::this_thread::yield();
+        return true;
+    }
+    return false;
+}
+
+inline void QueueBackoff::pause() {
+    if (!spin()) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+
+template <typename Ready>
+void QueueParking::park(Ready ready) {
+    parked.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready()) {
+        parkCount.fetch_add(1, std::memory_order_relaxed);
+        std::unique_lock lock(mutex);
+        condition.wait(lock, ready);
+    }
+    parked.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void QueueParking::wake() {
+    if (parked.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    // Taking the mutex orders this wake after a consumer's check under it, so the notify cannot fall
+    // between that check and its wait
+    { std::lock_guard lock(mutex); }
+    condition.notify_all();
+}
+
+// Helpers for the queue templates below; not part of their interface
+namespace detail {
+    // Capacity rounded up to a power of two so that slot indices are a mask instead of a division
+    inline size_t ringCapacity(const size_t requested) {
+        size_t capacity = 2;
+        while (capacity < requested) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    inline uint64_t elapsedNs(const std::chrono::steady_clock::time_point since) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+    }
+}
+
+template <typename T>
+SpscQueue<T>::SpscQueue(const size_t capacity, const size_t highWaterMark)
+    : slots(detail::ringCapacity(capacity)), mask(slots.size() - 1),
+      highWater(std::min(highWaterMark == 0 ? std::max<size_t>(capacity, 1) : highWaterMark, slots.size())) {}
+
+template <typename T>
+bool SpscQueue<T>::tryPush(T& value) {
+    const auto position = tail.load(std::memory_order_relaxed);
+    if (position - head.load(std::memory_order_acquire) >= highWater || closed()) {
+        return false;
+    }
+    slots[position & mask] = std::move(value);
+    tail.store(position + 1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (head.load(std::memory_order_relaxed) == position) {
+        parking.wake(); // The queue was empty, so the consumer may be parked
+    }
+    return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::push(T value) {
+    if (tryPush(value)) {
+        return true;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    QueueBackoff backoff;
+    auto pushed = false;
+    while (!closed() && !(pushed = tryPush(value))) {
+        backoff.pause();
+    }
+    pushStallNs.fetch_add(detail::elapsedNs(started), std::memory_order_relaxed);
+    return pushed;
+}
+
+template <typename T>
+size_t SpscQueue<T>::tryPopBatch(std::vector<T>& out, const size_t max) {
+    const auto position = head.load(std::memory_order_relaxed);
+    const auto count = std::min(tail.load(std::memory_order_acquire) - position, max);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(std::move(slots[(position + i) & mask]));
+    }
+    head.store(position + count, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+size_t SpscQueue<T>::popBatch(std::vector<T>& out, const size_t max) {
+    if (const auto count = tryPopBatch(out, max)) {
+        return count;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    QueueBackoff backoff;
+    size_t count;
+    while ((count = tryPopBatch(out, max)) == 0) {
+        if (closed()) {
+            count = tryPopBatch(out, max); // Values pushed just before close
+            break;
+        }
+        if (!backoff.spin()) {
+            parking.park([this] { return size() > 0 || closed(); });
+        }
+    }
+    popWaitNs.fetch_add(detail::elapsedNs(started), std::memory_order_relaxed);
+    return count;
+}
+
+template <typename T>
+void SpscQueue<T>::close() {
+    isClosed.store(true, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    parking.wake();
+}
+
+template <typename T>
+size_t SpscQueue<T>::size() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+template <typename T>
+QueueStats SpscQueue<T>::stats() const {
+    QueueStats result;
+    result.popped = head.load(std::memory_order_acquire);
+    result.pushed = tail.load(std::memory_order_acquire);
+    result.depth = result.pushed - result.popped;
+    result.capacity = slots.size();
+    result.highWaterMark = highWater;
+    result.pushStallNs = pushStallNs.load(std::memory_order_relaxed);
+    result.popWaitNs = popWaitNs.load(std::memory_order_relaxed);
+    result.consumerParks = parking.parks();
+    return result;
+}
+
+template <typename T>
+MpscQueue<T>::MpscQueue(const size_t capacity, const size_t highWaterMark)
+    : slots(std::make_unique<Slot[]>(detail::ringCapacity(capacity))), mask(detail::ringCapacity(capacity) - 1),
+      highWater(std::min(highWaterMark == 0 ? std::max<size_t>(capacity, 1) : highWaterMark, mask + 1)) {
+    for (size_t i = 0; i <= mask; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+// A slot is free for position p when its sequence is p, and holds the value for p once it is p + 1
+template <typename T>
+bool MpscQueue<T>::tryPush(T& value) {
+    auto position = enqueuePosition.load(std::memory_order_relaxed);
+    while (true) {
+        const auto popped = dequeuePosition.load(std::memory_order_acquire);
+        if ((position >= popped && position - popped >= highWater) || closed()) {
+            return false;
+        }
+        auto& slot = slots[position & mask];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                slot.value = std::move(value);
+                slot.sequence.store(position + 1, std::memory_order_release);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (dequeuePosition.load(std::memory_order_relaxed) == position) {
+                    parking.wake(); // The consumer is waiting on exactly this slot
+                }
+                return true;
+            }
+        } else if (difference < 0) {
+            return false; // The consumer has not freed this slot yet
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+template <typename T>
+bool MpscQueue<T>::push(T value) {
+    if (tryPush(value)) {
+        return true;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    QueueBackoff backoff;
+    auto pushed = false;
+    while (!closed() && !(pushed = tryPush(value))) {
+        backoff.pause();
+    }
+    pushStallNs.fetch_add(detail::elapsedNs(started), std::memory_order_relaxed);
+    return pushed;
+}
+
+template <typename T>
+size_t MpscQueue<T>::tryPopBatch(std::vector<T>& out, const size_t max) {
+    auto position = dequeuePosition.load(std::memory_order_relaxed);
+    size_t count = 0;
+    while (count < max) {
+        auto& slot = slots[position & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            break;
+        }
+        out.push_back(std::move(slot.value));
+        slot.sequence.store(position + mask + 1, std::memory_order_release);
+        ++position;
+        ++count;
+    }
+    dequeuePosition.store(position, std::memory_order_release);
+    return count;
+}
+
+template <typename T>
+size_t MpscQueue<T>::popBatch(std::vector<T>& out, const size_t max) {
+    if (const auto count = tryPopBatch(out, max)) {
+        return count;
+    }
+    const auto started = std::chrono::steady_clock::now();
+    QueueBackoff backoff;
+    size_t count;
+    while ((count = tryPopBatch(out, max)) == 0) {
+        if (closed()) {
+            count = tryPopBatch(out, max);
+            break;
+        }
+        if (!backoff.spin()) {
+            parking.park([this] {
+                const auto position = dequeuePosition.load(std::memory_order_relaxed);
+                return slots[position & mask].sequence.load(std::memory_order_acquire) == position + 1 || closed();
+            });
+        }
+    }
+    popWaitNs.fetch_add(detail::elapsedNs(started), std::memory_order_relaxed);
+    return count;
+}
+
+template <typename T>
+void MpscQueue<T>::close() {
+    isClosed.store(true, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    parking.wake();
+}
+
+template <typename T>
+size_t MpscQueue<T>::size() const {
+    const auto popped = dequeuePosition.load(std::memory_order_acquire);
+    const auto claimed = enqueuePosition.load(std::memory_order_acquire);
+    return claimed > popped ? claimed - popped : 0;
+}
+
+template <typename T>
+QueueStats MpscQueue<T>::stats() const {
+    QueueStats result;
+    result.popped = dequeuePosition.load(std::memory_order_acquire);
+    result.pushed = enqueuePosition.load(std::memory_order_acquire);
+    result.depth = result.pushed > result.popped ? result.pushed - result.popped : 0;
+    result.capacity = mask + 1;
+    result.highWaterMark = highWater;
+    result.pushStallNs = pushStallNs.load(std::memory_order_relaxed);
+    result.popWaitNs = popWaitNs.load(std::memory_order_relaxed);
+    result.consumerParks = parking.parks();
+    return result;
+}
+#endif // RING_QUEUE_TPP
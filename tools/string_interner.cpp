@@ -0,0 +1,77 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "string_interner.hpp"
+#include <stdexcept>
+#include "hash.hpp"
+
+StringInterner::StringInterner() : chunks(new std::atomic<Chunk*>[MAX_CHUNKS]) {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+StringInterner::~StringInterner() {
+    for (uint32_t i = 0; i < MAX_CHUNKS; ++i) {
+        delete chunks[i].load(std::memory_order_relaxed);
+    }
+}
+
+uint32_t StringInterner::intern(const std::string_view value) {
+    auto& shard = shards[Hash::bytes(value) % SHARD_COUNT];
+    std::lock_guard lock(shard.mutex);
+
+    if (const auto it = shard.ids.find(value); it != shard.ids.end()) {
+        return it->second;
+    }
+    const auto id = nextId.fetch_add(1, std::memory_order_acq_rel);
+    if (id >= MAX_CHUNKS * CHUNK_SIZE) {
+        throw std::length_error("StringInterner capacity exceeded");
+    }
+    const auto& key = shard.keys.emplace_back(value);
+    shard.ids.emplace(key, id);
+    publish(id, &key); // Deque elements never move, so the key pointer stays valid
+    return id;
+}
+
+std::optional<uint32_t> StringInterner::find(const std::string_view value) const {
+    const auto& shard = shards[Hash::bytes(value) % SHARD_COUNT];
+    std::lock_guard lock(shard.mutex);
+
+    const auto it = shard.ids.find(value);
+    if (it == shard.ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string_view StringInterner::lookup(const uint32_t id) const {
+    if ((id >> CHUNK_BITS) >= MAX_CHUNKS) {
+        return {};
+    }
+    const auto* chunk = chunks[id >> CHUNK_BITS].load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        return {};
+    }
+    const auto* key = (*chunk)[id & (CHUNK_SIZE - 1)].load(std::memory_order_acquire);
+    return key ? std::string_view(*key) : std::string_view{};
+}
+
+void StringInterner::publish(const uint32_t id, const std::string* key) {
+    auto& slot = chunks[id >> CHUNK_BITS];
+    auto* chunk = slot.load(std::memory_order_acquire);
+    if (chunk == nullptr) {
+        std::lock_guard lock(chunkMutex);
+        chunk = slot.load(std::memory_order_acquire);
+        if (chunk == nullptr) {
+            chunk = new Chunk();
+            for (auto& entry : *chunk) {
+                entry.store(nullptr, std::memory_order_relaxed);
+            }
+            slot.store(chunk, std::memory_order_release);
+        }
+    }
+    (*chunk)[id & (CHUNK_SIZE - 1)].store(key, std::memory_order_release);
+}
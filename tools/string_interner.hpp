@@ -0,0 +1,69 @@
+//
+// Created by jayian on 1/9/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef STRING_INTERNER_H
+#define STRING_INTERNER_H
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Thread-safe mapping from strings (post URIs, DIDs) to dense 32-bit ids.
+// Lookups by id are lock-free; interning only locks one of SHARD_COUNT shards.
+class StringInterner {
+public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+    StringInterner();
+    ~StringInterner();
+
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    // Return the id for value, assigning the next free id if it has not been seen
+    uint32_t intern(std::string_view value);
+
+    // Return the id for value without assigning one
+    [[nodiscard]] std::optional<uint32_t> find(std::string_view value) const;
+
+    // Return the string for an id previously returned by intern(); empty for unknown ids
+    [[nodiscard]] std::string_view lookup(uint32_t id) const;
+
+    [[nodiscard]] uint32_t size() const { return nextId.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t SHARD_COUNT = 64;
+    static constexpr uint32_t CHUNK_BITS = 14;
+    static constexpr uint32_t CHUNK_SIZE = 1u << CHUNK_BITS;
+    static constexpr uint32_t MAX_CHUNKS = 1u << 16;
+
+    // Keyed by views of the strings in keys, so lookups by string_view hash the caller's bytes without
+    // copying them (C++17 unordered_map has no heterogeneous find). A deque never moves its elements.
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::deque<std::string> keys;
+        std::unordered_map<std::string_view, uint32_t> ids;
+    };
+
+    using Chunk = std::array<std::atomic<const std::string*>, CHUNK_SIZE>;
+
+    std::array<Shard, SHARD_COUNT> shards;
+    std::unique_ptr<std::atomic<Chunk*>[]> chunks; // id -> key stored in its shard map
+    std::mutex chunkMutex;
+    std::atomic<uint32_t> nextId{0};
+
+    void publish(uint32_t id, const std::string* key);
+};
+
+#endif // STRING_INTERNER_H
@@ -0,0 +1,123 @@
+//
+// Created by jayian on 1/31/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <optional>
+#include <string>
+#include <string_view>
+
+class Timestamp {
+public:
+    // Microseconds since the Unix epoch for an RFC 3339 datetime such as the createdAt of a record,
+    // e.g. "2025-01-31T12:34:56.789Z" or "2025-01-31T12:34:56+02:00"
+    static std::optional<uint64_t> parseIso8601(const std::string_view text) {
+        size_t pos = 0;
+        int64_t year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+        if (!number(text, pos, 4, year) || !expect(text, pos, '-') || !number(text, pos, 2, month) ||
+            !expect(text, pos, '-') || !number(text, pos, 2, day) || pos >= text.size() ||
+            (text[pos] != 'T' && text[pos] != 't' && text[pos] != ' ')) {
+            return std::nullopt;
+        }
+        ++pos;
+        if (!number(text, pos, 2, hour) || !expect(text, pos, ':') || !number(text, pos, 2, minute) ||
+            !expect(text, pos, ':') || !number(text, pos, 2, second)) {
+            return std::nullopt;
+        }
+        if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+            return std::nullopt;
+        }
+
+        int64_t micros = 0;
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            int64_t scale = 100000;
+            for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos) {
+                micros += (text[pos] - '0') * scale;
+                scale /= 10;
+            }
+        }
+
+        int64_t offsetSeconds = 0;
+        if (pos < text.size() && (text[pos] == 'Z' || text[pos] == 'z')) {
+            ++pos;
+        } else if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+            const auto sign = text[pos++] == '-' ? -1 : 1;
+            int64_t offsetHours = 0, offsetMinutes = 0;
+            if (!number(text, pos, 2, offsetHours) || !expect(text, pos, ':') || !number(text, pos, 2, offsetMinutes)) {
+                return std::nullopt;
+            }
+            offsetSeconds = sign * (offsetHours * 3600 + offsetMinutes * 60);
+        } else {
+            return std::nullopt;
+        }
+        if (pos != text.size()) {
+            return std::nullopt;
+        }
+
+        const auto seconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offsetSeconds;
+        if (seconds < 0) {
+            return std::nullopt;
+        }
+        return static_cast<uint64_t>(seconds) * 1'000'000 + static_cast<uint64_t>(micros);
+    }
+
+    // RFC 3339 UTC datetime with milliseconds for microseconds since the Unix epoch, the form records use,
+    // e.g. "2025-01-31T12:34:56.789Z"
+    static std::string formatIso8601(const uint64_t micros) {
+        const auto seconds = static_cast<std::time_t>(micros / 1'000'000);
+        std::tm utc{};
+#ifdef _WIN32
+        gmtime_s(&utc, &seconds);
+#else
+        gmtime_r(&seconds, &utc);
+#endif
+        char text[40];
+        const auto length = std::strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &utc);
+        std::snprintf(text + length, sizeof(text) - length, ".%03uZ", static_cast<unsigned>(micros / 1000 % 1000));
+        return text;
+    }
+
+private:
+    static bool number(const std::string_view text, size_t& pos, const size_t digits, int64_t& value) {
+        if (pos + digits > text.size()) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < digits; ++i, ++pos) {
+            if (text[pos] < '0' || text[pos] > '9') {
+                return false;
+            }
+            value = value * 10 + (text[pos] - '0');
+        }
+        return true;
+    }
+
+    static bool expect(const std::string_view text, size_t& pos, const char c) {
+        if (pos >= text.size() || text[pos] != c) {
+            return false;
+        }
+        ++pos;
+        return true;
+    }
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar (Howard Hinnant's algorithm)
+    static int64_t daysFromCivil(int64_t year, const int64_t month, const int64_t day) {
+        year -= month <= 2;
+        const auto era = (year >= 0 ? year : year - 399) / 400;
+        const auto yearOfEra = year - era * 400;
+        const auto dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468;
+    }
+};
+
+#endif // TIMESTAMP_H
@@ -0,0 +1,179 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#include "tracing.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../nlohmann/json.hpp"
+
+namespace {
+    // The spans of one thread. Only that thread writes; exports read concurrently, like a seqlock: a slot
+    // is trusted only if no span begun by the end of the read could have reused it.
+    struct Ring {
+        struct Slot {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<uint64_t> trace{0};
+            std::atomic<uint64_t> start{0};
+            std::atomic<uint64_t> end{0};
+        };
+
+        uint32_t thread = 0;
+        std::atomic<uint64_t> begun{0};   // Spans whose slot is being or was written
+        std::atomic<uint64_t> written{0}; // Spans ever recorded; the next goes to slots[written % capacity]
+        std::atomic<uint64_t> cleared{0}; // Spans before this were dropped by clear()
+        std::array<Slot, Tracing::RING_CAPACITY> slots;
+
+        void push(const char* name, const uint64_t trace, const uint64_t start, const uint64_t end) {
+            const auto index = written.load(std::memory_order_relaxed);
+            begun.store(index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release); // Pairs with the fence in exportChromeJson
+            auto& slot = slots[index % slots.size()];
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.trace.store(trace, std::memory_order_relaxed);
+            slot.start.store(start, std::memory_order_relaxed);
+            slot.end.store(end, std::memory_order_relaxed);
+            written.store(index + 1, std::memory_order_release);
+        }
+    };
+
+    std::atomic<uint32_t> everyN{0};
+    std::atomic<uint64_t> nextTrace{1};
+
+    std::mutex ringsMutex;
+    std::vector<std::shared_ptr<Ring>> rings; // Kept after their threads exit so their spans can be exported
+
+    thread_local uint64_t currentTrace = 0; // 0 outside a sampled trace
+    thread_local uint32_t tracesStarted = 0;
+
+    // The calling thread's ring, made the first time it records a span
+    Ring& localRing() {
+        thread_local std::shared_ptr<Ring> ring;
+        if (!ring) {
+            auto made = std::make_shared<Ring>();
+            std::lock_guard lock(ringsMutex);
+            made->thread = static_cast<uint32_t>(rings.size() + 1);
+            rings.push_back(made);
+            ring = std::move(made);
+        }
+        return *ring;
+    }
+}
+
+void Tracing::setSampleEvery(const uint32_t n) {
+    everyN.store(n, std::memory_order_relaxed);
+}
+
+uint32_t Tracing::sampleEvery() {
+    return everyN.load(std::memory_order_relaxed);
+}
+
+uint64_t Tracing::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool Tracing::active() {
+    return currentTrace != 0;
+}
+
+void Tracing::record(const char* name, const uint64_t startNs, const uint64_t endNs) {
+    if (currentTrace != 0) {
+        localRing().push(name, currentTrace, startNs, std::max(startNs, endNs));
+    }
+}
+
+std::string Tracing::exportChromeJson() {
+    struct Event {
+        const char* name;
+        uint64_t trace;
+        uint64_t start;
+        uint64_t end;
+        uint32_t thread;
+    };
+
+    std::vector<std::shared_ptr<Ring>> snapshot;
+    {
+        std::lock_guard lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    std::vector<Event> events;
+    for (const auto& ring : snapshot) {
+        const auto written = ring->written.load(std::memory_order_acquire);
+        const auto oldest = std::max(ring->cleared.load(std::memory_order_relaxed),
+                                     written > RING_CAPACITY ? written - RING_CAPACITY : 0);
+        const auto first = events.size();
+        for (auto index = oldest; index < written; ++index) {
+            const auto& slot = ring->slots[index % RING_CAPACITY];
+            events.push_back(Event{slot.name.load(std::memory_order_relaxed),
+                                   slot.trace.load(std::memory_order_relaxed),
+                                   slot.start.load(std::memory_order_relaxed),
+                                   slot.end.load(std::memory_order_relaxed), ring->thread});
+        }
+
+        // Slots below this may have been reused by spans recorded while they were read
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto begun = ring->begun.load(std::memory_order_relaxed);
+        const auto valid = begun > RING_CAPACITY ? begun - RING_CAPACITY : 0;
+        if (valid > oldest) {
+            const auto stale = std::min<uint64_t>(valid - oldest, events.size() - first);
+            events.erase(events.begin() + static_cast<std::ptrdiff_t>(first),
+                         events.begin() + static_cast<std::ptrdiff_t>(first + stale));
+        }
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+    const auto base = events.empty() ? 0 : events.front().start;
+
+    nlohmann::json traceEvents = nlohmann::json::array();
+    for (const auto& event : events) {
+        traceEvents.push_back({
+            {"name", event.name},
+            {"cat", "bluesky_feed"},
+            {"ph", "X"},
+            {"ts", static_cast<double>(event.start - base) / 1e3},
+            {"dur", static_cast<double>(event.end - event.start) / 1e3},
+            {"pid", 1},
+            {"tid", event.thread},
+            {"args", {{"trace", event.trace}}}
+        });
+    }
+    return nlohmann::json{{"traceEvents", std::move(traceEvents)}, {"displayTimeUnit", "ms"}}.dump();
+}
+
+void Tracing::clear() {
+    std::lock_guard lock(ringsMutex);
+    for (const auto& ring : rings) {
+        ring->cleared.store(ring->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+Trace::Trace(const char* name) : name(name) {
+    if (currentTrace != 0) {
+        start = Tracing::now();
+        return;
+    }
+    const auto every = everyN.load(std::memory_order_relaxed);
+    if (every == 0 || tracesStarted++ % every != 0) {
+        return;
+    }
+    currentTrace = nextTrace.fetch_add(1, std::memory_order_relaxed);
+    root = true;
+    start = Tracing::now();
+}
+
+Trace::~Trace() {
+    if (start != 0) {
+        Tracing::record(name, start, Tracing::now());
+    }
+    if (root) {
+        currentTrace = 0;
+    }
+}
@@ -0,0 +1,83 @@
+//
+// Created by jayian on 2/12/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef TRACING_H
+#define TRACING_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Per-request tracing spans, exported as Chrome trace-event JSON (opens in Perfetto and chrome://tracing).
+//
+// A Trace marks the root of one unit of work, e.g. a served request or an outbound call, and decides
+// whether it is sampled; Spans opened on the same thread while a sampled trace is active are recorded
+// with its trace id, and cost one thread-local check otherwise. Each thread records into its own
+// fixed-size ring without locks, so the newest RING_CAPACITY spans of every thread are kept and older
+// ones are overwritten.
+namespace Tracing {
+    constexpr size_t RING_CAPACITY = 4096;
+
+    // Sample one in every n traces started on each thread; 0 turns tracing off (the default)
+    void setSampleEvery(uint32_t n);
+    [[nodiscard]] uint32_t sampleEvery();
+
+    // Nanoseconds on the clock spans are measured with
+    [[nodiscard]] uint64_t now();
+
+    // Whether the calling thread is inside a sampled trace
+    [[nodiscard]] bool active();
+
+    // Record a span that was timed by other means, e.g. from a library callback; a no-op outside a sampled
+    // trace. name must outlive the process, as string literals do.
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+
+    // Every span still held by the rings, as {"traceEvents": [...]} with complete ("X") events
+    [[nodiscard]] std::string exportChromeJson();
+
+    // Drop every recorded span
+    void clear();
+}
+
+// One span, from construction until end() or destruction
+class Span {
+public:
+    explicit Span(const char* name) : name(name), start(Tracing::active() ? Tracing::now() : 0) {}
+    ~Span() { end(); }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+    void end() {
+        if (start != 0) {
+            Tracing::record(name, start, Tracing::now());
+            start = 0;
+        }
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+// The root span of a trace. Inside another trace it is an ordinary span of that trace.
+class Trace {
+public:
+    explicit Trace(const char* name);
+    ~Trace();
+
+    Trace(const Trace&) = delete;
+    Trace& operator=(const Trace&) = delete;
+
+    [[nodiscard]] bool sampled() const { return root; }
+
+private:
+    const char* name;
+    uint64_t start = 0;
+    bool root = false;
+};
+
+#endif // TRACING_H
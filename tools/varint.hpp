@@ -0,0 +1,40 @@
+//
+// Created by jayian on 1/23/25.
+// Copyright (c) 2025 Interlaced Pixel. All rights reserved.
+//
+
+#ifndef VARINT_H
+#define VARINT_H
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Unsigned LEB128 varints, as used by cursors, compressed id lists and CIDs
+class Varint {
+public:
+    static void append(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+
+    // Reads one varint at position and advances it; false on truncated or overlong input
+    static bool read(const std::string_view data, size_t& position, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && position < data.size(); shift += 7) {
+            const auto byte = static_cast<unsigned char>(data[position++]);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // VARINT_H